@@ -0,0 +1,577 @@
+/*
+OpenIO SDS conscience
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <math.h>
+
+#include <metautils/lib/metautils.h>
+#include "expr.h"
+
+/* Deep enough for any sensible score expression. Deeper expressions are
+ * not compiled, and are left to expr_evaluate(). */
+#define EXPR_STACK_MAX 64
+
+/* Large enough for any double printed with "%f" */
+#define EXPR_STRBUF_MAX 512
+
+#define EXPR_NO_STR G_MAXUINT32
+
+enum expr_op_e
+{
+	/* Push <num> */
+	OP_NUM,
+	/* Stop, the expression is undefined */
+	OP_UNDEF,
+	/* Push the string constant <str> on the string stack */
+	OP_STR,
+	/* Push the string value of <slot> on the string stack, or the
+	 * constant <str> if the slot is undefined */
+	OP_STR_SLOT,
+	/* Push the numeric value of <slot>, or <num> if the slot is
+	 * undefined (according to <fallback>) */
+	OP_NUM_SLOT,
+	/* Pop a string, push its length */
+	OP_STRLEN,
+	/* Pop two strings, push 1 if they are equal, 0 otherwise */
+	OP_STREQ,
+	/* Unary operators */
+	OP_CEIL, OP_FLOOR, OP_NOT,
+	/* Binary operators */
+	OP_CMP, OP_EQ, OP_NEQ, OP_LT, OP_LE, OP_GT, OP_GE,
+	OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+	OP_AND, OP_XOR, OP_OR, OP_POW, OP_ROOT,
+	/* Ternary operator */
+	OP_CLAMP,
+};
+
+/* What OP_NUM_SLOT does when its slot is undefined */
+enum expr_fallback_e
+{
+	FB_NONE,    /* no fallback, the expression is undefined */
+	FB_NUM,     /* the fallback is <num> */
+	FB_INVALID, /* the fallback is not a number */
+};
+
+struct expr_op_s
+{
+	guint8 code;
+	guint8 fallback;
+	guint16 slot;
+	guint32 str;
+	double num;
+};
+
+struct expr_prog_s
+{
+	struct expr_op_s *ops;
+	guint ops_count;
+	/* NULL-terminated, the string constants */
+	gchar **strings;
+	/* NULL-terminated, the full names of the accessors */
+	gchar **slots;
+};
+
+#define FPcmp(d1,d2) ((d1) < (d2) ? -1 : ((d1) > (d2) ? 1 : 0))
+
+#define FPBOOL(D) ((D>0.0)||(D<0.0))
+
+/* ------------------------------------------------------------------------- */
+
+int
+expr_compile(struct expr_s *pExpr, const char * const *bases,
+		struct expr_prog_s **pProg)
+{
+	GArray *ops = g_array_new(FALSE, TRUE, sizeof(struct expr_op_s));
+	GPtrArray *strings = g_ptr_array_new();
+	GPtrArray *slots = g_ptr_array_new();
+	/* The depth of both stacks, at the current instruction */
+	guint depth = 0, str_depth = 0;
+
+	void _emit(enum expr_op_e code, double num) {
+		struct expr_op_s op = {.code = code, .str = EXPR_NO_STR, .num = num};
+		g_array_append_val(ops, op);
+	}
+
+	guint32 _intern_str(const char *s) {
+		for (guint i = 0; i < strings->len; i++) {
+			if (!strcmp(s, strings->pdata[i]))
+				return i;
+		}
+		g_ptr_array_add(strings, g_strdup(s));
+		return strings->len - 1;
+	}
+
+	gboolean _known_base(const char *b) {
+		for (const char * const *pb = bases; pb && *pb; pb++) {
+			if (!strcmp(*pb, b))
+				return TRUE;
+		}
+		return FALSE;
+	}
+
+	int _slot(struct expr_s *pE) {
+		gchar *name = g_strconcat(pE->expr.acc.base, ".",
+				pE->expr.acc.field, NULL);
+		for (guint i = 0; i < slots->len; i++) {
+			if (!strcmp(name, slots->pdata[i])) {
+				g_free(name);
+				return i;
+			}
+		}
+		if (slots->len > G_MAXUINT16) {
+			g_free(name);
+			return -1;
+		}
+		g_ptr_array_add(slots, name);
+		return slots->len - 1;
+	}
+
+	gboolean _push(void) {
+		return ++depth <= EXPR_STACK_MAX;
+	}
+
+	/* Mirrors __get_str() in expr_evaluate() */
+	gboolean _compile_str(struct expr_s *pE) {
+		if (!pE || pE->type >= NB_ET)
+			return FALSE;
+		if (++str_depth > 2)
+			return FALSE;
+
+		if (pE->type == VAL_STR_ET) {
+			if (!pE->expr.str)
+				return FALSE;
+			_emit(OP_STR, 0);
+			g_array_index(ops, struct expr_op_s, ops->len - 1).str =
+				_intern_str(pE->expr.str);
+			return TRUE;
+		}
+
+		if (pE->type != ACC_ET) {
+			_emit(OP_UNDEF, 0);
+			return TRUE;
+		}
+
+		if (!pE->expr.acc.base || !pE->expr.acc.field)
+			return FALSE;
+		if (!_known_base(pE->expr.acc.base)) {
+			if (!pE->expr.acc.fallback) {
+				_emit(OP_UNDEF, 0);
+			} else {
+				_emit(OP_STR, 0);
+				g_array_index(ops, struct expr_op_s, ops->len - 1).str =
+					_intern_str(pE->expr.acc.fallback);
+			}
+			return TRUE;
+		}
+
+		const int slot = _slot(pE);
+		if (slot < 0)
+			return FALSE;
+		_emit(OP_STR_SLOT, 0);
+		struct expr_op_s *op = &g_array_index(ops, struct expr_op_s, ops->len - 1);
+		op->slot = slot;
+		if (pE->expr.acc.fallback)
+			op->str = _intern_str(pE->expr.acc.fallback);
+		return TRUE;
+	}
+
+	auto gboolean _compile_num(struct expr_s *pE);
+
+	/* Mirrors the UN_STRNUM_ET case of __main_eval() */
+	gboolean _compile_strnum(struct expr_s *pE) {
+		if (!pE || pE->type >= NB_ET)
+			return FALSE;
+
+		if (pE->type == VAL_NUM_ET) {
+			_emit(OP_NUM, pE->expr.num);
+			return _push();
+		}
+
+		if (pE->type == VAL_STR_ET) {
+			if (!pE->expr.str)
+				return FALSE;
+			char *end = NULL;
+			const double d = strtod(pE->expr.str, &end);
+			if (end == pE->expr.str)
+				_emit(OP_UNDEF, 0);
+			else
+				_emit(OP_NUM, d);
+			return _push();
+		}
+
+		if (pE->type != ACC_ET)
+			return _compile_num(pE);
+
+		if (!pE->expr.acc.base || !pE->expr.acc.field)
+			return FALSE;
+		if (!_known_base(pE->expr.acc.base)) {
+			/* The interpreter leaves the result untouched */
+			_emit(pE->expr.acc.fallback ? OP_NUM : OP_UNDEF, 0);
+			return _push();
+		}
+
+		const int slot = _slot(pE);
+		if (slot < 0)
+			return FALSE;
+		_emit(OP_NUM_SLOT, 0);
+		struct expr_op_s *op = &g_array_index(ops, struct expr_op_s, ops->len - 1);
+		op->slot = slot;
+		op->fallback = FB_NONE;
+		if (pE->expr.acc.fallback) {
+			char *end = NULL;
+			op->num = strtod(pE->expr.acc.fallback, &end);
+			op->fallback = end == pE->expr.acc.fallback ? FB_INVALID : FB_NUM;
+		}
+		return _push();
+	}
+
+	/* Mirrors __main_eval() in expr_evaluate() */
+	gboolean _compile_num(struct expr_s *pE) {
+		if (!pE || pE->type >= NB_ET)
+			return FALSE;
+
+		switch (pE->type) {
+		case VAL_NUM_ET:
+			_emit(OP_NUM, pE->expr.num);
+			return _push();
+		case VAL_STR_ET:
+			if (!pE->expr.str)
+				return FALSE;
+			_emit(OP_NUM, strlen(pE->expr.str));
+			return _push();
+		case ACC_ET:
+		case UN_STRLEN_ET:
+			if (!_compile_str(pE->type == ACC_ET ? pE : pE->expr.unary))
+				return FALSE;
+			_emit(OP_STRLEN, 0);
+			str_depth --;
+			return _push();
+		case UN_STRNUM_ET:
+			return _compile_strnum(pE->expr.unary);
+		case UN_NUMSUP_ET:
+		case UN_NUMINF_ET:
+		case UN_NUMNOT_ET:
+			if (!_compile_num(pE->expr.unary))
+				return FALSE;
+			_emit(pE->type == UN_NUMSUP_ET ? OP_CEIL
+					: (pE->type == UN_NUMINF_ET ? OP_FLOOR : OP_NOT), 0);
+			return TRUE;
+		case BIN_STRCMP_ET:
+			if (!pE->expr.bin.p1 || !pE->expr.bin.p2)
+				return FALSE;
+			if (!_compile_str(pE->expr.bin.p1) || !_compile_str(pE->expr.bin.p2))
+				return FALSE;
+			_emit(OP_STREQ, 0);
+			str_depth -= 2;
+			return _push();
+		case TER_NUMCLAMP_ET:
+			if (!_compile_num(pE->expr.ter.p1)
+					|| !_compile_num(pE->expr.ter.p2)
+					|| !_compile_num(pE->expr.ter.p3))
+				return FALSE;
+			_emit(OP_CLAMP, 0);
+			depth -= 2;
+			return TRUE;
+		case BIN_NUMCMP_ET:
+		case BIN_NUMEQ_ET:
+		case BIN_NUMNEQ_ET:
+		case BIN_NUMLT_ET:
+		case BIN_NUMLE_ET:
+		case BIN_NUMGT_ET:
+		case BIN_NUMGE_ET:
+		case BIN_NUMADD_ET:
+		case BIN_NUMSUB_ET:
+		case BIN_NUMMUL_ET:
+		case BIN_NUMDIV_ET:
+		case BIN_NUMMOD_ET:
+		case BIN_NUMAND_ET:
+		case BIN_NUMXOR_ET:
+		case BIN_NUMOR_ET:
+		case BIN_POW_ET:
+		case BIN_ROOT_ET:
+			if (!_compile_num(pE->expr.bin.p1) || !_compile_num(pE->expr.bin.p2))
+				return FALSE;
+			/* The binary operators follow the same order in both enums */
+			_emit(OP_CMP + (pE->type - BIN_NUMCMP_ET), 0);
+			depth --;
+			return TRUE;
+		case NB_ET:
+			break;
+		}
+		return FALSE;
+	}
+
+	if (!pExpr || !pProg)
+		return EXPR_EVAL_ERROR;
+
+	if (!_compile_num(pExpr)) {
+		g_array_free(ops, TRUE);
+		g_ptr_array_set_free_func(strings, g_free);
+		g_ptr_array_free(strings, TRUE);
+		g_ptr_array_set_free_func(slots, g_free);
+		g_ptr_array_free(slots, TRUE);
+		return EXPR_EVAL_ERROR;
+	}
+
+	struct expr_prog_s *prog = g_malloc0(sizeof(*prog));
+	prog->ops_count = ops->len;
+	prog->ops = (struct expr_op_s*) g_array_free(ops, FALSE);
+	g_ptr_array_add(strings, NULL);
+	prog->strings = (gchar**) g_ptr_array_free(strings, FALSE);
+	g_ptr_array_add(slots, NULL);
+	prog->slots = (gchar**) g_ptr_array_free(slots, FALSE);
+	*pProg = prog;
+	return 0;
+}
+
+void
+expr_prog_clean(struct expr_prog_s *pProg)
+{
+	if (!pProg)
+		return;
+	g_free(pProg->ops);
+	g_strfreev(pProg->strings);
+	g_strfreev(pProg->slots);
+	g_free(pProg);
+}
+
+unsigned int
+expr_prog_count_slots(const struct expr_prog_s *pProg)
+{
+	EXTRA_ASSERT(pProg != NULL);
+	return g_strv_length(pProg->slots);
+}
+
+const char *
+expr_prog_get_slot(const struct expr_prog_s *pProg, unsigned int slot)
+{
+	EXTRA_ASSERT(pProg != NULL);
+	EXTRA_ASSERT(slot < expr_prog_count_slots(pProg));
+	return pProg->slots[slot];
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The value of the tag, formatted like the accessors of the conscience do.
+ * NULL if the tag has no value. */
+static const char *
+_tag_to_str(const struct service_tag_s *tag, char *buf, gsize len)
+{
+	if (!tag)
+		return NULL;
+	switch (tag->type) {
+	case STVT_I64:
+		g_snprintf(buf, len, "%"G_GINT64_FORMAT, tag->value.i);
+		return buf;
+	case STVT_REAL:
+		g_snprintf(buf, len, "%f", tag->value.r);
+		return buf;
+	case STVT_BOOL:
+		return tag->value.b ? "1" : "0";
+	case STVT_STR:
+		return tag->value.s;
+	case STVT_BUF:
+		return tag->value.buf;
+	}
+	return NULL;
+}
+
+/* Returns EXPR_EVAL_UNDEF if the tag has no value, EXPR_EVAL_ERROR if its
+ * value is not a number. */
+static int
+_tag_to_num(const struct service_tag_s *tag, double *pD)
+{
+	const char *s = NULL;
+	if (!tag)
+		return EXPR_EVAL_UNDEF;
+	switch (tag->type) {
+	case STVT_I64:
+		*pD = tag->value.i;
+		return EXPR_EVAL_DEF;
+	case STVT_REAL:
+		*pD = tag->value.r;
+		return EXPR_EVAL_DEF;
+	case STVT_BOOL:
+		*pD = tag->value.b ? 1 : 0;
+		return EXPR_EVAL_DEF;
+	case STVT_STR:
+		s = tag->value.s;
+		break;
+	case STVT_BUF:
+		s = tag->value.buf;
+		break;
+	}
+	if (!s)
+		return EXPR_EVAL_UNDEF;
+	char *end = NULL;
+	*pD = strtod(s, &end);
+	return end == s ? EXPR_EVAL_ERROR : EXPR_EVAL_DEF;
+}
+
+int
+expr_prog_evaluate(double *pResult, const struct expr_prog_s *pProg,
+		const struct service_tag_s * const *slots)
+{
+	double stack[EXPR_STACK_MAX];
+	guint sp = 0;
+	const char *str[2];
+	char str_buf[2][EXPR_STRBUF_MAX];
+	guint ssp = 0;
+	double d1, d2, d3;
+	int ret;
+
+	if (!pResult || !pProg)
+		return EXPR_EVAL_ERROR;
+
+	for (guint i = 0; i < pProg->ops_count; i++) {
+		const struct expr_op_s *op = pProg->ops + i;
+		switch (op->code) {
+		case OP_NUM:
+			stack[sp++] = op->num;
+			continue;
+		case OP_UNDEF:
+			return EXPR_EVAL_UNDEF;
+		case OP_STR:
+			str[ssp++] = pProg->strings[op->str];
+			continue;
+		case OP_STR_SLOT:
+			str[ssp] = _tag_to_str(slots[op->slot],
+					str_buf[ssp], EXPR_STRBUF_MAX);
+			if (!str[ssp]) {
+				if (op->str == EXPR_NO_STR)
+					return EXPR_EVAL_UNDEF;
+				str[ssp] = pProg->strings[op->str];
+			}
+			ssp ++;
+			continue;
+		case OP_NUM_SLOT:
+			ret = _tag_to_num(slots[op->slot], stack + sp);
+			if (ret == EXPR_EVAL_ERROR)
+				return EXPR_EVAL_UNDEF;
+			if (ret == EXPR_EVAL_UNDEF) {
+				if (op->fallback == FB_NUM) {
+					stack[sp] = op->num;
+				} else if (op->fallback == FB_INVALID) {
+					return EXPR_EVAL_UNDEF;
+				} else {
+					VARIABLE_PERIOD_DECLARE();
+					if (VARIABLE_PERIOD_SKIP(60)) {
+						GRID_DEBUG("%s is missing", pProg->slots[op->slot]);
+					} else {
+						/* once per minute */
+						GRID_WARN("%s is missing", pProg->slots[op->slot]);
+					}
+					return EXPR_EVAL_UNDEF;
+				}
+			}
+			sp ++;
+			continue;
+		case OP_STRLEN:
+			stack[sp++] = strlen(str[--ssp]);
+			continue;
+		case OP_STREQ:
+			ssp -= 2;
+			stack[sp++] = (strcmp(str[0], str[1]) == 0);
+			continue;
+		case OP_CEIL:
+			stack[sp-1] = ceil(stack[sp-1]);
+			continue;
+		case OP_FLOOR:
+			stack[sp-1] = floor(stack[sp-1]);
+			continue;
+		case OP_NOT:
+			stack[sp-1] = ((int) stack[sp-1]) ? 0 : 1;
+			continue;
+		case OP_CLAMP:
+			sp -= 2;
+			d1 = stack[sp-1];
+			d2 = stack[sp];
+			d3 = stack[sp+1];
+			stack[sp-1] = CLAMP(d1, d2, d3);
+			continue;
+		}
+
+		/* Binary operators */
+		sp --;
+		d1 = stack[sp-1];
+		d2 = stack[sp];
+		double *pD = stack + sp - 1;
+		switch (op->code) {
+		case OP_CMP:
+			*pD = FPcmp(d1, d2);
+			break;
+		case OP_EQ:
+			*pD = FPcmp(d1, d2) == 0;
+			break;
+		case OP_NEQ:
+			*pD = FPcmp(d1, d2) != 0;
+			break;
+		case OP_LT:
+			*pD = FPcmp(d1, d2) < 0;
+			break;
+		case OP_LE:
+			*pD = FPcmp(d1, d2) <= 0;
+			break;
+		case OP_GT:
+			*pD = FPcmp(d1, d2) > 0;
+			break;
+		case OP_GE:
+			*pD = FPcmp(d1, d2) >= 0;
+			break;
+		case OP_ADD:
+		case OP_OR:
+			*pD = d1 + d2;
+			break;
+		case OP_SUB:
+			*pD = d1 - d2;
+			break;
+		case OP_MUL:
+			*pD = d1 * d2;
+			break;
+		case OP_DIV:
+			*pD = FPcmp(d2, 0) == 0 ? 0 : d1 / d2;
+			break;
+		case OP_MOD:
+			if (FPcmp(d1, 0) < 0 || FPcmp(d2, 0) < 0)
+				*pD = 0;
+			else
+				*pD = (double) ((int) d1 % (int) d2);
+			break;
+		case OP_AND:
+			*pD = FPBOOL(d1) && FPBOOL(d2);
+			break;
+		case OP_XOR:
+			*pD = (int) d1 ^ (int) d2;
+			break;
+		case OP_POW:
+		case OP_ROOT:
+			if (FPcmp(d1, 0) == 0)
+				return EXPR_EVAL_UNDEF;
+			if (FPcmp(d2, 0) == 0)
+				*pD = 0.0;
+			else
+				*pD = pow(d2, op->code == OP_POW ? d1 : 1 / d1);
+			break;
+		default:
+			return EXPR_EVAL_ERROR;
+		}
+	}
+
+	EXTRA_ASSERT(sp == 1);
+	*pResult = stack[0];
+	return EXPR_EVAL_DEF;
+}
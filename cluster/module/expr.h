@@ -94,4 +94,29 @@ int expr_parse(const char *pBuf, struct expr_s **pE);
 
 int expr_evaluate(double *pResult, struct expr_s *pExpr, env_f pEnv);
 
+/* An expression compiled to a flat stack bytecode. The accessors it uses
+ * are numbered, and the caller resolves them before each evaluation. */
+struct expr_prog_s;
+
+struct service_tag_s;
+
+/* <bases> is the NULL-terminated list of the accessor bases known by the
+ * environment, e.g. "stat" and "tag". Returns 0 on success. */
+int expr_compile(struct expr_s *pExpr, const char * const *bases,
+		struct expr_prog_s **pProg);
+
+void expr_prog_clean(struct expr_prog_s *pProg);
+
+/* How many distinct accessors the program uses */
+unsigned int expr_prog_count_slots(const struct expr_prog_s *pProg);
+
+/* The full name of an accessor, e.g. "stat.cpu" */
+const char * expr_prog_get_slot(const struct expr_prog_s *pProg,
+		unsigned int slot);
+
+/* <slots> holds the resolved accessors, in the order of the slots, NULL
+ * for the undefined ones. Same return codes as expr_evaluate(). */
+int expr_prog_evaluate(double *pResult, const struct expr_prog_s *pProg,
+		const struct service_tag_s * const *slots);
+
 #endif /*OIO_SDS__metautils__lib__expr_h*/
@@ -50,6 +50,10 @@ License along with this library.
 
 # define TIME_DEFAULT_ALERT_LIMIT 300L
 
+/* How many removals are remembered per service type, for the clients
+ * polling the changes. Beyond, the clients reload the whole list. */
+# define MAX_REMOVED_SERVICES 1024
+
 # define EXPR_DEFAULT_META0 "100"
 # define EXPR_DEFAULT_META1 "root(2,((num stat.cpu)*(num stat.io)))"
 # define EXPR_DEFAULT_META2 "root(2,((num stat.cpu)*(num stat.io)))"
@@ -109,6 +113,10 @@ static GHashTable *full_srv_list_cache = NULL;
 static GThread *srv_cache_thread = NULL;
 static gint64 srv_cache_interval = 250 * G_TIME_SPAN_MILLISECOND;
 
+/* Changes at each start, so that the clients do not mix the generations
+ * of several consciences, or of several runs of the same. */
+static guint64 srv_generation_epoch = 0;
+
 static gchar *statsd_host = NULL;
 static gint statsd_port = 8125;
 
@@ -127,7 +135,12 @@ struct conscience_srv_s {
 
 	struct conscience_srvtype_s *srvtype;
 	GPtrArray *tags;
+	/* Indexed by the tag slots of the service type, points into <tags> */
+	struct service_tag_s **tag_slots;
+	guint tag_slots_len;
 	GByteArray *cache;
+	/* The generation of the type when <cache> last changed */
+	guint64 generation;
 
 	score_t put_score;
 	score_t get_score;
@@ -158,8 +171,27 @@ struct conscience_srvtype_s
 	gchar *get_score_expr_str;
 	struct expr_s *put_score_expr;
 	struct expr_s *get_score_expr;
+	/* Compiled versions of the expressions above, NULL when an expression
+	 * could not be compiled and must be interpreted. */
+	struct expr_prog_s *put_score_prog;
+	struct expr_prog_s *get_score_prog;
+	/* The tag slot of each accessor of the compiled expressions */
+	guint *put_score_slots;
+	guint *get_score_slots;
+	/* The names of the tags of the services of this type, interned.
+	 * Maps a name to its slot in conscience_srv_s, plus one. */
+	GHashTable *tag_slots_ht;
+	guint tag_slots_count;
 	GHashTable *services_ht;  /**<Maps (addr_info_t*) to (conscience_srv_s*)*/
 
+	/* Bumped each time a service changes or disappears, so that the clients
+	 * only fetch what changed since the generation they already know. */
+	guint64 generation;
+	/* The last removals (struct conscience_removal_s), oldest first. Those
+	 * up to <removed_floor> have been forgotten. */
+	GQueue *removed;
+	guint64 removed_floor;
+
 	GRWLock rw_lock;
 
 	time_t alert_frequency_limit;
@@ -172,8 +204,82 @@ struct conscience_srvtype_s
 	gchar type_name[LIMIT_LENGTH_SRVTYPE];
 };
 
+struct conscience_removal_s
+{
+	guint64 generation;
+	addr_info_t addr;
+};
+
 typedef gboolean (service_callback_f) (struct conscience_srv_s * srv, gpointer udata);
 
+/* The slots interned by every service type, in that order */
+enum conscience_tag_slot_e
+{
+	TAG_SLOT_UP,
+	TAG_SLOT_LOCK,
+	TAG_SLOT_PUT_LOCK,
+	TAG_SLOT_GET_LOCK,
+	TAG_SLOT_FIXED
+};
+
+static guint
+conscience_srvtype_intern_tag(struct conscience_srvtype_s *srvtype,
+		const gchar *name)
+{
+	gpointer p = g_hash_table_lookup(srvtype->tag_slots_ht, name);
+	if (p)
+		return GPOINTER_TO_UINT(p) - 1;
+	const guint slot = srvtype->tag_slots_count ++;
+	g_hash_table_insert(srvtype->tag_slots_ht, g_strdup(name),
+			GUINT_TO_POINTER(slot + 1));
+	return slot;
+}
+
+static struct service_tag_s *
+conscience_srv_get_tag_slot(struct conscience_srv_s *service, guint slot)
+{
+	return slot < service->tag_slots_len ? service->tag_slots[slot] : NULL;
+}
+
+/* The name is only used when the tag is created */
+static struct service_tag_s *
+conscience_srv_ensure_tag_slot(struct conscience_srv_s *service, guint slot,
+		const gchar *name)
+{
+	if (slot >= service->tag_slots_len) {
+		const guint len = MAX(slot + 1, service->srvtype->tag_slots_count);
+		service->tag_slots = g_renew(struct service_tag_s*,
+				service->tag_slots, len);
+		memset(service->tag_slots + service->tag_slots_len, 0,
+				(len - service->tag_slots_len) * sizeof(struct service_tag_s*));
+		service->tag_slots_len = len;
+	}
+	struct service_tag_s *tag = service->tag_slots[slot];
+	if (!tag) {
+		tag = g_malloc0(sizeof(struct service_tag_s));
+		g_strlcpy(tag->name, name, sizeof(tag->name));
+		tag->type = STVT_BOOL;
+		tag->value.b = FALSE;
+		g_ptr_array_add(service->tags, tag);
+		service->tag_slots[slot] = tag;
+	}
+	return tag;
+}
+
+/* Most of the values do not change between two registrations, the string
+ * already allocated is kept. */
+static void
+conscience_srv_update_tag(struct service_tag_s *dst, struct service_tag_s *src)
+{
+	if (dst->type == STVT_STR && dst->value.s) {
+		const gchar *s = src->type == STVT_STR ? src->value.s
+			: (src->type == STVT_BUF ? src->value.buf : NULL);
+		if (s && !strcmp(s, dst->value.s))
+			return;
+	}
+	service_tag_copy(dst, src);
+}
+
 static void
 conscience_srv_clear_tags(struct conscience_srv_s *service)
 {
@@ -182,6 +288,9 @@ conscience_srv_clear_tags(struct conscience_srv_s *service)
 		service_tag_destroy(tag);
 		g_ptr_array_remove_index_fast(service->tags, 0);
 	}
+	if (service->tag_slots_len)
+		memset(service->tag_slots, 0,
+				service->tag_slots_len * sizeof(struct service_tag_s*));
 }
 
 static void
@@ -195,6 +304,7 @@ conscience_srv_destroy(struct conscience_srv_s *service)
 		conscience_srv_clear_tags(service);
 		g_ptr_array_free(service->tags, TRUE);
 	}
+	g_free(service->tag_slots);
 
 	if (service->cache) {
 		GByteArray *gba = service->cache;
@@ -259,11 +369,26 @@ conscience_srv_compute_score(struct conscience_srv_s *service, enum score_type_e
 		}
 	}
 
-	gboolean compute_score(gint32 *pResult, struct expr_s *pExpr, gint32 old_score)
+	/* The accessors of the program are resolved by their tag slot, and the
+	 * values are read in place, without formatting them into strings. */
+	int evaluate(gdouble *pD, struct expr_prog_s *prog, const guint *map) {
+		const guint count = expr_prog_count_slots(prog);
+		const struct service_tag_s *slots[count + 1];
+		for (guint i = 0; i < count; i++) {
+			slots[i] = conscience_srv_get_tag_slot(service, map[i]);
+			if (!slots[i])
+				GRID_DEBUG("[%s/%s/] Undefined tag wanted: %s", nsinfo->name,
+						srvtype->type_name, expr_prog_get_slot(prog, i));
+		}
+		return expr_prog_evaluate(pD, prog, slots);
+	}
+
+	gboolean compute_score(gint32 *pResult, struct expr_s *pExpr,
+			struct expr_prog_s *prog, const guint *map, gint32 old_score)
 	{
 		EXTRA_ASSERT(pExpr != NULL);
 		gdouble d = 0.0;
-		if (expr_evaluate(&d, pExpr, getAcc))
+		if (prog ? evaluate(&d, prog, map) : expr_evaluate(&d, pExpr, getAcc))
 			return FALSE;
 
 		gint32 current = isnan(d) ? 0 : floor(d);
@@ -285,10 +410,14 @@ conscience_srv_compute_score(struct conscience_srv_s *service, enum score_type_e
 
 	gboolean ret = TRUE;
 	if (score_type & PUT && !service->put_locked) {
-		ret = compute_score(&service->put_score.value, srvtype->put_score_expr, service->put_score.value);
+		ret = compute_score(&service->put_score.value, srvtype->put_score_expr,
+				srvtype->put_score_prog, srvtype->put_score_slots,
+				service->put_score.value);
 	}
 	if (score_type & GET && !service->get_locked) {
-		ret &= compute_score(&service->get_score.value, srvtype->get_score_expr, service->get_score.value);
+		ret &= compute_score(&service->get_score.value, srvtype->get_score_expr,
+				srvtype->get_score_prog, srvtype->get_score_slots,
+				service->get_score.value);
 	}
 	return ret;
 }
@@ -362,11 +491,33 @@ _conscience_srv_serialize(struct conscience_srv_s *srv)
 	return gba;
 }
 
+/* Only one thread mutates the services at once, under the writer lock.
+ * The generation of the service is set before the new generation of the
+ * type is published to the readers. */
+static void
+conscience_srv_touch(struct conscience_srv_s *srv)
+{
+	struct conscience_srvtype_s *srvtype = srv->srvtype;
+	const guint64 gen = srvtype->generation + 1;
+	__atomic_store_n(&srv->generation, gen, __ATOMIC_RELAXED);
+	__atomic_store_n(&srvtype->generation, gen, __ATOMIC_RELEASE);
+}
+
+/* The new serialized form is published before the generation: a reader
+ * that gets the new generation also gets the new form, otherwise the next
+ * delta (since that generation) would skip the service. */
 static void
 _conscience_srv_prepare_cache(struct conscience_srv_s *srv)
 {
-	conscience_srv_clean_udata(srv);
-	srv->cache = _conscience_srv_serialize(srv);
+	GByteArray *gba = _conscience_srv_serialize(srv);
+	GByteArray *old = srv->cache;
+	const gboolean changed = !old || old->len != gba->len
+			|| memcmp(old->data, gba->data, gba->len);
+	__atomic_store_n(&srv->cache, gba, __ATOMIC_RELEASE);
+	if (old)
+		g_byte_array_unref(old);
+	if (changed)
+		conscience_srv_touch(srv);
 #ifdef HAVE_ENBUG
 	g_usleep(cs_enbug_serialize_delay);
 #endif
@@ -378,6 +529,27 @@ hash_service_id(gconstpointer p)
 	return djb_hash_buf(p, sizeof(addr_info_t));
 }
 
+static struct expr_prog_s *
+_compile_expression(struct conscience_srvtype_s *srvtype,
+		struct expr_s *pE, const gchar *expr_str, guint **pmap)
+{
+	static const char * const bases[] = {"stat", "tag", NULL};
+	struct expr_prog_s *prog = NULL;
+	if (expr_compile(pE, bases, &prog)) {
+		GRID_WARN("Expression '%s' will be interpreted, it cannot be compiled",
+				expr_str);
+		*pmap = NULL;
+		return NULL;
+	}
+	const guint count = expr_prog_count_slots(prog);
+	guint *map = g_malloc0((count + 1) * sizeof(guint));
+	for (guint i = 0; i < count; i++)
+		map[i] = conscience_srvtype_intern_tag(srvtype,
+				expr_prog_get_slot(prog, i));
+	*pmap = map;
+	return prog;
+}
+
 static gboolean
 conscience_srvtype_set_type_expression(struct conscience_srvtype_s * srvtype,
 	GError ** err, const gchar * expr_str, enum score_type_e score_type)
@@ -399,8 +571,12 @@ conscience_srvtype_set_type_expression(struct conscience_srvtype_s * srvtype,
 			g_free(srvtype->put_score_expr_str);
 		if (srvtype->put_score_expr)
 			expr_clean(srvtype->put_score_expr);
+		expr_prog_clean(srvtype->put_score_prog);
+		g_free(srvtype->put_score_slots);
 		srvtype->put_score_expr_str = g_strdup(expr_str);
 		srvtype->put_score_expr = pE;
+		srvtype->put_score_prog = _compile_expression(srvtype, pE, expr_str,
+				&srvtype->put_score_slots);
 	}
 	if (score_type & GET)
 	{
@@ -415,8 +591,12 @@ conscience_srvtype_set_type_expression(struct conscience_srvtype_s * srvtype,
 			g_free(srvtype->get_score_expr_str);
 		if (srvtype->get_score_expr)
 			expr_clean(srvtype->get_score_expr);
+		expr_prog_clean(srvtype->get_score_prog);
+		g_free(srvtype->get_score_slots);
 		srvtype->get_score_expr_str = g_strdup(expr_str);
 		srvtype->get_score_expr = pE;
+		srvtype->get_score_prog = _compile_expression(srvtype, pE, expr_str,
+				&srvtype->get_score_slots);
 	}
 	return TRUE;
 }
@@ -425,11 +605,19 @@ static void
 conscience_srvtype_init(struct conscience_srvtype_s *srvtype)
 {
 	EXTRA_ASSERT(srvtype != NULL);
+	srvtype->tag_slots_ht = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, NULL);
+	conscience_srvtype_intern_tag(srvtype, NAME_TAGNAME_UP);
+	conscience_srvtype_intern_tag(srvtype, NAME_TAGNAME_LOCK);
+	conscience_srvtype_intern_tag(srvtype, NAME_TAGNAME_PUT_LOCK);
+	conscience_srvtype_intern_tag(srvtype, NAME_TAGNAME_GET_LOCK);
+	EXTRA_ASSERT(srvtype->tag_slots_count == TAG_SLOT_FIXED);
 	conscience_srvtype_set_type_expression(srvtype, NULL, "100", PUT | GET);
 	srvtype->alert_frequency_limit = TIME_DEFAULT_ALERT_LIMIT;
 	srvtype->score_expiration = 300;
 	srvtype->score_variation_bound = 5;
 	srvtype->lock_at_first_register = TRUE;
+	srvtype->removed = g_queue_new();
 	g_rw_lock_init(&srvtype->rw_lock);
 }
 
@@ -467,6 +655,13 @@ conscience_srvtype_flush(struct conscience_srvtype_s *srvtype)
 		counter++;
 	}
 
+	/* Too many removals to remember them, the clients reload everything */
+	const guint64 gen = srvtype->generation + 1;
+	while (!g_queue_is_empty(srvtype->removed))
+		g_free(g_queue_pop_head(srvtype->removed));
+	srvtype->removed_floor = gen;
+	__atomic_store_n(&srvtype->generation, gen, __ATOMIC_RELEASE);
+
 	GRID_DEBUG("Service type [%s] flushed, [%u] services removed",
 		srvtype->type_name, counter);
 }
@@ -481,14 +676,22 @@ conscience_srvtype_destroy(struct conscience_srvtype_s *srvtype)
 
 	if (srvtype->services_ht)
 		g_hash_table_destroy(srvtype->services_ht);
+	if (srvtype->tag_slots_ht)
+		g_hash_table_destroy(srvtype->tag_slots_ht);
+	if (srvtype->removed)
+		g_queue_free_full(srvtype->removed, g_free);
 	if (srvtype->put_score_expr)
 		expr_clean(srvtype->put_score_expr);
+	expr_prog_clean(srvtype->put_score_prog);
+	g_free(srvtype->put_score_slots);
 	if (srvtype->put_score_expr_str) {
 		*(srvtype->put_score_expr_str) = '\0';
 		g_free(srvtype->put_score_expr_str);
 	}
 	if (srvtype->get_score_expr)
 		expr_clean(srvtype->get_score_expr);
+	expr_prog_clean(srvtype->get_score_prog);
+	g_free(srvtype->get_score_slots);
 	if (srvtype->get_score_expr_str) {
 		*(srvtype->get_score_expr_str) = '\0';
 		g_free(srvtype->get_score_expr_str);
@@ -516,6 +719,19 @@ conscience_srvtype_remove_srv(struct conscience_srvtype_s *srvtype,
 		srv->next->prev = srv->prev;
 		srv->next = srv->prev = NULL;
 		conscience_srv_destroy(srv);
+
+		/* Remember the removal for the clients polling the changes */
+		struct conscience_removal_s *removal = g_malloc(sizeof(*removal));
+		removal->generation = srvtype->generation + 1;
+		memcpy(&removal->addr, srvid, sizeof(addr_info_t));
+		g_queue_push_tail(srvtype->removed, removal);
+		while (g_queue_get_length(srvtype->removed) > MAX_REMOVED_SERVICES) {
+			struct conscience_removal_s *old = g_queue_pop_head(srvtype->removed);
+			srvtype->removed_floor = old->generation;
+			g_free(old);
+		}
+		__atomic_store_n(&srvtype->generation, removal->generation,
+				__ATOMIC_RELEASE);
 	}
 }
 
@@ -530,6 +746,8 @@ conscience_srvtype_register_srv(struct conscience_srvtype_s *srvtype,
 	memcpy(&(service->addr), srvid, sizeof(addr_info_t));
 	service->tags_mtime = 0;
 	service->tags = g_ptr_array_new();
+	service->tag_slots_len = srvtype->tag_slots_count;
+	service->tag_slots = g_new0(struct service_tag_s*, service->tag_slots_len);
 	service->lock_mtime = 0;
 	service->put_locked = FALSE;
 	service->put_score.timestamp = 0;
@@ -585,8 +803,8 @@ conscience_srvtype_zero_expired(struct conscience_srvtype_s * srvtype,
 				p_srv->get_score.timestamp = now;
 			}
 			p_srv->tags_mtime = now * G_TIME_SPAN_SECOND;
-			struct service_tag_s *tag =
-					service_info_ensure_tag(p_srv->tags, NAME_TAGNAME_UP);
+			struct service_tag_s *tag = conscience_srv_ensure_tag_slot(
+					p_srv, TAG_SLOT_UP, NAME_TAGNAME_UP);
 			service_tag_set_value_boolean(tag, FALSE);
 			_conscience_srv_prepare_cache(p_srv);
 			if (callback)
@@ -735,9 +953,9 @@ conscience_srvtype_refresh(struct conscience_srvtype_s *srvtype, struct service_
 			if (tag == tag_first) continue;
 
 			tags_updated = TRUE;
-			struct service_tag_s *orig =
-				service_info_ensure_tag(p_srv->tags, tag->name);
-			service_tag_copy(orig, tag);
+			const guint slot = conscience_srvtype_intern_tag(srvtype, tag->name);
+			conscience_srv_update_tag(
+					conscience_srv_ensure_tag_slot(p_srv, slot, tag->name), tag);
 		}
 	}
 	if (tags_updated) {
@@ -752,18 +970,18 @@ conscience_srvtype_refresh(struct conscience_srvtype_s *srvtype, struct service_
 
 	/* Set a tag to reflect the locked/unlocked state of the service.
 	 * Modifying service_info_s would cause upgrade issues. */
-	struct service_tag_s *lock_tag = service_info_ensure_tag(
-			p_srv->tags, NAME_TAGNAME_LOCK);
+	struct service_tag_s *lock_tag = conscience_srv_ensure_tag_slot(
+			p_srv, TAG_SLOT_LOCK, NAME_TAGNAME_LOCK);
 	if (p_srv->put_locked && p_srv->get_locked) {
 		service_tag_set_value_boolean(lock_tag, TRUE);
 	} else {
 		service_tag_set_value_boolean(lock_tag, FALSE);
 	}
-	struct service_tag_s *put_lock_tag = service_info_ensure_tag(
-			p_srv->tags, NAME_TAGNAME_PUT_LOCK);
+	struct service_tag_s *put_lock_tag = conscience_srv_ensure_tag_slot(
+			p_srv, TAG_SLOT_PUT_LOCK, NAME_TAGNAME_PUT_LOCK);
 	service_tag_set_value_boolean(put_lock_tag, p_srv->put_locked);
-	struct service_tag_s *get_lock_tag = service_info_ensure_tag(
-			p_srv->tags, NAME_TAGNAME_GET_LOCK);
+	struct service_tag_s *get_lock_tag = conscience_srv_ensure_tag_slot(
+			p_srv, TAG_SLOT_GET_LOCK, NAME_TAGNAME_GET_LOCK);
 	service_tag_set_value_boolean(get_lock_tag, p_srv->get_locked);
 
 	return p_srv;
@@ -881,21 +1099,29 @@ _et_bim_cest_dans_le_hub (gchar *m)
 			send_hub_stat("sent", m[0], EMSGSIZE);
 		} else {
 			GRID_TRACE2("HUB: published 1 action / %d bytes", rc);
-			int mlen = strlen(m+1);
-			rc = zmq_send(hub_zpub, m+1, mlen, ZMQ_DONTWAIT);
-			if (rc < 0) {
-				GRID_WARN("HUB: failed to publish service: (%d) %s",
-						errno, strerror(errno));
-				send_hub_stat("sent", m[0], errno);
-			} else if (rc != mlen) {
-				GRID_WARN("HUB: failed to publish service: "
-						"unexpected number of bytes sent: %d (expected=%d)",
-						rc, mlen);
-				send_hub_stat("sent", m[0], EMSGSIZE);
-			} else {
-				GRID_TRACE2("HUB: published 1 service / %d bytes", rc);
-				send_hub_stat("sent", m[0], 0);
-			}
+			const gchar *part = m+1;
+			do {
+				const int mlen = strlen(part);
+				const gchar *next = part + mlen + 1;
+				rc = zmq_send(hub_zpub, part, mlen,
+						ZMQ_DONTWAIT | (*next ? ZMQ_SNDMORE : 0));
+				if (rc < 0) {
+					GRID_WARN("HUB: failed to publish service: (%d) %s",
+							errno, strerror(errno));
+					send_hub_stat("sent", m[0], errno);
+					break;
+				} else if (rc != mlen) {
+					GRID_WARN("HUB: failed to publish service: "
+							"unexpected number of bytes sent: %d (expected=%d)",
+							rc, mlen);
+					send_hub_stat("sent", m[0], EMSGSIZE);
+					break;
+				} else {
+					GRID_TRACE2("HUB: published 1 service / %d bytes", rc);
+					send_hub_stat("sent", m[0], 0);
+				}
+				part = next;
+			} while (*part);
 		}
 	}
 	g_free (m);
@@ -1015,16 +1241,18 @@ conscience_srvtype_refresh_dated(
 
 		/* Set a tag to reflect the locked/unlocked state of the service.
 		 * Modifying service_info_s would cause upgrade issues. */
-		struct service_tag_s *lock_tag = service_info_ensure_tag(
-				p_srv->tags, NAME_TAGNAME_LOCK);
+		struct service_tag_s *lock_tag = conscience_srv_ensure_tag_slot(
+				p_srv, TAG_SLOT_LOCK, NAME_TAGNAME_LOCK);
 		if (p_srv->put_locked && p_srv->get_locked) {
 			service_tag_set_value_boolean(lock_tag, TRUE);
 		} else {
 			service_tag_set_value_boolean(lock_tag, FALSE);
 		}
-		tag_put_lock = service_info_ensure_tag(p_srv->tags, NAME_TAGNAME_PUT_LOCK);
+		tag_put_lock = conscience_srv_ensure_tag_slot(
+				p_srv, TAG_SLOT_PUT_LOCK, NAME_TAGNAME_PUT_LOCK);
 		service_tag_set_value_boolean(tag_put_lock, p_srv->put_locked);
-		tag_get_lock = service_info_ensure_tag(p_srv->tags, NAME_TAGNAME_GET_LOCK);
+		tag_get_lock = conscience_srv_ensure_tag_slot(
+				p_srv, TAG_SLOT_GET_LOCK, NAME_TAGNAME_GET_LOCK);
 		service_tag_set_value_boolean(tag_get_lock, p_srv->get_locked);
 	}
 
@@ -1041,9 +1269,10 @@ conscience_srvtype_refresh_dated(
 			const guint max = sid->si->tags->len;
 			for (guint i = 0; i < max; i++) {
 				struct service_tag_s *tag = g_ptr_array_index(sid->si->tags, i);
-				struct service_tag_s *orig = service_info_ensure_tag(
-						p_srv->tags, tag->name);
-				service_tag_copy(orig, tag);
+				const guint slot = conscience_srvtype_intern_tag(
+						srvtype, tag->name);
+				conscience_srv_update_tag(conscience_srv_ensure_tag_slot(
+							p_srv, slot, tag->name), tag);
 			}
 		}
 
@@ -1055,25 +1284,11 @@ conscience_srvtype_refresh_dated(
 	return p_srv;
 }
 
+/* Apply under the lock of <srvtype> an update received from the HUB */
 static void
-push_service_dated(struct service_info_dated_s *sid)
+_push_service_dated_unlocked(struct conscience_srvtype_s *srvtype,
+		struct service_info_dated_s *sid)
 {
-	struct conscience_srvtype_s *srvtype = conscience_get_srvtype(
-			sid->si->type, FALSE);
-
-	time_t now = oio_ext_real_time();
-	gint64 repli_lag = now - MAX(sid->tags_mtime, sid->lock_mtime);
-	if (!srvtype) {
-		GRID_ERROR("Service type [%s/%s] not found",
-				oio_server_namespace, sid->si->type);
-		send_hub_timing("lag", 'P', ENOENT, repli_lag);
-		return;
-	}
-	send_hub_timing("lag", 'P', 0, repli_lag);
-
-	/* TODO(FVE): measure time to obtain the lock, send alert. */
-	gint64 start = oio_ext_monotonic_time();
-	g_rw_lock_writer_lock(&srvtype->rw_lock);
 	struct conscience_srv_s *srv = \
 			conscience_srvtype_refresh_dated(srvtype, sid);
 	if (srv) {
@@ -1094,15 +1309,73 @@ push_service_dated(struct service_info_dated_s *sid)
 		/* Prepare the serialized form of the service */
 		_conscience_srv_prepare_cache (srv);
 	}
-	g_rw_lock_writer_unlock(&srvtype->rw_lock);
-	gint64 duration = oio_ext_monotonic_time() - start;
+}
 
-	oio_stats_add(
-		gq_count_hub_update, 1,
-		gq_lag_hub_update, repli_lag,
-		gq_time_hub_update, duration,
-		0, 0
-	);
+static gint
+_sid_cmp_type(gconstpointer a, gconstpointer b)
+{
+	const struct service_info_dated_s *sid0 = *(struct service_info_dated_s**)a;
+	const struct service_info_dated_s *sid1 = *(struct service_info_dated_s**)b;
+	return strcmp(sid0->si->type, sid1->si->type);
+}
+
+/* Apply the updates received from the HUB, grouped by service type, so that
+ * the lock of each type is taken once per batch. */
+static void
+push_services_dated(GPtrArray *sids)
+{
+	/* Stable, the updates of a service are applied in order */
+	g_ptr_array_sort(sids, _sid_cmp_type);
+
+	const time_t now = oio_ext_real_time();
+	for (guint i = 0; i < sids->len;) {
+		struct service_info_dated_s *first = sids->pdata[i];
+		guint end = i + 1;
+		while (end < sids->len && !_sid_cmp_type(
+					&sids->pdata[i], &sids->pdata[end]))
+			end++;
+
+		gint64 repli_lag = 0;
+		for (guint j = i; j < end; j++) {
+			struct service_info_dated_s *sid = sids->pdata[j];
+			repli_lag += now - MAX(sid->tags_mtime, sid->lock_mtime);
+		}
+
+		struct conscience_srvtype_s *srvtype = conscience_get_srvtype(
+				first->si->type, FALSE);
+		if (!srvtype) {
+			GRID_ERROR("Service type [%s/%s] not found",
+					oio_server_namespace, first->si->type);
+			for (guint j = i; j < end; j++) {
+				struct service_info_dated_s *sid = sids->pdata[j];
+				send_hub_timing("lag", 'P', ENOENT,
+						now - MAX(sid->tags_mtime, sid->lock_mtime));
+			}
+			i = end;
+			continue;
+		}
+
+		/* TODO(FVE): measure time to obtain the lock, send alert. */
+		gint64 start = oio_ext_monotonic_time();
+		g_rw_lock_writer_lock(&srvtype->rw_lock);
+		for (guint j = i; j < end; j++)
+			_push_service_dated_unlocked(srvtype, sids->pdata[j]);
+		g_rw_lock_writer_unlock(&srvtype->rw_lock);
+		gint64 duration = oio_ext_monotonic_time() - start;
+
+		for (guint j = i; j < end; j++) {
+			struct service_info_dated_s *sid = sids->pdata[j];
+			send_hub_timing("lag", 'P', 0,
+					now - MAX(sid->tags_mtime, sid->lock_mtime));
+		}
+		oio_stats_add(
+			gq_count_hub_update, end - i,
+			gq_lag_hub_update, repli_lag,
+			gq_time_hub_update, duration,
+			0, 0
+		);
+		i = end;
+	}
 }
 
 static void
@@ -1146,38 +1419,80 @@ rm_service_dated(struct service_info_dated_s *sid)
 /* -------------------------------------------------------------------------- */
 
 static struct service_info_dated_s *
-push_service(struct service_info_s *si)
+_push_service_unlocked(struct conscience_srvtype_s *srvtype,
+		struct service_info_s *si)
 {
 	struct service_info_dated_s *sid = NULL;
+	struct conscience_srv_s *srv = conscience_srvtype_refresh(srvtype, si);
+	if (srv) {
+		/* shortcut for services tagged DOWN */
+		gboolean bval = FALSE;
+		struct service_tag_s *tag = service_info_get_tag(si->tags, NAME_TAGNAME_UP);
+		if (tag && service_tag_get_value_boolean(tag, &bval, NULL) && !bval) {
+			if (!srv->put_locked)
+				srv->put_score.value = 0;
+			if (!srv->get_locked)
+				srv->get_score.value = 0;
+			if (!srv->put_locked || !srv->get_locked)
+				_alert_service_with_zeroed_score(srv);
+		}
+		/* Prepare the serialized form of the service */
+		_conscience_srv_prepare_cache (srv);
 
-	struct conscience_srvtype_s *srvtype = conscience_get_srvtype(si->type, FALSE);
-	if (!srvtype) {
-		GRID_ERROR("Service type [%s/%s] not found",
-				oio_server_namespace, si->type);
-	} else {
-		g_rw_lock_writer_lock(&srvtype->rw_lock);
-		struct conscience_srv_s *srv = conscience_srvtype_refresh(srvtype, si);
-		if (srv) {
-			/* shortcut for services tagged DOWN */
-			gboolean bval = FALSE;
-			struct service_tag_s *tag = service_info_get_tag(si->tags, NAME_TAGNAME_UP);
-			if (tag && service_tag_get_value_boolean(tag, &bval, NULL) && !bval) {
-				if (!srv->put_locked)
-					srv->put_score.value = 0;
-				if (!srv->get_locked)
-					srv->get_score.value = 0;
-				if (!srv->put_locked || !srv->get_locked)
-					_alert_service_with_zeroed_score(srv);
-			}
-			/* Prepare the serialized form of the service */
-			_conscience_srv_prepare_cache (srv);
+		sid = service_info_dated_new2(srv);
+	}
+	return sid;
+}
+
+static gint
+_si_cmp_type(gconstpointer a, gconstpointer b)
+{
+	const struct service_info_s *si0 = *(struct service_info_s**)a;
+	const struct service_info_s *si1 = *(struct service_info_s**)b;
+	return strcmp(si0->type, si1->type);
+}
+
+/* Register the services grouped by service type, so that the lock of each
+ * type is taken once per batch. The dated forms of the services registered
+ * are appended to <sids>, if set. Returns how many were registered. */
+static guint
+push_services(GPtrArray *sis, GPtrArray *sids)
+{
+	/* Stable, the registrations of a service are applied in order */
+	g_ptr_array_sort(sis, _si_cmp_type);
+
+	guint count = 0;
+	for (guint i = 0; i < sis->len;) {
+		struct service_info_s *first = sis->pdata[i];
+		guint end = i + 1;
+		while (end < sis->len && !_si_cmp_type(
+					&sis->pdata[i], &sis->pdata[end]))
+			end++;
+
+		struct conscience_srvtype_s *srvtype =
+			conscience_get_srvtype(first->type, FALSE);
+		if (!srvtype) {
+			GRID_ERROR("Service type [%s/%s] not found",
+					oio_server_namespace, first->type);
+			i = end;
+			continue;
+		}
 
-			sid = service_info_dated_new2(srv);
+		g_rw_lock_writer_lock(&srvtype->rw_lock);
+		for (; i < end; i++) {
+			struct service_info_dated_s *sid =
+				_push_service_unlocked(srvtype, sis->pdata[i]);
+			if (!sid)
+				continue;
+			++ count;
+			if (sids)
+				g_ptr_array_add(sids, sid);
+			else
+				service_info_dated_free(sid);
 		}
 		g_rw_lock_writer_unlock(&srvtype->rw_lock);
 	}
-
-	return sid;
+	return count;
 }
 
 static struct service_info_dated_s *
@@ -1208,32 +1523,39 @@ rm_service(struct service_info_s *si)
 }
 
 static void
-_load_and_update_service(gpointer srv_data, gpointer udata UNUSED)
-{
-	gchar *json_data = srv_data;
-	struct service_info_dated_s *sid = NULL;
-	GError *err = service_info_dated_load_json(json_data, &sid, FALSE);
-	EXTRA_ASSERT((err != NULL) ^ (sid != NULL));
-	if (err) {
-		GRID_WARN("HUB: decoder error: (%d) %s", err->code, err->message);
-		g_clear_error (&err);
-	} else {
-		push_service_dated(sid);
-		service_info_dated_free(sid);
+_load_and_update_services(gpointer data, gpointer udata UNUSED)
+{
+	GPtrArray *batch = data;
+	GPtrArray *sids = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)service_info_dated_free);
+	for (guint i = 0; i < batch->len; i++) {
+		struct service_info_dated_s *sid = NULL;
+		GError *err = service_info_dated_load_json(batch->pdata[i], &sid, FALSE);
+		EXTRA_ASSERT((err != NULL) ^ (sid != NULL));
+		if (err) {
+			GRID_WARN("HUB: decoder error: (%d) %s", err->code, err->message);
+			g_clear_error (&err);
+		} else {
+			g_ptr_array_add(sids, sid);
+		}
 	}
-	g_free(json_data);
+	if (sids->len > 0)
+		push_services_dated(sids);
+	g_ptr_array_free(sids, TRUE);
+	g_ptr_array_free(batch, TRUE);
 }
 
 static void
-_on_push (const guint8 *b, gsize l)
-{
-	/* Copy the buffer received from the HUB, send it to a thread pool
-	 * for decoding (we don't want to block the HUB). */
-	gchar *json_data = g_strndup((gchar*)b, l);
-	if (pool_update_srv) {
-		metautils_gthreadpool_push("SRVUPD", pool_update_srv, json_data);
+_on_push (GPtrArray *batch)
+{
+	/* The buffers received from the HUB have been copied, send them to
+	 * a thread pool for decoding (we don't want to block the HUB). */
+	if (batch->len <= 0) {
+		g_ptr_array_free(batch, TRUE);
+	} else if (pool_update_srv) {
+		metautils_gthreadpool_push("SRVUPD", pool_update_srv, batch);
 	} else {
-		_load_and_update_service(json_data, NULL);
+		_load_and_update_services(batch, NULL);
 	}
 }
 
@@ -1350,9 +1672,16 @@ hub_worker_sub (gpointer p)
 			send_hub_stat("recv", *action, 0);
 			if (more) {
 				switch (*action) {
-					case 'P':
-						_on_each_message (hub_zsub, _on_push);
+					case 'P': {
+						/* The services of a message are applied as a batch */
+						GPtrArray *batch = g_ptr_array_new_with_free_func(g_free);
+						void _collect(const guint8 *b, gsize l) {
+							g_ptr_array_add(batch, g_strndup((gchar*)b, l));
+						}
+						_on_each_message (hub_zsub, _collect);
+						_on_push (batch);
 						break;
+					}
 					case 'R':
 						_on_each_message (hub_zsub, _on_remove);
 						break;
@@ -1372,6 +1701,23 @@ hub_worker_sub (gpointer p)
 	return p;
 }
 
+/* The messages queued for the HUB are the action, then the parts of the
+ * message, each terminated by a NUL character, then an empty part. */
+
+static void
+hub_publish_services (GPtrArray *sids)
+{
+	if (!hub_queue || sids->len <= 0)
+		return;
+	GString *encoded = g_string_sized_new (256 * sids->len);
+	g_string_append_c (encoded, 'P');
+	for (guint i = 0; i < sids->len; i++) {
+		service_info_dated_encode_json(encoded, sids->pdata[i], TRUE);
+		g_string_append_c (encoded, '\0');
+	}
+	g_async_queue_push (hub_queue, g_string_free (encoded, FALSE));
+}
+
 static void
 hub_publish_service (const struct service_info_dated_s *sid)
 {
@@ -1380,6 +1726,7 @@ hub_publish_service (const struct service_info_dated_s *sid)
 	GString *encoded = g_string_sized_new (256);
 	g_string_append_c (encoded, 'P');
 	service_info_dated_encode_json(encoded, sid, TRUE);
+	g_string_append_c (encoded, '\0');
 	g_async_queue_push (hub_queue, g_string_free (encoded, FALSE));
 }
 
@@ -1391,6 +1738,7 @@ hub_remove_service (const struct service_info_dated_s *sid)
 	GString *encoded = g_string_sized_new (256);
 	g_string_append_c (encoded, 'R');
 	service_info_dated_encode_json(encoded, sid, TRUE);
+	g_string_append_c (encoded, '\0');
 	g_async_queue_push (hub_queue, g_string_free (encoded, FALSE));
 }
 
@@ -1402,6 +1750,7 @@ hub_flush_srvtype (const char *name)
 	GString *encoded = g_string_sized_new (256);
 	g_string_append_c (encoded, 'F');
 	g_string_append (encoded, name);
+	g_string_append_c (encoded, '\0');
 	g_async_queue_push (hub_queue, g_string_free (encoded, FALSE));
 }
 
@@ -1439,8 +1788,9 @@ _prepare_cached(struct conscience_srv_s *srv, gpointer u)
 
 	/* Reuse the serialized version of the service
 	 * that was made at registration time (saves CPU) */
-	if (srv->cache) {
-		g_byte_array_append(gba_body, srv->cache->data, srv->cache->len);
+	GByteArray *cache = __atomic_load_n(&srv->cache, __ATOMIC_ACQUIRE);
+	if (cache) {
+		g_byte_array_append(gba_body, cache->data, cache->len);
 		return TRUE;
 	} else {
 		/* Serialize the service without its tags and stats */
@@ -1451,6 +1801,75 @@ _prepare_cached(struct conscience_srv_s *srv, gpointer u)
 	}
 }
 
+static gchar *
+_srv_generation_encode(guint64 gen)
+{
+	return g_strdup_printf("%016"G_GINT64_MODIFIER"x.%"G_GUINT64_FORMAT,
+			srv_generation_epoch, gen);
+}
+
+static gboolean
+_srv_generation_decode(const gchar *token, guint64 *gen)
+{
+	gchar *end = NULL;
+	const guint64 epoch = g_ascii_strtoull(token, &end, 16);
+	if (end == token || *end != '.' || epoch != srv_generation_epoch)
+		return FALSE;
+	const gchar *start = end + 1;
+	*gen = g_ascii_strtoull(start, &end, 10);
+	return end != start && !*end;
+}
+
+/* Serialize the services of <type> changed since the generation in <token>,
+ * and in <removed> the services removed since then. When <token> is not
+ * a generation of this conscience or is too old to know what has been
+ * removed, all the services are serialized and <removed> is left NULL. */
+static GError *
+conscience_run_srvtype_changes(const gchar *type, const gchar *token,
+		GByteArray *body, GByteArray **removed, gchar **generation)
+{
+	struct conscience_srvtype_s *srvtype = conscience_get_srvtype(type, FALSE);
+	if (!srvtype)
+		return BADSRVTYPE(type);
+
+	guint64 since = 0;
+	gboolean _prepare_changed(struct conscience_srv_s *srv, gpointer u) {
+		if (__atomic_load_n(&srv->generation, __ATOMIC_RELAXED) <= since)
+			return TRUE;
+		return _prepare_cached(srv, u);
+	}
+
+	g_rw_lock_reader_lock(&srvtype->rw_lock);
+	const guint64 current =
+		__atomic_load_n(&srvtype->generation, __ATOMIC_ACQUIRE);
+	if (_srv_generation_decode(token, &since)
+			&& since >= srvtype->removed_floor && since <= current) {
+		conscience_srvtype_run_all(srvtype, _prepare_changed, body);
+		GByteArray *gba = g_byte_array_sized_new(256);
+		g_byte_array_append(gba, header, 2);
+		for (GList *l = srvtype->removed->tail; l; l = l->prev) {
+			struct conscience_removal_s *removal = l->data;
+			if (removal->generation <= since)
+				break;
+			struct service_info_s si = {};
+			memcpy(&si.addr, &removal->addr, sizeof(addr_info_t));
+			g_strlcpy(si.type, srvtype->type_name, sizeof(si.type));
+			g_strlcpy(si.ns_name, oio_server_namespace, sizeof(si.ns_name));
+			GByteArray *encoded = service_info_marshall_1(&si, NULL);
+			g_byte_array_append(gba, encoded->data, encoded->len);
+			g_byte_array_free(encoded, TRUE);
+		}
+		g_byte_array_append(gba, footer, 2);
+		*removed = gba;
+	} else {
+		conscience_srvtype_run_all(srvtype, _prepare_cached, body);
+	}
+	g_rw_lock_reader_unlock(&srvtype->rw_lock);
+
+	*generation = _srv_generation_encode(current);
+	return NULL;
+}
+
 static gboolean
 _cs_dispatch_SRV(struct gridd_reply_ctx_s *reply,
 	 gpointer g UNUSED, gpointer h UNUSED)
@@ -1474,6 +1893,38 @@ _cs_dispatch_SRV(struct gridd_reply_ctx_s *reply,
 	const gboolean full = metautils_message_extract_flag(
 			reply->request, NAME_MSGKEY_FULL, FALSE);
 
+	/* The client knows a generation of the list, or wants to know one:
+	 * only the changes are sent, out of the cache of lists whose generation
+	 * is not known. */
+	gchar *since = metautils_message_extract_string_copy(
+			reply->request, NAME_MSGKEY_GENERATION);
+	if (since && !full && strcmp(strtype, "all") != 0) {
+		GByteArray *removed = NULL;
+		gchar *generation = NULL;
+		GByteArray *gba = g_byte_array_sized_new(8192);
+		g_byte_array_append(gba, header, 2);
+		err = conscience_run_srvtype_changes(strtype, since, gba,
+				&removed, &generation);
+		g_free(since);
+		if (err) {
+			g_byte_array_free(gba, TRUE);
+			reply->send_error(0, err);
+		} else {
+			reply->subject("srv_type:%s\top_type:%s",
+					strtype, removed ? "delta" : "generation");
+			g_byte_array_append(gba, footer, 2);
+			reply->add_header(NAME_MSGKEY_GENERATION,
+					metautils_gba_from_string(generation));
+			if (removed)
+				reply->add_header(NAME_MSGKEY_REMOVED, removed);
+			g_free(generation);
+			reply->add_body(gba);
+			reply->send_reply(200, "OK");
+		}
+		return TRUE;
+	}
+	g_free(since);
+
 	/* Take a reference to the cache, so it's not freed while we use it.
 	 * There is a race condition if someone calls g_hash_table_unref
 	 * while we are calling g_hash_table_ref, hence the lock. */
@@ -1570,8 +2021,8 @@ _cs_dispatch_PUSH(struct gridd_reply_ctx_s *reply,
 		return TRUE;
 	}
 
-	/*Now push each service and reply the success */
-	guint count = 0;
+	/* Now push the valid services by batches and reply the success */
+	GPtrArray *sis = g_ptr_array_new();
 	for (GSList *l = list_srvinfo; l; l = g_slist_next(l)) {
 		struct service_info_s *si = l->data;
 		if (!metautils_addr_valid_for_connect(&si->addr)
@@ -1589,14 +2040,15 @@ _cs_dispatch_PUSH(struct gridd_reply_ctx_s *reply,
 					si->ns_name, si->type, srvaddr);
 			continue;
 		}
-		struct service_info_dated_s *sid = push_service(si);
-		if (sid) {
-			hub_publish_service(sid);
-			service_info_dated_free(sid);
-		}
-		++ count;
-	}
-	GRID_DEBUG("Pushed %u items (reqid=%s)", count, oio_ext_get_reqid());
+		g_ptr_array_add(sis, si);
+	}
+	GPtrArray *sids = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)service_info_dated_free);
+	push_services(sis, sids);
+	hub_publish_services(sids);
+	GRID_DEBUG("Pushed %u items (reqid=%s)", sis->len, oio_ext_get_reqid());
+	g_ptr_array_free(sids, TRUE);
+	g_ptr_array_free(sis, TRUE);
 	g_slist_free_full (list_srvinfo, (GDestroyNotify) service_info_clean);
 
 	reply->send_reply(200, "OK");
@@ -1737,7 +2189,7 @@ _init_hub (void)
 
 	if (hub_threads > 0) {
 		pool_update_srv = g_thread_pool_new(
-				(GFunc)_load_and_update_service,
+				(GFunc)_load_and_update_services,
 				NULL, hub_threads, FALSE, NULL);
 		g_assert(pool_update_srv != NULL);
 	}
@@ -1774,10 +2226,11 @@ _task_expire (gpointer p UNUSED)
 	for (gchar **ptype=typev; typev && *ptype ;++ptype) {
 		struct conscience_srvtype_s *srvtype = conscience_get_srvtype(*ptype, FALSE);
 		EXTRA_ASSERT(srvtype != NULL);
-		g_rw_lock_reader_lock(&srvtype->rw_lock);
+		/* The serialized forms are replaced, not under the readers */
+		g_rw_lock_writer_lock(&srvtype->rw_lock);
 		guint count = conscience_srvtype_zero_expired(srvtype,
 				service_expiration_notifier, NULL);
-		g_rw_lock_reader_unlock(&srvtype->rw_lock);
+		g_rw_lock_writer_unlock(&srvtype->rw_lock);
 
 		if (count)
 			GRID_NOTICE("Expired [%u] [%s] services", count, *ptype);
@@ -2074,7 +2527,7 @@ restart_srv_from_other_consciences(void)
 			oio_server_namespace, "all", TRUE, &all_services, 0);
 
 	if (!err) {
-		guint count = 0;
+		GPtrArray *sis = g_ptr_array_new();
 		for (GSList *l = all_services; l; l = g_slist_next(l)) {
 			struct service_info_s *si = l->data;
 			if (!metautils_addr_valid_for_connect(&si->addr)
@@ -2095,14 +2548,12 @@ restart_srv_from_other_consciences(void)
 					&& is_locked)) {
 				si->put_score.value = SCORE_UNSET;
 			}
-			struct service_info_dated_s *sid = push_service(si);
-			if (sid) {
-				service_info_dated_free(sid);
-			}
-			++count;
+			g_ptr_array_add(sis, si);
 		}
+		push_services(sis, NULL);
 		GRID_NOTICE("Loaded %u services from other consciences (reqid=%s)",
-				count, oio_ext_get_reqid());
+				sis->len, oio_ext_get_reqid());
+		g_ptr_array_free(sis, TRUE);
 	} else {
 		res = FALSE;
 		GRID_WARN("Failed to load services from other consciences: (%d) %s",
@@ -2635,6 +3086,9 @@ _cs_configure(int argc, char **argv)
 	/* Prepare nsinfo cache */
 	nsinfo_cache = namespace_info_marshall (nsinfo, NULL);
 
+	srv_generation_epoch =
+		((guint64)oio_ext_rand_int() << 32) | oio_ext_rand_int();
+
 	/* Prepare serialized service lists cache */
 	g_mutex_lock(&srv_lists_lock);
 	srv_list_cache = g_hash_table_new_full(
@@ -0,0 +1,599 @@
+/*
+OpenIO SDS core library
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <core/ec.h>
+
+#include <string.h>
+
+#include <core/oiostr.h>
+
+#include "internals.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define HAVE_EC_SSSE3 1
+#endif
+
+#define EC_HEADER_MAGIC 0xb0c5ecc
+#define EC_LIBEC_VERSION ((1 << 16) | (6 << 8) | 2)
+/* The headers written before have no metadata checksum */
+#define EC_LIBEC_VERSION_CHKSUM ((1 << 16) | (2 << 8))
+#define EC_CHKSUM_NONE 1
+
+/* The versions of the backends, as reported by liberasurecode */
+#define EC_ISA_L_VERSION ((2 << 16) | (14 << 8))
+#define EC_LIBERASURECODE_RS_VAND_VERSION (1 << 16)
+
+/* The identifiers of the backends, as known by liberasurecode */
+enum ec_algo_e
+{
+	EC_ALGO_ISA_L_RS_VAND = 4,
+	EC_ALGO_LIBERASURECODE_RS_VAND = 6,
+	EC_ALGO_ISA_L_RS_CAUCHY = 7,
+};
+
+struct oio_ec_s
+{
+	enum ec_algo_e algo;
+	guint32 algo_version;
+	/* The size of the words, in bits: 8 or 16 */
+	guint w;
+	guint k;
+	guint m;
+	gsize segment_size;
+	/* The generator matrix: k+m rows of k coefficients, the k first rows
+	 * are the identity. */
+	guint *matrix;
+};
+
+/* Galois fields ------------------------------------------------------------ */
+
+/* GF(2^8) as isa-l, GF(2^16) as liberasurecode */
+static guint8 gf8_log[256];
+static guint8 gf8_exp[2 * 255];
+static guint16 *gf16_log = NULL;
+static guint16 *gf16_exp = NULL;
+
+static void _gf8_region_muladd_generic (guint8 c, const guint8 *src,
+		guint8 *dst, gsize len);
+
+static void (*_gf8_region_muladd) (guint8 c, const guint8 *src,
+		guint8 *dst, gsize len) = _gf8_region_muladd_generic;
+
+static inline guint
+_gf_mul (guint w, guint a, guint b)
+{
+	if (!a || !b)
+		return 0;
+	if (w == 8)
+		return gf8_exp[gf8_log[a] + gf8_log[b]];
+	return gf16_exp[gf16_log[a] + gf16_log[b]];
+}
+
+static inline guint
+_gf_inv (guint w, guint a)
+{
+	EXTRA_ASSERT(a != 0);
+	if (w == 8)
+		return gf8_exp[255 - gf8_log[a]];
+	return gf16_exp[65535 - gf16_log[a]];
+}
+
+static void
+_gf8_region_muladd_generic (guint8 c, const guint8 *src, guint8 *dst, gsize len)
+{
+	guint8 t[256];
+	for (guint x = 0; x < 256; x++)
+		t[x] = _gf_mul(8, c, x);
+	for (gsize i = 0; i < len; i++)
+		dst[i] ^= t[src[i]];
+}
+
+#ifdef HAVE_EC_SSSE3
+/* The product by <c> of each nibble, looked up 16 bytes at once */
+__attribute__((target("ssse3")))
+static void
+_gf8_region_muladd_ssse3 (guint8 c, const guint8 *src, guint8 *dst, gsize len)
+{
+	guint8 lo[16], hi[16];
+	for (guint x = 0; x < 16; x++) {
+		lo[x] = _gf_mul(8, c, x);
+		hi[x] = _gf_mul(8, c, x << 4);
+	}
+	const __m128i tlo = _mm_loadu_si128((const __m128i*) lo);
+	const __m128i thi = _mm_loadu_si128((const __m128i*) hi);
+	const __m128i mask = _mm_set1_epi8(0x0f);
+
+	gsize i = 0;
+	for (; i + 16 <= len; i += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+		const __m128i l = _mm_and_si128(v, mask);
+		const __m128i h = _mm_and_si128(_mm_srli_epi64(v, 4), mask);
+		const __m128i p = _mm_xor_si128(
+				_mm_shuffle_epi8(tlo, l), _mm_shuffle_epi8(thi, h));
+		const __m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_xor_si128(d, p));
+	}
+	for (; i < len; i++)
+		dst[i] ^= _gf_mul(8, c, src[i]);
+}
+#endif
+
+/* The words are little-endian. The product being linear, it is computed
+ * from the products of each byte of the word. */
+static void
+_gf16_region_muladd (guint c, const guint8 *src, guint8 *dst, gsize len)
+{
+	guint16 tlo[256], thi[256];
+	for (guint x = 0; x < 256; x++) {
+		tlo[x] = _gf_mul(16, c, x);
+		thi[x] = _gf_mul(16, c, x << 8);
+	}
+	for (gsize i = 0; i + 1 < len; i += 2) {
+		const guint16 p = tlo[src[i]] ^ thi[src[i+1]];
+		dst[i] ^= p & 0xFF;
+		dst[i+1] ^= p >> 8;
+	}
+	if (len % 2)
+		dst[len-1] ^= (guint8) _gf_mul(16, c, src[len-1]);
+}
+
+/* dst ^= c * src */
+static void
+_region_muladd (guint w, guint c, const guint8 *src, guint8 *dst, gsize len)
+{
+	if (!c)
+		return;
+	if (c == 1) {
+		for (gsize i = 0; i < len; i++)
+			dst[i] ^= src[i];
+	} else if (w == 8) {
+		_gf8_region_muladd(c, src, dst, len);
+	} else {
+		_gf16_region_muladd(c, src, dst, len);
+	}
+}
+
+static void
+_gf_init (void)
+{
+	static gsize inited = 0;
+	if (!g_once_init_enter(&inited))
+		return;
+
+	guint x = 1;
+	for (guint i = 0; i < 255; i++) {
+		gf8_exp[i] = gf8_exp[i + 255] = x;
+		gf8_log[x] = i;
+		x <<= 1;
+		if (x & 0x100)
+			x ^= 0x11d;
+	}
+
+	gf16_log = g_malloc0(65536 * sizeof(guint16));
+	gf16_exp = g_malloc0(2 * 65535 * sizeof(guint16));
+	x = 1;
+	for (guint i = 0; i < 65535; i++) {
+		gf16_exp[i] = gf16_exp[i + 65535] = x;
+		gf16_log[x] = i;
+		x <<= 1;
+		if (x & 0x10000)
+			x ^= 0x1100b;
+	}
+
+#ifdef HAVE_EC_SSSE3
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("ssse3"))
+		_gf8_region_muladd = _gf8_region_muladd_ssse3;
+#endif
+
+	g_once_init_leave(&inited, 1);
+}
+
+/* Matrices ----------------------------------------------------------------- */
+
+static gboolean
+_matrix_invert (guint w, const guint *in, guint *out, guint n)
+{
+	guint *a = g_malloc(n * n * sizeof(guint));
+	memcpy(a, in, n * n * sizeof(guint));
+	memset(out, 0, n * n * sizeof(guint));
+	for (guint i = 0; i < n; i++)
+		out[i*n + i] = 1;
+
+	for (guint c = 0; c < n; c++) {
+		guint p = c;
+		while (p < n && !a[p*n + c])
+			p++;
+		if (p >= n) {
+			g_free(a);
+			return FALSE;
+		}
+		if (p != c) {
+			for (guint j = 0; j < n; j++) {
+				guint t = a[p*n + j]; a[p*n + j] = a[c*n + j]; a[c*n + j] = t;
+				t = out[p*n + j]; out[p*n + j] = out[c*n + j]; out[c*n + j] = t;
+			}
+		}
+		const guint inv = _gf_inv(w, a[c*n + c]);
+		for (guint j = 0; j < n; j++) {
+			a[c*n + j] = _gf_mul(w, a[c*n + j], inv);
+			out[c*n + j] = _gf_mul(w, out[c*n + j], inv);
+		}
+		for (guint r = 0; r < n; r++) {
+			const guint f = a[r*n + c];
+			if (r == c || !f)
+				continue;
+			for (guint j = 0; j < n; j++) {
+				a[r*n + j] ^= _gf_mul(w, f, a[c*n + j]);
+				out[r*n + j] ^= _gf_mul(w, f, out[c*n + j]);
+			}
+		}
+	}
+
+	g_free(a);
+	return TRUE;
+}
+
+/* The Vandermonde matrix over the points 0 .. k+m-1, made systematic, then
+ * normalized for the first parity row and the first column to be all ones,
+ * as liberasurecode does. */
+static guint *
+_matrix_liberasurecode_rs_vand (guint k, guint m)
+{
+	const guint rows = k + m;
+	guint *v = g_malloc0(rows * k * sizeof(guint));
+	for (guint i = 0; i < rows; i++) {
+		guint acc = 1;
+		for (guint j = 0; j < k; j++) {
+			v[i*k + j] = acc;
+			acc = _gf_mul(16, acc, i);
+		}
+	}
+
+	guint *inv = g_malloc0(k * k * sizeof(guint));
+	guint *out = g_malloc0(rows * k * sizeof(guint));
+	if (!_matrix_invert(16, v, inv, k))
+		g_assert_not_reached();
+	for (guint i = 0; i < k; i++)
+		out[i*k + i] = 1;
+	for (guint i = k; i < rows; i++) {
+		for (guint j = 0; j < k; j++) {
+			guint x = 0;
+			for (guint l = 0; l < k; l++)
+				x ^= _gf_mul(16, v[i*k + l], inv[l*k + j]);
+			out[i*k + j] = x;
+		}
+	}
+
+	for (guint j = 0; j < k; j++) {
+		const guint c = out[k*k + j];
+		if (c && c != 1) {
+			const guint ic = _gf_inv(16, c);
+			for (guint i = k; i < rows; i++)
+				out[i*k + j] = _gf_mul(16, out[i*k + j], ic);
+		}
+	}
+	for (guint i = k + 1; i < rows; i++) {
+		const guint c = out[i*k];
+		if (c && c != 1) {
+			const guint ic = _gf_inv(16, c);
+			for (guint j = 0; j < k; j++)
+				out[i*k + j] = _gf_mul(16, out[i*k + j], ic);
+		}
+	}
+
+	g_free(inv);
+	g_free(v);
+	return out;
+}
+
+/* As gf_gen_rs_matrix() and gf_gen_cauchy1_matrix() in isa-l */
+static guint *
+_matrix_isa_l (guint k, guint m, gboolean cauchy)
+{
+	const guint rows = k + m;
+	guint *out = g_malloc0(rows * k * sizeof(guint));
+	for (guint i = 0; i < k; i++)
+		out[i*k + i] = 1;
+
+	guint gen = 1;
+	for (guint i = k; i < rows; i++) {
+		guint p = 1;
+		for (guint j = 0; j < k; j++) {
+			if (cauchy) {
+				out[i*k + j] = _gf_inv(8, i ^ j);
+			} else {
+				out[i*k + j] = p;
+				p = _gf_mul(8, p, gen);
+			}
+		}
+		gen = _gf_mul(8, gen, 2);
+	}
+	return out;
+}
+
+/* Fragment headers --------------------------------------------------------- */
+
+static guint32
+_crc32_step (guint32 crc, guint8 b)
+{
+	crc ^= b;
+	for (int i = 0; i < 8; i++)
+		crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+	return crc;
+}
+
+/* <legacy> as liberasurecode up to 1.6.2, that shifted a signed int, the
+ * later versions compute the checksum of zlib and accept both. */
+static guint32
+_crc32 (const guint8 *p, gsize len, gboolean legacy)
+{
+	guint32 crc = ~0U;
+	while (len--) {
+		const guint32 sign =
+			legacy && (crc & 0x80000000U) ? 0xFF000000U : 0;
+		crc = _crc32_step(crc, *p++) ^ sign;
+	}
+	return ~crc;
+}
+
+static guint32
+_get32 (const guint8 *p)
+{
+	guint32 v;
+	memcpy(&v, p, sizeof(v));
+	return GUINT32_FROM_LE(v);
+}
+
+static void
+_put32 (guint8 *p, guint32 v)
+{
+	v = GUINT32_TO_LE(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+/* The packed layout of the fragment_header_t of liberasurecode */
+#define HDR_INDEX        0
+#define HDR_SIZE         4
+#define HDR_BACKEND_MD   8
+#define HDR_ORIG_SIZE   12
+#define HDR_CHKSUM_TYPE 20
+#define HDR_BACKEND_ID  54
+#define HDR_BACKEND_VER 55
+#define HDR_META_END    59
+#define HDR_MAGIC       59
+#define HDR_LIBEC_VER   63
+#define HDR_META_CHKSUM 67
+
+gboolean
+oio_ec_header_parse (const guint8 *raw, struct oio_ec_header_s *out)
+{
+	if (_get32(raw + HDR_MAGIC) != EC_HEADER_MAGIC)
+		return FALSE;
+	/* None of the backends supported stores metadata in the fragments */
+	if (_get32(raw + HDR_BACKEND_MD) != 0)
+		return FALSE;
+	const guint32 chksum = _get32(raw + HDR_META_CHKSUM);
+	if (_get32(raw + HDR_LIBEC_VER) >= EC_LIBEC_VERSION_CHKSUM
+			&& chksum != _crc32(raw, HDR_META_END, TRUE)
+			&& chksum != _crc32(raw, HDR_META_END, FALSE))
+		return FALSE;
+	out->index = _get32(raw + HDR_INDEX);
+	out->size = _get32(raw + HDR_SIZE);
+	guint64 orig;
+	memcpy(&orig, raw + HDR_ORIG_SIZE, sizeof(orig));
+	out->orig_data_size = GUINT64_FROM_LE(orig);
+	return TRUE;
+}
+
+void
+oio_ec_header_pack (const struct oio_ec_s *ec,
+		const struct oio_ec_header_s *hdr, guint8 *raw)
+{
+	memset(raw, 0, OIO_EC_HEADER_SIZE);
+	_put32(raw + HDR_INDEX, hdr->index);
+	_put32(raw + HDR_SIZE, hdr->size);
+	const guint64 orig = GUINT64_TO_LE(hdr->orig_data_size);
+	memcpy(raw + HDR_ORIG_SIZE, &orig, sizeof(orig));
+	raw[HDR_CHKSUM_TYPE] = EC_CHKSUM_NONE;
+	raw[HDR_BACKEND_ID] = ec->algo;
+	_put32(raw + HDR_BACKEND_VER, ec->algo_version);
+	_put32(raw + HDR_MAGIC, EC_HEADER_MAGIC);
+	_put32(raw + HDR_LIBEC_VER, EC_LIBEC_VERSION);
+	/* As the version announced computes it */
+	_put32(raw + HDR_META_CHKSUM, _crc32(raw, HDR_META_END, TRUE));
+}
+
+/* Codec -------------------------------------------------------------------- */
+
+GError *
+oio_ec_create (const char *chunk_method, struct oio_ec_s **out)
+{
+	EXTRA_ASSERT(out != NULL);
+	*out = NULL;
+
+	if (!chunk_method || !oio_str_prefixed(chunk_method, "ec", "/"))
+		return BADREQ("Not an erasure-coded chunk method: %s", chunk_method);
+
+	gint64 k = 0, m = 0, seg = OIO_EC_SEGMENT_SIZE;
+	gchar *algo = NULL;
+	gchar **tokens = g_strsplit(strchr(chunk_method, '/') + 1, ",", -1);
+	for (gchar **pt = tokens; *pt; ++pt) {
+		gchar *value = strchr(*pt, '=');
+		if (!value)
+			continue;
+		*(value++) = '\0';
+		if (!strcmp(*pt, "k"))
+			oio_str_is_number(value, &k);
+		else if (!strcmp(*pt, "m"))
+			oio_str_is_number(value, &m);
+		else if (!strcmp(*pt, "ec_segment_size"))
+			oio_str_is_number(value, &seg);
+		else if (!strcmp(*pt, "algo"))
+			oio_str_replace(&algo, value);
+	}
+	g_strfreev(tokens);
+
+	GError *err = NULL;
+	struct oio_ec_s ec = {0};
+	if (k < 1 || m < 1 || k + m > 255 || seg < 1) {
+		err = BADREQ("Invalid erasure coding parameters: %s", chunk_method);
+	} else if (!g_strcmp0(algo, "liberasurecode_rs_vand")) {
+		ec.algo = EC_ALGO_LIBERASURECODE_RS_VAND;
+		ec.algo_version = EC_LIBERASURECODE_RS_VAND_VERSION;
+		ec.w = 16;
+	} else if (!g_strcmp0(algo, "isa_l_rs_vand")) {
+		ec.algo = EC_ALGO_ISA_L_RS_VAND;
+		ec.algo_version = EC_ISA_L_VERSION;
+		ec.w = 8;
+	} else if (!g_strcmp0(algo, "isa_l_rs_cauchy")) {
+		ec.algo = EC_ALGO_ISA_L_RS_CAUCHY;
+		ec.algo_version = EC_ISA_L_VERSION;
+		ec.w = 8;
+	} else {
+		err = NEWERROR(CODE_NOT_IMPLEMENTED,
+				"Erasure coding algorithm not supported: %s", algo);
+	}
+	g_free(algo);
+	if (err)
+		return err;
+
+	_gf_init();
+	ec.k = k;
+	ec.m = m;
+	ec.segment_size = seg;
+	if (ec.algo == EC_ALGO_LIBERASURECODE_RS_VAND)
+		ec.matrix = _matrix_liberasurecode_rs_vand(ec.k, ec.m);
+	else
+		ec.matrix = _matrix_isa_l(ec.k, ec.m,
+				ec.algo == EC_ALGO_ISA_L_RS_CAUCHY);
+
+	*out = g_memdup(&ec, sizeof(ec));
+	return NULL;
+}
+
+void
+oio_ec_destroy (struct oio_ec_s *ec)
+{
+	if (!ec)
+		return;
+	g_free(ec->matrix);
+	g_free(ec);
+}
+
+guint oio_ec_get_k (const struct oio_ec_s *ec) { return ec->k; }
+
+guint oio_ec_get_m (const struct oio_ec_s *ec) { return ec->m; }
+
+gsize oio_ec_get_segment_size (const struct oio_ec_s *ec) { return ec->segment_size; }
+
+gsize
+oio_ec_get_fragment_size (const struct oio_ec_s *ec, gsize seg_size)
+{
+	/* As liberasurecode, the segment is padded to a multiple of k words */
+	const gsize align = ec->k * (ec->w / 8);
+	const gsize aligned = ((seg_size + align - 1) / align) * align;
+	return OIO_EC_HEADER_SIZE + aligned / ec->k;
+}
+
+void
+oio_ec_encode (const struct oio_ec_s *ec,
+		const guint8 * const *data, guint8 **parity, gsize len)
+{
+	for (guint i = 0; i < ec->m; i++) {
+		const guint *row = ec->matrix + (ec->k + i) * ec->k;
+		memset(parity[i], 0, len);
+		for (guint j = 0; j < ec->k; j++)
+			_region_muladd(ec->w, row[j], data[j], parity[i], len);
+	}
+}
+
+GError *
+oio_ec_decode (const struct oio_ec_s *ec,
+		const guint8 * const *frags, gsize frag_size, GByteArray *out)
+{
+	const guint k = ec->k, n = ec->k + ec->m;
+	if (frag_size < OIO_EC_HEADER_SIZE)
+		return NEWERROR(CODE_CONTENT_CORRUPTED, "EC fragment too short");
+
+	/* Place the blocks after the index in their header */
+	const guint8 *blocks[n];
+	memset(blocks, 0, sizeof(blocks));
+	struct oio_ec_header_s hdr = {0};
+	guint found = 0;
+	for (guint i = 0; i < n; i++) {
+		if (!frags[i])
+			continue;
+		struct oio_ec_header_s h = {0};
+		if (!oio_ec_header_parse(frags[i], &h)
+				|| h.index >= n
+				|| h.size > frag_size - OIO_EC_HEADER_SIZE
+				|| h.orig_data_size > (guint64)h.size * k
+				|| (ec->w == 16 && (h.size % 2))
+				|| (found && (h.size != hdr.size
+						|| h.orig_data_size != hdr.orig_data_size)))
+			return NEWERROR(CODE_CONTENT_CORRUPTED,
+					"Invalid EC fragment at position %u", i);
+		if (!blocks[h.index]) {
+			blocks[h.index] = frags[i] + OIO_EC_HEADER_SIZE;
+			hdr = h;
+			found ++;
+		}
+	}
+	if (found < k)
+		return ERRPTF("Not enough EC fragments: %u/%u", found, k);
+
+	/* Rebuild the missing data blocks from the k first blocks present */
+	guint8 *rebuilt[k];
+	memset(rebuilt, 0, sizeof(rebuilt));
+	guint rows[k];
+	for (guint i = 0, r = 0; i < n && r < k; i++) {
+		if (blocks[i])
+			rows[r++] = i;
+	}
+	if (rows[k-1] >= k) {
+		guint *a = g_malloc0(k * k * sizeof(guint));
+		guint *inv = g_malloc(k * k * sizeof(guint));
+		for (guint r = 0; r < k; r++)
+			memcpy(a + r*k, ec->matrix + rows[r]*k, k * sizeof(guint));
+		const gboolean invertible = _matrix_invert(ec->w, a, inv, k);
+		for (guint j = 0; invertible && j < k; j++) {
+			if (blocks[j])
+				continue;
+			rebuilt[j] = g_malloc0(hdr.size);
+			for (guint r = 0; r < k; r++)
+				_region_muladd(ec->w, inv[j*k + r], blocks[rows[r]],
+						rebuilt[j], hdr.size);
+		}
+		g_free(inv);
+		g_free(a);
+		if (!invertible)
+			return ERRPTF("EC decoding matrix not invertible");
+	}
+
+	gsize remaining = hdr.orig_data_size;
+	for (guint j = 0; j < k && remaining > 0; j++) {
+		const gsize len = MIN(remaining, hdr.size);
+		g_byte_array_append(out, blocks[j] ? blocks[j] : rebuilt[j], len);
+		remaining -= len;
+	}
+	for (guint j = 0; j < k; j++)
+		g_free(rebuilt[j]);
+	return NULL;
+}
@@ -0,0 +1,87 @@
+/*
+OpenIO SDS core library
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#ifndef OIO_SDS__sdk__ec_h
+# define OIO_SDS__sdk__ec_h 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/* Reed-Solomon codec of the erasure-coded chunks, compatible with the
+ * fragments written by liberasurecode. Each segment of a metachunk is cut
+ * into k data blocks, m parity blocks are computed, and each block is stored
+ * after a header, as a fragment of its own chunk. A chunk is the sequence of
+ * the fragments of the segments of its metachunk. */
+
+#define OIO_EC_HEADER_SIZE 80
+
+/* The size of the segments, unless an "ec_segment_size" parameter is present
+ * in the chunk method. */
+#define OIO_EC_SEGMENT_SIZE 1048576
+
+struct oio_ec_s;
+
+struct oio_ec_header_s
+{
+	guint32 index;
+	/* The size of the block following the header */
+	guint32 size;
+	/* The size of the segment */
+	guint64 orig_data_size;
+};
+
+/* Build the codec described by a chunk method, such as
+ * "ec/k=6,m=3,algo=liberasurecode_rs_vand". The algorithms supported are
+ * liberasurecode_rs_vand, isa_l_rs_vand and isa_l_rs_cauchy. */
+GError * oio_ec_create (const char *chunk_method, struct oio_ec_s **out);
+
+void oio_ec_destroy (struct oio_ec_s *ec);
+
+guint oio_ec_get_k (const struct oio_ec_s *ec);
+
+guint oio_ec_get_m (const struct oio_ec_s *ec);
+
+gsize oio_ec_get_segment_size (const struct oio_ec_s *ec);
+
+/* The size of each fragment of a segment of <seg_size> bytes, header
+ * included. */
+gsize oio_ec_get_fragment_size (const struct oio_ec_s *ec, gsize seg_size);
+
+/* Returns FALSE if <raw> is not the header of a fragment */
+gboolean oio_ec_header_parse (const guint8 *raw, struct oio_ec_header_s *out);
+
+void oio_ec_header_pack (const struct oio_ec_s *ec,
+		const struct oio_ec_header_s *hdr, guint8 *raw);
+
+/* Compute the m parity blocks from the k data blocks, all of <len> bytes */
+void oio_ec_encode (const struct oio_ec_s *ec,
+		const guint8 * const *data, guint8 **parity, gsize len);
+
+/* Rebuild a segment from at least k of its fragments. <frags> has k+m
+ * items, NULL for the missing fragments, the others are <frag_size> bytes
+ * long, header included. The segment is appended to <out>. */
+GError * oio_ec_decode (const struct oio_ec_s *ec,
+		const guint8 * const *frags, gsize frag_size, GByteArray *out);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /*OIO_SDS__sdk__ec_h*/
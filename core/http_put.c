@@ -34,11 +34,22 @@ License along with this library.
 #include <curl/multi.h>
 
 #include <core/client_variables.h>
+#include <core/oiocfg.h>
 #include <core/oioext.h>
 #include <core/oiolog.h>
 
 #include "internals.h"
 #include "http_internals.h"
+#include "ec.h"
+
+/* In an erasure-coded upload, how many fragments a destination may lag
+ * behind the most advanced one before it is abandoned, if enough others
+ * keep up. */
+#define EC_MAX_BACKLOG 16
+
+/* In an erasure-coded upload, how many fragments are kept ready for the
+ * destinations of the quorum. The data fed waits to be encoded beyond. */
+#define EC_MIN_QUEUED 2
 
 enum http_single_put_e
 {
@@ -73,7 +84,18 @@ struct http_put_dest_s
 	/* user data corresponding to this destination */
 	gpointer user_data;
 
+	/* The buffer being sent, and how much of it has already been sent. The
+	 * buffer is shared with the other destinations, and never copied but
+	 * into the send buffer of curl. */
 	GBytes *buffer;
+	gsize buffer_offset;
+
+	/* Erasure-coded upload: the index of the fragments to send, the queue
+	 * of the fragments not sent yet, and the checksum of all the fragments
+	 * queued, sent as a trailer. */
+	guint fragment;
+	GQueue *fragments; /* <GBytes*> */
+	GChecksum *checksum;
 
 	/* HTTP error code (valid if success == 1) */
 	gint64 bytes_sent;
@@ -108,6 +130,17 @@ struct http_put_s
 
 	GQueue *buffer_tail; /* <GBytes*> */
 
+	/* Erasure-coded upload, NULL for a replicated upload. The data fed
+	 * waits in <buffer_tail>, <tail_offset> bytes of its head are already
+	 * encoded. It is cut into segments, each segment is encoded and its
+	 * fragments are queued on their destinations. */
+	struct oio_ec_s *ec;
+	gsize tail_offset;
+	GByteArray *segment;
+	GChecksum *metachunk_checksum;
+	gint64 metachunk_size;
+	gboolean eof;
+
 	enum http_whole_put_state_e state;
 };
 
@@ -167,6 +200,23 @@ http_put_create(gint64 content_length, gint64 soft_length)
 	return p;
 }
 
+struct http_put_s *
+http_put_create_ec(struct oio_ec_s *ec, gint64 soft_length)
+{
+	EXTRA_ASSERT(ec != NULL);
+#if LIBCURL_VERSION_NUM < 0x074000
+	/* The metachunk size and hash are sent as trailers */
+	(void) ec, (void) soft_length;
+	return NULL;
+#else
+	struct http_put_s *p = http_put_create(-1, soft_length);
+	p->ec = ec;
+	p->segment = g_byte_array_sized_new(oio_ec_get_segment_size(ec));
+	p->metachunk_checksum = g_checksum_new(G_CHECKSUM_MD5);
+	return p;
+#endif
+}
+
 struct http_put_dest_s *
 http_put_add_dest(struct http_put_s *p, const char *url, gpointer u)
 {
@@ -187,12 +237,27 @@ http_put_add_dest(struct http_put_s *p, const char *url, gpointer u)
 	dest->bytes_sent = 0;
 	dest->http_code = 0;
 	dest->state = HTTP_SINGLE_BEGIN;
+	if (p->ec) {
+		dest->fragment = g_slist_length(p->dests);
+		dest->fragments = g_queue_new();
+		dest->checksum = g_checksum_new(G_CHECKSUM_MD5);
+	}
 
 	p->dests = g_slist_append(p->dests, dest);
 
 	return dest;
 }
 
+void
+http_put_dest_set_fragment(struct http_put_dest_s *dest, guint index)
+{
+	EXTRA_ASSERT(dest != NULL);
+	EXTRA_ASSERT(dest->http_put->ec != NULL);
+	EXTRA_ASSERT(index < oio_ec_get_k(dest->http_put->ec)
+			+ oio_ec_get_m(dest->http_put->ec));
+	dest->fragment = index;
+}
+
 void
 http_put_dest_add_header(struct http_put_dest_s *dest,
 		const char *key, const char *val_fmt, ...)
@@ -242,6 +307,10 @@ http_put_dest_destroy(gpointer destination)
 		g_bytes_unref(dest->buffer);
 		dest->buffer = NULL;
 	}
+	if (dest->fragments)
+		g_queue_free_full(dest->fragments, (GDestroyNotify)g_bytes_unref);
+	if (dest->checksum)
+		g_checksum_free(dest->checksum);
 
 	g_free(dest);
 }
@@ -259,6 +328,10 @@ http_put_destroy(struct http_put_s *p)
 		g_queue_free_full(p->buffer_tail, (GDestroyNotify)g_bytes_unref);
 		p->buffer_tail = NULL;
 	}
+	if (p->segment)
+		g_byte_array_free(p->segment, TRUE);
+	if (p->metachunk_checksum)
+		g_checksum_free(p->metachunk_checksum);
 	g_free(p);
 }
 
@@ -271,6 +344,139 @@ http_put_expected_bytes (struct http_put_s *p)
 	return p->remaining_length;
 }
 
+/* Encode one segment and queue each fragment on its destinations */
+static void
+_ec_push_segment (struct http_put_s *p, const guint8 *data, gsize len)
+{
+	const guint k = oio_ec_get_k(p->ec), m = oio_ec_get_m(p->ec), n = k + m;
+	const gsize fs = oio_ec_get_fragment_size(p->ec, len);
+	const gsize bs = fs - OIO_EC_HEADER_SIZE;
+
+	guint8 *frags[n];
+	for (guint i = 0; i < n; i++) {
+		frags[i] = g_malloc0(fs);
+		struct oio_ec_header_s hdr = {.index = i, .size = bs, .orig_data_size = len};
+		oio_ec_header_pack(p->ec, &hdr, frags[i]);
+	}
+	for (guint i = 0; i < k && i * bs < len; i++)
+		memcpy(frags[i] + OIO_EC_HEADER_SIZE, data + i * bs, MIN(bs, len - i * bs));
+
+	const guint8 *blocks[k];
+	guint8 *parity[m];
+	for (guint i = 0; i < k; i++)
+		blocks[i] = frags[i] + OIO_EC_HEADER_SIZE;
+	for (guint i = 0; i < m; i++)
+		parity[i] = frags[k + i] + OIO_EC_HEADER_SIZE;
+	oio_ec_encode(p->ec, blocks, parity, bs);
+
+	GBytes *out[n];
+	for (guint i = 0; i < n; i++)
+		out[i] = g_bytes_new_take(frags[i], fs);
+	for (GSList *l = p->dests; l; l = l->next) {
+		struct http_put_dest_s *d = l->data;
+		if (d->state == HTTP_SINGLE_FINISHED)
+			continue;
+		g_checksum_update(d->checksum, frags[d->fragment], fs);
+		g_queue_push_tail(d->fragments, g_bytes_ref(out[d->fragment]));
+	}
+	for (guint i = 0; i < n; i++)
+		g_bytes_unref(out[i]);
+}
+
+/* The backlog of the destinations still up, sorted */
+static guint
+_ec_backlogs (struct http_put_s *p, guint *out)
+{
+	guint count = 0;
+	for (GSList *l = p->dests; l; l = l->next) {
+		struct http_put_dest_s *d = l->data;
+		if (d->state < HTTP_SINGLE_FINISHED)
+			out[count++] = g_queue_get_length(d->fragments);
+	}
+	for (guint i = 1; i < count; i++) {
+		for (guint j = i; j > 0 && out[j-1] > out[j]; j--) {
+			const guint t = out[j]; out[j] = out[j-1]; out[j-1] = t;
+		}
+	}
+	return count;
+}
+
+/* Encode the data fed while the destinations of the quorum lack fragments,
+ * and never ahead of them. */
+static void
+_ec_encode_pending (struct http_put_s *p)
+{
+	const gsize seg = oio_ec_get_segment_size(p->ec);
+	const guint quorum = MIN(oio_ec_get_k(p->ec) + 1,
+			oio_ec_get_k(p->ec) + oio_ec_get_m(p->ec));
+	guint backlogs[g_slist_length(p->dests) + 1];
+
+	for (;;) {
+		const guint count = _ec_backlogs(p, backlogs);
+		if (!count || backlogs[MIN(quorum, count) - 1] >= EC_MIN_QUEUED)
+			return;
+
+		GBytes *b = g_queue_peek_head(p->buffer_tail);
+		if (!b)
+			return;
+		gsize len = 0;
+		const guint8 *data = g_bytes_get_data(b, &len);
+
+		if (!len) {
+			/* the last segment is partial */
+			if (p->segment->len > 0) {
+				_ec_push_segment(p, p->segment->data, p->segment->len);
+				g_byte_array_set_size(p->segment, 0);
+			}
+			for (GSList *l = p->dests; l; l = l->next) {
+				struct http_put_dest_s *d = l->data;
+				if (d->state < HTTP_SINGLE_FINISHED)
+					g_queue_push_tail(d->fragments, g_bytes_new_static("", 0));
+			}
+		} else {
+			data += p->tail_offset;
+			len -= p->tail_offset;
+			/* whole segments are encoded without a copy */
+			if (!p->segment->len && len >= seg) {
+				_ec_push_segment(p, data, seg);
+				p->tail_offset += seg;
+				len -= seg;
+			} else {
+				const gsize n = MIN(len, seg - p->segment->len);
+				g_byte_array_append(p->segment, data, n);
+				p->tail_offset += n;
+				len -= n;
+				if (p->segment->len == seg) {
+					_ec_push_segment(p, p->segment->data, seg);
+					g_byte_array_set_size(p->segment, 0);
+				}
+			}
+			if (len > 0)
+				continue;
+		}
+		g_bytes_unref(g_queue_pop_head(p->buffer_tail));
+		p->tail_offset = 0;
+	}
+}
+
+static void
+_ec_feed (struct http_put_s *p, GBytes *b)
+{
+	const gsize len = g_bytes_get_size(b);
+	if (len > 0) {
+		g_checksum_update(p->metachunk_checksum,
+				g_bytes_get_data(b, NULL), len);
+		p->metachunk_size += len;
+		g_queue_push_tail(p->buffer_tail, b);
+	} else if (!p->eof) {
+		p->eof = TRUE;
+		g_queue_push_tail(p->buffer_tail, b);
+	} else {
+		g_bytes_unref(b);
+	}
+	_ec_encode_pending(p);
+}
+
 void
 http_put_feed (struct http_put_s *p, GBytes *b)
 {
@@ -280,7 +486,10 @@ http_put_feed (struct http_put_s *p, GBytes *b)
 	GRID_TRACE("%s (%p) <- %"G_GSIZE_FORMAT, __FUNCTION__, p, len);
 	EXTRA_ASSERT (len <= 0 || p->remaining_length < 0 || len <= p->remaining_length);
 
-	g_queue_push_tail (p->buffer_tail, b);
+	if (p->ec)
+		_ec_feed (p, b);
+	else
+		g_queue_push_tail (p->buffer_tail, b);
 
 	if (!len) { /* marker for end of stream */
 		p->remaining_length = 0;
@@ -289,6 +498,13 @@ http_put_feed (struct http_put_s *p, GBytes *b)
 	}
 }
 
+gboolean
+http_put_wants_data (struct http_put_s *p)
+{
+	EXTRA_ASSERT (p != NULL);
+	return !p->ec || g_queue_is_empty(p->buffer_tail);
+}
+
 gboolean
 http_put_done (struct http_put_s *p)
 {
@@ -336,6 +552,19 @@ http_put_get_http_code(struct http_put_s *p, gpointer k)
 	return 0;
 }
 
+const char *
+http_put_get_checksum(struct http_put_s *p, gpointer k)
+{
+	EXTRA_ASSERT(p != NULL);
+	EXTRA_ASSERT(k != NULL);
+	for (GSList *l=p->dests; l ;l=l->next) {
+		struct http_put_dest_s *dest = l->data;
+		if (dest && dest->user_data == k && dest->checksum)
+			return g_checksum_get_string(dest->checksum);
+	}
+	return NULL;
+}
+
 void
 http_put_get_md5(struct http_put_s *p, guint8 *buffer, gsize size)
 {
@@ -378,10 +607,13 @@ cb_read(char *data, size_t s, size_t n, struct http_put_dest_s *dest)
 	}
 
 	gsize bs = 0;
-	gconstpointer b = g_bytes_get_data (dest->buffer, &bs);
+	const guint8 *b = g_bytes_get_data (dest->buffer, &bs);
 
 	if (!b || !bs)
 		return _done_reading (dest, "EOF marker");
+	EXTRA_ASSERT (dest->buffer_offset < bs);
+	b += dest->buffer_offset;
+	bs -= dest->buffer_offset;
 
 	size_t remaining = dest->http_put->content_length - dest->bytes_sent;
 	size_t max = s * n;
@@ -393,10 +625,9 @@ cb_read(char *data, size_t s, size_t n, struct http_put_dest_s *dest)
 	if (real == bs) {
 		g_bytes_unref (dest->buffer);
 		dest->buffer = NULL;
+		dest->buffer_offset = 0;
 	} else {
-		GBytes *tmp = dest->buffer;
-		dest->buffer = g_bytes_new_from_bytes (tmp, real, bs - real);
-		g_bytes_unref (tmp);
+		dest->buffer_offset += real;
 	}
 
 	dest->bytes_sent += real;
@@ -440,6 +671,33 @@ cb_header(char *ptr, size_t size, size_t nmemb, void *raw_dest)
 	return len;
 }
 
+#if LIBCURL_VERSION_NUM >= 0x074000
+static int
+cb_trailer(struct curl_slist **list, struct http_put_dest_s *dest)
+{
+	struct http_put_s *p = dest->http_put;
+	gchar *mc_hash = g_ascii_strup(
+			g_checksum_get_string(p->metachunk_checksum), -1);
+	gchar *hash = g_ascii_strup(g_checksum_get_string(dest->checksum), -1);
+	gchar *tmp;
+
+	tmp = g_strdup_printf("%s: %"G_GINT64_FORMAT,
+			RAWX_HEADER_METACHUNK_SIZE, p->metachunk_size);
+	*list = curl_slist_append(*list, tmp);
+	g_free(tmp);
+	tmp = g_strdup_printf("%s: %s", RAWX_HEADER_METACHUNK_HASH, mc_hash);
+	*list = curl_slist_append(*list, tmp);
+	g_free(tmp);
+	tmp = g_strdup_printf("%s: %s", RAWX_HEADER_CHUNK_HASH, hash);
+	*list = curl_slist_append(*list, tmp);
+	g_free(tmp);
+
+	g_free(hash);
+	g_free(mc_hash);
+	return CURL_TRAILERFUNC_OK;
+}
+#endif
+
 static void
 _start_upload(struct http_put_s *p)
 {
@@ -466,6 +724,16 @@ _start_upload(struct http_put_s *p)
 		else
 			http_put_dest_add_header(dest, "Transfer-Encoding", "chunked");
 		http_put_dest_add_header(dest, "Expect", " ");
+#if LIBCURL_VERSION_NUM >= 0x074000
+		if (p->ec) {
+			http_put_dest_add_header(dest, "Trailer", "%s, %s, %s",
+					RAWX_HEADER_METACHUNK_SIZE, RAWX_HEADER_METACHUNK_HASH,
+					RAWX_HEADER_CHUNK_HASH);
+			curl_easy_setopt(dest->handle, CURLOPT_TRAILERFUNCTION,
+					(curl_trailer_callback)cb_trailer);
+			curl_easy_setopt(dest->handle, CURLOPT_TRAILERDATA, dest);
+		}
+#endif
 
 		curl_easy_setopt(dest->handle, CURLOPT_READFUNCTION,
 				(curl_read_callback)cb_read);
@@ -522,7 +790,56 @@ _manage_curl_events (struct http_put_s *p)
 			dest->handle = NULL;
 			g_bytes_unref(dest->buffer);
 			dest->buffer = NULL;
+			if (dest->fragments) {
+				g_queue_free_full(dest->fragments, (GDestroyNotify)g_bytes_unref);
+				dest->fragments = g_queue_new();
+			}
+		}
+	}
+}
+
+/* Abandon the destinations of an erasure-coded upload that lag too far
+ * behind the most advanced one, as long as a quorum of k+1 destinations
+ * keeps up. */
+static void
+_ec_drop_laggards (struct http_put_s *p)
+{
+	const guint k = oio_ec_get_k(p->ec), m = oio_ec_get_m(p->ec);
+	const guint quorum = MIN(k + 1, k + m);
+	guint backlogs[g_slist_length(p->dests) + 1];
+
+	const guint count = _ec_backlogs(p, backlogs);
+	if (!count)
+		return;
+	const guint max = backlogs[0] + EC_MAX_BACKLOG;
+	guint keeping_up = 0;
+	while (keeping_up < count && backlogs[keeping_up] <= max)
+		keeping_up ++;
+	if (keeping_up < quorum || keeping_up == count)
+		return;
+
+	for (GSList *l = p->dests; l; l = l->next) {
+		struct http_put_dest_s *d = l->data;
+		if (d->state == HTTP_SINGLE_FINISHED
+				|| g_queue_get_length(d->fragments) <= max)
+			continue;
+		GRID_WARN("Upload to [%s] abandoned: %u fragments late", d->url,
+				g_queue_get_length(d->fragments) - backlogs[0]);
+		if (d->handle) {
+			CURLMcode rc = curl_multi_remove_handle(p->mhandle, d->handle);
+			EXTRA_ASSERT(rc == CURLM_OK);
+			(void)rc;
+			curl_easy_cleanup(d->handle);
+			d->handle = NULL;
+		}
+		if (d->buffer) {
+			g_bytes_unref(d->buffer);
+			d->buffer = NULL;
 		}
+		g_queue_free_full(d->fragments, (GDestroyNotify)g_bytes_unref);
+		d->fragments = g_queue_new();
+		d->http_code = 0;
+		d->state = HTTP_SINGLE_FINISHED;
 	}
 }
 
@@ -572,7 +889,18 @@ http_put_step (struct http_put_s *p)
 			count_waiting_for_data ++;
 	}
 	EXTRA_ASSERT(count_waiting_for_data <= count_up);
-	if (count_waiting_for_data == count_up) {
+	if (p->ec) {
+		/* each destination is fed with its own fragments, at its own pace */
+		_ec_encode_pending(p);
+		_ec_drop_laggards(p);
+		for (GSList *l=p->dests; l ;l=l->next) {
+			struct http_put_dest_s *d = l->data;
+			if (!d->buffer && d->state < HTTP_SINGLE_FINISHED) {
+				d->buffer = g_queue_pop_head(d->fragments);
+				d->buffer_offset = 0;
+			}
+		}
+	} else if (count_waiting_for_data == count_up) {
 		GBytes *buf = g_queue_pop_head (p->buffer_tail);
 		if (buf) {
 			for (GSList *l=p->dests; l ;l=l->next) {
@@ -582,6 +910,7 @@ http_put_step (struct http_put_s *p)
 					d->buffer = NULL;
 				}
 				d->buffer = g_bytes_ref (buf);
+				d->buffer_offset = 0;
 			}
 			g_bytes_unref (buf);
 		}
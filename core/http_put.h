@@ -27,12 +27,21 @@ extern "C" {
 #include <glib.h>
 
 struct http_put_s;
+struct oio_ec_s;
 
 /* Create a new http put request. Specifying <content_length> and <soft_length>
  * both equal to -1 means a pure streamed upload. */
 struct http_put_s * http_put_create (gint64 content_length,
 		gint64 soft_length);
 
+/* Create an erasure-coded streamed upload, with one destination per
+ * fragment. The data fed is cut into segments, each segment is encoded and
+ * each destination receives its own fragment, then the metachunk size and
+ * hash and the checksum of the fragments as trailers. <ec> must outlive the
+ * upload. Returns NULL if libcurl cannot send trailers. */
+struct http_put_s * http_put_create_ec (struct oio_ec_s *ec,
+		gint64 soft_length);
+
 /* Add a new destination where to send data.
  * @param p http request handle
  * @param url destination url
@@ -45,12 +54,21 @@ struct http_put_s * http_put_create (gint64 content_length,
 struct http_put_dest_s *http_put_add_dest(struct http_put_s *p,
 		const char *url, gpointer k);
 
+/* Set the index of the fragments sent to this destination of an
+ * erasure-coded upload. Defaults to the rank of the destination. */
+void http_put_dest_set_fragment(struct http_put_dest_s *dest, guint index);
+
 /* Add a header for this destination. */
 void http_put_dest_add_header(struct http_put_dest_s *dest, const char *key,
 		const char *fmt, ...) __attribute__ ((format (printf, 3, 4)));
 
 void http_put_feed (struct http_put_s *p, GBytes *b);
 
+/* FALSE while the data already fed to an erasure-coded upload waits to be
+ * encoded: the caller should step the upload before feeding more. Always
+ * TRUE for a replicated upload. */
+gboolean http_put_wants_data (struct http_put_s *p);
+
 GError * http_put_step (struct http_put_s *p);
 
 gboolean http_put_done (struct http_put_s *p);
@@ -85,6 +103,16 @@ const char *http_put_get_header(struct http_put_s *p, gpointer k, const char *he
  */
 guint http_put_get_http_code(struct http_put_s *p, gpointer k);
 
+/* Get the MD5 of the fragments sent to the destination represented by its
+ * user_data, for an erasure-coded upload. To be called once the upload is
+ * done.
+ * @param p http put handle
+ * @param k data pointer used to add a destination
+ * @return the hexadecimal hash, or NULL if k is not found or the upload is
+ * not erasure-coded
+ * @note the return value must not be freed by caller. */
+const char *http_put_get_checksum(struct http_put_s *p, gpointer k);
+
 /* Free http_put and all destinations
  * @param p http_put to free
  */
@@ -287,6 +287,22 @@ struct oio_sds_dl_src_s
 struct oio_error_s* oio_sds_download (struct oio_sds_s *sds,
 		struct oio_sds_dl_src_s *src, struct oio_sds_dl_dst_s *dst);
 
+/** Counters of the reads of the replicated chunks, since the creation of
+ * the client. hedged/reads is the hedge rate, hedge_wins/hedged the ratio
+ * of the hedged reads answering first. */
+struct oio_sds_dl_stats_s
+{
+	/** The reads of a replicated part, hedged reads excluded */
+	size_t reads;
+	/** The reads started on a second chunk, the first one being late */
+	size_t hedged;
+	/** The hedged reads that answered before the read they hedged */
+	size_t hedge_wins;
+};
+
+void oio_sds_get_download_stats (struct oio_sds_s *sds,
+		struct oio_sds_dl_stats_s *out);
+
 /**
  * Downloads the whole file
  * works with fully qualified urls (content) and local paths
@@ -371,6 +387,13 @@ struct oio_error_s * oio_sds_upload_prepare (struct oio_sds_ul_s *ul,
 struct oio_error_s * oio_sds_upload_feed (struct oio_sds_ul_s *ul,
 		const unsigned char *buf, size_t len);
 
+/** Like oio_sds_upload_feed(), but the <len> bytes at <buf> are not copied:
+ * they are borrowed until <release> is called with <u>. <release> may be
+ * NULL if the memory outlives the upload. */
+struct oio_error_s * oio_sds_upload_feed_borrowed (struct oio_sds_ul_s *ul,
+		const unsigned char *buf, size_t len,
+		void (*release) (void *u), void *u);
+
 struct oio_error_s * oio_sds_upload_step (struct oio_sds_ul_s *ul);
 
 struct oio_error_s * oio_sds_upload_commit (struct oio_sds_ul_s *ul);
@@ -422,7 +445,9 @@ struct oio_error_s* oio_sds_upload (struct oio_sds_s *sds,
 		struct oio_sds_ul_src_s *src, struct oio_sds_ul_dst_s *dst);
 
 /** Simply wraps oio_sds_upload() without the autocreation flag
- * set. */
+ * set. A regular file is read, or uploaded from a read-only mapping when
+ * core.sds.upload.mmap is true: truncating it during the upload then raises
+ * SIGBUS in the caller. */
 struct oio_error_s* oio_sds_upload_from_file (struct oio_sds_s *sds,
 		struct oio_sds_ul_dst_s *dst, const char *local,
 		size_t off, size_t len);
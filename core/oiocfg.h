@@ -148,6 +148,14 @@ extern "C" {
 #  define RAWX_HEADER_CHUNK_HASH RAWX_HEADER_PREFIX "chunk-hash"
 # endif
 
+# ifndef RAWX_HEADER_METACHUNK_HASH
+#  define RAWX_HEADER_METACHUNK_HASH RAWX_HEADER_PREFIX "metachunk-hash"
+# endif
+
+# ifndef RAWX_HEADER_METACHUNK_SIZE
+#  define RAWX_HEADER_METACHUNK_SIZE RAWX_HEADER_PREFIX "metachunk-size"
+# endif
+
 # ifndef RAWX_HEADER_CHUNKS_NB
 #  define RAWX_HEADER_CHUNKS_NB RAWX_HEADER_PREFIX "chunks-nb"
 # endif
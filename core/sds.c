@@ -19,10 +19,12 @@ License along with this library.
 
 #include <core/oio_sds.h>
 
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <json.h>
@@ -32,6 +34,7 @@ License along with this library.
 #include <core/client_variables.h>
 #include <metautils/lib/metautils.h>
 
+#include "ec.h"
 #include "http_put.h"
 #include "http_del.h"
 #include "http_internals.h"
@@ -53,7 +56,15 @@ struct oio_sds_s
 
 	GMutex curl_lock;
 	CURL *curl_handle;
+	/* Keeps the connections to the rawx services between the downloads */
+	CURLM *curl_multi;
 	gint64 chunk_size;
+
+	/* The latencies of the reads, per rawx service, and the counters of the
+	 * hedged reads */
+	GMutex stats_lock;
+	GHashTable *rawx_latencies;
+	struct oio_sds_dl_stats_s dl_stats;
 };
 
 struct oio_error_s;
@@ -106,6 +117,35 @@ _release_proxy_handle(struct oio_sds_s *sds, CURL *h)
 		curl_easy_cleanup(old);
 }
 
+static CURLM *
+_get_download_multi (struct oio_sds_s *sds)
+{
+	CURLM *out = NULL;
+
+	g_mutex_lock(&sds->curl_lock);
+	out = sds->curl_multi;
+	sds->curl_multi = NULL;
+	g_mutex_unlock(&sds->curl_lock);
+
+	if (!out)
+		out = curl_multi_init();
+	return out;
+}
+
+static void
+_release_download_multi (struct oio_sds_s *sds, CURLM *m)
+{
+	CURLM *old = NULL;
+
+	g_mutex_lock(&sds->curl_lock);
+	old = sds->curl_multi;
+	sds->curl_multi = m;
+	g_mutex_unlock(&sds->curl_lock);
+
+	if (old)
+		curl_multi_cleanup(old);
+}
+
 /* Chunk parsing helpers (JSON) --------------------------------------------- */
 
 struct chunk_position_s
@@ -481,6 +521,9 @@ oio_sds_init (struct oio_sds_s **out, const char *ns)
 	(*out)->admin = FALSE;
 	g_mutex_init(&((*out)->curl_lock));
 	(*out)->chunk_size = 0;
+	g_mutex_init(&((*out)->stats_lock));
+	(*out)->rawx_latencies = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, g_free);
 
 	return NULL;
 }
@@ -493,7 +536,11 @@ oio_sds_free (struct oio_sds_s *sds)
 	oio_str_clean (&sds->proxy);
 	if (sds->curl_handle)
 		curl_easy_cleanup (sds->curl_handle);
+	if (sds->curl_multi)
+		curl_multi_cleanup (sds->curl_multi);
 	g_mutex_clear(&(sds->curl_lock));
+	g_hash_table_destroy (sds->rawx_latencies);
+	g_mutex_clear(&(sds->stats_lock));
 	g_slice_free (struct oio_sds_s, sds);
 }
 
@@ -655,6 +702,18 @@ struct _download_ctx_s
 
 	struct metachunk_s **metachunks;
 	GSList *chunks;
+
+	/* The parts of the ranges to be downloaded, in order */
+	GPtrArray *parts;
+	CURLM *mhandle;
+	/* The next part to be started, and the head of the window: the part
+	 * whose data is given to the application. */
+	guint next_started;
+	guint next_delivered;
+	/* Set when the application refused some data */
+	GError *hook_error;
+	/* The codec of the erasure-coded contents */
+	struct oio_ec_s *ec;
 };
 
 static void
@@ -688,162 +747,784 @@ _dl_debug (const char *caller, struct oio_sds_dl_src_s *src,
 	g_string_free (out, TRUE);
 }
 
-/* The range is relative to the chunk */
-static GError *
-_download_range_from_chunk (struct _download_ctx_s *dl,
-		const struct oio_sds_dl_range_s *range, const char *c0_url,
-		const char * const *headers_opt, size_t *p_nbread)
-{
-	size_t _write_wrapper (char *data, size_t s, size_t n, void *ignored UNUSED) {
-		size_t total = s*n;
-		if (total + *p_nbread > range->size) {
-			GRID_WARN("server gave us more data than expected "
-					"(%"G_GSIZE_FORMAT"/%"G_GSIZE_FORMAT")",
-					total, (size_t)(range->size - *p_nbread));
-			total = range->size - *p_nbread;
+/* Parallel download ---------------------------------------------------------
+ * The ranges are cut into parts, each relative to a metachunk. A window of
+ * parts is fetched in parallel, on a curl multi handle kept by the client
+ * with its connections. The data is given in order to the sequential hook:
+ * the head of the window streams directly to the hook, the parts after it
+ * are buffered until they become the head.
+ * A replicated part is read from one of the chunks, and from the next one
+ * on a failure. An erasure-coded part reads the fragments of whole segments
+ * from k chunks at once, and decodes them when k fragments are complete.
+ * A parity fragment is read in place of each fragment that fails, and in
+ * addition to them when they are late. */
+
+/* Replica latencies ---------------------------------------------------------
+ * The client keeps, per rawx service, an EWMA and the recent samples of the
+ * time to the first byte of its reads, a failed read counting as the longest
+ * hedging delay. The replicas much slower than the best
+ * one are read last, and a replicated part is read from a second replica
+ * after the recent p99 latency of the first one. */
+
+#define RAWX_LATENCY_SAMPLES 64
+
+struct _rawx_latency_s
+{
+	gint64 ewma;
+	gint64 samples[RAWX_LATENCY_SAMPLES];
+	guint count;
+};
+
+/* The "host:port" of the chunk URL */
+static gchar *
+_chunk_service (const struct chunk_s *chunk)
+{
+	const char *s = strstr (chunk->url, "://");
+	s = s ? s + 3 : chunk->url;
+	const char *e = strchr (s, '/');
+	return e ? g_strndup (s, e - s) : g_strdup (s);
+}
+
+static void
+_rawx_latency_record (struct oio_sds_s *sds, const struct chunk_s *chunk,
+		gint64 latency)
+{
+	gchar *key = _chunk_service (chunk);
+	g_mutex_lock (&sds->stats_lock);
+	struct _rawx_latency_s *l = g_hash_table_lookup (sds->rawx_latencies, key);
+	if (!l) {
+		l = g_malloc0 (sizeof(*l));
+		l->ewma = latency;
+		g_hash_table_insert (sds->rawx_latencies, key, l);
+		key = NULL;
+	} else {
+		l->ewma = (7 * l->ewma + latency) / 8;
+	}
+	l->samples[l->count++ % RAWX_LATENCY_SAMPLES] = latency;
+	g_mutex_unlock (&sds->stats_lock);
+	g_free (key);
+}
+
+static int
+_cmp_gint64 (const void *p0, const void *p1)
+{
+	const gint64 i0 = *(const gint64*)p0, i1 = *(const gint64*)p1;
+	return CMP(i0, i1);
+}
+
+/* The EWMA latency of the service of the chunk (0 if unknown), and its
+ * recent p99 (-1 with too few samples). */
+static gint64
+_rawx_latency_get (struct oio_sds_s *sds, const struct chunk_s *chunk,
+		gint64 *p99)
+{
+	gint64 samples[RAWX_LATENCY_SAMPLES], ewma = 0;
+	guint count = 0;
+
+	gchar *key = _chunk_service (chunk);
+	g_mutex_lock (&sds->stats_lock);
+	struct _rawx_latency_s *l = g_hash_table_lookup (sds->rawx_latencies, key);
+	if (l) {
+		ewma = l->ewma;
+		count = MIN(l->count, RAWX_LATENCY_SAMPLES);
+		memcpy (samples, l->samples, count * sizeof(gint64));
+	}
+	g_mutex_unlock (&sds->stats_lock);
+	g_free (key);
+
+	if (p99) {
+		*p99 = -1;
+		if (count >= 8) {
+			qsort (samples, count, sizeof(gint64), _cmp_gint64);
+			*p99 = samples[(count * 99) / 100];
 		}
+	}
+	return ewma;
+}
 
-		/* TODO compute a MD5SUM */
+/* Move the replicas more than twice slower than the fastest known one at the
+ * end of their metachunk, keeping the order of the others. */
+static void
+_download_order_replicas (struct _download_ctx_s *dl)
+{
+	for (struct metachunk_s **p = dl->metachunks; *p; ++p) {
+		struct metachunk_s *meta = *p;
+		const guint n = g_slist_length (meta->chunks);
+		gint64 latencies[n], best = G_MAXINT64;
+		guint i = 0;
+		for (GSList *l = meta->chunks; l; l = l->next, i++) {
+			latencies[i] = _rawx_latency_get (dl->sds, l->data, NULL);
+			if (latencies[i] > 0)
+				best = MIN(best, latencies[i]);
+		}
+		if (best == G_MAXINT64)
+			continue;
+
+		GSList *fast = NULL, *slow = NULL;
+		i = 0;
+		for (GSList *l = meta->chunks; l; l = l->next, i++) {
+			if (latencies[i] > 2 * best)
+				slow = g_slist_prepend (slow, l->data);
+			else
+				fast = g_slist_prepend (fast, l->data);
+		}
+		g_slist_free (meta->chunks);
+		meta->chunks = g_slist_concat (g_slist_reverse (fast),
+				g_slist_reverse (slow));
+	}
+}
 
-		int sent = dl->dst->data.hook.cb(dl->dst->data.hook.ctx,
-				(const unsigned char*)data, total);
-		if ((size_t)sent == total) {
-			GRID_TRACE("user callback managed %"G_GSIZE_FORMAT" bytes", total);
-			*p_nbread += (size_t ) sent;
-			return s*n;  // Make libcurl think we read the whole buffer
-		} else {
-			GRID_WARN("user callback failed: %d/%"G_GSIZE_FORMAT" bytes sent",
-					  sent, total);
-			return sent;
+void
+oio_sds_get_download_stats (struct oio_sds_s *sds,
+		struct oio_sds_dl_stats_s *out)
+{
+	if (!sds || !out)
+		return;
+	g_mutex_lock (&sds->stats_lock);
+	*out = sds->dl_stats;
+	g_mutex_unlock (&sds->stats_lock);
+}
+
+struct _download_part_s;
+
+/* One request to one chunk */
+struct _download_fetch_s
+{
+	struct _download_part_s *part;
+	struct chunk_s *chunk;
+	/* The next byte expected, relative to the chunk, and how many bytes
+	 * are still expected */
+	gsize offset;
+	gsize size;
+	/* The fragments received, for an erasure-coded part */
+	GByteArray *buffer;
+	CURL *handle;
+	struct oio_headers_s headers;
+	/* When the request started, and when its first byte arrived */
+	gint64 started;
+	gint64 first_byte;
+	guint8 flag_done : 1;
+	/* The request lost a race against a hedged request */
+	guint8 flag_cancelled : 1;
+};
+
+struct _download_part_s
+{
+	struct _download_ctx_s *dl;
+	struct metachunk_s *meta;
+	guint index;
+	/* The range still expected, relative to the metachunk */
+	gsize offset;
+	gsize size;
+	/* What has been received (or decoded) while the part was not the head */
+	GByteArray *buffer;
+
+	/* Replicated: the chunks not attempted yet, the current attempt, and
+	 * the hedged attempt racing against it until one of them answers */
+	GSList *next_chunks;
+	struct _download_fetch_s *fetch;
+	struct _download_fetch_s *hedge;
+
+	/* Erasure-coded: the segments [seg_first, seg_first + seg_count) are
+	 * read, the range starting <skip> bytes after the first one. Both
+	 * arrays are indexed by the position of the chunk in the metachunk,
+	 * <frags> is NULL on the positions not attempted yet. */
+	guint seg_first;
+	guint seg_count;
+	gsize skip;
+	struct chunk_s **frag_chunks;
+	struct _download_fetch_s **frags;
+	guint frags_running;
+	guint frags_done;
+	gint64 hedge_deadline;
+
+	guint8 flag_started : 1;
+	guint8 flag_done : 1;
+};
+
+static gboolean
+_download_deliver (struct _download_ctx_s *dl, const guint8 *data, gsize len)
+{
+	if (!len)
+		return TRUE;
+	int sent = dl->dst->data.hook.cb(dl->dst->data.hook.ctx, data, len);
+	if (sent < 0 || (gsize)sent != len) {
+		GRID_WARN("user callback failed: %d/%"G_GSIZE_FORMAT" bytes sent",
+				sent, len);
+		if (!dl->hook_error)
+			dl->hook_error = SYSERR("Download: user callback failed");
+		return FALSE;
+	}
+	GRID_TRACE("user callback managed %"G_GSIZE_FORMAT" bytes", len);
+	dl->dst->out_size += len;
+	return TRUE;
+}
+
+static size_t
+_download_fetch_write (char *data, size_t s, size_t n,
+		struct _download_fetch_s *fetch)
+{
+	struct _download_part_s *part = fetch->part;
+	struct _download_ctx_s *dl = part->dl;
+
+	/* Do not mistake the body of an error for data */
+	long code = 0;
+	curl_easy_getinfo(fetch->handle, CURLINFO_RESPONSE_CODE, &code);
+	if (2 != (code/100))
+		return s*n;
+
+	if (!fetch->first_byte) {
+		fetch->first_byte = oio_ext_monotonic_time ();
+		_rawx_latency_record (dl->sds, fetch->chunk,
+				fetch->first_byte - fetch->started);
+	}
+
+	/* The first replica to answer wins the race */
+	if (part->hedge) {
+		if (fetch->flag_cancelled)
+			return 0;
+		if (fetch == part->hedge) {
+			part->hedge = part->fetch;
+			part->fetch = fetch;
+			g_mutex_lock (&dl->sds->stats_lock);
+			dl->sds->dl_stats.hedge_wins ++;
+			g_mutex_unlock (&dl->sds->stats_lock);
 		}
+		/* The loser is at least as slow as it lasted */
+		if (!part->hedge->first_byte && !part->hedge->flag_cancelled)
+			_rawx_latency_record (dl->sds, part->hedge->chunk,
+					fetch->first_byte - part->hedge->started);
+		part->hedge->flag_cancelled = 1;
 	}
 
-	GError *err = NULL;
+	size_t total = s*n;
+	if (total > fetch->size) {
+		GRID_WARN("server gave us more data than expected "
+				"(%"G_GSIZE_FORMAT"/%"G_GSIZE_FORMAT")", total, fetch->size);
+		total = fetch->size;
+	}
+
+	/* TODO compute a MD5SUM */
+
+	if (part->frags) {
+		g_byte_array_append(fetch->buffer, (const guint8*)data, total);
+	} else if (part->index == dl->next_delivered) {
+		EXTRA_ASSERT(part->buffer->len == 0);
+		if (!_download_deliver(dl, (const guint8*)data, total))
+			return 0;
+	} else {
+		g_byte_array_append(part->buffer, (const guint8*)data, total);
+	}
+	if (!part->frags) {
+		part->offset += total;
+		part->size -= total;
+	}
+	fetch->offset += total;
+	fetch->size -= total;
+	return s*n;  // Make libcurl think we read the whole buffer
+}
+
+static GError *
+_download_fetch_start (struct _download_part_s *part, struct chunk_s *chunk,
+		gsize offset, gsize size, struct _download_fetch_s **out)
+{
+	struct _download_fetch_s *fetch = g_malloc0 (sizeof(*fetch));
+	fetch->part = part;
+	fetch->chunk = chunk;
+	fetch->offset = offset;
+	fetch->size = size;
+	fetch->started = oio_ext_monotonic_time ();
+	if (part->frags)
+		fetch->buffer = g_byte_array_sized_new (size);
+	*out = fetch;
 
 	gchar str_range[64] = "";
 	g_snprintf (str_range, sizeof(str_range),
 			"bytes=%"G_GSIZE_FORMAT"-%"G_GSIZE_FORMAT,
-			range->offset, range->offset + range->size - 1);
-	GRID_TRACE ("%s Range:%s %s", __FUNCTION__, str_range, c0_url);
-
-	CURL *h = _curl_get_handle_blob ();
-	struct oio_headers_s headers = {NULL,NULL};
-	oio_headers_common (&headers);
-	oio_headers_add (&headers, "Range", str_range);
-	if (headers_opt != NULL)
-		for (; headers_opt[0] && headers_opt[1]; headers_opt += 2)
-			oio_headers_add(&headers, headers_opt[0], headers_opt[1]);
-	curl_easy_setopt (h, CURLOPT_HTTPHEADER, headers.headers);
-	curl_easy_setopt (h, CURLOPT_CUSTOMREQUEST, "GET");
-	curl_easy_setopt (h, CURLOPT_URL, c0_url);
-	curl_easy_setopt (h, CURLOPT_WRITEFUNCTION, _write_wrapper);
-	curl_easy_setopt (h, CURLOPT_WRITEDATA, dl->dst->data.hook.ctx);
-
-	CURLcode rc = curl_easy_perform (h);
-	if (rc != CURLE_OK) {
-		err = SYSERR("CURL: download error [%s]: (%d) %s", c0_url,
-				rc, curl_easy_strerror(rc));
-	} else {
-		long code = 0;
-		rc = curl_easy_getinfo (h, CURLINFO_RESPONSE_CODE, &code);
-		if (2 != (code/100))
-			err = SYSERR("Download: (%ld)", code);
+			offset, offset + size - 1);
+	GRID_TRACE ("%s Range:%s %s", __FUNCTION__, str_range, chunk->url);
+
+	fetch->handle = _curl_get_handle_blob ();
+	/* The connections are kept by the multi handle, for the next fetches */
+	curl_easy_setopt (fetch->handle, CURLOPT_FORBID_REUSE, 0L);
+	curl_easy_setopt (fetch->handle, CURLOPT_FRESH_CONNECT, 0L);
+	oio_headers_common (&fetch->headers);
+	oio_headers_add (&fetch->headers, "Range", str_range);
+	curl_easy_setopt (fetch->handle, CURLOPT_HTTPHEADER, fetch->headers.headers);
+	curl_easy_setopt (fetch->handle, CURLOPT_CUSTOMREQUEST, "GET");
+	curl_easy_setopt (fetch->handle, CURLOPT_URL, chunk->url);
+	curl_easy_setopt (fetch->handle, CURLOPT_WRITEFUNCTION, _download_fetch_write);
+	curl_easy_setopt (fetch->handle, CURLOPT_WRITEDATA, fetch);
+	curl_easy_setopt (fetch->handle, CURLOPT_PRIVATE, fetch);
+
+	CURLMcode rc = curl_multi_add_handle (part->dl->mhandle, fetch->handle);
+	if (rc != CURLM_OK)
+		return SYSERR("CURL: multi error: %s", curl_multi_strerror(rc));
+	return NULL;
+}
+
+static void
+_download_fetch_stop (struct _download_fetch_s *fetch)
+{
+	if (!fetch->handle)
+		return;
+	curl_multi_remove_handle (fetch->part->dl->mhandle, fetch->handle);
+	curl_easy_cleanup (fetch->handle);
+	fetch->handle = NULL;
+	oio_headers_clear (&fetch->headers);
+}
+
+static void
+_download_fetch_free (struct _download_fetch_s *fetch)
+{
+	if (!fetch)
+		return;
+	_download_fetch_stop (fetch);
+	if (fetch->buffer)
+		g_byte_array_free (fetch->buffer, TRUE);
+	g_free (fetch);
+}
+
+static void
+_download_part_free (struct _download_part_s *part)
+{
+	if (!part)
+		return;
+	_download_fetch_free (part->fetch);
+	_download_fetch_free (part->hedge);
+	if (part->frags) {
+		const guint n = oio_ec_get_k(part->dl->ec) + oio_ec_get_m(part->dl->ec);
+		for (guint i = 0; i < n; i++)
+			_download_fetch_free (part->frags[i]);
+		g_free (part->frags);
+	}
+	g_free (part->frag_chunks);
+	g_byte_array_free (part->buffer, TRUE);
+	g_free (part);
+}
+
+/* Erasure-coded parts -------------------------------------------------------*/
+
+static gsize
+_ec_segment_size (struct _download_part_s *part, guint seg)
+{
+	const gsize seg_size = oio_ec_get_segment_size (part->dl->ec);
+	return MIN(seg_size, part->meta->size - seg * seg_size);
+}
+
+/* Start a fetch on the next position not attempted yet, the data positions
+ * coming first. */
+static GError *
+_download_ec_start_next (struct _download_part_s *part, gboolean *started)
+{
+	struct oio_ec_s *ec = part->dl->ec;
+	const guint n = oio_ec_get_k(ec) + oio_ec_get_m(ec);
+
+	*started = FALSE;
+	for (guint pos = 0; pos < n; pos++) {
+		if (part->frags[pos] || !part->frag_chunks[pos])
+			continue;
+
+		/* All the segments before the range are complete */
+		const gsize full = oio_ec_get_fragment_size (ec,
+				oio_ec_get_segment_size (ec));
+		gsize size = 0;
+		for (guint s = 0; s < part->seg_count; s++)
+			size += oio_ec_get_fragment_size (ec,
+					_ec_segment_size (part, part->seg_first + s));
+
+		*started = TRUE;
+		part->frags_running ++;
+		return _download_fetch_start (part, part->frag_chunks[pos],
+				part->seg_first * full, size, part->frags + pos);
 	}
+	return NULL;
+}
 
-	curl_easy_cleanup (h);
-	oio_headers_clear (&headers);
+static GError *
+_download_ec_start (struct _download_part_s *part)
+{
+	const guint k = oio_ec_get_k (part->dl->ec);
+	gboolean started = TRUE;
+	GError *err = NULL;
+
+	while (!err && started && part->frags_running < k)
+		err = _download_ec_start_next (part, &started);
+	if (!err && part->frags_running < k)
+		err = ERRPTF("Not enough chunks: %u/%u", part->frags_running, k);
+	if (!err && oio_sds_download_ec_hedge_delay > 0)
+		part->hedge_deadline =
+			oio_ext_monotonic_time () + oio_sds_download_ec_hedge_delay;
 	return err;
 }
 
-/* the range is relative to the segment of the metachunk
- * Until there are available chunks, take the next chunk (they are equally
- * capable replicas) and attempt a read. */
 static GError *
-_download_range_from_metachunk_replicated (struct _download_ctx_s *dl,
-		const struct oio_sds_dl_range_s *range, struct metachunk_s *meta)
+_download_ec_decode (struct _download_part_s *part)
 {
-	GRID_TRACE("%s", __FUNCTION__);
-	struct oio_sds_dl_range_s r0 = *range;
-	GSList *tail_chunks = meta->chunks;
-
-	while (r0.size > 0) {
-		GRID_TRACE("%s at %"G_GSIZE_FORMAT"+%"G_GSIZE_FORMAT,
-				__FUNCTION__, r0.offset, r0.size);
-
-		if (!tail_chunks)
-			return ERRPTF("Too many failures");
-		struct chunk_s *chunk = tail_chunks->data;
-		tail_chunks = tail_chunks->next;
-
-		/* Attempt a read */
-		size_t nbread = 0;
-		GError *err = _download_range_from_chunk (dl, range,
-				chunk->url, NULL, &nbread);
-		EXTRA_ASSERT (nbread <= r0.size);
-		if (err) {
-			/* TODO manage the error kind to allow a retry */
-			return err;
-		} else {
-			dl->dst->out_size += nbread;
-			if (r0.size == G_MAXSIZE) {
-				r0.size = 0;
-			} else {
-				r0.offset += nbread;
-				r0.size -= nbread;
-			}
+	struct oio_ec_s *ec = part->dl->ec;
+	const guint n = oio_ec_get_k(ec) + oio_ec_get_m(ec);
+	GError *err = NULL;
+
+	/* The fragments still running are useless */
+	for (guint pos = 0; pos < n; pos++) {
+		if (part->frags[pos])
+			_download_fetch_stop (part->frags[pos]);
+	}
+	part->frags_running = 0;
+
+	gsize frag_offset = 0;
+	for (guint s = 0; !err && s < part->seg_count; s++) {
+		const gsize frag_size = oio_ec_get_fragment_size (ec,
+				_ec_segment_size (part, part->seg_first + s));
+		const guint8 *frags[n];
+		for (guint pos = 0; pos < n; pos++) {
+			struct _download_fetch_s *fetch = part->frags[pos];
+			frags[pos] = (fetch && fetch->flag_done) ?
+				fetch->buffer->data + frag_offset : NULL;
 		}
+		err = oio_ec_decode (ec, frags, frag_size, part->buffer);
+		frag_offset += frag_size;
+	}
+
+	if (!err && part->buffer->len < part->skip + part->size)
+		err = NEWERROR(CODE_CONTENT_CORRUPTED,
+				"Download: EC segments shorter than expected");
+	if (!err) {
+		g_byte_array_remove_range (part->buffer, 0, part->skip);
+		g_byte_array_set_size (part->buffer, part->size);
+		part->offset += part->size;
+		part->size = 0;
+		part->flag_done = 1;
 	}
+	return err;
+}
+
+static GError *
+_download_ec_finish (struct _download_part_s *part,
+		struct _download_fetch_s *fetch, GError *err)
+{
+	const guint k = oio_ec_get_k (part->dl->ec);
 
+	part->frags_running --;
+	if (!err) {
+		fetch->flag_done = 1;
+		if (++part->frags_done >= k)
+			return _download_ec_decode (part);
+		return NULL;
+	}
+
+	GRID_DEBUG("%s, reading another fragment", err->message);
+	g_clear_error (&err);
+	gboolean started = FALSE;
+	if ((err = _download_ec_start_next (part, &started)))
+		return err;
+	if (part->frags_running + part->frags_done < k)
+		return ERRPTF("Too many failures: %u fragments available, %u required",
+				part->frags_running + part->frags_done, k);
 	return NULL;
 }
 
-/* The range is relative to the metachunk, not the whole content */
+/* Read one more fragment of the parts late to complete */
+static GError *
+_download_ec_hedge (struct _download_ctx_s *dl, gint64 *next_deadline)
+{
+	const gint64 now = oio_ext_monotonic_time ();
+	GError *err = NULL;
+
+	for (guint i = dl->next_delivered; !err && i < dl->next_started; i++) {
+		struct _download_part_s *part = dl->parts->pdata[i];
+		if (part->flag_done || !part->hedge_deadline)
+			continue;
+		if (part->hedge_deadline <= now) {
+			gboolean started = FALSE;
+			err = _download_ec_start_next (part, &started);
+			if (started)
+				GRID_DEBUG("Download: hedged EC read, %u fragments running",
+						part->frags_running);
+			part->hedge_deadline = started ?
+				now + oio_sds_download_ec_hedge_delay : 0;
+		}
+		if (part->hedge_deadline && (!*next_deadline
+					|| part->hedge_deadline < *next_deadline))
+			*next_deadline = part->hedge_deadline;
+	}
+	return err;
+}
+
+/* Generic parts -------------------------------------------------------------*/
+
+/* Attempt a read of what remains of the part, on the next chunk */
+static GError *
+_download_part_start (struct _download_part_s *part)
+{
+	part->flag_started = 1;
+	if (part->frags)
+		return _download_ec_start (part);
+
+	EXTRA_ASSERT(part->fetch == NULL);
+	if (!part->next_chunks)
+		return ERRPTF("Too many failures");
+	struct chunk_s *chunk = part->next_chunks->data;
+	part->next_chunks = part->next_chunks->next;
+	g_mutex_lock (&part->dl->sds->stats_lock);
+	part->dl->sds->dl_stats.reads ++;
+	g_mutex_unlock (&part->dl->sds->stats_lock);
+	return _download_fetch_start (part, chunk, part->offset, part->size,
+			&part->fetch);
+}
+
+/* Read the replicated parts from one more chunk when the current one has not
+ * answered after the recent p99 latency of its service. */
 static GError *
-_download_range_from_metachunk (struct _download_ctx_s *dl,
-		struct oio_sds_dl_range_s *range, struct metachunk_s *meta)
+_download_replicated_hedge (struct _download_ctx_s *dl, gint64 *next_deadline)
 {
-	GRID_TRACE ("%s %"G_GSIZE_FORMAT"+%"G_GSIZE_FORMAT
-			" chunk-method=%s from [%i] #=%u %"G_GSIZE_FORMAT"+%"G_GSIZE_FORMAT,
-			__FUNCTION__, range->offset, range->size, dl->chunk_method,
-			meta->meta, g_slist_length (meta->chunks),
-			meta->offset, meta->size);
+	const gint64 now = oio_ext_monotonic_time ();
+	GError *err = NULL;
 
-	EXTRA_ASSERT (meta->chunks != NULL);
-	EXTRA_ASSERT (range->offset < meta->size);
-	EXTRA_ASSERT (range->size <= meta->size);
-	EXTRA_ASSERT (range->offset + range->size <= meta->size);
+	for (guint i = dl->next_delivered; !err && i < dl->next_started; i++) {
+		struct _download_part_s *part = dl->parts->pdata[i];
+
+		/* The loser of a race is dropped */
+		if (part->hedge && part->hedge->flag_cancelled) {
+			_download_fetch_free (part->hedge);
+			part->hedge = NULL;
+		}
+		if (part->flag_done || part->hedge || !part->fetch
+				|| part->fetch->first_byte || !part->next_chunks)
+			continue;
+
+		gint64 delay = 0;
+		_rawx_latency_get (dl->sds, part->fetch->chunk, &delay);
+		if (delay < 0)
+			delay = oio_sds_download_hedge_delay_max;
+		delay = CLAMP(delay, oio_sds_download_hedge_delay_min,
+				oio_sds_download_hedge_delay_max);
+		const gint64 deadline = part->fetch->started + delay;
+		if (deadline > now) {
+			if (!*next_deadline || deadline < *next_deadline)
+				*next_deadline = deadline;
+			continue;
+		}
 
-	return _download_range_from_metachunk_replicated (dl, range, meta);
+		struct chunk_s *chunk = part->next_chunks->data;
+		part->next_chunks = part->next_chunks->next;
+		GRID_DEBUG("Download: hedged read of [%s] after %"G_GINT64_FORMAT"ms",
+				chunk->url, delay / G_TIME_SPAN_MILLISECOND);
+		g_mutex_lock (&dl->sds->stats_lock);
+		dl->sds->dl_stats.hedged ++;
+		g_mutex_unlock (&dl->sds->stats_lock);
+		err = _download_fetch_start (part, chunk, part->offset, part->size,
+				&part->hedge);
+	}
+	return err;
 }
 
-/* The range is relative to the whole content */
+/* An attempt ended: the part is complete, or what remains of it is read from
+ * another chunk. */
 static GError *
-_download_range (struct _download_ctx_s *dl, struct oio_sds_dl_range_s *range)
+_download_fetch_finish (struct _download_fetch_s *fetch, CURLcode rc)
+{
+	struct _download_part_s *part = fetch->part;
+	struct _download_ctx_s *dl = part->dl;
+	GError *err = NULL;
+
+	long code = 0;
+	curl_easy_getinfo (fetch->handle, CURLINFO_RESPONSE_CODE, &code);
+	if (dl->hook_error) {
+		err = g_error_copy(dl->hook_error);
+	} else if (rc != CURLE_OK) {
+		err = SYSERR("CURL: download error [%s]: (%d) %s", fetch->chunk->url,
+				rc, curl_easy_strerror(rc));
+	} else if (2 != (code/100)) {
+		err = SYSERR("Download: (%ld)", code);
+	} else if (fetch->size > 0) {
+		err = SYSERR("Download: %"G_GSIZE_FORMAT" bytes missing from [%s]",
+				fetch->size, fetch->chunk->url);
+	}
+	/* A service failing before any answer, even fast, is demoted as if it
+	 * was as slow as the longest hedging delay */
+	if (err && !fetch->first_byte && !fetch->flag_cancelled && !dl->hook_error)
+		_rawx_latency_record (dl->sds, fetch->chunk,
+				MAX(oio_ext_monotonic_time () - fetch->started,
+					oio_sds_download_hedge_delay_max));
+	_download_fetch_stop (fetch);
+
+	if (part->frags)
+		return _download_ec_finish (part, fetch, err);
+
+	/* Of two racing requests, the one that lost, or failed before any of
+	 * them answered, is dropped and the other goes on */
+	if (part->hedge) {
+		struct _download_fetch_s *other =
+			fetch == part->fetch ? part->hedge : part->fetch;
+		if (fetch->flag_cancelled || (err && !other->flag_cancelled)) {
+			GRID_DEBUG("Download: read of [%s] dropped", fetch->chunk->url);
+			g_clear_error (&err);
+			part->fetch = other;
+			part->hedge = NULL;
+			_download_fetch_free (fetch);
+			return NULL;
+		}
+		/* The winner is done, the loser is useless */
+		_download_fetch_free (part->hedge);
+		part->hedge = NULL;
+	}
+
+	if (!err) {
+		part->flag_done = 1;
+	} else if (!dl->hook_error && part->next_chunks) {
+		GRID_DEBUG("%s, retrying on another chunk", err->message);
+		g_clear_error (&err);
+		_download_fetch_free (part->fetch);
+		part->fetch = NULL;
+		err = _download_part_start (part);
+	}
+	return err;
+}
+
+static struct _download_part_s *
+_download_part_add (struct _download_ctx_s *dl, struct metachunk_s *meta,
+		gsize offset, gsize size)
+{
+	struct _download_part_s *part = g_malloc0 (sizeof(*part));
+	part->dl = dl;
+	part->meta = meta;
+	part->index = dl->parts->len;
+	part->offset = offset;
+	part->size = size;
+	part->buffer = g_byte_array_new ();
+	g_ptr_array_add (dl->parts, part);
+	return part;
+}
+
+/* The range is relative to the whole content */
+static void
+_download_plan_range (struct _download_ctx_s *dl,
+		const struct oio_sds_dl_range_s *range)
 {
 	GRID_TRACE ("%s %"G_GSIZE_FORMAT"+%"G_GSIZE_FORMAT,
 			__FUNCTION__, range->offset, range->size);
 
 	struct oio_sds_dl_range_s r0 = *range;
 
-	for (struct metachunk_s **p = dl->metachunks; *p; ++p) {
-		if ((r0.offset >= (*p)->offset)
-				&& (r0.offset < (*p)->offset + (*p)->size)) {
-			struct oio_sds_dl_range_s r1;
-			r1.offset = r0.offset - (*p)->offset;
-			gsize maxsize = (*p)->size - r1.offset;
-			r1.size = MIN(maxsize, r0.size);
-
-			GError *err = _download_range_from_metachunk (dl, &r1, *p);
-			if (NULL != err)
-				return err;
-			r0.offset += r1.size;
-			r0.size -= r1.size;
+	for (struct metachunk_s **p = dl->metachunks; *p && r0.size > 0; ++p) {
+		struct metachunk_s *meta = *p;
+		if ((r0.offset < meta->offset)
+				|| (r0.offset >= meta->offset + meta->size))
+			continue;
+
+		EXTRA_ASSERT (meta->chunks != NULL);
+		/* relative to the metachunk, not the whole content */
+		gsize offset = r0.offset - meta->offset;
+		gsize size = MIN(meta->size - offset, r0.size);
+		r0.offset += size;
+		r0.size -= size;
+
+		if (!dl->ec) {
+			while (size > 0) {
+				const gsize len = MIN(size, (gsize)oio_sds_download_part_size);
+				struct _download_part_s *part =
+					_download_part_add (dl, meta, offset, len);
+				part->next_chunks = meta->chunks;
+				offset += len;
+				size -= len;
+			}
+			continue;
+		}
+
+		/* The parts of an erasure-coded metachunk cover whole segments, and
+		 * are aligned on their size. */
+		const guint n = oio_ec_get_k(dl->ec) + oio_ec_get_m(dl->ec);
+		const gsize seg_size = oio_ec_get_segment_size (dl->ec);
+		const gsize max = MAX(seg_size,
+				(oio_sds_download_part_size / seg_size) * seg_size);
+		while (size > 0) {
+			const gsize len = MIN(size, max - (offset % max));
+			struct _download_part_s *part =
+				_download_part_add (dl, meta, offset, len);
+			part->seg_first = offset / seg_size;
+			part->seg_count = (offset + len - 1) / seg_size - part->seg_first + 1;
+			part->skip = offset - part->seg_first * seg_size;
+			part->frags = g_malloc0 (n * sizeof(struct _download_fetch_s*));
+			part->frag_chunks = g_malloc0 (n * sizeof(struct chunk_s*));
+			for (GSList *l = meta->chunks; l; l = l->next) {
+				struct chunk_s *chunk = l->data;
+				if (chunk->position.intra < n
+						&& !part->frag_chunks[chunk->position.intra])
+					part->frag_chunks[chunk->position.intra] = chunk;
+			}
+			offset += len;
+			size -= len;
 		}
 	}
 
 	EXTRA_ASSERT (r0.size == 0);
 	EXTRA_ASSERT (r0.offset == range->offset + range->size);
-	return NULL;
+}
+
+static GError *
+_download_parts (struct _download_ctx_s *dl)
+{
+	GError *err = NULL;
+	const guint window = MAX(1, oio_sds_download_parallel);
+
+	while (!err) {
+		/* Give the complete parts at the head of the window, then what the
+		 * new head received in advance */
+		while (dl->next_delivered < dl->parts->len) {
+			struct _download_part_s *head = dl->parts->pdata[dl->next_delivered];
+			if (!_download_deliver (dl, head->buffer->data, head->buffer->len))
+				return g_error_copy (dl->hook_error);
+			g_byte_array_set_size (head->buffer, 0);
+			if (!head->flag_done)
+				break;
+			dl->next_delivered ++;
+		}
+		if (dl->next_delivered >= dl->parts->len)
+			break;
+
+		/* Slide the window */
+		while (!err && dl->next_started < dl->parts->len
+				&& dl->next_started < dl->next_delivered + window)
+			err = _download_part_start (dl->parts->pdata[dl->next_started++]);
+		if (err)
+			break;
+
+		int running = 0;
+		CURLMcode mrc = curl_multi_perform (dl->mhandle, &running);
+		if (mrc != CURLM_OK) {
+			err = SYSERR("CURL: multi error: %s", curl_multi_strerror(mrc));
+			break;
+		}
+
+		int msgs_left = 0;
+		CURLMsg *msg = NULL;
+		while (!err && (msg = curl_multi_info_read (dl->mhandle, &msgs_left))) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			struct _download_fetch_s *fetch = NULL;
+			curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, &fetch);
+			EXTRA_ASSERT (fetch != NULL);
+			err = _download_fetch_finish (fetch, msg->data.result);
+		}
+
+		gint64 deadline = 0;
+		if (!err && dl->ec)
+			err = _download_ec_hedge (dl, &deadline);
+		else if (!err && oio_sds_download_hedge)
+			err = _download_replicated_hedge (dl, &deadline);
+
+		if (!err && running > 0) {
+			int timeout = 1000;
+			if (deadline > 0) {
+				const gint64 delay = deadline - oio_ext_monotonic_time ();
+				timeout = CLAMP(delay / G_TIME_SPAN_MILLISECOND, 1, 1000);
+			}
+			curl_multi_wait (dl->mhandle, NULL, 0, timeout, NULL);
+		}
+	}
+
+	return err;
 }
 
 static GError *
@@ -891,12 +1572,38 @@ _download (struct _download_ctx_s *dl)
 		dl->src->ranges = range_autov;
 	}
 
-	/* Ok, let's download each range sequentially */
+	/* The erasure-coded fragments are decoded locally */
 	GError *err = NULL;
-	for (struct oio_sds_dl_range_s **p = dl->src->ranges; *p; ++p) {
-		if (NULL != (err = _download_range (dl, *p)))
-			break;
+	if (_chunk_method_is_EC(dl->chunk_method)
+			&& (err = oio_ec_create (dl->chunk_method, &dl->ec))) {
+		dl->src->ranges = ranges;
+		return err;
 	}
+	if (!dl->ec && !dl->sds->no_shuffle)
+		_download_order_replicas (dl);
+
+	/* Ok, let's download the ranges, in order */
+	dl->parts = g_ptr_array_new_with_free_func (
+			(GDestroyNotify)_download_part_free);
+	for (struct oio_sds_dl_range_s **p = dl->src->ranges; *p; ++p)
+		_download_plan_range (dl, *p);
+
+	dl->mhandle = _get_download_multi (dl->sds);
+	if (!dl->mhandle)
+		err = SYSERR("CURL multi allocation error");
+	else
+		err = _download_parts (dl);
+
+	/* The parts detach their handles, the multi handle keeps the
+	 * connections for the next download */
+	g_ptr_array_free (dl->parts, TRUE);
+	dl->parts = NULL;
+	if (dl->mhandle)
+		_release_download_multi (dl->sds, dl->mhandle);
+	dl->mhandle = NULL;
+	g_clear_error (&dl->hook_error);
+	oio_ec_destroy (dl->ec);
+	dl->ec = NULL;
 
 	/* restore the caller's ranges, then cleanup */
 	dl->src->ranges = ranges;
@@ -1132,6 +1839,7 @@ struct oio_sds_ul_s
 	gchar *stgpol;
 	gchar *chunk_method;
 	gchar *mime_type;
+	struct oio_ec_s *ec;
 
 	/* current upload */
 	struct metachunk_s *mc;
@@ -1268,6 +1976,7 @@ oio_sds_upload_clean (struct oio_sds_ul_s *ul)
 	oio_str_clean (&ul->chunk_method);
 	oio_str_clean (&ul->mime_type);
 	_sds_upload_reset (ul);
+	oio_ec_destroy (ul->ec);
 
 	g_free (ul);
 }
@@ -1437,6 +2146,22 @@ oio_sds_upload_feed (struct oio_sds_ul_s *ul,
 	return NULL;
 }
 
+struct oio_error_s *
+oio_sds_upload_feed_borrowed (struct oio_sds_ul_s *ul,
+		const unsigned char *buf, size_t len,
+		void (*release) (void *u), void *u)
+{
+	GRID_TRACE("%s (%p) <- %"G_GSIZE_FORMAT, __FUNCTION__, ul, len);
+	EXTRA_ASSERT (ul != NULL);
+	g_assert (!ul->finished);
+	g_assert (ul->ready_for_data);
+	if (release)
+		_upload_feed_bytes(ul, g_bytes_new_with_free_func (buf, len, release, u));
+	else
+		_upload_feed_bytes(ul, g_bytes_new_static (buf, len));
+	return NULL;
+}
+
 static void
 _finish_metachunk_upload(struct oio_sds_ul_s *ul)
 {
@@ -1452,7 +2177,17 @@ _finish_metachunk_upload(struct oio_sds_ul_s *ul)
 		c->flag_success = 2 == (http_put_get_http_code(ul->put, c) / 100);
 	}
 
-	if (ul->checksum_chunk) {
+	if (ul->ec) {
+		/* Each chunk holds its own fragments */
+		for (GSList *l = ul->mc->chunks; l; l = l->next) {
+			struct chunk_s *c = l->data;
+			const char *h = http_put_get_checksum (ul->put, c);
+			if (!h)
+				continue;
+			g_strlcpy (c->hexhash, h, sizeof(c->hexhash));
+			oio_str_upper (c->hexhash);
+		}
+	} else if (ul->checksum_chunk) {
 		const char *h = g_checksum_get_string (ul->checksum_chunk);
 		for (GSList *l = ul->mc->chunks; l; l = l->next) {
 			struct chunk_s *c = l->data;
@@ -1473,19 +2208,27 @@ _sds_upload_finish (struct oio_sds_ul_s *ul)
 	guint total = g_slist_length (ul->http_dests);
 	GRID_TRACE("%s uploads %u/%u failed", __FUNCTION__, failures, total);
 
+	/* An erasure-coded metachunk needs k+1 fragments, to be readable even
+	 * after the loss of one more of them. */
+	guint quorum = 1;
+	if (ul->ec)
+		quorum = MIN(oio_ec_get_k(ul->ec) + 1, total);
+
 	if (failures >= total) {
 		err = ERRPTF("No upload succeeded");
+	} else if (total - failures < quorum) {
+		err = ERRPTF("EC quorum not reached: %u/%u uploads succeeded",
+				total - failures, quorum);
+		/* the fragments written are useless, let the abort remove them */
+		for (GSList *l = ul->mc->chunks; l; l = l->next)
+			ul->chunks_failed = g_slist_prepend (ul->chunks_failed, l->data);
 	} else {
-		const gboolean is_ec = _chunk_method_is_EC(ul->chunk_method);
-
 		_finish_metachunk_upload(ul);
 
-		/* TODO: in case of EC, we may wanna read response headers */
-
 		/* store the structure in holders for further commit/abort */
 		for (GSList *l = ul->mc->chunks; l; l = l->next) {
 			struct chunk_s *chunk = l->data;
-			if (is_ec || chunk->flag_success) {
+			if (chunk->flag_success) {
 				ul->chunks_done = g_slist_prepend (ul->chunks_done, chunk);
 			} else {
 				ul->chunks_failed = g_slist_prepend (ul->chunks_failed, chunk);
@@ -1587,12 +2330,29 @@ _sds_upload_renew (struct oio_sds_ul_s *ul)
 	}
 
 	/* Initiate the PolyPut (c) with all its targets */
-	ul->put = http_put_create (-1, ul->chunk_size);
 	gboolean composed_positions = _chunk_method_is_EC(ul->chunk_method);
+	if (composed_positions) {
+		/* Each chunk holds the fragments of k times its size of data, and
+		 * the metachunks hold whole segments. */
+		if (!ul->ec && (err = (struct oio_error_s*) oio_ec_create (
+						ul->chunk_method, &ul->ec)))
+			return (GError*) err;
+		const gint64 seg = oio_ec_get_segment_size (ul->ec);
+		gint64 mc_size = ul->chunk_size * oio_ec_get_k (ul->ec);
+		if (mc_size > seg)
+			mc_size -= mc_size % seg;
+		if (!(ul->put = http_put_create_ec (ul->ec, mc_size)))
+			return NEWERROR(CODE_NOT_IMPLEMENTED,
+					"EC upload requires libcurl >= 7.64");
+	} else {
+		ul->put = http_put_create (-1, ul->chunk_size);
+	}
 
 	for (GSList *l = ul->mc->chunks; l; l = l->next) {
 		struct chunk_s *c = l->data;
 		struct http_put_dest_s *dest = http_put_add_dest (ul->put, c->url, c);
+		if (ul->ec)
+			http_put_dest_set_fragment (dest, c->position.intra);
 
 		_sds_upload_add_headers(ul, dest);
 
@@ -1684,8 +2444,9 @@ oio_sds_upload_step (struct oio_sds_ul_s *ul)
 	EXTRA_ASSERT (ul->put != NULL);
 	EXTRA_ASSERT (0 != http_put_expected_bytes (ul->put));
 
-	/* An upload is really running, maybe feed it */
-	if (!g_queue_is_empty (ul->buffer_tail)) {
+	/* An upload is really running, maybe feed it. An erasure-coded upload
+	 * holds no more than it can encode ahead of its destinations. */
+	if (!g_queue_is_empty (ul->buffer_tail) && http_put_wants_data (ul->put)) {
 		GRID_TRACE("%s (%p) Data ready!", __FUNCTION__, ul);
 		GBytes *buf = g_queue_pop_head (ul->buffer_tail);
 
@@ -1851,6 +2612,29 @@ _ul_debug (const char *caller, struct oio_sds_ul_src_s *src,
 	g_string_free (out, TRUE);
 }
 
+/* Commit the upload if it succeeded, else roll it back, then free it */
+static GError *
+_upload_conclude (struct oio_sds_ul_s *ul, struct oio_error_s *err)
+{
+	if (!err) {
+		err = oio_sds_upload_commit (ul);
+		if (err) {
+			if (oio_error_code(err) == CODE_CONTENT_EXISTS ||
+					oio_error_code(err) == CODE_CONTENT_PRECONDITION) {
+				_upload_abort_no_error(ul);
+			} else {
+				GRID_WARN("Conditions unsafe to abort the upload: (%d) %s",
+						oio_error_code(err), oio_error_message(err));
+			}
+		}
+	} else {
+		_upload_abort_no_error(ul);
+	}
+
+	oio_sds_upload_clean (ul);
+	return (GError*) err;
+}
+
 static GError *
 _upload_sequential (struct oio_sds_s *sds, struct oio_sds_ul_dst_s *dst,
 		struct oio_sds_ul_src_s *src)
@@ -1918,23 +2702,32 @@ _upload_sequential (struct oio_sds_s *sds, struct oio_sds_ul_dst_s *dst,
 			err = oio_sds_upload_step (ul);
 	}
 
-	if (!err) {
-		err = oio_sds_upload_commit (ul);
-		if (err) {
-			if (oio_error_code(err) == CODE_CONTENT_EXISTS ||
-					oio_error_code(err) == CODE_CONTENT_PRECONDITION) {
-				_upload_abort_no_error(ul);
-			} else {
-				GRID_WARN("Conditions unsafe to abort the upload: (%d) %s",
-						oio_error_code(err), oio_error_message(err));
-			}
-		}
-	} else {
-		_upload_abort_no_error(ul);
+	return _upload_conclude (ul, err);
+}
+
+/* Upload the <len> bytes at <base> without any copy. The memory must stay
+ * valid until the upload returns. */
+static GError *
+_upload_borrowed (struct oio_sds_s *sds, struct oio_sds_ul_dst_s *dst,
+		const guint8 *base, size_t len)
+{
+	struct oio_sds_ul_s *ul = oio_sds_upload_init (sds, dst);
+	if (!ul)
+		return BADREQ("Invalid source, destination or content id");
+
+	struct oio_error_s *err = NULL;
+	if (len > 0) {
+		err = oio_sds_upload_prepare (ul, len);
+		if (!err)
+			_upload_feed_bytes (ul, g_bytes_new_static (base, len));
 	}
+	if (!err)
+		_upload_feed_bytes (ul, g_bytes_new_static ((guint8*)"", 0));
 
-	oio_sds_upload_clean (ul);
-	return (GError*) err;
+	while (!err && !oio_sds_upload_done (ul))
+		err = oio_sds_upload_step (ul);
+
+	return _upload_conclude (ul, err);
 }
 
 struct oio_error_s*
@@ -1988,7 +2781,28 @@ oio_sds_upload_from_file (struct oio_sds_s *sds, struct oio_sds_ul_dst_s *dst,
 		err = SYSERR("open() error: (%d) %s", errno, strerror(errno));
 	else if (0 > fstat (fd, &st))
 		err = SYSERR("fstat() error: (%d) %s", errno, strerror(errno));
-	else if (!(in = fdopen(fd, "r")))
+	else if (S_ISREG(st.st_mode) && oio_sds_upload_mmap) {
+		/* A regular file is mapped and uploaded without any copy. Reading
+		 * the pages past its end, if truncated meanwhile, raises SIGBUS. */
+		const size_t total = st.st_size;
+		off = MIN(off, total);
+		if (len == 0 || len == (size_t)-1 || len > total - off)
+			len = total - off;
+		if (!len) {
+			err = _upload_borrowed (sds, dst, (guint8*)"", 0);
+		} else {
+			const size_t delta = off % sysconf(_SC_PAGESIZE);
+			void *map = mmap (NULL, len + delta, PROT_READ, MAP_PRIVATE,
+					fd, off - delta);
+			if (map == MAP_FAILED) {
+				err = SYSERR("mmap() error: (%d) %s", errno, strerror(errno));
+			} else {
+				madvise (map, len + delta, MADV_SEQUENTIAL);
+				err = _upload_borrowed (sds, dst, (guint8*)map + delta, len);
+				munmap (map, len + delta);
+			}
+		}
+	} else if (!(in = fdopen(fd, "r")))
 		err = SYSERR("fdopen() error: (%d) %s", errno, strerror(errno));
 	else {
 		lseek (fd, off, SEEK_SET);
@@ -2021,26 +2835,7 @@ oio_sds_upload_from_buffer (struct oio_sds_s *sds,
 	if (dst->content_id && !oio_str_ishexa1 (dst->content_id))
 		return (struct oio_error_s*) BADREQ("content_id not hexadecimal");
 
-	FILE *in = NULL;
-	GError *err = NULL;
-
-	if (!(in = fmemopen (base, len, "r")))
-		err = SYSERR("fmemopen() error: (%d) %s", errno, strerror(errno));
-	else {
-		struct oio_sds_ul_src_s src0 = {
-			.type = OIO_UL_SRC_HOOK_SEQUENTIAL, .data = { .hook = {
-				.cb = _read_FILE,
-				.ctx = in,
-				.size = len
-			}},
-		};
-
-		err = _upload_sequential (sds, dst, &src0);
-	}
-
-	if (in)
-		fclose (in);
-	return (struct oio_error_s*) err;
+	return (struct oio_error_s*) _upload_borrowed (sds, dst, base, len);
 }
 
 /* List --------------------------------------------------------------------- */
@@ -53,6 +53,55 @@ struct test_data_s
 	test_func_f func;
 };
 
+/* The allocators of the libc are wrapped to count the allocations of the
+ * whole process, libraries included, and report what an upload costs. */
+#ifdef __GLIBC__
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static gint64 allocations = 0;
+
+void *
+malloc (size_t size)
+{
+	__atomic_add_fetch (&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+	__atomic_add_fetch (&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+	__atomic_add_fetch (&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_realloc (ptr, size);
+}
+
+static gint64
+_get_allocations (void)
+{
+	return __atomic_load_n (&allocations, __ATOMIC_RELAXED);
+}
+#else
+static gint64 _get_allocations (void) { return 0; }
+#endif
+
+static void
+_report_allocations (const char *what, gint64 since, gsize size)
+{
+	const gint64 count = _get_allocations () - since;
+	if (size > 0 && count > 0)
+		g_test_message ("%s %"G_GSIZE_FORMAT" bytes: %"G_GINT64_FORMAT
+				" allocations, %.1f per MiB", what, size, count,
+				(count * 1048576.0) / size);
+}
+
 static int
 _on_item (void *ctx UNUSED, const struct oio_sds_list_item_s *item)
 {
@@ -141,8 +190,10 @@ putget (const gint64 size)
 		struct oio_sds_ul_dst_s dst = OIO_SDS_UPLOAD_DST_INIT;
 		dst.url = url_random;
 		dst.autocreate = 1;
+		const gint64 since = _get_allocations ();
 		err = oio_sds_upload_from_buffer (client, &dst, buffer, size);
 		g_assert_no_error((GError*)err);
+		_report_allocations ("Uploaded from buffer", since, size);
 	} while (0);
 
 	/* check the hash and size known by OIO */
@@ -547,8 +598,10 @@ _roundtrip_put_from_file (const char * const * properties)
 	ul_dst.out_size = 0;
 	ul_dst.content_id = content_id;
 	ul_dst.properties = properties;
+	const gint64 since = _get_allocations ();
 	err = oio_sds_upload_from_file (client, &ul_dst, source_path, 0, 0);
 	NOERROR(err);
+	_report_allocations ("Uploaded from file", since, fi0.fs);
 
 	_roundtrip_tail (&fi0, content_id, properties);
 
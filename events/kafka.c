@@ -52,11 +52,10 @@ static void kafka_log_forward(
 	g_log(G_LOG_DOMAIN, log_level, "%s - %s: %s", fac, rd_kafka_name(rk), buf);
 }
 
+/* The purged messages are requeued, they might be spooled then sent later */
 static gboolean message_should_be_dropped(rd_kafka_resp_err_t err) {
 	return (
-		err == RD_KAFKA_RESP_ERR__PURGE_QUEUE
-		|| err == RD_KAFKA_RESP_ERR__PURGE_INFLIGHT
-		|| err == RD_KAFKA_RESP_ERR__KEY_SERIALIZATION
+		err == RD_KAFKA_RESP_ERR__KEY_SERIALIZATION
 		|| err == RD_KAFKA_RESP_ERR__VALUE_SERIALIZATION
 		|| err == RD_KAFKA_RESP_ERR_INVALID_MSG_SIZE
 		|| err == RD_KAFKA_RESP_ERR_INVALID_MSG
@@ -251,6 +250,15 @@ kafka_connect(struct kafka_s *kafka)
 	if (!kafka->producer) {
 		rd_kafka_conf_destroy(conf);
 		err = BADREQ("Unable to instantiate Kafka producer: %s", errstr);
+	} else if (kafka->callback_ctx) {
+		kafka->topic_handle = rd_kafka_topic_new(
+				kafka->producer, kafka->topic, NULL);
+		if (!kafka->topic_handle) {
+			err = BADREQ("Unable to instantiate Kafka topic %s: %s",
+					kafka->topic, rd_kafka_err2str(rd_kafka_last_error()));
+			rd_kafka_destroy(kafka->producer);
+			kafka->producer = NULL;
+		}
 	}
 
 	return err;
@@ -338,6 +346,53 @@ kafka_publish_message(struct kafka_s *kafka,
 	return err;
 }
 
+GError*
+kafka_publish_batch(struct kafka_s *kafka,
+		rd_kafka_message_t *msgs, guint count)
+{
+	if (!kafka || !kafka->producer || !kafka->topic_handle) {
+		// One should call "kafka_connect" before publishing a message
+		return BADREQ("Try to publish messages without producer");
+	}
+	EXTRA_ASSERT(kafka->callback_ctx != NULL);
+
+	/* The payloads are freed by librdkafka once delivered, the keys are
+	 * always copied. */
+	const int accepted = rd_kafka_produce_batch(kafka->topic_handle,
+			RD_KAFKA_PARTITION_UA, RD_KAFKA_MSG_F_FREE, msgs, count);
+
+	guint requeued = 0;
+	rd_kafka_resp_err_t last = RD_KAFKA_RESP_ERR_NO_ERROR;
+	/* Backwards, so that the requeued messages keep their order */
+	for (guint i = count; i > 0; i--) {
+		rd_kafka_message_t *m = msgs + i - 1;
+		if (m->err == RD_KAFKA_RESP_ERR_NO_ERROR) {
+			g_free(m->key);
+		} else if (m->err == RD_KAFKA_RESP_ERR_MSG_SIZE_TOO_LARGE
+				|| message_should_be_dropped(m->err)) {
+			kafka->callback_ctx->drop_func(kafka->topic, m->key, m->payload);
+		} else {
+			kafka->callback_ctx->requeue_func(m->key, m->payload);
+			last = m->err;
+			requeued ++;
+		}
+		m->key = m->payload = NULL;
+	}
+
+	/* Serve the delivery reports of the previous batches */
+	if (oio_events_kafka_flush)
+		rd_kafka_flush(kafka->producer,
+			oio_events_kafka_timeout_flush / G_TIME_SPAN_MILLISECOND);
+	else
+		rd_kafka_poll(kafka->producer, 0);
+
+	if (requeued > 0)
+		return BUSY("Failed to produce %u/%u messages to topic %s (%d accepted)"
+				": %s, retry later", requeued, count, kafka->topic, accepted,
+				rd_kafka_err2str(last));
+	return NULL;
+}
+
 GError*
 kafka_flush(struct kafka_s *kafka)
 {
@@ -369,6 +424,10 @@ kafka_close(struct kafka_s *kafka)
 
 	if (kafka && kafka->producer) {
 		err = kafka_flush(kafka);
+		if (kafka->topic_handle) {
+			rd_kafka_topic_destroy(kafka->topic_handle);
+			kafka->topic_handle = NULL;
+		}
 		rd_kafka_destroy(kafka->producer);
 		kafka->producer = NULL;
 	}
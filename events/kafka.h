@@ -37,6 +37,8 @@ struct kafka_s
 	rd_kafka_t *producer;
 	rd_kafka_conf_t* conf;
 	const gchar* topic;
+	/* Handle on <topic>, tied to the producer, used by batches */
+	rd_kafka_topic_t *topic_handle;
 	struct kafka_callback_ctx *callback_ctx;
 };
 
@@ -64,6 +66,14 @@ GError* kafka_publish_message(struct kafka_s *kafka,
 		void* msg, size_t msglen,
 		const gchar* topic, const gboolean sync);
 
+/** Enqueue a batch of messages to the topic of the connector, without
+ * waiting for their delivery, which is reported to the callbacks given to
+ * "kafka_create". The ownership of the payloads and the keys of <msgs> is
+ * taken: the messages refused by the producer are given back to the requeue
+ * or the drop callback. Returns a retryable error if some were requeued. */
+GError* kafka_publish_batch(struct kafka_s *kafka,
+		rd_kafka_message_t *msgs, guint count);
+
 /** Check if producer encountered a fatal error.
  * If so, the producer should be restarted **/
 GError* kafka_check_fatal_error(struct kafka_s *kafka);
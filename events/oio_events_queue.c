@@ -112,6 +112,15 @@ oio_events_queue__get_total_sent_events(struct oio_events_queue_s *self)
 	return 0;
 }
 
+guint64
+oio_events_queue__get_total_sent_batches(struct oio_events_queue_s *self)
+{
+	if (VTABLE_HAS(self,struct oio_events_queue_abstract_s*,get_total_sent_batches)) {
+		EVTQ_CALL(self,get_total_sent_batches)(self);
+	}
+	return 0;
+}
+
 gint64
 oio_events_queue__get_health(struct oio_events_queue_s *self)
 {
@@ -319,6 +328,20 @@ _stat_append_to_str(const gchar *key,
 	guint64 time_us = oio_events_queue__get_total_send_time(queue);
 	double time_s = (double)time_us / (double)G_TIME_SPAN_SECOND;
 	g_string_append_printf(in_out->out, "%.6f\n", time_s);
+
+	/* The average batch fill is sent_total / sent_batches_total */
+	guint64 batches = oio_events_queue__get_total_sent_batches(queue);
+	if (batches > 0) {
+		g_string_append_static(in_out->out,
+				"meta_event_sent_batches_total{service_id=\"");
+		g_string_append(in_out->out, in_out->service_id);
+		g_string_append_static(in_out->out, "\",event_type=\"");
+		g_string_append(in_out->out, key);
+		g_string_append_static(in_out->out, "\",namespace=\"");
+		g_string_append(in_out->out, in_out->namespace);
+		g_string_append_static(in_out->out, "\"} ");
+		g_string_append_printf(in_out->out, "%"G_GUINT64_FORMAT"\n", batches);
+	}
 }
 
 void
@@ -55,6 +55,10 @@ guint64 oio_events_queue__get_total_send_time(struct oio_events_queue_s *self);
 /** Get the total number of events sent through this queue. */
 guint64 oio_events_queue__get_total_sent_events(struct oio_events_queue_s *self);
 
+/** Get the total number of batches of events sent through this queue,
+ * 0 if the queue does not send batches. */
+guint64 oio_events_queue__get_total_sent_batches(struct oio_events_queue_s *self);
+
 /* Get a health metric for the events queue, from 0 (bad) to 100 (good). */
 gint64 oio_events_queue__get_health(struct oio_events_queue_s *self);
 
@@ -72,11 +72,12 @@ oio_events_queue_factory__create_beanstalkd (
 
 	struct _queue_with_endpoint_s *self = g_malloc0 (sizeof(*self));
 	self->vtable = &vtable_BEANSTALKD;
-	self->queue = g_async_queue_new ();
+	self->queue = oio_events_ring_create(oio_events_common_max_pending);
 	self->queue_name = g_strdup(tube);
 	self->endpoint = g_strdup (endpoint);
 	self->running = FALSE;
 	self->healthy = FALSE;
+	_q_spool_open(self);
 
 	oio_events_queue_buffer_init(&(self->buffer));
 	self->event_send_count = grid_single_rrd_create(
@@ -134,7 +135,7 @@ _q_manage_message(struct _queue_with_endpoint_s *q, struct _running_ctx_s *ctx)
 	EXTRA_ASSERT(ctx->beanstalkd != NULL && ctx->beanstalkd->fd >= 0);
 
 	gboolean rc = TRUE;
-	gchar* msg = g_async_queue_timeout_pop (q->queue, 200 * G_TIME_SPAN_MILLISECOND);
+	gchar* msg = oio_events_ring_pop(q->queue, 200 * G_TIME_SPAN_MILLISECOND);
 	if (!msg) goto exit;
 	if (!*msg) goto exit;
 
@@ -157,7 +158,7 @@ _q_manage_message(struct _queue_with_endpoint_s *q, struct _running_ctx_s *ctx)
 		if (CODE_IS_RETRY(err->code) || CODE_IS_NETWORK_ERROR(err->code)) {
 			GRID_NOTICE("Beanstalkd recoverable error with [%s]: (%d) %s",
 					q->endpoint, err->code, err->message);
-			g_async_queue_push_front(q->queue, msg);
+			oio_events_ring_push_front(q->queue, msg);
 			msg = NULL;
 			ctx->attempts_put += 1;
 			rc = FALSE;
@@ -242,6 +243,14 @@ exit:
 	}
 }
 
+static void
+_q_spool_push(gchar *key, gchar *msg, gpointer udata)
+{
+	struct _queue_with_endpoint_s *q = udata;
+	g_free(key);
+	oio_events_ring_push(q->queue, msg);
+}
+
 static GError *
 _q_run (struct _queue_with_endpoint_s *q)
 {
@@ -258,6 +267,8 @@ _q_run (struct _queue_with_endpoint_s *q)
 			_q_flush_buffered(q, FALSE);
 		}
 
+		_q_spool_tick(q, ctx.now, _q_spool_push);
+
 		if (!_q_reconnect(q, &ctx)) {
 			EXPO_BACKOFF(100 * G_TIME_SPAN_MILLISECOND, ctx.attempts_connect, 5);
 			continue;
@@ -39,6 +39,7 @@ License along with this library.
 #include "oio_events_queue_internals.h"
 #include "oio_events_queue_buffer.h"
 #include "oio_events_queue_fanout.h"
+#include "oio_events_queue_ring.h"
 
 #define EXPO_BACKOFF(DELAY,TRY,MAX_TRIES) \
 	g_usleep((1 << MIN(TRY, MAX_TRIES)) * DELAY); \
@@ -70,7 +71,7 @@ static struct oio_events_queue_vtable_s vtable_FANOUT =
 struct _queue_FANOUT_s
 {
 	struct oio_events_queue_vtable_s *vtable;
-	GAsyncQueue *queue;
+	struct oio_events_ring_s *queue;
 	GThread *worker;
 
 	struct oio_events_queue_s **output_tab;
@@ -95,7 +96,7 @@ oio_events_queue_factory__create_fanout (
 
 	struct _queue_FANOUT_s *self = g_malloc0 (sizeof(*self));
 	self->vtable = &vtable_FANOUT;
-	self->queue = g_async_queue_new ();
+	self->queue = oio_events_ring_create(oio_events_common_max_pending);
 	self->output_tab = subv;
 	self->output_nb = sublen;
 	oio_events_queue_buffer_init(&(self->buffer));
@@ -125,10 +126,10 @@ static void
 _flush_buffered(struct _queue_FANOUT_s *q, gboolean total)
 {
 	const gint avail =
-		oio_events_common_max_pending - g_async_queue_length(q->queue);
+		oio_events_common_max_pending - oio_events_ring_length(q->queue);
 	if (avail < (gint) oio_events_common_max_pending / 100) {
 		GRID_WARN("Pending events queue is reaching maximum: %d/%d",
-				g_async_queue_length(q->queue),
+				oio_events_ring_length(q->queue),
 				oio_events_common_max_pending);
 	}
 
@@ -152,7 +153,7 @@ _q_run (struct _queue_FANOUT_s *q)
 	/* run the agent loop of the current queue */
 	while (q->running
 			|| !oio_events_queue_buffer_is_empty(&q->buffer)
-			|| g_async_queue_length(q->queue) > 0	) {
+			|| oio_events_ring_length(q->queue) > 0) {
 
 		const gint64 now = oio_ext_monotonic_time();
 
@@ -165,7 +166,7 @@ _q_run (struct _queue_FANOUT_s *q)
 		/* find an event, preferring the last that failed */
 		gchar *msg = saved;
 		saved = NULL;
-		if (!msg) msg = g_async_queue_timeout_pop (q->queue, 300 * G_TIME_SPAN_MILLISECOND);
+		if (!msg) msg = oio_events_ring_pop(q->queue, 300 * G_TIME_SPAN_MILLISECOND);
 		if (!msg) continue;
 
 		/* forward the event as a beanstalkd job */
@@ -185,7 +186,7 @@ _q_run (struct _queue_FANOUT_s *q)
 			 * This event is therefore pushed again in the queue.
 			 */
 			if (msg) {
-				g_async_queue_push_front(q->queue, msg);
+				oio_events_ring_push_front(q->queue, msg);
 				msg = NULL;
 			}
 		}
@@ -194,7 +195,7 @@ _q_run (struct _queue_FANOUT_s *q)
 	}
 
 	if (saved) {
-		g_async_queue_push (q->queue, saved);
+		oio_events_ring_push(q->queue, saved);
 	}
 	saved = NULL;
 	return err;
@@ -264,7 +265,7 @@ _q_destroy (struct oio_events_queue_s *self)
 		g_free(q->output_tab);
 	}
 
-	g_async_queue_unref (q->queue);
+	oio_events_ring_destroy(q->queue);
 	oio_events_queue_buffer_clean(&(q->buffer));
 
 	q->vtable = NULL;
@@ -276,7 +277,7 @@ _q_send (struct oio_events_queue_s *self, gchar *key UNUSED, gchar *msg)
 {
 	struct _queue_FANOUT_s *q = (struct _queue_FANOUT_s*) self;
 	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_FANOUT);
-	g_async_queue_push (q->queue, msg);
+	oio_events_ring_push(q->queue, msg);
 	return TRUE;
 }
 
@@ -300,7 +301,7 @@ _q_is_stalled (struct oio_events_queue_s *self)
 {
 	struct _queue_FANOUT_s *q = (struct _queue_FANOUT_s*) self;
 	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_FANOUT);
-	const int l = g_async_queue_length (q->queue);
+	const int l = oio_events_ring_length(q->queue);
 	if (l <= 0)
 		return FALSE;
 	return ((guint)l) >= oio_events_common_max_pending;
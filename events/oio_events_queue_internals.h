@@ -34,6 +34,7 @@ struct oio_events_queue_vtable_s
 	gboolean (*is_stalled) (struct oio_events_queue_s *self);
 	guint64 (*get_total_sent_events) (struct oio_events_queue_s *self);
 	guint64 (*get_total_send_time) (struct oio_events_queue_s *self);
+	guint64 (*get_total_sent_batches) (struct oio_events_queue_s *self);
 	gint64 (*get_health) (struct oio_events_queue_s *self);
 	void (*set_buffering) (struct oio_events_queue_s *self, gint64 v);
 	GError * (*start) (struct oio_events_queue_s *self);
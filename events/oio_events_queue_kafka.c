@@ -42,6 +42,7 @@ static struct oio_events_queue_vtable_s vtable_KAFKA =
 	.is_stalled = _q_is_stalled,
 	.get_total_send_time = _q_get_total_send_time,
 	.get_total_sent_events = _q_get_total_sent_events,
+	.get_total_sent_batches = _q_get_total_sent_batches,
 	.get_health = _q_get_health,
 	.set_buffering = _q_set_buffering,
 	.start = _q_start,
@@ -69,17 +70,20 @@ oio_events_queue_factory__create_kafka(
 
 	struct _queue_with_endpoint_s *self = g_malloc0(sizeof(*self));
 	self->vtable = &vtable_KAFKA;
-	self->queue = g_async_queue_new();
+	self->queue = oio_events_ring_create(oio_events_common_max_pending);
 	self->endpoint = g_strdup(endpoint);
 	self->queue_name = g_strdup(topic);
 	self->running = FALSE;
 	self->healthy = FALSE;
+	_q_spool_open(self);
 
 	oio_events_queue_buffer_init(&(self->buffer));
 	self->event_send_count = grid_single_rrd_create(
 			oio_ext_monotonic_seconds(), OIO_EVENTS_STATS_HISTORY_SECONDS);
 	self->event_send_time = grid_single_rrd_create(
 			oio_ext_monotonic_seconds(), OIO_EVENTS_STATS_HISTORY_SECONDS);
+	self->event_send_batches = grid_single_rrd_create(
+			oio_ext_monotonic_seconds(), OIO_EVENTS_STATS_HISTORY_SECONDS);
 
 	*out = (struct oio_events_queue_s*) self;
 
@@ -96,69 +100,90 @@ struct _running_ctx_s {
 	guint attempts_check;
 	guint attempts_put;
 	struct kafka_s* kafka;
+	/* Reused from a batch to the next */
+	rd_kafka_message_t *batch;
+	gpointer *popped;
+	guint batch_alloc;
 };
 
 
 /**
- * Poll the next message and manage it.
+ * Poll the next messages and publish them as a single batch.
  * Returns TRUE if the loop might continue or FALSE it the loop should
  * pause a bit.
  */
 static gboolean
-_q_manage_message(struct _queue_with_endpoint_s *q, struct _running_ctx_s *ctx)
+_q_manage_batch(struct _queue_with_endpoint_s *q, struct _running_ctx_s *ctx)
 {
 	EXTRA_ASSERT(ctx->kafka != NULL);
 
-	gboolean rc = TRUE;
-	struct oio_kafka_event_s *evt = g_async_queue_timeout_pop(
-			q->queue, 200 * G_TIME_SPAN_MILLISECOND);
-	if (!evt) goto exit;
-	if (!evt->msg) goto exit;
-	if (!*(evt->msg)) goto exit;
+	const guint max = MAX(1U, oio_events_kafka_batch_size);
+	if (max > ctx->batch_alloc) {
+		ctx->batch = g_renew(rd_kafka_message_t, ctx->batch, max);
+		ctx->popped = g_renew(gpointer, ctx->popped, max);
+		ctx->batch_alloc = max;
+	}
+
+	guint count = 0;
+	void _add(struct oio_kafka_event_s *evt) {
+		if (evt->msg && *(evt->msg)) {
+			rd_kafka_message_t *m = ctx->batch + (count++);
+			memset(m, 0, sizeof(*m));
+			m->payload = evt->msg;
+			m->len = strlen(evt->msg);
+			m->key = evt->key;
+			m->key_len = evt->key ? strlen(evt->key) : 0;
+		} else {
+			g_free(evt->key);
+			g_free(evt->msg);
+		}
+		g_free(evt);
+	}
+
+	const guint popped = oio_events_ring_pop_batch(
+			q->queue, ctx->popped, max, 200 * G_TIME_SPAN_MILLISECOND);
+	if (!popped) {
+		/* Serve the delivery reports even when idle */
+		kafka_poll(ctx->kafka);
+		return TRUE;
+	}
+	for (guint i = 0; i < popped; i++)
+		_add(ctx->popped[i]);
+
+	if (!count)
+		return TRUE;
 
-	/* forward the event as a beanstalkd job */
-	const size_t keylen = evt->key ? strlen(evt->key) : 0;
-	const size_t msglen = strlen(evt->msg);
 	gint64 start = oio_ext_monotonic_time();
-	GError *err = kafka_publish_message(ctx->kafka, evt->key, keylen, evt->msg,
-			msglen, q->queue_name, FALSE);
+	GError *err = kafka_publish_batch(ctx->kafka, ctx->batch, count);
 	gint64 end = oio_ext_monotonic_time();
 	time_t end_seconds = end / G_TIME_SPAN_SECOND;
-	/* count the operation whether it's a success or a failure */
-	grid_single_rrd_add(q->event_send_count, end_seconds, 1);
+	/* count the operations whether they are successes or failures */
+	grid_single_rrd_add(q->event_send_count, end_seconds, count);
 	grid_single_rrd_add(q->event_send_time, end_seconds, end - start);
+	grid_single_rrd_add(q->event_send_batches, end_seconds, 1);
 #ifdef HAVE_EXTRA_DEBUG
 	if (intercept_errors)
 		(*intercept_errors) (err);
 #endif
 	if (!err) {
 		ctx->attempts_put = 0;
-	} else {
-		if (CODE_IS_RETRY(err->code) || CODE_IS_NETWORK_ERROR(err->code)) {
-			GRID_NOTICE("Kafka recoverable error with [%s]: (%d) %s",
-					q->endpoint, err->code, err->message);
-			g_async_queue_push_front(q->queue, evt);
-			evt = NULL;
-			ctx->attempts_put += 1;
-			rc = FALSE;
-		} else {
-			GRID_WARN("Kafka unrecoverable error with [%s]: (%d) %s",
-					q->endpoint, err->code, err->message);
-			_drop_event(q->queue_name, evt->key, evt->msg);
-			g_free(evt);
-			evt = NULL;
-			ctx->attempts_put = 0;
-		}
-		g_clear_error (&err);
+		return TRUE;
 	}
 
-exit:
-	if (evt) {
-		g_free(evt->key);
-		g_free(evt->msg);
-		g_free(evt);
+	/* The refused messages have already been requeued or dropped */
+	const gboolean retry =
+		CODE_IS_RETRY(err->code) || CODE_IS_NETWORK_ERROR(err->code);
+	if (retry) {
+		GRID_NOTICE("Kafka recoverable error with [%s]: (%d) %s",
+				q->endpoint, err->code, err->message);
+		ctx->attempts_put += 1;
+	} else {
+		GRID_WARN("Kafka unrecoverable error with [%s]: (%d) %s",
+				q->endpoint, err->code, err->message);
+		ctx->attempts_put = 0;
 	}
-	return rc;
+	g_clear_error(&err);
+	return !retry;
 }
 
 static gboolean
@@ -241,8 +266,14 @@ _q_run(struct _queue_with_endpoint_s *q)
 		struct oio_kafka_event_s *evt_wrapper = g_malloc0(sizeof(struct oio_kafka_event_s));
 		evt_wrapper->key = key;
 		evt_wrapper->msg = msg;
-		g_async_queue_push_front(q->queue, evt_wrapper);
+		oio_events_ring_push_front(q->queue, evt_wrapper);
 	};
+	void __spool_push(gchar *key, gchar *msg, gpointer udata UNUSED) {
+		struct oio_kafka_event_s *evt_wrapper = g_malloc0(sizeof(struct oio_kafka_event_s));
+		evt_wrapper->key = key;
+		evt_wrapper->msg = msg;
+		oio_events_ring_push(q->queue, evt_wrapper);
+	}
 
 	err = kafka_create(
 			q->endpoint, q->queue_name, __requeue_fn, _drop_event, &(ctx.kafka), FALSE);
@@ -261,6 +292,8 @@ _q_run(struct _queue_with_endpoint_s *q)
 			_q_flush_buffered(q, FALSE);
 		}
 
+		_q_spool_tick(q, ctx.now, __spool_push);
+
 		if (!_q_reconnect(q, &ctx)) {
 			EXPO_BACKOFF(100 * G_TIME_SPAN_MILLISECOND, ctx.attempts_connect, 5);
 			continue;
@@ -271,7 +304,7 @@ _q_run(struct _queue_with_endpoint_s *q)
 			continue;
 		}
 
-		if (!_q_manage_message(q, &ctx)) {
+		if (!_q_manage_batch(q, &ctx)) {
 			EXPO_BACKOFF(100 * G_TIME_SPAN_MILLISECOND, ctx.attempts_put, 5);
 		}
 	}
@@ -288,27 +321,38 @@ _q_run(struct _queue_with_endpoint_s *q)
 
 		_q_flush_buffered(q, TRUE);
 
-		if (!_q_manage_message(q, &ctx)) {
+		if (!_q_manage_batch(q, &ctx)) {
 			g_usleep(100 * G_TIME_SPAN_MILLISECOND);
 		}
 	}
 
+	/* close the socket to the kafka broker, the undelivered events are
+	 * requeued */
+	err = kafka_destroy(ctx.kafka);
+
 	// Flush pending
-	guint count = 0;
-	while (0 < g_async_queue_length(q->queue)) {
-		struct oio_kafka_event_s *evt = g_async_queue_try_pop(q->queue);
-		if (evt) {
-			_drop_event(q->queue_name, evt->key, evt->msg);
-			g_free(evt);
-			++ count;
-		}
+	GPtrArray *keys = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *msgs = g_ptr_array_new_with_free_func(g_free);
+	struct oio_kafka_event_s *evt;
+	while ((evt = oio_events_ring_pop(q->queue, 0))) {
+		g_ptr_array_add(keys, evt->key);
+		g_ptr_array_add(msgs, evt->msg);
+		g_free(evt);
 	}
-	if (count > 0) {
-		GRID_WARN("%u events lost", count);
+	const guint count = msgs->len;
+	if (!_q_spool_save(q, (gchar**) keys->pdata, (gchar**) msgs->pdata, count)) {
+		for (guint i = 0; i < count; i++) {
+			_drop_event(q->queue_name, keys->pdata[i], msgs->pdata[i]);
+			keys->pdata[i] = msgs->pdata[i] = NULL;
+		}
+		if (count > 0)
+			GRID_WARN("%u events lost", count);
 	}
+	g_ptr_array_free(keys, TRUE);
+	g_ptr_array_free(msgs, TRUE);
 
-	/* close the socket to the kafka broker */
-	err = kafka_destroy(ctx.kafka);
+	g_free(ctx.batch);
+	g_free(ctx.popped);
 
 	return err;
 }
@@ -349,9 +393,14 @@ gboolean
 _q_send_ext(struct oio_events_queue_s *self, gchar* key, gchar *msg)
 {
 	struct _queue_with_endpoint_s *q = (struct _queue_with_endpoint_s*) self;
+	if (_q_spool_offer(q, key, msg)) {
+		g_free(key);
+		g_free(msg);
+		return TRUE;
+	}
 	struct oio_kafka_event_s *evt_wrapper = g_malloc0(sizeof(struct oio_kafka_event_s));
 	evt_wrapper->key = key;
 	evt_wrapper->msg = msg;
-	g_async_queue_push(q->queue, evt_wrapper);
+	oio_events_ring_push(q->queue, evt_wrapper);
 	return TRUE;
 }
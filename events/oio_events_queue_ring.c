@@ -0,0 +1,263 @@
+/*
+OpenIO SDS event queue
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <core/internals.h>
+
+#include "oio_events_queue_ring.h"
+
+#define RING_CACHE_LINE 64
+
+/* Each slot on its own cache line, so that the producers writing adjacent
+ * slots do not invalidate each other. The sequence tells who may use the
+ * slot: the producer of position P when it equals P, the consumer when it
+ * equals P+1. */
+struct _ring_slot_s
+{
+	guint64 seq;
+	gpointer item;
+} __attribute__((aligned(RING_CACHE_LINE)));
+
+struct oio_events_ring_s
+{
+	struct _ring_slot_s *slots;
+	guint64 mask;
+
+	/* Next position to be written, shared by the producers */
+	guint64 head __attribute__((aligned(RING_CACHE_LINE)));
+
+	/* Next position to be read, only written by the consumer */
+	guint64 tail __attribute__((aligned(RING_CACHE_LINE)));
+	/* Requeued items, only accessed by the consumer */
+	GQueue front;
+	gint front_len;
+
+	/* Set by the consumer while it sleeps */
+	gint waiting __attribute__((aligned(RING_CACHE_LINE)));
+	GMutex lock;
+	GCond cond;
+	/* Protected by <lock>, the items pushed while the ring is full */
+	GQueue overflow;
+	gint overflow_len;
+};
+
+struct oio_events_ring_s *
+oio_events_ring_create(guint capacity)
+{
+	guint64 size = 2;
+	while (size < capacity && size < OIO_EVENTS_RING_MAX_CAPACITY)
+		size <<= 1;
+
+	struct oio_events_ring_s *r = NULL;
+	if (posix_memalign((void**)&r, RING_CACHE_LINE, sizeof(*r)) != 0)
+		g_error("Memory allocation failure");
+	memset(r, 0, sizeof(*r));
+	if (posix_memalign((void**)&r->slots, RING_CACHE_LINE,
+				size * sizeof(struct _ring_slot_s)) != 0)
+		g_error("Memory allocation failure");
+	for (guint64 i = 0; i < size; i++) {
+		r->slots[i].seq = i;
+		r->slots[i].item = NULL;
+	}
+	r->mask = size - 1;
+	g_queue_init(&r->front);
+	g_queue_init(&r->overflow);
+	g_mutex_init(&r->lock);
+	g_cond_init(&r->cond);
+	return r;
+}
+
+void
+oio_events_ring_destroy(struct oio_events_ring_s *r)
+{
+	if (!r)
+		return;
+	g_queue_clear(&r->front);
+	g_queue_clear(&r->overflow);
+	g_mutex_clear(&r->lock);
+	g_cond_clear(&r->cond);
+	free(r->slots);
+	free(r);
+}
+
+static gboolean
+_ring_try_push(struct oio_events_ring_s *r, gpointer item)
+{
+	guint64 pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+	for (;;) {
+		struct _ring_slot_s *s = r->slots + (pos & r->mask);
+		const guint64 seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+		const gint64 diff = (gint64)(seq - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&r->head, &pos, pos + 1, TRUE,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				s->item = item;
+				__atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+				return TRUE;
+			}
+			/* <pos> has been reloaded by the failed CAS */
+		} else if (diff < 0) {
+			/* The slot still holds the item of the previous lap */
+			return FALSE;
+		} else {
+			pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+static gpointer
+_ring_try_pop(struct oio_events_ring_s *r)
+{
+	const guint64 pos = r->tail;
+	struct _ring_slot_s *s = r->slots + (pos & r->mask);
+	const guint64 seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+	if (seq != pos + 1)
+		return NULL;
+	gpointer item = s->item;
+	s->item = NULL;
+	/* Give the slot back to the producers of the next lap */
+	__atomic_store_n(&s->seq, pos + r->mask + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&r->tail, pos + 1, __ATOMIC_RELEASE);
+	return item;
+}
+
+static void
+_ring_wake(struct oio_events_ring_s *r)
+{
+	/* Pairs with the fence of the consumer, going to sleep */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&r->waiting, __ATOMIC_RELAXED)) {
+		g_mutex_lock(&r->lock);
+		g_cond_signal(&r->cond);
+		g_mutex_unlock(&r->lock);
+	}
+}
+
+void
+oio_events_ring_push(struct oio_events_ring_s *r, gpointer item)
+{
+	EXTRA_ASSERT(r != NULL);
+	EXTRA_ASSERT(item != NULL);
+
+	/* Once the ring overflowed, keep the order until the overflow is
+	 * drained by the consumer. */
+	if (!g_atomic_int_get(&r->overflow_len) && _ring_try_push(r, item)) {
+		_ring_wake(r);
+		return;
+	}
+
+	g_mutex_lock(&r->lock);
+	g_queue_push_tail(&r->overflow, item);
+	g_atomic_int_inc(&r->overflow_len);
+	g_cond_signal(&r->cond);
+	g_mutex_unlock(&r->lock);
+}
+
+void
+oio_events_ring_push_front(struct oio_events_ring_s *r, gpointer item)
+{
+	EXTRA_ASSERT(r != NULL);
+	EXTRA_ASSERT(item != NULL);
+	g_queue_push_head(&r->front, item);
+	g_atomic_int_inc(&r->front_len);
+}
+
+static gpointer
+_ring_pop(struct oio_events_ring_s *r, gboolean locked)
+{
+	if (r->front.length > 0) {
+		g_atomic_int_add(&r->front_len, -1);
+		return g_queue_pop_head(&r->front);
+	}
+
+	gpointer item = _ring_try_pop(r);
+	if (item)
+		return item;
+	/* A producer claimed the slot but did not publish it yet: wait for
+	 * it, the overflow only comes after. */
+	while (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) != r->tail) {
+		if ((item = _ring_try_pop(r)))
+			return item;
+		g_thread_yield();
+	}
+	if (!g_atomic_int_get(&r->overflow_len))
+		return NULL;
+
+	if (!locked)
+		g_mutex_lock(&r->lock);
+	if ((item = g_queue_pop_head(&r->overflow)))
+		g_atomic_int_add(&r->overflow_len, -1);
+	if (!locked)
+		g_mutex_unlock(&r->lock);
+	return item;
+}
+
+gpointer
+oio_events_ring_pop(struct oio_events_ring_s *r, gint64 timeout)
+{
+	EXTRA_ASSERT(r != NULL);
+
+	gpointer item = _ring_pop(r, FALSE);
+	if (item || timeout <= 0)
+		return item;
+
+	const gint64 deadline = g_get_monotonic_time() + timeout;
+	g_mutex_lock(&r->lock);
+	__atomic_store_n(&r->waiting, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	while (!(item = _ring_pop(r, TRUE))) {
+		if (!g_cond_wait_until(&r->cond, &r->lock, deadline)) {
+			item = _ring_pop(r, TRUE);
+			break;
+		}
+	}
+	__atomic_store_n(&r->waiting, 0, __ATOMIC_RELAXED);
+	g_mutex_unlock(&r->lock);
+	return item;
+}
+
+guint
+oio_events_ring_pop_batch(struct oio_events_ring_s *r,
+		gpointer *tab, guint max, gint64 timeout)
+{
+	EXTRA_ASSERT(r != NULL);
+	EXTRA_ASSERT(tab != NULL);
+
+	if (!max || !(tab[0] = oio_events_ring_pop(r, timeout)))
+		return 0;
+	guint count = 1;
+	while (count < max && (tab[count] = _ring_pop(r, FALSE)))
+		count ++;
+	return count;
+}
+
+gint
+oio_events_ring_length(struct oio_events_ring_s *r)
+{
+	EXTRA_ASSERT(r != NULL);
+	const guint64 tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	const guint64 head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	const gint64 in_ring = head > tail ? (gint64)(head - tail) : 0;
+	return (gint) in_ring
+		+ g_atomic_int_get(&r->overflow_len)
+		+ g_atomic_int_get(&r->front_len);
+}
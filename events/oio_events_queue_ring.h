@@ -0,0 +1,61 @@
+/*
+OpenIO SDS event queue
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#ifndef OIO_SDS__sqlx__oio_events_queue_ring_h
+# define OIO_SDS__sqlx__oio_events_queue_ring_h 1
+
+#include <glib.h>
+
+/* The ring never holds more slots than this, the extra events wait in an
+ * overflow list. */
+#define OIO_EVENTS_RING_MAX_CAPACITY 65536
+
+/* A bounded multi-producer single-consumer queue of events. The producers
+ * never take a lock, unless the ring is full. The consumer only takes a
+ * lock to sleep when the ring is empty.
+ * NULL items are not allowed. */
+struct oio_events_ring_s;
+
+/** The capacity is rounded up to a power of 2, and bounded by
+ * OIO_EVENTS_RING_MAX_CAPACITY. */
+struct oio_events_ring_s * oio_events_ring_create(guint capacity);
+
+/** The items still in the ring are not freed. */
+void oio_events_ring_destroy(struct oio_events_ring_s *ring);
+
+/** Any thread. Never fails, a full ring overflows. */
+void oio_events_ring_push(struct oio_events_ring_s *ring, gpointer item);
+
+/** Consumer thread only, requeues an item to be popped first. */
+void oio_events_ring_push_front(struct oio_events_ring_s *ring,
+		gpointer item);
+
+/** Consumer thread only. Waits at most <timeout> microseconds for an item,
+ * returns NULL if none came. */
+gpointer oio_events_ring_pop(struct oio_events_ring_s *ring, gint64 timeout);
+
+/** Consumer thread only. Waits at most <timeout> microseconds for a first
+ * item, then pops what is already there, up to <max> items.
+ * Returns how many items have been stored in <tab>. */
+guint oio_events_ring_pop_batch(struct oio_events_ring_s *ring,
+		gpointer *tab, guint max, gint64 timeout);
+
+/** Any thread, an approximation when items are pushed concurrently. */
+gint oio_events_ring_length(struct oio_events_ring_s *ring);
+
+#endif /*OIO_SDS__sqlx__oio_events_queue_ring_h*/
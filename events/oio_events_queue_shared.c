@@ -66,7 +66,9 @@ _q_destroy(struct oio_events_queue_s *self)
 		q->worker = NULL;
 	}
 
-	g_async_queue_unref(q->queue);
+	oio_events_ring_destroy(q->queue);
+	oio_events_spool_close(q->spool);
+	q->spool = NULL;
 	oio_str_clean(&q->endpoint);
 	oio_str_clean(&q->username);
 	oio_str_clean(&q->password);
@@ -74,8 +76,11 @@ _q_destroy(struct oio_events_queue_s *self)
 	oio_events_queue_buffer_clean(&(q->buffer));
 	grid_single_rrd_destroy(q->event_send_count);
 	grid_single_rrd_destroy(q->event_send_time);
+	if (q->event_send_batches)
+		grid_single_rrd_destroy(q->event_send_batches);
 	q->event_send_count = NULL;
 	q->event_send_time = NULL;
+	q->event_send_batches = NULL;
 	q->vtable = NULL;
 	g_free(q);
 }
@@ -87,24 +92,28 @@ _q_destroy(struct oio_events_queue_s *self)
 void
 _q_flush_pending(struct _queue_with_endpoint_s *q)
 {
-	guint count = 0;
-	while (0 < g_async_queue_length(q->queue)) {
-		gchar *msg = g_async_queue_try_pop(q->queue);
-		if (msg) {
-			_drop_event(q->queue_name, NULL, msg);
-			++ count;
-		}
-	}
-	if (count > 0) {
-		GRID_WARN("%u events lost", count);
+	GPtrArray *msgs = g_ptr_array_new();
+	gchar *msg;
+	while ((msg = oio_events_ring_pop(q->queue, 0)))
+		g_ptr_array_add(msgs, msg);
+
+	const guint count = msgs->len;
+	if (_q_spool_save(q, NULL, (gchar**) msgs->pdata, count)) {
+		g_ptr_array_set_free_func(msgs, g_free);
+	} else {
+		for (guint i = 0; i < count; i++)
+			_drop_event(q->queue_name, NULL, msgs->pdata[i]);
+		if (count > 0)
+			GRID_WARN("%u events lost", count);
 	}
+	g_ptr_array_free(msgs, TRUE);
 }
 
 gboolean
 _q_is_empty(struct _queue_with_endpoint_s *q)
 {
 	return oio_events_queue_buffer_is_empty(&q->buffer)
-		&& 0 >= g_async_queue_length(q->queue);
+		&& 0 >= oio_events_ring_length(q->queue);
 }
 
 gboolean
@@ -123,7 +132,9 @@ _q_is_stalled(struct oio_events_queue_s *self)
 {
 	struct _queue_with_endpoint_s *q = (struct _queue_with_endpoint_s*) self;
 	EXTRA_ASSERT (q != NULL && q->vtable != NULL);
-	const int l = g_async_queue_length(q->queue);
+	if (q->spool && oio_events_spool_is_active(q->spool))
+		return oio_events_spool_size(q->spool) >= oio_events_spool_max_size;
+	const int l = oio_events_ring_length(q->queue);
 	if (l <= 0) {
 		return FALSE;
 	}
@@ -134,7 +145,10 @@ gboolean
 _q_send(struct oio_events_queue_s *self, gchar* key UNUSED, gchar *msg)
 {
 	struct _queue_with_endpoint_s *q = (struct _queue_with_endpoint_s*) self;
-	g_async_queue_push(q->queue, msg);
+	if (_q_spool_offer(q, NULL, msg))
+		g_free(msg);
+	else
+		oio_events_ring_push(q->queue, msg);
 	return TRUE;
 }
 
@@ -162,10 +176,10 @@ void
 _q_flush_buffered(struct _queue_with_endpoint_s *q, gboolean total)
 {
 	const gint avail =
-		oio_events_common_max_pending - g_async_queue_length(q->queue);
+		oio_events_common_max_pending - oio_events_ring_length(q->queue);
 	if (avail < (gint) oio_events_common_max_pending / 100) {
 		GRID_WARN("Pending events queue is reaching maximum: %d/%d",
-				g_async_queue_length(q->queue),
+				oio_events_ring_length(q->queue),
 				oio_events_common_max_pending);
 	}
 
@@ -202,6 +216,17 @@ _q_get_total_sent_events(struct oio_events_queue_s *self)
 	return grid_single_rrd_get(q->event_send_count, now);
 }
 
+guint64
+_q_get_total_sent_batches(struct oio_events_queue_s *self)
+{
+	struct _queue_with_endpoint_s *q = (struct _queue_with_endpoint_s*) self;
+	EXTRA_ASSERT(q != NULL && q->vtable != NULL);
+	if (!q->event_send_batches)
+		return 0;
+	gint64 now = oio_ext_monotonic_seconds();
+	return grid_single_rrd_get(q->event_send_batches, now);
+}
+
 guint64
 _q_get_avg_send_rate(struct oio_events_queue_s *self, gint64 duration)
 {
@@ -240,3 +265,58 @@ _q_get_health(struct oio_events_queue_s *self)
 	double max_score = ((double)SCORE_MAX);
 	return (gint64) (max_score / (1.0 + log(1.0 + q->pending_events * 0.1)));
 }
+
+void
+_q_spool_open(struct _queue_with_endpoint_s *q)
+{
+	if (!oio_events_spool_dir[0])
+		return;
+	GError *err = oio_events_spool_open(
+			oio_events_spool_dir, q->queue_name, &q->spool);
+	if (err) {
+		GRID_WARN("Events spool disabled for [%s]: (%d) %s",
+				q->queue_name, err->code, err->message);
+		g_clear_error(&err);
+	}
+}
+
+gboolean
+_q_spool_offer(struct _queue_with_endpoint_s *q,
+		const gchar *key, const gchar *msg)
+{
+	if (!q->spool)
+		return FALSE;
+	const gboolean full = oio_events_ring_length(q->queue)
+		>= (gint) oio_events_common_max_pending;
+	/* Lock-free, in the usual case */
+	if (!full && !oio_events_spool_is_active(q->spool))
+		return FALSE;
+	return oio_events_spool_offer(q->spool, key, msg, full);
+}
+
+gboolean
+_q_spool_save(struct _queue_with_endpoint_s *q,
+		gchar **keys, gchar **msgs, guint count)
+{
+	return q->spool && oio_events_spool_prepend(q->spool, keys, msgs, count);
+}
+
+void
+_q_spool_tick(struct _queue_with_endpoint_s *q, gint64 now,
+		oio_events_spool_cb push)
+{
+	if (!q->spool)
+		return;
+
+	if (now - q->spool_last_sync >= oio_events_spool_sync_period) {
+		q->spool_last_sync = now;
+		oio_events_spool_sync(q->spool);
+	}
+
+	if (!oio_events_spool_is_active(q->spool))
+		return;
+	const gint low = MAX(1U, oio_events_common_max_pending / 2);
+	const gint len = oio_events_ring_length(q->queue);
+	if (len < low)
+		oio_events_spool_replay(q->spool, low - len, push, q);
+}
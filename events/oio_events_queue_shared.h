@@ -23,6 +23,9 @@ License along with this library.
 
 #include <core/internals.h>
 
+#include "oio_events_queue_ring.h"
+#include "oio_events_queue_spool.h"
+
 
 // Internally used functions and structures, shared by several implementations
 
@@ -35,7 +38,7 @@ License along with this library.
 struct _queue_with_endpoint_s
 {
 	struct oio_events_queue_vtable_s *vtable;
-	GAsyncQueue *queue;
+	struct oio_events_ring_s *queue;
 	GThread *worker;
 
 	gchar *endpoint;
@@ -49,8 +52,13 @@ struct _queue_with_endpoint_s
 	volatile gboolean healthy;  // used to know if a queue is explicitly unhealthy
 
 	struct oio_events_queue_buffer_s buffer;
+	/* Absorbs what exceeds the pending events, NULL if disabled */
+	struct oio_events_spool_s *spool;
+	gint64 spool_last_sync;
 	struct grid_single_rrd_s *event_send_count;
 	struct grid_single_rrd_s *event_send_time;
+	/* Only for the queues sending events by batches */
+	struct grid_single_rrd_s *event_send_batches;
 };
 
 #ifdef HAVE_EXTRA_DEBUG
@@ -79,6 +87,7 @@ guint64 _q_get_avg_send_time(struct oio_events_queue_s *self, gint64 duration);
 gint64 _q_get_health(struct oio_events_queue_s *self);
 guint64 _q_get_total_send_time(struct oio_events_queue_s *self);
 guint64 _q_get_total_sent_events(struct oio_events_queue_s *self);
+guint64 _q_get_total_sent_batches(struct oio_events_queue_s *self);
 gboolean _q_is_empty(struct _queue_with_endpoint_s *q);
 gboolean _q_is_running(struct _queue_with_endpoint_s *q);
 /** Does the queue reached the maximum pending events? */
@@ -90,4 +99,20 @@ gboolean _q_send_overwritable(struct oio_events_queue_s *self, gchar *tag,
 	gchar *msg);
 void _q_set_buffering(struct oio_events_queue_s *self, gint64 v);
 
+/** Open the spool of the queue, if configured. */
+void _q_spool_open(struct _queue_with_endpoint_s *q);
+/** Spool the event if the pending events are too many, or if the spool is
+ * not empty yet. Returns TRUE if the event has been spooled, the ownership
+ * of <key> and <msg> is not taken. */
+gboolean _q_spool_offer(struct _queue_with_endpoint_s *q,
+		const gchar *key, const gchar *msg);
+/** Save the events that could not be sent before the exit, ahead of the
+ * spooled ones that are more recent. <keys> may be NULL. */
+gboolean _q_spool_save(struct _queue_with_endpoint_s *q,
+		gchar **keys, gchar **msgs, guint count);
+/** From the worker: sync the spool and replay it into the pending events,
+ * while they are less than half of the maximum. */
+void _q_spool_tick(struct _queue_with_endpoint_s *q, gint64 now,
+		oio_events_spool_cb push);
+
 #endif /*OIO_SDS__sqlx__oio_events_queue_shared_h*/
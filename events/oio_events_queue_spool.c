@@ -0,0 +1,575 @@
+/*
+OpenIO SDS event queue
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <core/oio_core.h>
+#include <core/internals.h>
+#include <events/events_variables.h>
+
+#include "oio_events_queue_spool.h"
+
+#define SPOOL_SUFFIX ".spool"
+
+/* Leaves room for the segments prepended */
+#define SPOOL_FIRST_ID (G_GUINT64_CONSTANT(1) << 32)
+
+/* Each event is stored as this header, the key then the message */
+struct _spool_record_s
+{
+	guint32 key_len;
+	guint32 msg_len;
+};
+
+struct oio_events_spool_s
+{
+	gchar *path;
+	int lock_fd;
+
+	GMutex lock;
+	gint active;
+	guint64 size;
+	/* Sorted ids of the segments, the first is read, the last is written */
+	GArray *segments;
+	guint64 next_id;
+
+	int wfd;
+	guint64 woff;
+	gboolean dirty;
+	gboolean dir_dirty;
+	/* Rotated segments, to be synced and closed */
+	GSList *unsynced;
+
+	int rfd;
+	guint64 roff;
+	/* The size of the segment being read, unless it is also written */
+	guint64 rend;
+};
+
+static gchar *
+_segment_path(struct oio_events_spool_s *s, guint64 id)
+{
+	return g_strdup_printf("%s/%016" G_GINT64_MODIFIER "X" SPOOL_SUFFIX,
+			s->path, id);
+}
+
+static gint
+_cmp_id(gconstpointer a, gconstpointer b)
+{
+	return CMP(*(const guint64*)a, *(const guint64*)b);
+}
+
+static GError *
+_load_segments(struct oio_events_spool_s *s)
+{
+	GError *err = NULL;
+	GDir *dir = g_dir_open(s->path, 0, &err);
+	if (!dir)
+		return err;
+
+	const gchar *name;
+	while ((name = g_dir_read_name(dir))) {
+		if (!g_str_has_suffix(name, SPOOL_SUFFIX))
+			continue;
+		gchar *end = NULL;
+		const guint64 id = g_ascii_strtoull(name, &end, 16);
+		if (end != name + strlen(name) - strlen(SPOOL_SUFFIX))
+			continue;
+		gchar *path = _segment_path(s, id);
+		struct stat st = {0};
+		if (0 == g_stat(path, &st)) {
+			g_array_append_val(s->segments, id);
+			s->size += st.st_size;
+			s->next_id = MAX(s->next_id, id + 1);
+		}
+		g_free(path);
+	}
+	g_dir_close(dir);
+
+	g_array_sort(s->segments, _cmp_id);
+	/* Never append after what a previous run left, it might end with a
+	 * partial record. */
+	if (s->segments->len > 0)
+		s->active = TRUE;
+	return NULL;
+}
+
+GError *
+oio_events_spool_open(const gchar *dir, const gchar *name,
+		struct oio_events_spool_s **out)
+{
+	EXTRA_ASSERT(dir != NULL);
+	EXTRA_ASSERT(name != NULL);
+	EXTRA_ASSERT(out != NULL);
+	*out = NULL;
+
+	gchar *safe = g_strdup(name);
+	for (gchar *p = safe; *p; p++) {
+		if (!g_ascii_isalnum(*p) && *p != '.' && *p != '-' && *p != '_')
+			*p = '_';
+	}
+
+	struct oio_events_spool_s *s = g_malloc0(sizeof(*s));
+	s->path = g_build_filename(dir, safe, NULL);
+	s->lock_fd = s->wfd = s->rfd = -1;
+	s->segments = g_array_new(FALSE, FALSE, sizeof(guint64));
+	s->next_id = SPOOL_FIRST_ID;
+	g_mutex_init(&s->lock);
+	g_free(safe);
+
+	GError *err = NULL;
+	if (0 != g_mkdir_with_parents(s->path, 0755)) {
+		err = SYSERR("mkdir(%s): (%d) %s", s->path, errno, strerror(errno));
+	} else {
+		gchar *path = g_build_filename(s->path, "lock", NULL);
+		s->lock_fd = open(path, O_CREAT|O_RDWR|O_CLOEXEC, 0644);
+		if (s->lock_fd < 0)
+			err = SYSERR("open(%s): (%d) %s", path, errno, strerror(errno));
+		else if (0 != flock(s->lock_fd, LOCK_EX|LOCK_NB))
+			err = BUSY("Spool %s already locked: (%d) %s",
+					s->path, errno, strerror(errno));
+		g_free(path);
+	}
+	if (!err)
+		err = _load_segments(s);
+
+	if (err) {
+		oio_events_spool_close(s);
+		return err;
+	}
+
+	if (s->segments->len > 0)
+		GRID_NOTICE("Events spool %s: %u segments (%" G_GUINT64_FORMAT
+				" bytes) to be replayed", s->path, s->segments->len, s->size);
+	*out = s;
+	return NULL;
+}
+
+void
+oio_events_spool_close(struct oio_events_spool_s *s)
+{
+	if (!s)
+		return;
+	oio_events_spool_sync(s);
+	if (s->wfd >= 0)
+		close(s->wfd);
+	if (s->rfd >= 0)
+		close(s->rfd);
+	if (s->lock_fd >= 0)
+		close(s->lock_fd);
+	g_array_free(s->segments, TRUE);
+	g_mutex_clear(&s->lock);
+	g_free(s->path);
+	g_free(s);
+}
+
+gboolean
+oio_events_spool_is_active(struct oio_events_spool_s *s)
+{
+	return g_atomic_int_get(&s->active);
+}
+
+guint64
+oio_events_spool_size(struct oio_events_spool_s *s)
+{
+	g_mutex_lock(&s->lock);
+	const guint64 size = s->size;
+	g_mutex_unlock(&s->lock);
+	return size;
+}
+
+static GError *
+_rotate(struct oio_events_spool_s *s)
+{
+	if (s->wfd >= 0) {
+		/* The segment being read is sealed */
+		if (s->rfd >= 0 && s->segments->len == 1)
+			s->rend = s->woff;
+		s->unsynced = g_slist_prepend(s->unsynced, GINT_TO_POINTER(s->wfd));
+		s->wfd = -1;
+	}
+
+	const guint64 id = s->next_id;
+	gchar *path = _segment_path(s, id);
+	int fd = open(path, O_CREAT|O_EXCL|O_WRONLY|O_APPEND|O_CLOEXEC, 0644);
+	GError *err = NULL;
+	if (fd < 0) {
+		err = SYSERR("open(%s): (%d) %s", path, errno, strerror(errno));
+	} else {
+		s->next_id ++;
+		s->wfd = fd;
+		s->woff = 0;
+		s->dir_dirty = TRUE;
+		g_array_append_val(s->segments, id);
+	}
+	g_free(path);
+	return err;
+}
+
+/* Returns the size of the record written, or -1 with errno set */
+static gssize
+_write_record(int fd, const gchar *key, const gchar *msg)
+{
+	struct _spool_record_s hdr = {
+		.key_len = key ? strlen(key) : 0,
+		.msg_len = strlen(msg),
+	};
+	struct iovec iov[3] = {
+		{ &hdr, sizeof(hdr) },
+		{ (void*) key, hdr.key_len },
+		{ (void*) msg, hdr.msg_len },
+	};
+	const gssize total = sizeof(hdr) + hdr.key_len + hdr.msg_len;
+	const gssize w = writev(fd, iov, 3);
+	if (w == total)
+		return total;
+	if (w >= 0)
+		errno = ENOSPC;
+	return -1;
+}
+
+static GError *
+_append(struct oio_events_spool_s *s, const gchar *key, const gchar *msg)
+{
+	if (s->wfd < 0 || s->woff >= oio_events_spool_segment_size) {
+		GError *err = _rotate(s);
+		if (err)
+			return err;
+	}
+
+	const gssize total = _write_record(s->wfd, key, msg);
+	if (total < 0) {
+		const int errsav = errno;
+		/* Never leave a partial record behind */
+		if (0 != ftruncate(s->wfd, s->woff))
+			GRID_WARN("Events spool %s: truncation failure: (%d) %s",
+					s->path, errno, strerror(errno));
+		return SYSERR("Events spool %s: write failure: (%d) %s",
+				s->path, errsav, strerror(errsav));
+	}
+	s->woff += total;
+	s->size += total;
+	s->dirty = TRUE;
+	return NULL;
+}
+
+gboolean
+oio_events_spool_offer(struct oio_events_spool_s *s,
+		const gchar *key, const gchar *msg, gboolean force)
+{
+	EXTRA_ASSERT(s != NULL);
+	EXTRA_ASSERT(msg != NULL);
+
+	GError *err = NULL;
+	g_mutex_lock(&s->lock);
+	if (!force && !s->active) {
+		g_mutex_unlock(&s->lock);
+		return FALSE;
+	}
+	if (!(err = _append(s, key, msg)))
+		g_atomic_int_set(&s->active, TRUE);
+	g_mutex_unlock(&s->lock);
+
+	if (err) {
+		GRID_WARN("%s", err->message);
+		g_clear_error(&err);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Where the records of the segment being read end */
+static guint64
+_read_end(struct oio_events_spool_s *s)
+{
+	const gboolean writing = s->wfd >= 0 && s->segments->len == 1;
+	return writing ? s->woff : s->rend;
+}
+
+static GError *
+_copy_unread(struct oio_events_spool_s *s, int fd)
+{
+	GError *err = NULL;
+	const guint64 end = _read_end(s);
+	const gsize max = 64 * 1024;
+	guint8 *buf = g_malloc(max);
+	for (guint64 off = s->roff; !err && off < end; ) {
+		const gssize r = pread(s->rfd, buf, MIN(max, end - off), off);
+		if (r <= 0)
+			err = SYSERR("Events spool %s: read failure: (%d) %s",
+					s->path, r < 0 ? errno : EIO, strerror(r < 0 ? errno : EIO));
+		else if (r != write(fd, buf, r))
+			err = SYSERR("Events spool %s: write failure: (%d) %s",
+					s->path, errno, strerror(errno));
+		else
+			off += r;
+	}
+	g_free(buf);
+	return err;
+}
+
+/* Write the events in a new first segment, followed by what remains to be
+ * replayed of the segment being read, that is then dropped. */
+static GError *
+_prepend(struct oio_events_spool_s *s,
+		gchar **keys, gchar **msgs, guint count)
+{
+	guint64 id = s->next_id;
+	if (s->segments->len > 0) {
+		const guint64 first = g_array_index(s->segments, guint64, 0);
+		if (first == 0)
+			return BUSY("Events spool %s: no room before the first segment",
+					s->path);
+		id = first - 1;
+	}
+	const gboolean moving = s->segments->len > 0 && s->rfd >= 0;
+
+	GError *err = NULL;
+	guint64 added = 0;
+	gchar *path = _segment_path(s, id);
+	gchar *tmp = g_strconcat(path, ".tmp", NULL);
+	int fd = open(tmp, O_CREAT|O_TRUNC|O_WRONLY|O_CLOEXEC, 0644);
+	if (fd < 0)
+		err = SYSERR("open(%s): (%d) %s", tmp, errno, strerror(errno));
+	for (guint i = 0; !err && i < count; i++) {
+		const gssize w = _write_record(fd, keys ? keys[i] : NULL, msgs[i]);
+		if (w < 0)
+			err = SYSERR("Events spool %s: write failure: (%d) %s",
+					s->path, errno, strerror(errno));
+		else
+			added += w;
+	}
+	if (!err && moving)
+		err = _copy_unread(s, fd);
+	if (!err && 0 != fdatasync(fd))
+		err = SYSERR("Events spool %s: sync failure: (%d) %s",
+				s->path, errno, strerror(errno));
+	if (fd >= 0)
+		close(fd);
+	if (!err && 0 != g_rename(tmp, path))
+		err = SYSERR("rename(%s): (%d) %s", tmp, errno, strerror(errno));
+	if (err)
+		g_unlink(tmp);
+	g_free(tmp);
+	g_free(path);
+	if (err)
+		return err;
+
+	if (moving) {
+		/* Its unread part now lives in the new segment */
+		path = _segment_path(s, g_array_index(s->segments, guint64, 0));
+		if (s->wfd >= 0 && s->segments->len == 1) {
+			close(s->wfd);
+			s->wfd = -1;
+			s->dirty = FALSE;
+		}
+		close(s->rfd);
+		s->rfd = -1;
+		s->roff = 0;
+		g_unlink(path);
+		g_free(path);
+		g_array_remove_index(s->segments, 0);
+	}
+	if (id == s->next_id)
+		s->next_id ++;
+	g_array_prepend_val(s->segments, id);
+	s->size += added;
+	s->dir_dirty = TRUE;
+	return NULL;
+}
+
+gboolean
+oio_events_spool_prepend(struct oio_events_spool_s *s,
+		gchar **keys, gchar **msgs, guint count)
+{
+	EXTRA_ASSERT(s != NULL);
+	EXTRA_ASSERT(msgs != NULL);
+	if (!count)
+		return TRUE;
+
+	g_mutex_lock(&s->lock);
+	GError *err = _prepend(s, keys, msgs, count);
+	if (!err)
+		g_atomic_int_set(&s->active, TRUE);
+	g_mutex_unlock(&s->lock);
+
+	if (err) {
+		GRID_WARN("%s", err->message);
+		g_clear_error(&err);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void
+oio_events_spool_sync(struct oio_events_spool_s *s)
+{
+	g_mutex_lock(&s->lock);
+	GSList *fds = s->unsynced;
+	s->unsynced = NULL;
+	if (s->dirty && s->wfd >= 0) {
+		const int fd = dup(s->wfd);
+		if (fd >= 0)
+			fds = g_slist_prepend(fds, GINT_TO_POINTER(fd));
+	}
+	s->dirty = FALSE;
+	const gboolean dir_dirty = s->dir_dirty;
+	s->dir_dirty = FALSE;
+	g_mutex_unlock(&s->lock);
+
+	/* Out of the lock, the emitters may go on spooling */
+	for (GSList *l = fds; l; l = l->next) {
+		const int fd = GPOINTER_TO_INT(l->data);
+		fdatasync(fd);
+		close(fd);
+	}
+	g_slist_free(fds);
+
+	if (dir_dirty) {
+		const int fd = open(s->path, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+		if (fd >= 0) {
+			fsync(fd);
+			close(fd);
+		}
+	}
+}
+
+/* The first segment has been entirely replayed */
+static void
+_segment_done(struct oio_events_spool_s *s)
+{
+	const guint64 id = g_array_index(s->segments, guint64, 0);
+	if (s->rfd >= 0) {
+		close(s->rfd);
+		s->rfd = -1;
+	}
+	if (s->wfd >= 0 && s->segments->len == 1) {
+		close(s->wfd);
+		s->wfd = -1;
+		s->dirty = FALSE;
+	}
+	gchar *path = _segment_path(s, id);
+	struct stat st = {0};
+	if (0 == g_stat(path, &st)) {
+		/* What remains unread, e.g. a partial record */
+		const guint64 left =
+			(guint64)st.st_size > s->roff ? (guint64)st.st_size - s->roff : 0;
+		s->size -= MIN(s->size, left);
+	}
+	g_unlink(path);
+	g_free(path);
+	g_array_remove_index(s->segments, 0);
+	s->roff = 0;
+}
+
+/* Read the record at the current offset of the first segment, up to
+ * <limit> bytes. Returns FALSE if there is no complete record. */
+static gboolean
+_read_record(struct oio_events_spool_s *s, guint64 limit,
+		gchar **pkey, gchar **pmsg)
+{
+	struct _spool_record_s hdr = {0};
+	if (s->roff + sizeof(hdr) > limit
+			|| sizeof(hdr) != pread(s->rfd, &hdr, sizeof(hdr), s->roff))
+		return FALSE;
+	const guint64 total = sizeof(hdr) + (guint64)hdr.key_len + hdr.msg_len;
+	if (s->roff + total > limit)
+		return FALSE;
+
+	gchar *key = hdr.key_len ? g_malloc(hdr.key_len + 1) : NULL;
+	gchar *msg = g_malloc(hdr.msg_len + 1);
+	struct iovec iov[2] = {
+		{ key, hdr.key_len },
+		{ msg, hdr.msg_len },
+	};
+	const gssize r = preadv(s->rfd, iov, 2, s->roff + sizeof(hdr));
+	if (r < 0 || (guint64)r != total - sizeof(hdr)) {
+		g_free(key);
+		g_free(msg);
+		return FALSE;
+	}
+	if (key)
+		key[hdr.key_len] = '\0';
+	msg[hdr.msg_len] = '\0';
+	s->roff += total;
+	s->size -= MIN(s->size, total);
+	*pkey = key;
+	*pmsg = msg;
+	return TRUE;
+}
+
+guint
+oio_events_spool_replay(struct oio_events_spool_s *s, guint max,
+		oio_events_spool_cb cb, gpointer udata)
+{
+	EXTRA_ASSERT(s != NULL);
+	EXTRA_ASSERT(cb != NULL);
+
+	guint count = 0;
+	g_mutex_lock(&s->lock);
+	while (count < max && s->segments->len > 0) {
+		const guint64 id = g_array_index(s->segments, guint64, 0);
+		const gboolean writing = s->wfd >= 0 && s->segments->len == 1;
+
+		if (s->rfd < 0) {
+			gchar *path = _segment_path(s, id);
+			s->rfd = open(path, O_RDONLY|O_CLOEXEC);
+			s->roff = 0;
+			if (s->rfd < 0)
+				GRID_WARN("Events spool %s: lost segment: (%d) %s",
+						path, errno, strerror(errno));
+			g_free(path);
+			if (s->rfd < 0) {
+				_segment_done(s);
+				continue;
+			}
+			struct stat st = {0};
+			s->rend = 0 == fstat(s->rfd, &st) ? (guint64) st.st_size : 0;
+		}
+
+		gchar *key = NULL, *msg = NULL;
+		if (_read_record(s, _read_end(s), &key, &msg)) {
+			(*cb)(key, msg, udata);
+			count ++;
+			continue;
+		}
+
+		/* The segment being written is replayed up to the last record */
+		if (writing && s->roff < s->woff)
+			break;
+		/* Either a sealed segment, maybe ending with the partial record
+		 * of a crash, or the writer has been caught up. */
+		_segment_done(s);
+	}
+	if (s->segments->len == 0) {
+		s->size = 0;
+		g_atomic_int_set(&s->active, FALSE);
+	}
+	g_mutex_unlock(&s->lock);
+	return count;
+}
@@ -0,0 +1,69 @@
+/*
+OpenIO SDS event queue
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#ifndef OIO_SDS__sqlx__oio_events_queue_spool_h
+# define OIO_SDS__sqlx__oio_events_queue_spool_h 1
+
+#include <glib.h>
+
+/* An append-only log of events, in rotated segment files, absorbing what
+ * exceeds the in-memory queue of pending events. The events are replayed
+ * in order, and the segments left by a previous run are replayed first. */
+struct oio_events_spool_s;
+
+/* Takes the ownership of <key> and <msg> */
+typedef void (*oio_events_spool_cb)(gchar *key, gchar *msg, gpointer udata);
+
+/** Open (or create) the spool <name> in the directory <dir>. The spool is
+ * locked, it cannot be shared by several processes. */
+GError * oio_events_spool_open(const gchar *dir, const gchar *name,
+		struct oio_events_spool_s **out);
+
+/** Sync the spool and close it. The events not replayed yet are kept. */
+void oio_events_spool_close(struct oio_events_spool_s *spool);
+
+/** Are there events waiting in the spool? Lock-free. */
+gboolean oio_events_spool_is_active(struct oio_events_spool_s *spool);
+
+/** Append the event to the spool, if the spool is already active or if
+ * <force> is set. The ownership of <key> and <msg> is not taken.
+ * Returns TRUE if the event has been spooled. */
+gboolean oio_events_spool_offer(struct oio_events_spool_s *spool,
+		const gchar *key, const gchar *msg, gboolean force);
+
+/** Spool the <count> events ahead of those already spooled, e.g. the
+ * events still pending in memory at the exit, that are older. <keys> may be
+ * NULL. The ownership of the strings is not taken. Returns TRUE if all the
+ * events have been spooled, FALSE if none has been. */
+gboolean oio_events_spool_prepend(struct oio_events_spool_s *spool,
+		gchar **keys, gchar **msgs, guint count);
+
+/** Sync to the disk what has been appended since the last call.
+ * To be called periodically, out of the path of the emitters. */
+void oio_events_spool_sync(struct oio_events_spool_s *spool);
+
+/** Pass at most <max> of the oldest events to <cb>, in order, and forget
+ * them. Once the spool is empty, it becomes inactive, atomically with the
+ * last event given. Returns how many events were given. */
+guint oio_events_spool_replay(struct oio_events_spool_s *spool, guint max,
+		oio_events_spool_cb cb, gpointer udata);
+
+/** How many bytes wait in the spool */
+guint64 oio_events_spool_size(struct oio_events_spool_s *spool);
+
+#endif /*OIO_SDS__sqlx__oio_events_queue_spool_h*/
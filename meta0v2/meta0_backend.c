@@ -42,7 +42,7 @@ struct meta0_backend_s
 static GError* _open_and_lock(struct meta0_backend_s *m0,
 		enum m0v2_open_type_e how, struct sqlx_sqlite3_s **handle);
 
-static void _unlock_and_close(struct sqlx_sqlite3_s *sq3);
+static GError* _unlock_and_close(struct sqlx_sqlite3_s *sq3, GError *err);
 
 /* ------------------------------------------------------------------------- */
 
@@ -175,7 +175,7 @@ _load(struct meta0_backend_s *m0)
 	if (err != NULL)
 		g_prefix_error(&err, "Query error: ");
 
-	_unlock_and_close(sq3);
+	err = _unlock_and_close(sq3, err);
 	return err;
 }
 
@@ -294,12 +294,12 @@ _open_and_lock(struct meta0_backend_s *m0, enum m0v2_open_type_e how,
 	return NULL;
 }
 
-static void
-_unlock_and_close(struct sqlx_sqlite3_s *sq3)
+static GError*
+_unlock_and_close(struct sqlx_sqlite3_s *sq3, GError *err)
 {
 	EXTRA_ASSERT(sq3 != NULL);
 	sqlx_admin_save_lazy (sq3);
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	return sqlx_repository_unlock_and_close_written(sq3, err);
 }
 
 static GError *
@@ -390,7 +390,7 @@ meta0_backend_fill_from_json(struct meta0_backend_s *m0,
 			sqlx_transaction_notify_huge_changes(repctx);
 		err = sqlx_transaction_end(repctx, err);
 	}
-	_unlock_and_close(sq3);
+	err = _unlock_and_close(sq3, err);
 
 cleanup:
 	meta0_utils_array_clean(mapping);
@@ -433,7 +433,7 @@ meta0_backend_reset(struct meta0_backend_s *m0, gboolean flag_local)
 		err = sqlx_transaction_end (repctx, err);
 	}
 
-	_unlock_and_close (sq3);
+	err = _unlock_and_close(sq3, err);
 	return err;
 }
 
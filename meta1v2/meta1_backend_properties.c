@@ -247,7 +247,7 @@ meta1_backend_set_container_properties(struct meta1_backend_s *m1,
 		err = sqlx_transaction_end(repctx, err);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -270,7 +270,7 @@ meta1_backend_del_container_properties(struct meta1_backend_s *m1,
 		err = sqlx_transaction_end(repctx, err);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -293,7 +293,7 @@ meta1_backend_get_container_properties(struct meta1_backend_s *m1,
 		err = sqlx_transaction_end(repctx, err);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
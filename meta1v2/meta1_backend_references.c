@@ -147,7 +147,7 @@ meta1_backend_user_create(struct meta1_backend_s *m1,
 			meta1_backend_notify_services(m1, url);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -168,7 +168,7 @@ meta1_backend_user_destroy(struct meta1_backend_s *m1,
 		err = sqlx_transaction_end(repctx, err);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -198,6 +198,6 @@ meta1_backend_user_info(struct meta1_backend_s *m1,
 		oio_url_cleanv (urls);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
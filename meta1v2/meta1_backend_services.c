@@ -840,7 +840,7 @@ meta1_backend_services_config(struct meta1_backend_s *m1,
 			__notify_services_by_cid(m1, sq3, url);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	g_free(m1url);
 	return err;
 }
@@ -869,7 +869,7 @@ meta1_backend_services_set(struct meta1_backend_s *m1,
 			__notify_services_by_cid(m1, sq3, url);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	g_free(m1url);
 
 	/* XXX JFS: ugly quirk until we find a pretty way to distinguish the
@@ -912,7 +912,7 @@ meta1_backend_services_link (struct meta1_backend_s *m1,
 		}
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -950,7 +950,7 @@ meta1_backend_services_poll(struct meta1_backend_s *m1,
 		}
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -1047,7 +1047,7 @@ label_retry:
 		err = sqlx_transaction_end(repctx, err);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -1074,7 +1074,7 @@ meta1_backend_services_unlink(struct meta1_backend_s *m1,
 			__notify_services_by_cid(m1, sq3, url);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -1141,7 +1141,7 @@ meta1_backend_services_relink(struct meta1_backend_s *m1,
 					__notify_services_by_cid(m1, sq3, url);
 			}
 		}
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 
 out:
@@ -1235,7 +1235,7 @@ meta1_backend_notify_services(struct meta1_backend_s *m1, struct oio_url_s *url)
 	GError *err = _open_and_lock(m1, url, M1V2_OPENBASE_MASTERSLAVE, &sq3);
 	if (!err) {
 		__notify_services_by_cid(m1, sq3, url);
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 	return err;
 }
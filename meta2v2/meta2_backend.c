@@ -37,6 +37,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <sqliterepo/sqlite_utils.h>
 #include <sqliterepo/sqliterepo.h>
 #include <sqliterepo/election.h>
+#include <sqliterepo/sqliterepo_variables.h>
 
 #include <events/beanstalkd.h>
 #include <events/oio_events_queue.h>
@@ -215,6 +216,8 @@ _init_notifiers(struct meta2_backend_s *m2, const char *ns)
 #undef INIT
 }
 
+static void _commit_group_destroy(struct m2b_commit_group_s *group);
+
 GError *
 meta2_backend_init(struct meta2_backend_s **result,
 		struct sqlx_repository_s *repo, const gchar *ns,
@@ -245,6 +248,9 @@ meta2_backend_init(struct meta2_backend_s **result,
 	m2->prepare_data_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
 			g_free, g_free);
 	g_rw_lock_init(&(m2->prepare_data_lock));
+	m2->commit_groups = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify) _commit_group_destroy);
+	g_mutex_init(&m2->commit_groups_lock);
 	m2->resolver = resolver;
 
 	GError *err;
@@ -305,6 +311,10 @@ meta2_backend_clean(struct meta2_backend_s *m2)
 
 	g_hash_table_unref(m2->prepare_data_cache);
 	m2->prepare_data_cache = NULL;
+	if (m2->commit_groups)
+		g_hash_table_unref(m2->commit_groups);
+	m2->commit_groups = NULL;
+	g_mutex_clear(&m2->commit_groups_lock);
 	g_rw_lock_clear(&(m2->prepare_data_lock));
 	g_mutex_clear(&m2->nsinfo_lock);
 	namespace_info_free(m2->nsinfo);
@@ -511,16 +521,13 @@ _sql_queries_pack(gpointer value, gpointer data) {
 	oio_str_gstring_append_json_quote(beanstalkd_job, value);
 }
 
+/* Push the queries saved during a sharding to the sharding queue. */
 static void
-m2b_close(struct meta2_backend_s *m2b, struct sqlx_sqlite3_s *sq3,
-		struct oio_url_s *url)
+_m2b_save_sharding_queries(struct meta2_backend_s *m2b,
+		struct sqlx_sqlite3_s *sq3, struct oio_url_s *url)
 {
-	EXTRA_ASSERT(m2b != NULL);
-
-	if (!sq3)
-		return;
 	if (!sq3->sharding_queue || !sq3->update_queries)
-		goto exit;
+		return;
 
 	GString *beanstalkd_job = g_string_new("{");
 	oio_str_gstring_append_json_pair(beanstalkd_job, "path",
@@ -543,13 +550,35 @@ m2b_close(struct meta2_backend_s *m2b, struct sqlx_sqlite3_s *sq3,
 					err->code, err->message);
 			g_clear_error(&err);
 		}
-		goto exit;
 	}
+}
 
-exit:
+static void
+m2b_close(struct meta2_backend_s *m2b, struct sqlx_sqlite3_s *sq3,
+		struct oio_url_s *url)
+{
+	EXTRA_ASSERT(m2b != NULL);
+
+	if (!sq3)
+		return;
+	_m2b_save_sharding_queries(m2b, sq3, url);
 	sqlx_repository_unlock_and_close_noerror(sq3);
 }
 
+/* Like m2b_close(), after a write:
+ * see sqlx_repository_unlock_and_close_written(). */
+static GError *
+m2b_close_written(struct meta2_backend_s *m2b, struct sqlx_sqlite3_s *sq3,
+		struct oio_url_s *url, GError *err)
+{
+	EXTRA_ASSERT(m2b != NULL);
+
+	if (!sq3)
+		return err;
+	_m2b_save_sharding_queries(m2b, sq3, url);
+	return sqlx_repository_unlock_and_close_written(sq3, err);
+}
+
 static void
 m2b_destroy(struct sqlx_sqlite3_s *sq3)
 {
@@ -939,24 +968,32 @@ _connect_to_sharding_queue(struct oio_url_s *url,
 	return err;
 }
 
+/* Check the object targeted by the URL belongs to the (already open) base,
+ * or tell the client which shard to contact. */
+static GError *
+_check_object_target(struct sqlx_sqlite3_s *sq3, struct oio_url_s *url,
+		enum m2v2_open_type_e how)
+{
+	enum m2v2_open_type_e replimode = how & M2V2_OPEN_REPLIMODE;
+	const gchar *path = oio_url_get(url, OIOURL_PATH);
+	if (oio_ext_is_shard_redirection())
+		return _check_shard_range(sq3, url, path,
+				replimode != M2V2_OPEN_MASTERONLY);
+	return _redirect_to_shard(sq3, path);
+}
+
 static GError *
 m2b_open_for_object(struct meta2_backend_s *m2b, struct oio_url_s *url,
 		enum m2v2_open_type_e how, struct sqlx_sqlite3_s **result)
 {
 	GError *err = NULL;
 	struct sqlx_sqlite3_s *sq3 = NULL;
-	enum m2v2_open_type_e replimode = how & M2V2_OPEN_REPLIMODE;
 
 	err = m2b_open(m2b, url, how, &sq3);
 	if (err)
 		return err;
 
-	const gchar *path = oio_url_get(url, OIOURL_PATH);
-	if (oio_ext_is_shard_redirection())
-		err = _check_shard_range(sq3, url, path,
-				replimode != M2V2_OPEN_MASTERONLY);
-	else
-		err = _redirect_to_shard(sq3, path);
+	err = _check_object_target(sq3, url, how);
 	if (err)
 		m2b_close(m2b, sq3, url);
 	else
@@ -991,6 +1028,204 @@ _transaction_begin(struct sqlx_sqlite3_s *sq3, struct oio_url_s *url,
 	return NULL;
 }
 
+/* Group commit ------------------------------------------------------------- */
+
+/* Concurrent writers targeting the same base gather in a commit group. The
+ * first one becomes the leader: it opens the base and starts a transaction,
+ * then lends the handle to each queued writer in turn. Each writer runs its
+ * own operation in its own thread (the request context is thread-local),
+ * protected by a savepoint so that a failure only discards its own changes.
+ * A single COMMIT (and a single replication round) closes the batch. */
+
+typedef GError* (*m2b_grouped_op_f) (struct sqlx_sqlite3_s *sq3, gpointer udata);
+
+struct m2b_writer_s
+{
+	m2b_grouped_op_f op;
+	gpointer udata;
+	GError *err;
+	gboolean batched;  /* picked by a leader, cannot leave anymore */
+	gboolean running;  /* currently owns the base handle */
+	gboolean done;     /* the batch has been committed (or not) */
+};
+
+struct m2b_commit_group_s
+{
+	GCond cond;
+	GQueue writers;  /* <struct m2b_writer_s*> waiting for a leader */
+	struct sqlx_sqlite3_s *sq3;
+	guint refcount;
+	gboolean led;
+};
+
+static void
+_commit_group_destroy(struct m2b_commit_group_s *group)
+{
+	if (!group)
+		return;
+	EXTRA_ASSERT(group->refcount == 0);
+	EXTRA_ASSERT(g_queue_is_empty(&group->writers));
+	g_cond_clear(&group->cond);
+	g_free(group);
+}
+
+static GError *
+_m2b_run_grouped(struct sqlx_sqlite3_s *sq3, struct m2b_writer_s *w)
+{
+	/* The admin table is cached in RAM: flush it before the savepoint so
+	 * that it can be reloaded if the operation fails. */
+	sqlx_admin_save_lazy(sq3);
+	int rc = sqlx_exec(sq3->db, "SAVEPOINT m2b_group");
+	if (rc != SQLITE_OK)
+		return SQLITE_GERROR(sq3->db, rc);
+
+	GError *err = w->op(sq3, w->udata);
+	if (err) {
+		sqlx_exec(sq3->db, "ROLLBACK TO m2b_group");
+		sqlx_admin_reload(sq3);
+	}
+	sqlx_exec(sq3->db, "RELEASE m2b_group");
+	return err;
+}
+
+/* Called without the lock held, by the writer that took the lead. */
+static void
+_m2b_lead_group(struct meta2_backend_s *m2b, struct oio_url_s *url,
+		enum m2v2_open_type_e how, struct m2b_commit_group_s *group,
+		struct m2b_writer_s *self)
+{
+	GError *err = NULL;
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	struct sqlx_repctx_s *repctx = NULL;
+	GPtrArray *batch = g_ptr_array_new();
+
+	g_ptr_array_add(batch, self);
+	self->batched = TRUE;
+
+	if (!(err = m2b_open(m2b, url, how, &sq3))
+			&& !(err = _transaction_begin(sq3, url, &repctx))) {
+		self->err = _m2b_run_grouped(sq3, self);
+
+		g_mutex_lock(&m2b->commit_groups_lock);
+		if (meta2_group_commit_delay > 0) {
+			/* Do not use oio_ext_monotonic_time(), it can be a fake clock */
+			const gint64 until = g_get_monotonic_time()
+				+ meta2_group_commit_delay;
+			while (g_queue_get_length(&group->writers) + 1 < meta2_group_commit_max
+					&& g_cond_wait_until(&group->cond,
+						&m2b->commit_groups_lock, until)) {}
+		}
+		group->sq3 = sq3;
+		while (batch->len < meta2_group_commit_max
+				&& !g_queue_is_empty(&group->writers)) {
+			struct m2b_writer_s *w = g_queue_pop_head(&group->writers);
+			w->batched = w->running = TRUE;
+			g_ptr_array_add(batch, w);
+			g_cond_broadcast(&group->cond);
+			while (w->running)
+				g_cond_wait(&group->cond, &m2b->commit_groups_lock);
+		}
+		group->sq3 = NULL;
+		g_mutex_unlock(&m2b->commit_groups_lock);
+
+		err = sqlx_transaction_end(repctx, NULL);
+		if (!err)
+			m2b_add_modified_container(m2b, sq3);
+		GRID_TRACE("Group commit of %u writers on %s",
+				batch->len, oio_url_get(url, OIOURL_HEXID));
+	}
+	if (sq3)
+		err = m2b_close_written(m2b, sq3, url, err);
+
+	g_mutex_lock(&m2b->commit_groups_lock);
+	for (guint i = 0; i < batch->len; i++) {
+		struct m2b_writer_s *w = batch->pdata[i];
+		if (err && !w->err)
+			w->err = g_error_copy(err);
+		w->done = TRUE;
+	}
+	g_cond_broadcast(&group->cond);
+	g_mutex_unlock(&m2b->commit_groups_lock);
+
+	g_clear_error(&err);
+	g_ptr_array_free(batch, TRUE);
+}
+
+static GError *
+m2b_group_commit(struct meta2_backend_s *m2b, struct oio_url_s *url,
+		enum m2v2_open_type_e how, m2b_grouped_op_f op, gpointer udata)
+{
+	struct m2b_writer_s self = {0};
+	self.op = op;
+	self.udata = udata;
+
+	/* Requests with a different redirection flag would not open the
+	 * same base with the same checks. */
+	gchar key[STRLEN_CONTAINERID + 4];
+	g_snprintf(key, sizeof(key), "%s/%d", oio_url_get(url, OIOURL_HEXID),
+			oio_ext_is_shard_redirection() ? 1 : 0);
+	/* The deadline of the request is on its own (maybe fake) clock,
+	 * the waits are on the clock of GLib. */
+	const gint64 now = oio_ext_monotonic_time();
+	gint64 deadline = oio_ext_get_deadline();
+	if (deadline <= 0)
+		deadline = now + _cache_timeout_open;
+	deadline = g_get_monotonic_time() + (deadline - now);
+
+	g_mutex_lock(&m2b->commit_groups_lock);
+	struct m2b_commit_group_s *group =
+		g_hash_table_lookup(m2b->commit_groups, key);
+	if (!group) {
+		group = g_malloc0(sizeof(*group));
+		g_cond_init(&group->cond);
+		g_queue_init(&group->writers);
+		g_hash_table_insert(m2b->commit_groups, g_strdup(key), group);
+	}
+	group->refcount++;
+
+	if (!group->led) {
+		group->led = TRUE;
+		g_mutex_unlock(&m2b->commit_groups_lock);
+		_m2b_lead_group(m2b, url, how, group, &self);
+		g_mutex_lock(&m2b->commit_groups_lock);
+		group->led = FALSE;
+	} else {
+		g_queue_push_tail(&group->writers, &self);
+		g_cond_broadcast(&group->cond);
+		while (!self.done) {
+			if (self.running) {
+				struct sqlx_sqlite3_s *sq3 = group->sq3;
+				g_mutex_unlock(&m2b->commit_groups_lock);
+				self.err = _m2b_run_grouped(sq3, &self);
+				g_mutex_lock(&m2b->commit_groups_lock);
+				self.running = FALSE;
+				g_cond_broadcast(&group->cond);
+			} else if (!self.batched && !group->led) {
+				/* The previous leader is gone: take its place. */
+				g_queue_remove(&group->writers, &self);
+				group->led = TRUE;
+				g_mutex_unlock(&m2b->commit_groups_lock);
+				_m2b_lead_group(m2b, url, how, group, &self);
+				g_mutex_lock(&m2b->commit_groups_lock);
+				group->led = FALSE;
+			} else if (!g_cond_wait_until(&group->cond,
+						&m2b->commit_groups_lock, deadline)
+					&& !self.batched) {
+				g_queue_remove(&group->writers, &self);
+				self.err = BUSY("Timeout while waiting for a group commit");
+				self.done = TRUE;
+			}
+		}
+	}
+
+	/* Wake up a writer that may take the lead */
+	g_cond_broadcast(&group->cond);
+	if (!--group->refcount)
+		g_hash_table_remove(m2b->commit_groups, key);
+	g_mutex_unlock(&m2b->commit_groups_lock);
+	return self.err;
+}
+
 static GError *
 _table_is_empty(struct sqlx_sqlite3_s *sq3, const gchar *table)
 {
@@ -1261,7 +1496,7 @@ meta2_backend_create_container(struct meta2_backend_s *m2,
 	 * M2_PREP that occurred after a GETVERS (the meta1 is filled) but before
 	 * the CREATE. */
 	meta2_backend_change_callback(sq3, m2);
-	m2b_close(m2, sq3, url);
+	err = m2b_close_written(m2, sq3, url, err);
 	return err;
 }
 
@@ -1352,7 +1587,7 @@ meta2_backend_flush_container(struct meta2_backend_s *m2, struct oio_url_s *url,
 				}
 			}
 		}
-		m2b_close(m2, sq3, url);
+		err = m2b_close_written(m2, sq3, url, err);
 	}
 
 	return err;
@@ -1381,7 +1616,7 @@ meta2_backend_purge_container(struct meta2_backend_s *m2, struct oio_url_s *url,
 		}
 		if (!err)
 			m2b_add_modified_container(m2, sq3);
-		m2b_close(m2, sq3, url);
+		err = m2b_close_written(m2, sq3, url, err);
 	}
 
 	return err;
@@ -1415,7 +1650,7 @@ meta2_backend_drain_container(struct meta2_backend_s *m2, struct oio_url_s *url,
 			}
 		}
 
-		m2b_close(m2, sq3, url);
+		err = m2b_close_written(m2, sq3, url, err);
 	}
 
 	return err;
@@ -1571,7 +1806,7 @@ meta2_backend_notify_container_state(struct meta2_backend_s *m2b,
 		}
 		if (!err)
 			m2b_add_modified_container(m2b, sq3);
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -1592,7 +1827,7 @@ meta2_backend_drain_content(struct meta2_backend_s *m2,
 			err = m2db_drain_content(sq3, url, cb, u0);
 			err = sqlx_transaction_end(repctx, err);
 		}
-		m2b_close(m2, sq3, url);
+		err = m2b_close_written(m2, sq3, url, err);
 	}
 	return err;
 }
@@ -1731,11 +1966,63 @@ meta2_backend_delete_alias(struct meta2_backend_s *m2b,
 			m2b_add_modified_container(m2b, sq3);
 		}
 	}
-	m2b_close(m2b, sq3, url);
+	err = m2b_close_written(m2b, sq3, url, err);
 
 	return err;
 }
 
+struct m2b_put_alias_s
+{
+	struct oio_url_s *url;
+	GSList *beans;
+	m2_onbean_cb cb_deleted;
+	gpointer u0_deleted;
+	m2_onbean_cb cb_added;
+	gpointer u0_added;
+};
+
+static GError *
+_check_put_alias_target(struct sqlx_sqlite3_s *sq3)
+{
+	if (!oio_ext_is_shard_redirection()
+			&& sqlx_admin_has(sq3, M2V2_ADMIN_SHARDING_ROOT))
+		return NEWERROR(CODE_NOT_ALLOWED, "Creating an object directly on "
+				"shard is not allowed. Please use the root container.");
+	return NULL;
+}
+
+static GError *
+_put_alias(struct sqlx_sqlite3_s *sq3, struct m2b_put_alias_s *ctx)
+{
+	GError *err = NULL;
+	struct m2db_put_args_s args;
+	memset(&args, 0, sizeof(args));
+	args.sq3 = sq3;
+	args.url = ctx->url;
+	args.ns_max_versions = meta2_max_versions;
+	args.worm_mode = oio_ns_mode_worm && !oio_ext_is_admin();
+
+	if (!(err = m2db_put_alias(&args, ctx->beans,
+			ctx->cb_deleted, ctx->u0_deleted,
+			ctx->cb_added, ctx->u0_added))) {
+		m2db_increment_version(sq3);
+	}
+	return err;
+}
+
+static GError *
+_put_alias_grouped(struct sqlx_sqlite3_s *sq3, gpointer udata)
+{
+	struct m2b_put_alias_s *ctx = udata;
+	GError *err = _check_object_target(sq3, ctx->url,
+			M2V2_OPEN_MASTERONLY|M2V2_OPEN_ENABLED);
+	if (!err)
+		err = _check_put_alias_target(sq3);
+	if (!err)
+		err = _put_alias(sq3, ctx);
+	return err;
+}
+
 GError*
 meta2_backend_put_alias(struct meta2_backend_s *m2b, struct oio_url_s *url,
 		GSList *in, m2_onbean_cb cb_deleted, gpointer u0_deleted,
@@ -1744,42 +2031,42 @@ meta2_backend_put_alias(struct meta2_backend_s *m2b, struct oio_url_s *url,
 	GError *err = NULL;
 	struct sqlx_sqlite3_s *sq3 = NULL;
 	struct sqlx_repctx_s *repctx = NULL;
+	struct m2b_put_alias_s ctx = {
+		.url = url, .beans = in,
+		.cb_deleted = cb_deleted, .u0_deleted = u0_deleted,
+		.cb_added = cb_added, .u0_added = u0_added,
+	};
 
 	EXTRA_ASSERT(m2b != NULL);
 	EXTRA_ASSERT(url != NULL);
 	if (!in)
 		return NEWERROR(CODE_BAD_REQUEST, "No bean");
 
+	/* Forcing the versioning alters the container itself,
+	 * keep such requests out of the groups. */
+	if (meta2_group_commit_max > 1 && !oio_ext_get_force_versioning())
+		return m2b_group_commit(m2b, url,
+				M2V2_OPEN_MASTERONLY|M2V2_OPEN_ENABLED,
+				_put_alias_grouped, &ctx);
+
 	err = m2b_open_for_object(m2b, url, M2V2_OPEN_MASTERONLY|M2V2_OPEN_ENABLED,
 			&sq3);
 	if (!err) {
-		if (!oio_ext_is_shard_redirection()
-				&& sqlx_admin_has(sq3, M2V2_ADMIN_SHARDING_ROOT)) {
+		if ((err = _check_put_alias_target(sq3))) {
 			m2b_close(m2b, sq3, url);
-			return NEWERROR(CODE_NOT_ALLOWED, "Creating an object directly on "
-					"shard is not allowed. Please use the root container.");
+			return err;
 		}
-		struct m2db_put_args_s args;
-		memset(&args, 0, sizeof(args));
-		args.sq3 = sq3;
-		args.url = url;
-		args.ns_max_versions = meta2_max_versions;
-		args.worm_mode = oio_ns_mode_worm && !oio_ext_is_admin();
-
 		if (!(err = _transaction_begin(sq3, url, &repctx))) {
 			if (oio_ext_get_force_versioning()) {
 				GRID_DEBUG("Updating max_version: %s", oio_ext_get_force_versioning());
 				m2db_set_max_versions(sq3, atoi(oio_ext_get_force_versioning()));
 			}
-			if (!(err = m2db_put_alias(&args, in,
-					cb_deleted, u0_deleted, cb_added, u0_added))) {
-				m2db_increment_version(sq3);
-			}
+			err = _put_alias(sq3, &ctx);
 			err = sqlx_transaction_end(repctx, err);
 			if (!err)
 				m2b_add_modified_container(m2b, sq3);
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -1825,7 +2112,7 @@ meta2_backend_change_alias_policy(struct meta2_backend_s *m2b,
 			// No need to update container stats as it should have been updated on
 			// transition request.
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -1871,7 +2158,7 @@ meta2_backend_request_policy_transition(struct meta2_backend_s *m2,
 						g_string_free (event, FALSE));
 			}
 		}
-		m2b_close(m2, sq3, url);
+		err = m2b_close_written(m2, sq3, url, err);
 	}
 
 	return err;
@@ -1910,7 +2197,7 @@ meta2_backend_restore_drained(struct meta2_backend_s *m2b,
 			if (!err)
 				m2b_add_modified_container(m2b, sq3);
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -1951,7 +2238,7 @@ meta2_backend_update_content(struct meta2_backend_s *m2b, struct oio_url_s *url,
 			if (!err)
 				m2b_add_modified_container(m2b, sq3);
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -1983,7 +2270,7 @@ meta2_backend_truncate_content(struct meta2_backend_s *m2b,
 			if (!err)
 				m2b_add_modified_container(m2b, sq3);
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -2029,7 +2316,7 @@ meta2_backend_force_alias(struct meta2_backend_s *m2b, struct oio_url_s *url,
 		if (!err)
 			m2b_add_modified_container(m2b, sq3);
 
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -2067,7 +2354,7 @@ meta2_backend_purge_alias(struct meta2_backend_s *m2, struct oio_url_s *url,
 		}
 		if (!err)
 			m2b_add_modified_container(m2, sq3);
-		m2b_close(m2, sq3, url);
+		err = m2b_close_written(m2, sq3, url, err);
 	}
 
 	return err;
@@ -2111,7 +2398,7 @@ meta2_backend_insert_beans(struct meta2_backend_s *m2b,
 		}
 		if (!err)
 			m2b_add_modified_container(m2b, sq3);
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	if (error_already) {
@@ -2151,7 +2438,7 @@ meta2_backend_delete_beans(struct meta2_backend_s *m2b,
 				m2db_increment_version(sq3);
 			err = sqlx_transaction_end(repctx, err);
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -2196,7 +2483,7 @@ meta2_backend_update_beans(struct meta2_backend_s *m2b, struct oio_url_s *url,
 				m2db_increment_version(sq3);
 			err = sqlx_transaction_end(repctx, err);
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -2245,7 +2532,7 @@ meta2_backend_append_to_alias(struct meta2_backend_s *m2b,
 		}
 		if (!err)
 			m2b_add_modified_container(m2b, sq3);
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	namespace_info_free (nsinfo);
@@ -2288,7 +2575,7 @@ meta2_backend_del_properties(struct meta2_backend_s *m2b,
 				m2db_increment_version(sq3);
 			err = sqlx_transaction_end(repctx, err);
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -2314,7 +2601,7 @@ meta2_backend_set_properties(struct meta2_backend_s *m2b, struct oio_url_s *url,
 				m2db_increment_version(sq3);
 			err = sqlx_transaction_end(repctx, err);
 		}
-		m2b_close(m2b, sq3, url);
+		err = m2b_close_written(m2b, sq3, url, err);
 	}
 
 	return err;
@@ -3273,7 +3560,7 @@ rollback:
 			}
 		}
 
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 end:
 	g_free(queue_url);
@@ -3351,7 +3638,7 @@ meta2_backend_prepare_shrinking(struct meta2_backend_s *m2b,
 		}
 
 rollback:
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 
 	return err;
@@ -3575,9 +3862,10 @@ meta2_backend_merge_sharding(struct meta2_backend_s *m2b,
 		}
 close:
 		if (to_merge_sq3) {
-			sqlx_repository_unlock_and_close_noerror(to_merge_sq3);
+			err = sqlx_repository_unlock_and_close_written(
+					to_merge_sq3, err);
 		}
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 end:
 	oio_url_clean(to_merge_url);
@@ -3627,7 +3915,7 @@ meta2_backend_update_shard(struct meta2_backend_s *m2b,
 				err = sqlx_transaction_end(repctx, err);
 			}
 		}
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 
 	return err;
@@ -3729,7 +4017,7 @@ meta2_backend_lock_sharding(struct meta2_backend_s *m2b,
 			}
 			g_strfreev(indexes);
 		}
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 
 	return err;
@@ -3788,7 +4076,7 @@ meta2_backend_replace_sharding(struct meta2_backend_s *m2b,
 					m2b_add_modified_container(m2b, sq3);
 			}
 		}
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 
 	return err;
@@ -3896,7 +4184,7 @@ meta2_backend_clean_locally_sharding(struct meta2_backend_s *m2b,
 	err = sqlx_transaction_end(repctx, err);
 
 close:
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 end:
 	g_free(suffix);
 	return err;
@@ -3977,7 +4265,7 @@ close:
 	if (!err && !(*truncated)) {
 		m2b_add_modified_container(m2b, sq3);
 	}
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 	return err;
 }
 
@@ -4118,7 +4406,7 @@ meta2_backend_abort_sharding(struct meta2_backend_s *m2b, struct oio_url_s *url)
 	err = m2b_open_with_args(m2b, url, NULL, &open_args, &sq3);
 	if (!err) {
 		err = _meta2_abort_sharding(m2b, sq3, url);
-		sqlx_repository_unlock_and_close_noerror(sq3);
+		err = sqlx_repository_unlock_and_close_written(sq3, err);
 	}
 
 	return err;
@@ -4280,7 +4568,7 @@ meta2_backend_create_lifecycle_views(struct meta2_backend_s *m2b,
 rollback:
 	err = sqlx_transaction_end(repctx_view, err);
 close:
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 end:
 	return err;
 }
@@ -4678,7 +4966,7 @@ rollback:
 	}
 
 close:
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 end:
 	g_free(offset_key);
 	g_free(full_query);
@@ -4937,7 +5225,7 @@ rollback:
 			ht_policies, storage_class_order);
 	}
 close:
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 end:
 	g_free(offset_key);
 	g_free(full_query);
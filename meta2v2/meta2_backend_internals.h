@@ -73,6 +73,10 @@ struct meta2_backend_s
 	// Cache for admin values useful for M2_PREPARE requests
 	GHashTable *prepare_data_cache;
 	GRWLock prepare_data_lock;
+
+	// Writers gathered per base, for group commits
+	GHashTable *commit_groups;
+	GMutex commit_groups_lock;
 };
 
 #endif /*OIO_SDS__meta2v2__meta2_backend_internals_h*/
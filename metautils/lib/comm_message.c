@@ -191,6 +191,69 @@ message_marshall_gba(MESSAGE m, GError **err)
 	return result;
 }
 
+static void
+_der_append_length(GByteArray *gba, gsize len)
+{
+	guint8 b;
+	if (len < 0x80) {
+		b = len;
+		g_byte_array_append(gba, &b, 1);
+		return;
+	}
+	guint8 tmp[sizeof(gsize)];
+	guint n = 0;
+	for (gsize l = len; l; l >>= 8)
+		tmp[n++] = l & 0xFF;
+	b = 0x80 | n;
+	g_byte_array_append(gba, &b, 1);
+	while (n > 0)
+		g_byte_array_append(gba, &tmp[--n], 1);
+}
+
+GByteArray*
+message_marshall_gba_header(MESSAGE m, gsize body_size, GError **err)
+{
+	EXTRA_ASSERT(m != NULL);
+	EXTRA_ASSERT(m->body == NULL);
+
+	GByteArray *encoded = message_marshall_gba(m, err);
+	if (!encoded)
+		return NULL;
+
+	/* Skip the frame size, then the tag and the length of the SEQUENCE */
+	const guint8 *seq = encoded->data + 4;
+	gsize hdr_len = 2, content_len = seq[1];
+	if (seq[1] & 0x80) {
+		const guint n = seq[1] & 0x7F;
+		content_len = 0;
+		for (guint i = 0; i < n; i++)
+			content_len = (content_len << 8) | seq[2 + i];
+		hdr_len += n;
+	}
+
+	/* The body is the last field: [4] IMPLICIT OCTET STRING */
+	GByteArray *body_hdr = g_byte_array_sized_new(16);
+	guint8 tag = 0x84;
+	g_byte_array_append(body_hdr, &tag, 1);
+	_der_append_length(body_hdr, body_size);
+
+	guint32 u32 = 0;
+	GByteArray *result = g_byte_array_sized_new(
+			encoded->len + body_hdr->len + 16);
+	g_byte_array_append(result, (guint8*)&u32, sizeof(u32));
+	tag = 0x30;
+	g_byte_array_append(result, &tag, 1);
+	_der_append_length(result, content_len + body_hdr->len + body_size);
+	g_byte_array_append(result, seq + hdr_len, content_len);
+	g_byte_array_append(result, body_hdr->data, body_hdr->len);
+	g_byte_array_free(body_hdr, TRUE);
+	g_byte_array_free(encoded, TRUE);
+
+	guint32 s32 = result->len - 4 + body_size;
+	*((guint32*)(result->data)) = g_htonl(s32);
+	return result;
+}
+
 GByteArray*
 message_marshall_gba_and_clean(MESSAGE m)
 {
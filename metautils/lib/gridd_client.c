@@ -26,6 +26,7 @@ License along with this library.
 #include <strings.h>
 #include <errno.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 
 #include "metautils.h"
 
@@ -80,6 +81,7 @@ struct gridd_client_s
 	guint8 keepalive : 1;
 	guint8 forbid_redirect : 1;
 	guint8 avoidance_onoff : 1;
+	guint8 reused : 1; /* the connection has been taken from the pool */
 
 	gchar orig_url[URL_MAXLEN];
 	gchar url[URL_MAXLEN];
@@ -165,6 +167,173 @@ _count_network_error (const char *url, const GError *err)
 	g_mutex_unlock(&lock_errors);
 }
 
+/* Pool of idle connections ------------------------------------------------ */
+
+struct pooled_cnx_s
+{
+	gint64 last_used;
+	int fd;
+};
+
+static GMutex lock_pool;
+static GHashTable *pool_idle = NULL;  /* <gchar*> -> <GQueue*> of <pooled_cnx_s*> */
+static guint pool_idle_count = 0;
+static gint64 pool_last_purge = 0;
+
+static GQuark gq_pool_hit = 0;
+static GQuark gq_pool_miss = 0;
+static GQuark gq_pool_expired = 0;
+static GQuark gq_pool_broken = 0;
+static GQuark gq_pool_idle = 0;
+
+void _oio_cnx_pool_constructor (void);
+
+void __attribute__ ((constructor))
+_oio_cnx_pool_constructor (void)
+{
+	static volatile guint lazy_init = 1;
+	if (lazy_init) {
+		if (g_atomic_int_compare_and_exchange(&lazy_init, 1, 0)) {
+			g_mutex_init(&lock_pool);
+			pool_idle = g_hash_table_new_full(g_str_hash, g_str_equal,
+					g_free, (GDestroyNotify) g_queue_free);
+			gq_pool_hit = g_quark_from_static_string("counter cnx.pool_hit");
+			gq_pool_miss = g_quark_from_static_string("counter cnx.pool_miss");
+			gq_pool_expired = g_quark_from_static_string("counter cnx.pool_expired");
+			gq_pool_broken = g_quark_from_static_string("counter cnx.pool_broken");
+			gq_pool_idle = g_quark_from_static_string("gauge cnx.pooled");
+		}
+	}
+}
+
+static void
+_pooled_cnx_close(struct pooled_cnx_s *cnx)
+{
+	metautils_pclose(&(cnx->fd));
+	g_free(cnx);
+	-- pool_idle_count;
+}
+
+/* An idle connection must have nothing to read: neither data nor EOF. */
+static gboolean
+_pooled_cnx_is_healthy(int fd)
+{
+	guint8 b;
+	ssize_t rc = recv(fd, &b, 1, MSG_PEEK|MSG_DONTWAIT);
+	return rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/* The queues are sorted from the most recently used to the least recently
+ * used connection, the expired connections are at the tail. */
+static guint
+_pool_queue_expire(GQueue *q, gint64 now)
+{
+	guint count = 0;
+	struct pooled_cnx_s *cnx;
+	while ((cnx = g_queue_peek_tail(q))
+			&& cnx->last_used < OLDEST(now, oio_client_cnx_pool_ttl_idle)) {
+		g_queue_pop_tail(q);
+		_pooled_cnx_close(cnx);
+		++ count;
+	}
+	return count;
+}
+
+static guint
+_pool_purge(gint64 now)
+{
+	guint count = 0;
+	gboolean _expire(gpointer k UNUSED, gpointer v, gpointer u UNUSED) {
+		count += _pool_queue_expire(v, now);
+		return g_queue_is_empty(v);
+	}
+	if (pool_last_purge < OLDEST(now, G_TIME_SPAN_SECOND)) {
+		pool_last_purge = now;
+		g_hash_table_foreach_remove(pool_idle, _expire, NULL);
+	}
+	return count;
+}
+
+/* Returns an idle connection to <url>, or -1 if none is available */
+static int
+_cnx_pool_acquire(const char *url)
+{
+	int fd = -1;
+	guint expired = 0, broken = 0, idle = 0;
+	const gint64 now = oio_ext_monotonic_time();
+
+	g_mutex_lock(&lock_pool);
+	GQueue *q = g_hash_table_lookup(pool_idle, url);
+	if (q) {
+		expired += _pool_queue_expire(q, now);
+		struct pooled_cnx_s *cnx;
+		while (fd < 0 && (cnx = g_queue_pop_head(q))) {
+			if (_pooled_cnx_is_healthy(cnx->fd)) {
+				fd = cnx->fd;
+				g_free(cnx);
+				-- pool_idle_count;
+			} else {
+				_pooled_cnx_close(cnx);
+				++ broken;
+			}
+		}
+	}
+	expired += _pool_purge(now);
+	idle = pool_idle_count;
+	g_mutex_unlock(&lock_pool);
+
+	oio_stats_add(
+			fd >= 0 ? gq_pool_hit : gq_pool_miss, 1,
+			gq_pool_expired, expired,
+			gq_pool_broken, broken, 0, 0);
+	oio_stats_set(gq_pool_idle, idle, 0, 0, 0, 0, 0, 0);
+	return fd;
+}
+
+/* Gives the ownership of <fd> to the pool */
+static void
+_cnx_pool_release(const char *url, int fd)
+{
+	guint expired = 0, idle = 0;
+	const gint64 now = oio_ext_monotonic_time();
+
+	g_mutex_lock(&lock_pool);
+	GQueue *q = g_hash_table_lookup(pool_idle, url);
+	if (!q) {
+		q = g_queue_new();
+		g_hash_table_insert(pool_idle, g_strdup(url), q);
+	}
+	struct pooled_cnx_s *cnx = g_malloc(sizeof(*cnx));
+	cnx->fd = fd;
+	cnx->last_used = now;
+	g_queue_push_head(q, cnx);
+	++ pool_idle_count;
+	while (g_queue_get_length(q) > oio_client_cnx_pool_max_idle)
+		_pooled_cnx_close(g_queue_pop_tail(q));
+	expired += _pool_purge(now);
+	idle = pool_idle_count;
+	g_mutex_unlock(&lock_pool);
+
+	if (expired)
+		oio_stats_add(gq_pool_expired, expired, 0, 0, 0, 0, 0, 0);
+	oio_stats_set(gq_pool_idle, idle, 0, 0, 0, 0, 0, 0);
+}
+
+void
+gridd_client_cnx_pool_flush(void)
+{
+	g_mutex_lock(&lock_pool);
+	gboolean _flush(gpointer k UNUSED, gpointer v, gpointer u UNUSED) {
+		struct pooled_cnx_s *cnx;
+		while ((cnx = g_queue_pop_head(v)))
+			_pooled_cnx_close(cnx);
+		return TRUE;
+	}
+	g_hash_table_foreach_remove(pool_idle, _flush, NULL);
+	g_mutex_unlock(&lock_pool);
+	oio_stats_set(gq_pool_idle, 0, 0, 0, 0, 0, 0, 0);
+}
+
 /* ------------------------------------------------------------------------- */
 
 static void
@@ -181,9 +350,10 @@ _client_reset_reply(struct gridd_client_s *client)
  * alongside with the initiation sequence.
  */
 static GError*
-_client_connect(struct gridd_client_s *client)
+_client_connect_new(struct gridd_client_s *client)
 {
 	GError *err = NULL;
+	client->reused = 0;
 	gsize sent = client->request ? client->request->len : 0;
 	client->fd = sock_connect_and_send(client->url, &err,
 			sent ? client->request->data : NULL, &sent);
@@ -206,6 +376,24 @@ _client_connect(struct gridd_client_s *client)
 	return NULL;
 }
 
+static GError*
+_client_connect(struct gridd_client_s *client)
+{
+	if (oio_client_cnx_pool_enabled) {
+		int fd = _cnx_pool_acquire(client->url);
+		if (fd >= 0) {
+			client->fd = fd;
+			client->reused = 1;
+			client->tv_connect = oio_ext_monotonic_time ();
+			client->sent_bytes = 0;
+			_client_reset_reply(client);
+			client->step = REQ_SENDING;
+			return NULL;
+		}
+	}
+	return _client_connect_new(client);
+}
+
 static void
 _client_reset_request(struct gridd_client_s *client)
 {
@@ -226,6 +414,21 @@ _client_reset_cnx(struct gridd_client_s *client)
 	client->step = NONE;
 }
 
+/* The last reply has been entirely consumed, the connection is ready for
+ * another request toward the same peer. */
+static void
+_client_release_cnx(struct gridd_client_s *client)
+{
+	if (client->fd < 0)
+		return;
+	if (oio_client_cnx_pool_enabled && oio_client_cnx_pool_max_idle > 0) {
+		_cnx_pool_release(client->url, client->fd);
+		client->fd = -1;
+	} else {
+		metautils_pclose(&(client->fd));
+	}
+}
+
 static void
 _client_reset_target(struct gridd_client_s *client)
 {
@@ -289,7 +492,7 @@ _client_manage_reply(struct gridd_client_s *client, MESSAGE reply)
 		client->step = (status==CODE_FINAL_OK) ? STATUS_OK : REP_READING_SIZE;
 		if (client->step == STATUS_OK) {
 			if (!client->keepalive)
-				metautils_pclose(&(client->fd));
+				_client_release_cnx(client);
 		} else {
 			_client_reset_reply(client);
 		}
@@ -318,7 +521,8 @@ _client_manage_reply(struct gridd_client_s *client, MESSAGE reply)
 	if (status == CODE_REDIRECT && !client->forbid_redirect) {
 		/* Reset the context */
 		_client_reset_reply(client);
-		_client_reset_cnx(client);
+		_client_release_cnx(client);
+		client->step = NONE;
 		client->sent_bytes = 0;
 
 		++ client->nb_redirects;
@@ -349,8 +553,10 @@ _client_manage_reply(struct gridd_client_s *client, MESSAGE reply)
 		return err;
 	}
 
-	if (!client->keepalive)
-		_client_reset_cnx(client);
+	if (!client->keepalive) {
+		_client_release_cnx(client);
+		client->step = NONE;
+	}
 	_client_reset_reply(client);
 
 	if (status == CODE_REDIRECT_SHARD && client->on_reply) {
@@ -461,6 +667,8 @@ _client_manage_event_in_buffer(struct gridd_client_s *client, guint8 *d, gsize d
 
 				EXTRA_ASSERT(rc > 0);
 				g_byte_array_append(client->reply, d, rc);
+				/* The peer got the request, it must never be sent again */
+				client->reused = 0;
 
 				if (client->reply->len < 4)  /* size still incomplete */
 					return NULL;
@@ -538,6 +746,29 @@ _client_manage_event(struct gridd_client_s *client)
 
 /* ------------------------------------------------------------------------- */
 
+/* The peer may have closed a pooled connection right before it has been
+ * reused. The request is sent again on a new connection only if it could
+ * not be sent: the requests are not idempotent, and once it has been sent
+ * the peer may have executed it before the connection dropped. */
+static gboolean
+_client_retry_reused(struct gridd_client_s *client, GError *err)
+{
+	if (!client->reused || err->code != CODE_NETWORK_ERROR)
+		return FALSE;
+	if (client->step != REQ_SENDING)
+		return FALSE;
+
+	GRID_DEBUG("Pooled connection to [%s] broken: (%d) %s",
+			client->url, err->code, err->message);
+	oio_stats_add(gq_pool_broken, 1, 0, 0, 0, 0, 0, 0);
+	_client_reset_cnx(client);
+	GError *e = _client_connect_new(client);
+	if (!e)
+		return TRUE;
+	g_clear_error(&e);
+	return FALSE;
+}
+
 void
 gridd_client_react(struct gridd_client_s *client)
 {
@@ -548,6 +779,8 @@ retry:
 		if (client->step == REP_READING_SIZE && client->reply
 				&& client->reply->len >= 4)
 				goto retry;
+	} else if (_client_retry_reused(client, err)) {
+		g_clear_error(&err);
 	} else {
 		_client_reset_request(client);
 		_client_reset_reply(client);
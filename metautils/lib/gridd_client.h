@@ -95,6 +95,11 @@ void gridd_client_no_redirect (struct gridd_client_s *c);
 /* Only works with clients of the default type */
 void gridd_client_set_avoidance (struct gridd_client_s *c, gboolean on);
 
+/* Close all the idle connections kept for the next requests. The pool
+ * reports its activity in the "cnx.pool_*" counters and the "cnx.pooled"
+ * gauge of the process stats. */
+void gridd_client_cnx_pool_flush (void);
+
 /* ------------------------------------------------------------------------- */
 
 typedef GTree* down_hosts_t;
@@ -60,6 +60,12 @@ MESSAGE message_unmarshall(const guint8 *buf, gsize len, GError ** error);
 /** Calls message_marshall_gba() then metautils_message_destroy() on 'm'. */
 GByteArray* message_marshall_gba_and_clean(MESSAGE m);
 
+/** Serialize a message without body, as if it had a body of body_size
+ * bytes: the caller must send exactly body_size bytes right after the
+ * returned header. */
+GByteArray* message_marshall_gba_header(MESSAGE m, gsize body_size,
+		GError **err);
+
 typedef gint (*body_decoder_f)(GSList **r, const void *b, gsize l, GError **e);
 
 /** Adds a new custom field in the list of the message. Now check is made to
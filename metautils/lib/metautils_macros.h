@@ -62,6 +62,7 @@ License along with this library.
 #define NAME_MSGKEY_CONTENTID          "CI"
 #define NAME_MSGKEY_DELETE_MARKER      "DELETE_MARKER"
 #define NAME_MSGKEY_DELIMITER          "DELIMITER"
+#define NAME_MSGKEY_EXTENT_SIZE        "EXTENT_SIZE"
 #define NAME_MSGKEY_DRYRUN             "DRYRUN"
 #define NAME_MSGKEY_DST                "DST"
 #define NAME_MSGKEY_EVENT              "E"
@@ -74,6 +75,7 @@ License along with this library.
 #define NAME_MSGKEY_FORMAT             "FORMAT"
 #define NAME_MSGKEY_FROZEN             "FROZEN"
 #define NAME_MSGKEY_FULL               "FULL"
+#define NAME_MSGKEY_GENERATION         "GEN"
 #define NAME_MSGKEY_KEY                "K"
 #define NAME_MSGKEY_LIMIT              "LIMIT"
 #define NAME_MSGKEY_LOCAL              "LOCAL"
@@ -98,9 +100,11 @@ License along with this library.
 #define NAME_MSGKEY_RECOMPUTE          "RECOMPUTE"
 #define NAME_MSGKEY_REGION             "REGION"
 #define NAME_MSGKEY_REJOIN             "REJOIN"
+#define NAME_MSGKEY_REMOVED            "REMOVED"
 #define NAME_MSGKEY_REPLI_DESTS        "REPLI_DESTS"
 #define NAME_MSGKEY_REPLI_ID           "REPLI_ID"
 #define NAME_MSGKEY_REPLI_PROJECT_ID   "REPLI_PROJECT_ID"
+#define NAME_MSGKEY_REPLI_SEQ          "REPLI_SEQ"
 #define NAME_MSGKEY_REPLICAS           "REPLICAS"
 #define NAME_MSGKEY_RESTORE_DRAINED    "RESTORE"
 #define NAME_MSGKEY_ROOT_HEXID         "RID"
@@ -125,7 +125,7 @@ _req_get_option (struct req_args_s *args, const char *name)
 const char *
 _req_get_token (struct req_args_s *args, const char *name)
 {
-	return path_matching_get_variable (args->matchings[0], name);
+	return path_matching_get_variable (args->matchings, name);
 }
 
 enum http_rc_e
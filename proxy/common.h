@@ -41,6 +41,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <metautils/lib/common_variables.h>
 #include <proxy/proxy_variables.h>
 #include <proxy/shard_resolver.h>
+#include <proxy/srvtype_list.h>
 
 #include <cluster/lib/gridcluster.h>
 #include <server/network_server.h>
@@ -219,7 +220,7 @@ enum cache_control_e
 struct req_args_s
 {
 	struct oio_requri_s *req_uri; // parsed URI
-	struct path_matching_s **matchings; // matched handlers
+	struct path_matching_s *matchings; // matched handlers
 	struct oio_url_s *url;
 	enum cache_control_e cache_control;
 
@@ -371,6 +372,16 @@ GError * conscience_remote_get_services(struct req_args_s *args, gchar **cs,
 		const char *type, gboolean full, GSList **out,
 		gint64 deadline);
 
+/* Fetch the services of <type> changed since the generation <since> ("0"
+ * if none is known) and the services removed since, with the generation
+ * reached. If the conscience could not tell the changes, <delta> is FALSE
+ * and <changed> holds all the services. <generation> is NULL if the
+ * conscience does not track the generations. */
+GError * conscience_remote_get_service_changes(gchar **cs,
+		const char *type, const gchar *since, gchar **generation,
+		gboolean *delta, GSList **changed, GSList **removed,
+		gint64 deadline);
+
 GError * conscience_remote_get_types(struct req_args_s *args, gchar **cs,
 		gchar ***out,
 		gint64 deadline);
@@ -116,6 +116,84 @@ conscience_remote_get_services(struct req_args_s *args, gchar **allcs,
 	return _loop_on_allcs_while_neterror(args, allcs, action);
 }
 
+GError *
+conscience_remote_get_service_changes(gchar **allcs,
+		const char *type, const gchar *since, gchar **generation,
+		gboolean *delta, GSList **changed, GSList **removed, gint64 deadline)
+{
+	EXTRA_ASSERT(type != NULL);
+	EXTRA_ASSERT(since != NULL);
+
+	GSList *l_changed = NULL, *l_removed = NULL;
+	gchar *gen = NULL;
+	gboolean has_removed = FALSE;
+
+	void _reset(void) {
+		g_slist_free_full(l_changed, (GDestroyNotify)service_info_clean);
+		g_slist_free_full(l_removed, (GDestroyNotify)service_info_clean);
+		l_changed = l_removed = NULL;
+		g_free(gen);
+		gen = NULL;
+		has_removed = FALSE;
+	}
+
+	gboolean _on_reply(gpointer ctx UNUSED, guint status UNUSED, MESSAGE reply) {
+		GSList *l = NULL;
+		GError *e = metautils_message_extract_body_encoded(reply, FALSE,
+				&l, service_info_unmarshall);
+		if (!e) {
+			l_changed = metautils_gslist_precat(l_changed, l);
+			l = NULL;
+			gsize len = 0;
+			if (metautils_message_get_field(reply, NAME_MSGKEY_REMOVED, &len)) {
+				has_removed = TRUE;
+				e = metautils_message_extract_header_encoded(reply,
+						NAME_MSGKEY_REMOVED, FALSE, &l, service_info_unmarshall);
+				l_removed = metautils_gslist_precat(l_removed, l);
+			}
+		}
+		if (!e && !gen)
+			gen = metautils_message_extract_string_copy(reply,
+					NAME_MSGKEY_GENERATION);
+		if (e) {
+			GRID_WARN("Invalid list of [%s]: (%d) %s", type, e->code, e->message);
+			g_clear_error(&e);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	GError * action (const char *cs) {
+		_reset();
+		MESSAGE req = metautils_message_create_named("CS_SRV",
+				oio_clamp_deadline(proxy_timeout_conscience, deadline));
+		metautils_message_add_field_str(req, NAME_MSGKEY_TYPENAME, type);
+		metautils_message_add_field_str(req, NAME_MSGKEY_GENERATION, since);
+		GByteArray *encoded = message_marshall_gba_and_clean(req);
+		struct gridd_client_s *client = gridd_client_create(cs, encoded,
+				NULL, _on_reply);
+		g_byte_array_unref(encoded);
+		if (!client)
+			return SYSERR("client creation");
+		gridd_client_set_timeout(client,
+				oio_clamp_timeout(proxy_timeout_conscience, deadline));
+		GError *err = gridd_client_run(client);
+		gridd_client_free(client);
+		return err;
+	}
+
+	GError *err = _loop_on_allcs_while_neterror(NULL, allcs, action);
+	if (err) {
+		_reset();
+		return err;
+	}
+	*generation = gen;
+	*delta = has_removed;
+	*changed = l_changed;
+	*removed = l_removed;
+	return NULL;
+}
+
 GError *
 conscience_remote_get_types(struct req_args_s *args, gchar **allcs,
 		gchar ***out, gint64 deadline)
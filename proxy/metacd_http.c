@@ -76,6 +76,13 @@ GRWLock wanted_rwlock = {0};
 gchar **wanted_srvtypes = NULL;
 GBytes **wanted_prepared = NULL;
 
+/* The list of the services of each type. Only used by the task reloading
+ * the LB. */
+static GHashTable *srv_lists = NULL;
+
+/* A full reload of the LB could not purge the services removed */
+static gboolean lb_needs_purge = FALSE;
+
 // Misc. handlers --------------------------------------------------------------
 
 static enum http_rc_e
@@ -126,14 +133,12 @@ action_status(struct req_args_s *args)
 	return HTTPRC_DONE;
 }
 
-static struct path_matching_s **
-_metacd_match (const gchar *method, const gchar *path)
+/* Builds the matching key from the request in <key>, that must be able to
+ * hold strlen(path) + 2 + strlen(method) + 1 bytes. */
+static guint
+_metacd_match (const gchar *method, const gchar *path, gchar *key,
+		struct path_matching_s *tab, guint max)
 {
-	gsize lp = strlen(path), lm = strlen(method);
-	if (lp > proxy_url_path_maxlen || lm > 64)
-		return g_malloc0(sizeof(struct path_matching_s*));
-
-	gchar *key = g_alloca (lp + 2 + lm + 1);
 	gchar *pk = key;
 
 	// Copy and purify the path
@@ -159,14 +164,7 @@ _metacd_match (const gchar *method, const gchar *path)
 	*pk = '\0';
 
 	GRID_TRACE2("matching [%s]", key);
-	gchar **tokens = g_strsplit (key, "/", -1);
-	for (gchar **p=tokens; *p ;++p) {
-		gchar *unescaped = g_uri_unescape_string(*p,NULL);
-		oio_str_reuse(p, unescaped);
-	}
-	struct path_matching_s **result = path_parser_match (path_parser, tokens);
-	g_strfreev (tokens);
-	return result;
+	return path_parser_match (path_parser, key, tab, max);
 }
 
 static gboolean
@@ -294,17 +292,23 @@ handler_action (struct http_request_s *rq, struct http_reply_ctx_s *rp)
 	struct oio_requri_s ruri = {NULL, NULL, NULL, NULL};
 	oio_requri_parse (rq->req_uri, &ruri);
 
-	struct path_matching_s **matchings = _metacd_match (rq->cmd, ruri.path);
+	struct path_matching_s matchings[PATH_MATCHING_MAX];
+	guint matched = 0;
+	const gsize lp = strlen(ruri.path), lm = strlen(rq->cmd);
+	if (lp <= proxy_url_path_maxlen && lm <= 64) {
+		gchar *key = g_alloca (lp + 2 + lm + 1);
+		matched = _metacd_match (rq->cmd, ruri.path, key,
+				matchings, PATH_MATCHING_MAX);
+	}
 
 	GRID_TRACE2("URI path[%s] query[%s] fragment[%s] matches[%u]",
-			ruri.path, ruri.query, ruri.fragment,
-			g_strv_length((gchar**)matchings));
+			ruri.path, ruri.query, ruri.fragment, matched);
 
 	GQuark gq_count = gq_count_unexpected;
 	GQuark gq_time = gq_time_unexpected;
 
 	enum http_rc_e rc;
-	if (!*matchings) {
+	if (!matched) {
 		rp->set_content_type (HTTP_CONTENT_TYPE_JSON);
 		rp->set_body_gstr (g_string_new("{\"status\":404,\"message\":\"No handler found\"}"));
 		rp->set_status (HTTP_CODE_NOT_FOUND, "No handler found");
@@ -323,8 +327,8 @@ handler_action (struct http_request_s *rq, struct http_reply_ctx_s *rp)
 		if (!_metacd_load_url (&args, url)) {
 			rc = _reply_format_error(&args, BADREQ("Invalid oio url"));
 		} else {
-			gq_count = (*matchings)->last->gq_count;
-			gq_time = (*matchings)->last->gq_time;
+			gq_count = matchings->last->gq_count;
+			gq_time = matchings->last->gq_time;
 
 			GRID_TRACE("%s %s URL %s", __FUNCTION__,
 					ruri.path, oio_url_get(args.url, OIOURL_WHOLE));
@@ -332,7 +336,7 @@ handler_action (struct http_request_s *rq, struct http_reply_ctx_s *rp)
 			if (!oio_url_check(url, ns_name, &err)) {
 				rc = _reply_format_error(&args, BADREQ("Invalid parameter %s", err));
 			} else {
-				req_handler_f handler = (*matchings)->last->u;
+				req_handler_f handler = matchings->last->u;
 				rc = (*handler) (&args);
 			}
 		}
@@ -344,7 +348,6 @@ handler_action (struct http_request_s *rq, struct http_reply_ctx_s *rp)
 			gq_count, 1, gq_count_all, 1,
 			gq_time, (guint64) spent, gq_time_all, (guint64) spent);
 
-	path_matching_cleanv (matchings);
 	oio_requri_clear (&ruri);
 	oio_url_pclean (&url);
 	oio_ext_set_reqid (NULL);
@@ -512,8 +515,10 @@ _encode_wanted_services (const char *type, GSList *list)
 	return g_string_free_to_bytes(encoded);
 }
 
+/* <list> holds all the services of the type, <feed> those to be fed to
+ * the LB worlds: all of them or only those changed. */
 static void
-_reload_srvtype(const char *type, GSList *list)
+_reload_srvtype(const char *type, GSList *list, GSList *feed)
 {
 	/* reloads the known services */
 	time_t now = oio_ext_monotonic_seconds ();
@@ -523,24 +528,24 @@ _reload_srvtype(const char *type, GSList *list)
 	});
 
 	/* updates the score of the local services */
-	if (flag_local_scores && NULL != list) {
-		for (GSList *l=list; l ;l=l->next)
+	if (flag_local_scores && NULL != feed) {
+		for (GSList *l=feed; l ;l=l->next)
 			REG_WRITE(_NOLOCK_local_score_update(l->data));
 	}
 
 	/* prepares a cache of services wanted by the clients */
-	if (flag_cache_enabled && NULL != list) {
+	if (flag_cache_enabled && NULL != list && NULL != feed) {
 		GBytes *encoded = _encode_wanted_services (type, list);
 		WANTED_WRITE (encoded = _NOLOCK_precache_list_of_services (type, encoded));
 		g_bytes_unref (encoded);
 	}
 
 	/* reload the LB worlds, all of them #facepalm */
-	if (list) {
-		oio_lb_world__feed_service_info_list(lb_world, list);
+	if (feed) {
+		oio_lb_world__feed_service_info_list(lb_world, feed);
 
 		GSList *rlist = NULL;
-		for (GSList *l = list; l; l=l->next) {
+		for (GSList *l = feed; l; l=l->next) {
 			struct service_info_s *si = l->data;
 			if (!si || strcmp(si->type, NAME_SRVTYPE_RAWX)) continue;
 			rlist = g_slist_prepend(rlist, si);
@@ -553,7 +558,8 @@ _reload_srvtype(const char *type, GSList *list)
 static void
 _reload_lb_service_types(
 		struct oio_lb_world_s *lbw, struct oio_lb_s *lb_,
-		gchar **tabtypes, GPtrArray *tabsrv, GPtrArray *taberr)
+		gchar **tabtypes, GPtrArray *tabsrv, GPtrArray *tabfeed,
+		GPtrArray *taberr)
 {
 	struct service_update_policies_s *pols = service_update_policies_create();
 	gchar *pols_cfg = oio_var_get_string(oio_ns_service_update_policy);
@@ -569,18 +575,18 @@ _reload_lb_service_types(
 		}
 
 		if (!taberr->pdata[i])
-			_reload_srvtype(srvtype, tabsrv->pdata[i]);
+			_reload_srvtype(srvtype, tabsrv->pdata[i], tabfeed->pdata[i]);
 	}
 
 	service_update_policies_destroy(pols);
 }
 
 static void
-_free_list_of_services(gpointer p)
+_free_list(gpointer p)
 {
 	if (!p)
 		return;
-	g_slist_free_full((GSList*)p, (GDestroyNotify)service_info_clean);
+	g_slist_free((GSList*)p);
 }
 
 static void
@@ -614,6 +620,47 @@ _filter_good_services(GSList *src, GSList **out_garbage)
 	return good;
 }
 
+/* Apply to the list of services of <type> the changes since its generation.
+ * <all> receives all the services of the type, <changes> those added or
+ * changed (all of them when the whole list has been reloaded), and
+ * <partial> tells if only additions and changes happened. The services are
+ * still owned by the list. */
+static GError *
+_srvtype_list_refresh(gchar **cs, const char *type,
+		GSList **all, GSList **changes, gboolean *partial)
+{
+	struct srvtype_list_s *sl = g_hash_table_lookup(srv_lists, type);
+	if (!sl) {
+		sl = srvtype_list_create();
+		g_hash_table_insert(srv_lists, g_strdup(type), sl);
+	}
+
+	gchar *generation = NULL;
+	gboolean delta = FALSE;
+	GSList *changed = NULL, *removed = NULL;
+	GError *err = conscience_remote_get_service_changes(cs, type,
+			sl->generation ? sl->generation : "0", &generation, &delta,
+			&changed, &removed, oio_ext_get_deadline());
+	if (err)
+		return err;
+
+	GSList *bad = NULL;
+	changed = _filter_good_services(changed, &bad);
+	g_slist_free_full(bad, (GDestroyNotify)service_info_clean);
+
+	*partial = srvtype_list_apply(sl, generation, delta, changed, removed, all);
+	*changes = changed;
+
+	if (!delta || removed || changed) {
+		GRID_DEBUG("%s list of [%s]: %u changed, %u removed, %u known",
+				delta ? "Delta" : "Full", type, g_slist_length(changed),
+				g_slist_length(removed), g_hash_table_size(sl->services));
+	}
+
+	g_slist_free_full(removed, (GDestroyNotify)service_info_clean);
+	return NULL;
+}
+
 /* If you ever plan to factorize this code with the similar part in
  * sqlx/sqlx_service.c be careful that a lot of context is expected on both
  * sides, and that even the function used to fetch the services cannot be the
@@ -623,8 +670,10 @@ lb_cache_reload (void)
 {
 	struct namespace_info_s *nsi = NULL;
 	gchar **tabtypes = NULL;
-	GPtrArray *tabsrv = NULL, *taberr = NULL;
+	GPtrArray *tabsrv = NULL, *tabfeed = NULL, *taberr = NULL;
 	gboolean any_loading_error = FALSE;
+	/* Only additions and changes, no need to purge the LB worlds */
+	gboolean incremental = !lb_needs_purge;
 	down_hosts_t down = NULL;
 	guint nb_down = 0;
 
@@ -642,35 +691,44 @@ lb_cache_reload (void)
 
 	oio_ext_set_prefixed_random_reqid("task-reload-srv-");
 
-	/* preload all the services */
-	tabsrv = g_ptr_array_new_full(8, _free_list_of_services);
+	/* refresh the lists of services with their changes */
+	tabsrv = g_ptr_array_new_full(8, _free_list);
+	tabfeed = g_ptr_array_new_full(8, _free_list);
 	taberr = g_ptr_array_new_full(8, _free_error);
 	for (char **pt=tabtypes; *pt ;++pt) {
-		GSList *srv = NULL;
-		GError *e = conscience_remote_get_services(NULL, cs, *pt, FALSE, &srv,
-				oio_ext_get_deadline());
+		GSList *srv = NULL, *changes = NULL;
+		gboolean partial = FALSE;
+		GError *e = _srvtype_list_refresh(cs, *pt, &srv, &changes, &partial);
 		if (e) {
 			GRID_WARN("Failed to load the list of [%s] in NS=%s", *pt, ns_name);
 			any_loading_error = TRUE;
+		} else if (!partial) {
+			incremental = FALSE;
 		}
 
-		GSList *bad = NULL;
-		srv = _filter_good_services(srv, &bad);
-		g_slist_free_full(bad, (GDestroyNotify)service_info_clean);
-
 		g_ptr_array_add(tabsrv, srv);
+		g_ptr_array_add(tabfeed, changes);
 		g_ptr_array_add(taberr, e);
 		nb_down += gridd_client_update_down_hosts(&down, srv);
 	}
 	gridd_client_replace_global_down_hosts(&down, nb_down);
 
+	/* The LB worlds cannot forget a service, they must be fed with all the
+	 * services then purged of those not fed. */
+	if (!incremental) {
+		for (guint i=0; tabtypes[i] ;++i) {
+			g_slist_free(tabfeed->pdata[i]);
+			tabfeed->pdata[i] = g_slist_copy(tabsrv->pdata[i]);
+		}
+	}
+
 #define reload_lb(W,L) do { \
-	if (!any_loading_error) \
+	if (!any_loading_error && !incremental) \
 		oio_lb_world__increment_generation(W); \
 	oio_lb_world__reload_pools(W, L, nsi); \
-	_reload_lb_service_types(W, L, tabtypes, tabsrv, taberr); \
+	_reload_lb_service_types(W, L, tabtypes, tabsrv, tabfeed, taberr); \
 	oio_lb_world__reload_storage_policies(W, L, nsi); \
-	if (!any_loading_error) \
+	if (!any_loading_error && !incremental) \
 		oio_lb_world__purge_old_generations(W); \
 	else \
 		oio_lb_world__rehash_all_slots(W); \
@@ -679,11 +737,13 @@ lb_cache_reload (void)
 	/* refresh the load-balancing world */
 	reload_lb(lb_world, lb);
 	reload_lb(lb_world_rawx, lb_rawx);
+	lb_needs_purge = !incremental && any_loading_error;
 
 out:
 	if (tabtypes) g_free0 (tabtypes);
 	if (nsi) namespace_info_free(nsi);
 	if (tabsrv) g_ptr_array_free(tabsrv, TRUE);
+	if (tabfeed) g_ptr_array_free(tabfeed, TRUE);
 	if (taberr) g_ptr_array_free(taberr, TRUE);
 	gridd_client_clear_down_hosts(&down);
 	return !any_loading_error;
@@ -1043,6 +1103,10 @@ grid_main_specific_fini (void)
 		lru_tree_destroy (srv_known);
 		srv_known = NULL;
 	}
+	if (srv_lists) {
+		g_hash_table_destroy (srv_lists);
+		srv_lists = NULL;
+	}
 	if (srv_master) {
 		lru_tree_destroy (srv_master);
 		srv_master = NULL;
@@ -1382,6 +1446,8 @@ grid_main_configure (int argc, char **argv)
 
 	srv_down = lru_tree_create((GCompareFunc)g_strcmp0, g_free, NULL, LTO_NOATIME);
 	srv_known = lru_tree_create((GCompareFunc)g_strcmp0, g_free, NULL, LTO_NOATIME);
+	srv_lists = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)srvtype_list_free);
 	srv_master = lru_tree_create((GCompareFunc)g_strcmp0, g_free, g_free, LTO_NOATIME);
 
 	oio_resolver_cache_enabled = BOOL(flag_cache_enabled);
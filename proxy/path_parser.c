@@ -28,38 +28,38 @@ static struct trie_node_s * _node_init (const struct trie_node_s*,
 /* Clean the node and all its children (recursively) */
 static void _node_free (struct trie_node_s *);
 
-/* Allocates an empty array */
-static struct trie_node_s ** _nodev_empty (void);
+/* Binary search among the children with an explicit word */
+static struct trie_node_s * _node_find_word (const struct trie_node_s *,
+		const gchar *);
 
-/* clean the array */
-static void _nodev_free (struct trie_node_s **);
-
-/* Search the array for an element with the same word or the same variable */
-static struct trie_node_s * _nodev_lookup (struct trie_node_s **,
+/* Search the children for an element with the same word or variable,
+ * creates it if missing. */
+static struct trie_node_s * _node_ensure_child (struct trie_node_s *,
 		const gchar *, const gchar *);
 
-/* appends to the node array */
-struct trie_node_s ** _nodev_append (struct trie_node_s **, struct trie_node_s *);
-
 /* Fills the tree */
-static struct trie_node_s ** _trie_insert (const struct trie_node_s *,
-		struct trie_node_s **, gchar **, const char*, gpointer);
-
-/* Recursively run the tree */
-static GSList * _trie_explore (struct trie_node_s **, gchar **,
-		const struct path_matching_s *);
+static void _trie_insert (struct trie_node_s *, gchar **, const char*,
+		gpointer);
 
-static struct path_matching_s * _match_dup (const struct path_matching_s *m0);
+struct match_ctx_s
+{
+	struct path_matching_s *tab;
+	guint max;
+	guint count;
+	struct path_matching_s current;
+};
 
-static void _match_free (struct path_matching_s *);
+/* Recursively run the tree */
+static void _trie_explore (const struct trie_node_s *, gchar **,
+		struct match_ctx_s *);
 
 /* ------------------------------------------------------------------------- */
 
 struct path_parser_s *
 path_parser_init (void)
 {
-	struct path_parser_s *self = g_try_malloc0 (sizeof(*self));
-	self->roots = _nodev_empty ();
+	struct path_parser_s *self = g_malloc0 (sizeof(*self));
+	self->root = _node_init (NULL, NULL, NULL);
 	return self;
 }
 
@@ -68,22 +68,63 @@ path_parser_clean (struct path_parser_s *self)
 {
 	if (!self)
 		return;
-	_nodev_free (self->roots);
+	_node_free (self->root);
 	g_free (self);
 }
 
-struct path_matching_s **
-path_parser_match (struct path_parser_s *self, gchar **tokens)
+/* Decode the %XX sequences in place, the result is never longer. */
+static gboolean
+_unescape_inplace (gchar *s)
 {
-	struct path_matching_s nomatch = {NULL,NULL};
-	GSList *lmatch = _trie_explore (self->roots, tokens, &nomatch);
-
-	struct path_matching_s **p, **result;
-	p = result = g_try_malloc0 ((1 + g_slist_length(lmatch)) * sizeof (struct path_matching_s*));
-	for (GSList *l=lmatch; l ;l=l->next)
-		(*p++) = l->data;
-	g_slist_free (lmatch);
-	return result;
+	gchar *d = s;
+	for (; *s ;++s) {
+		if (*s != '%') {
+			*(d++) = *s;
+		} else {
+			const int hi = g_ascii_xdigit_value (s[1]);
+			const int lo = hi < 0 ? -1 : g_ascii_xdigit_value (s[2]);
+			if (lo < 0 || (hi == 0 && lo == 0))
+				return FALSE;
+			*(d++) = (gchar) ((hi << 4) | lo);
+			s += 2;
+		}
+	}
+	*d = '\0';
+	return TRUE;
+}
+
+guint
+path_parser_match (struct path_parser_s *self, gchar *key,
+		struct path_matching_s *tab, guint max)
+{
+	EXTRA_ASSERT (self != NULL);
+	EXTRA_ASSERT (key != NULL);
+	EXTRA_ASSERT (tab != NULL);
+
+	/* Tokenize in place */
+	gchar *tokens[PATH_PARSER_MAX_DEPTH + 1];
+	guint count = 0;
+	for (gchar *p = key; ;) {
+		/* Deeper than any route */
+		if (count >= PATH_PARSER_MAX_DEPTH)
+			return 0;
+		tokens[count++] = p;
+		gchar *sep = strchr (p, '/');
+		if (sep)
+			*sep = '\0';
+		if (!_unescape_inplace (tokens[count-1]))
+			return 0;
+		if (!sep)
+			break;
+		p = sep + 1;
+	}
+	tokens[count] = NULL;
+
+	struct match_ctx_s ctx = {0};
+	ctx.tab = tab;
+	ctx.max = max;
+	_trie_explore (self->root, tokens, &ctx);
+	return ctx.count;
 }
 
 void
@@ -92,35 +133,21 @@ path_parser_configure (struct path_parser_s *self, const char *descr, void *u)
 	EXTRA_ASSERT (self != NULL);
 	EXTRA_ASSERT (descr != NULL);
 	gchar **tokens = g_strsplit (descr, "/", -1);
-	self->roots = _trie_insert (NULL, self->roots, tokens, descr, u);
+	EXTRA_ASSERT (g_strv_length (tokens) <= PATH_PARSER_MAX_DEPTH);
+	_trie_insert (self->root, tokens, descr, u);
 	g_strfreev (tokens);
 }
 
-void
-path_matching_cleanv (struct path_matching_s **tab)
-{
-	if (!tab)
-		return;
-	for (struct path_matching_s **p = tab; *p ;++p)
-		_match_free (*p);
-	g_free (tab);
-}
-
 const gchar *
-path_matching_get_variable (struct path_matching_s *self, const char *name)
+path_matching_get_variable (const struct path_matching_s *self,
+		const char *name)
 {
 	EXTRA_ASSERT (self != NULL);
 	EXTRA_ASSERT (name != NULL);
 
-	gsize l = strlen (name);
-	gchar *key = g_alloca (l+2);
-	memcpy(key, name, l);
-	key[l] = '=';
-	key[l+1] = 0;
-
-	for (gchar **p = self->vars; *p ;++p) {
-		if (g_str_has_prefix (*p, key))
-			return (*p) + (l+1);
+	for (guint i = 0; i < self->vars_count; i++) {
+		if (!strcmp (self->vars[i].name, name))
+			return self->vars[i].value;
 	}
 
 	return NULL;
@@ -128,31 +155,13 @@ path_matching_get_variable (struct path_matching_s *self, const char *name)
 
 /* ------------------------------------------------------------------------- */
 
-struct path_matching_s *
-_match_dup (const struct path_matching_s *m0)
-{
-	struct path_matching_s *m = g_slice_new (struct path_matching_s);
-	m->last = m0->last;
-	m->vars = m0->vars ? g_strdupv (m0->vars) : g_try_malloc0 (sizeof(gchar*));
-	return m;
-}
-
-void
-_match_free (struct path_matching_s *m)
-{
-	if (m->vars) g_strfreev (m->vars);
-	g_slice_free (struct path_matching_s, m);
-}
-
 struct trie_node_s *
 _node_init (const struct trie_node_s *parent, const gchar *word, const gchar *var)
 {
-	struct trie_node_s *n = g_try_malloc (sizeof(struct trie_node_s));
+	struct trie_node_s *n = g_malloc0 (sizeof(struct trie_node_s));
 	n->parent = parent;
-	n->next = _nodev_empty ();
 	n->word = word ? g_strdup (word) : NULL;
 	n->var = var ? g_strdup (var) : NULL;
-	n->u = NULL;
 	return n;
 }
 
@@ -161,64 +170,79 @@ _node_free (struct trie_node_s *n)
 {
 	if (!n)
 		return;
-	if (n->word)
-		g_free (n->word);
-	if (n->var)
-		g_free (n->var);
-	_nodev_free (n->next);
+	for (guint i = 0; i < n->words_count; i++)
+		_node_free (n->words[i]);
+	for (guint i = 0; i < n->vars_count; i++)
+		_node_free (n->vars[i]);
+	g_free (n->words);
+	g_free (n->vars);
+	g_free (n->word);
+	g_free (n->var);
 	g_free (n);
 }
 
-struct trie_node_s **
-_nodev_empty (void)
+/* Returns the position of <word> in the sorted children, or where it should
+ * be inserted. */
+static guint
+_node_locate_word (const struct trie_node_s *n, const gchar *word,
+		gboolean *found)
 {
-	return g_try_malloc0 (4 * sizeof(struct trie_node_s*));
-}
-
-void
-_nodev_free (struct trie_node_s **tab)
-{
-	if (!tab)
-		return;
-	for (struct trie_node_s **p = tab; *p ;++p) {
-		_node_free (*p);
-		*p = NULL;
+	guint lo = 0, hi = n->words_count;
+	while (lo < hi) {
+		const guint mid = lo + (hi - lo) / 2;
+		const int cmp = strcmp (word, n->words[mid]->word);
+		if (!cmp) {
+			*found = TRUE;
+			return mid;
+		}
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
 	}
-	g_free (tab);
-}
-
-static gsize
-_nodev_length (struct trie_node_s **tab)
-{
-	gsize count = 0;
-	while (*(tab++))
-		count ++;
-	return count;
+	*found = FALSE;
+	return lo;
 }
 
-struct trie_node_s **
-_nodev_append (struct trie_node_s **tab, struct trie_node_s *n)
+struct trie_node_s *
+_node_find_word (const struct trie_node_s *n, const gchar *word)
 {
-	gsize l = _nodev_length (tab);
-	tab = g_try_realloc (tab, (l+2) * sizeof (struct trie_node_s*));
-	tab[l] = n;
-	tab[l+1] = NULL;
-	return tab;
+	gboolean found = FALSE;
+	const guint i = _node_locate_word (n, word, &found);
+	return found ? n->words[i] : NULL;
 }
 
 struct trie_node_s *
-_nodev_lookup (struct trie_node_s **tab, const gchar *word, const gchar *var)
+_node_ensure_child (struct trie_node_s *n, const gchar *word, const gchar *var)
 {
-	EXTRA_ASSERT (tab != NULL);
 	EXTRA_ASSERT ((word != NULL) ^ (var != NULL));
 
-	for (; *tab ;++tab) {
-		if (word && (*tab)->word && !strcmp (word, (*tab)->word))
-			return *tab;
-		if (var && (*tab)->var && !strcmp (var, (*tab)->var))
-			return *tab;
+	struct trie_node_s *child = NULL;
+	if (word) {
+		gboolean found = FALSE;
+		const guint i = _node_locate_word (n, word, &found);
+		if (found)
+			return n->words[i];
+		child = _node_init (n, word, NULL);
+		n->words = g_realloc (n->words,
+				(n->words_count + 1) * sizeof (struct trie_node_s*));
+		memmove (n->words + i + 1, n->words + i,
+				(n->words_count - i) * sizeof (struct trie_node_s*));
+		n->words[i] = child;
+		n->words_count ++;
+	} else {
+		for (guint i = 0; i < n->vars_count; i++) {
+			if (!strcmp (var, n->vars[i]->var))
+				return n->vars[i];
+		}
+		child = _node_init (n, NULL, var);
+		n->vars = g_realloc (n->vars,
+				(n->vars_count + 1) * sizeof (struct trie_node_s*));
+		n->vars[n->vars_count++] = child;
 	}
-	return NULL;
+
+	child->rank = n->words_count + n->vars_count - 1;
+	return child;
 }
 
 #define P PROXYD_PREFIX"/$NS/"
@@ -249,11 +273,11 @@ _stat_name (const char *prefix, const char *tail, gchar *d, gsize dlen)
 	return d;
 }
 
-struct trie_node_s **
-_trie_insert (const struct trie_node_s *parent, struct trie_node_s **tab,
-		gchar **words, const char *descr, gpointer u)
+void
+_trie_insert (struct trie_node_s *parent, gchar **words, const char *descr,
+		gpointer u)
 {
-	EXTRA_ASSERT (tab != NULL);
+	EXTRA_ASSERT (parent != NULL);
 	EXTRA_ASSERT (words != NULL);
 	EXTRA_ASSERT (*words != NULL);
 
@@ -263,16 +287,11 @@ _trie_insert (const struct trie_node_s *parent, struct trie_node_s **tab,
 	else
 		word = *words;
 
-	// The word didn't exist yet, create it
-	struct trie_node_s *n = _nodev_lookup (tab, word, var);
-	if (!n) {
-		n = _node_init (parent, word, var);
-		tab = _nodev_append (tab, n);
-	}
+	struct trie_node_s *n = _node_ensure_child (parent, word, var);
 
 	// Then recurse on the next words, or mark the node as final.
 	if (*(words+1))
-		n->next = _trie_insert (n, n->next, words+1, descr, u);
+		_trie_insert (n, words+1, descr, u);
 	else {
 		gchar tmp[512];
 		n->u = u;
@@ -281,65 +300,70 @@ _trie_insert (const struct trie_node_s *parent, struct trie_node_s **tab,
 		n->gq_time = g_quark_from_string (
 				_stat_name(OIO_STAT_PREFIX_TIME, descr, tmp, sizeof(tmp)));
 	}
-
-	return tab;
 }
 
-GSList *
-_trie_explore (struct trie_node_s **tab, gchar **needles,
-		const struct path_matching_s *current_match)
+static void
+_trie_step (const struct trie_node_s *n, gchar **needles,
+		struct match_ctx_s *ctx)
 {
-	GSList *matches = NULL;
-
-	void step (struct path_matching_s *m) {
-		if (!needles[1]) { // potential final match
-			if (!(*tab)->u) // we matched nothing
-				_match_free (m);
-			else // final match found
-				matches = g_slist_prepend (matches, m);
-		} else { // only a partial match, so we recurse
-			GSList *local_matches = _trie_explore ((*tab)->next, needles+1, m);
-			_match_free (m);
-			if (local_matches) {
-				/* the order matters! */
-				matches = g_slist_concat (matches, local_matches);
-			}
+	const guint saved = ctx->current.vars_count;
+	if (n->var) {
+		if (saved >= PATH_MATCHING_MAX_VARS)
+			return;
+		ctx->current.vars[saved].name = n->var;
+		ctx->current.vars[saved].value = *needles;
+		ctx->current.vars_count ++;
+	}
+
+	if (!needles[1]) { // potential final match
+		if (n->u) {
+			ctx->current.last = n;
+			ctx->tab[ctx->count++] = ctx->current;
 		}
+	} else { // only a partial match, so we recurse
+		_trie_explore (n, needles+1, ctx);
 	}
 
+	ctx->current.vars_count = saved;
+}
+
+void
+_trie_explore (const struct trie_node_s *node, gchar **needles,
+		struct match_ctx_s *ctx)
+{
 	EXTRA_ASSERT (needles && *needles);
 
-	for (; *tab ;++tab) {
-		if ((*tab)->word) { // Explicit word
-			if (0 != strcmp (*needles, (*tab)->word))
-				continue;
-			struct path_matching_s *m = _match_dup (current_match);
-			m->last = *tab;
-			step (m);
-		} else { // Wildcard
-			struct path_matching_s *m = _match_dup (current_match);
-			m->last = *tab;
-			m->vars = oio_strv_append (m->vars, g_strdup_printf("%s=%s", (*tab)->var, *needles));
-			step (m);
+	/* At most one explicit word matches, the variables match anything.
+	 * The order matters: the children are run in the order of the routes
+	 * declarations. */
+	const struct trie_node_s *word = _node_find_word (node, *needles);
+	guint iv = 0;
+	while (ctx->count < ctx->max) {
+		if (word && (iv >= node->vars_count
+					|| word->rank < node->vars[iv]->rank)) {
+			_trie_step (word, needles, ctx);
+			word = NULL;
+		} else if (iv < node->vars_count) {
+			_trie_step (node->vars[iv++], needles, ctx);
+		} else {
+			break;
 		}
 	}
-
-	return matches;
 }
 
 static void
-_run (void (*hook) (const struct trie_node_s *), struct trie_node_s **p)
+_run (void (*hook) (const struct trie_node_s *), const struct trie_node_s *n)
 {
-	for (; *p ;++p) {
-		if ((*p)->u) hook (*p);
-		if ((*p)->next) _run (hook, (*p)->next);
-	}
+	if (n->u) hook (n);
+	for (guint i = 0; i < n->words_count; i++)
+		_run (hook, n->words[i]);
+	for (guint i = 0; i < n->vars_count; i++)
+		_run (hook, n->vars[i]);
 }
 
 void
 path_parser_foreach (struct path_parser_s *self,
 		void (*hook) (const struct trie_node_s *))
 {
-	if (self->roots) _run (hook, self->roots);
+	if (self->root) _run (hook, self->root);
 }
-
@@ -21,16 +21,39 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 # include <glib.h>
 
+/* How many variables a route may capture */
+# define PATH_MATCHING_MAX_VARS 8
+
+/* How many matchings are kept for a request */
+# define PATH_MATCHING_MAX 8
+
+/* How many tokens a route may have */
+# define PATH_PARSER_MAX_DEPTH 32
+
+struct path_variable_s
+{
+	const gchar *name;
+	const gchar *value;
+};
+
 struct path_matching_s
 {
 	const struct trie_node_s *last;
-	gchar **vars;
+	guint vars_count;
+	struct path_variable_s vars[PATH_MATCHING_MAX_VARS];
 };
 
 struct trie_node_s
 {
 	const struct trie_node_s *parent;
-	struct trie_node_s **next;
+	/* children with an explicit word, sorted by word */
+	struct trie_node_s **words;
+	/* children with a variable, sorted by rank */
+	struct trie_node_s **vars;
+	guint words_count;
+	guint vars_count;
+	/* order of insertion among the siblings */
+	guint rank;
 	gchar *word;
 	gchar *var;
 	gpointer u;
@@ -40,7 +63,7 @@ struct trie_node_s
 
 struct path_parser_s
 {
-	struct trie_node_s **roots;
+	struct trie_node_s *root;
 };
 
 /* Creates a new parser */
@@ -55,18 +78,18 @@ void path_parser_clean (struct path_parser_s *self);
 void path_parser_configure (struct path_parser_s *self,
 		const char *descr, void *udata);
 
-/* Run the parsing logic. Returns a NULL pointer array of matching
- * structures. The return has to be freed with path_matching_cleanv(). */
-struct path_matching_s ** path_parser_match (struct path_parser_s *self,
-		gchar **tokens);
+/* Run the parsing logic on <key>, split in place on '/' and unescaped.
+ * Fills <tab> with at most <max> matchings, in the order the routes have
+ * been configured, and returns how many were found. Nothing is allocated:
+ * the matchings point to <key>, that must outlive them. */
+guint path_parser_match (struct path_parser_s *self, gchar *key,
+		struct path_matching_s *tab, guint max);
 
 void path_parser_foreach (struct path_parser_s *self,
 		void (*hook) (const struct trie_node_s *n));
 
 /* Returns the variable captured during the matching process. */
-const gchar * path_matching_get_variable (struct path_matching_s *self,
+const gchar * path_matching_get_variable (const struct path_matching_s *self,
 		const char *name);
 
-void path_matching_cleanv (struct path_matching_s **tab);
-
 #endif /*OIO_SDS__proxy__path_parser_h*/
@@ -0,0 +1,65 @@
+/*
+OpenIO SDS proxy
+Copyright (C) 2025 OVH SAS
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <metautils/lib/metautils.h>
+#include <proxy/srvtype_list.h>
+
+struct srvtype_list_s *
+srvtype_list_create(void)
+{
+	struct srvtype_list_s *sl = g_malloc0(sizeof(*sl));
+	sl->services = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)service_info_clean);
+	return sl;
+}
+
+void
+srvtype_list_free(struct srvtype_list_s *sl)
+{
+	if (!sl)
+		return;
+	g_free(sl->generation);
+	g_hash_table_destroy(sl->services);
+	g_free(sl);
+}
+
+gboolean
+srvtype_list_apply(struct srvtype_list_s *sl, gchar *generation,
+		gboolean delta, GSList *changed, GSList *removed, GSList **all)
+{
+	if (!delta)
+		g_hash_table_remove_all(sl->services);
+	for (GSList *l = removed; l; l = l->next) {
+		gchar *k = service_info_key(l->data);
+		g_hash_table_remove(sl->services, k);
+		g_free(k);
+	}
+	for (GSList *l = changed; l; l = l->next)
+		g_hash_table_insert(sl->services, service_info_key(l->data), l->data);
+
+	*all = NULL;
+	GHashTableIter iter;
+	gpointer v = NULL;
+	g_hash_table_iter_init(&iter, sl->services);
+	while (g_hash_table_iter_next(&iter, NULL, &v))
+		*all = g_slist_prepend(*all, v);
+
+	g_free(sl->generation);
+	sl->generation = generation;
+	return delta && !removed;
+}
@@ -0,0 +1,44 @@
+/*
+OpenIO SDS proxy
+Copyright (C) 2025 OVH SAS
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OIO_SDS__proxy__srvtype_list_h
+# define OIO_SDS__proxy__srvtype_list_h 1
+
+#include <glib.h>
+
+/* The services of a type, as known at the conscience, kept up to date
+ * with the changes polled since the generation of the list. */
+struct srvtype_list_s
+{
+	gchar *generation;
+	GHashTable *services;  /* service_info_key() -> (struct service_info_s*) */
+};
+
+struct srvtype_list_s * srvtype_list_create(void);
+
+void srvtype_list_free(struct srvtype_list_s *sl);
+
+/* Apply the changes polled since the generation of the list, and take
+ * <generation>. The list takes the services of <changed>, that is all
+ * of them when <delta> is FALSE, and <removed> is left to the caller.
+ * <all> receives all the services of the list, still owned by the list.
+ * Returns if only additions and changes happened. */
+gboolean srvtype_list_apply(struct srvtype_list_s *sl, gchar *generation,
+		gboolean delta, GSList *changed, GSList *removed, GSList **all);
+
+#endif /*OIO_SDS__proxy__srvtype_list_h*/
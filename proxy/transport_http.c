@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <metautils/lib/common_variables.h>
 #include <server/slab.h>
 #include <server/network_server.h>
+#include <server/server_variables.h>
 
 #include "transport_http.h"
 
@@ -53,9 +54,7 @@ static int http_notify_input(struct network_client_s *clt);
 
 enum http_parser_step_e
 {
-	STEP_FIRST_R0, STEP_FIRST_N0,
-	STEP_SEP_R0, STEP_SEP_N0,
-	STEP_HEADERS_R0, STEP_HEADERS_N0,
+	STEP_HEAD,
 	STEP_BODY_ASIS
 };
 
@@ -63,42 +62,37 @@ struct http_parser_s
 {
 	enum http_parser_step_e step;
 	GError *error;
-	GString *buf;
+
+	/* Not owned, the head of the request being parsed: the request line and
+	 * the headers, up to the empty line. Once complete, the head is split in
+	 * place and the providers receive slices of it. */
+	GString *head;
+	/* Offset in <head> of the line being received */
+	gsize line_start;
 
 	gint64 content_read;
 	gint64 content_length;
-	void (*command_provider)(const gchar *req, const gchar *sel, const gchar *ver);
-	void (*header_provider)(const gchar *name, const gchar *value);
+	void (*command_provider)(gchar *req, gchar *sel, gchar *ver);
+	void (*header_provider)(gchar *name, gchar *value);
 	void (*body_provider)(const guint8 *data, gsize data_len);
 };
 
 struct http_parsing_result_s
 {
 	enum { HPRC_SUCCESS = 0, HPRC_MORE, HPRC_ERROR } status;
+	/* The bytes after a complete request belong to the next one */
+	gsize consumed;
 };
 
-static void
-gstr_chomp(GString *gstr)
-{
-	if (!gstr)
-		return;
-	gchar *start, *end;
-	start = gstr->str;
-	end = start + gstr->len;
-	while (end > start && (*(end-1) == '\n' || *(end-1) == '\r'))
-		*(--end) = '\0';
-}
-
 static gboolean
-_manage_and_renew_command(struct http_parser_s *parser, GString *buf)
+_manage_command(struct http_parser_s *parser, gchar *line)
 {
 	gchar *cmd, *selector, *version;
 
-	if (!buf->len)
+	if (!*line)
 		return FALSE;
 
-	gstr_chomp(buf);
-	cmd = buf->str;
+	cmd = line;
 	selector = strchr(cmd, ' ');
 	if (!selector)
 		return FALSE;
@@ -110,25 +104,22 @@ _manage_and_renew_command(struct http_parser_s *parser, GString *buf)
 
 	if (parser->command_provider)
 		parser->command_provider(cmd, selector, version);
-
-	g_string_set_size(buf, 0);
 	return TRUE;
 }
 
 static gboolean
-_manage_and_renew_header(struct http_parser_s *parser, GString *buf)
+_manage_header(struct http_parser_s *parser, gchar *line)
 {
-	if (!buf->len)
-		return TRUE;
-
-	gstr_chomp(buf);
-	gchar *header = buf->str;
+	gchar *header = line;
 	gchar *sep = strchr(header, ':');
-	if (!sep)
+	if (!sep || sep == header)
 		return FALSE;
 	*(sep++) = '\0';
-	if (*(sep++) != ' ')
-		return FALSE;
+	while (*sep == ' ' || *sep == '\t')
+		++ sep;
+	gchar *end = sep + strlen(sep);
+	while (end > sep && (*(end-1) == ' ' || *(end-1) == '\t'))
+		*(--end) = '\0';
 
 	oio_str_lower (header);
 	if (*header == 'c' && !strcmp(header, "content-length"))
@@ -136,8 +127,29 @@ _manage_and_renew_header(struct http_parser_s *parser, GString *buf)
 
 	if (parser->header_provider)
 		parser->header_provider(header, sep);
+	return TRUE;
+}
 
-	g_string_set_size(buf, 0);
+/* Split the complete head in place, each line terminated by "\r\n". */
+static gboolean
+_manage_head(struct http_parser_s *parser)
+{
+	gchar *line = parser->head->str;
+	gchar *const end = line + parser->head->len;
+
+	for (gboolean first = TRUE; line < end; first = FALSE) {
+		gchar *eol = memchr(line, '\r', end - line);
+		EXTRA_ASSERT(eol != NULL);
+		*eol = '\0';
+		if (first) {
+			if (!_manage_command(parser, line))
+				return FALSE;
+		} else if (*line) {
+			if (!_manage_header(parser, line))
+				return FALSE;
+		}
+		line = eol + 2;
+	}
 	return TRUE;
 }
 
@@ -151,71 +163,45 @@ http_parse(struct http_parser_s *parser, const guint8 *data, gsize available)
 		if (msg)
 			parser->error = NEWERROR(0, "%s", msg);
 		rc.status = status;
+		rc.consumed = consumed;
 		return rc;
 	}
 
 	while (consumed < available) {
-		guint8 d = data[consumed];
 		gint64 max;
 		switch (parser->step) {
 
-			case STEP_FIRST_R0:
-				if (d == '\r')
-					parser->step = STEP_FIRST_N0;
-				else
-					g_string_append_c(parser->buf, d);
-				++ consumed;
-				continue;
-
-			case STEP_FIRST_N0:
-				if (d == '\n') {
-					if (!_manage_and_renew_command(parser, parser->buf))
-						return _build_rc(HPRC_ERROR, "CMD parsing error");
-					parser->step = STEP_SEP_R0;
-					++ consumed;
+			case STEP_HEAD: {
+				/* Append whole lines: memchr() is vectorized by the libc */
+				const guint8 *start = data + consumed;
+				const guint8 *nl = memchr(start, '\n', available - consumed);
+				const gsize len = nl ? (gsize)(nl - start) + 1 : available - consumed;
+				g_string_append_len(parser->head, (const gchar*) start, len);
+				consumed += len;
+				if (!nl)
 					continue;
-				}
-				return _build_rc(HPRC_ERROR, "CMD parsing error");
-
-			case STEP_SEP_R0:
-				if (d == '\r')
-					parser->step = STEP_SEP_N0;
-				else {
-					if (!_manage_and_renew_header(parser, parser->buf))
-						return _build_rc(HPRC_ERROR, "HDR parsing error");
-					g_string_append_c(parser->buf, d);
-					parser->step = STEP_HEADERS_R0;
-				}
-				++ consumed;
-				continue;
 
-			case STEP_SEP_N0:
-				if (d == '\n') {
-					++ consumed;
-					if (!_manage_and_renew_header(parser, parser->buf))
-						return _build_rc(HPRC_ERROR, "HDR parsing error");
-					parser->step = STEP_BODY_ASIS;
-					if (parser->content_read >= parser->content_length)
-						return _build_rc(HPRC_SUCCESS, NULL);
+				const gchar *line = parser->head->str + parser->line_start;
+				const gsize line_len = parser->head->len - parser->line_start;
+				if (line_len < 2 || line[line_len - 2] != '\r')
+					return _build_rc(HPRC_ERROR, parser->line_start
+							? "HDR parsing error" : "CMD parsing error");
+				/* A single CR is not allowed inside a line */
+				if (memchr(line, '\r', line_len - 2))
+					return _build_rc(HPRC_ERROR, "HDR parsing error");
+				if (line_len > 2 || !parser->line_start) {
+					parser->line_start = parser->head->len;
 					continue;
 				}
-				return _build_rc(HPRC_ERROR, "SEP parsing error");
-
-			case STEP_HEADERS_R0:
-				if (d == '\r')
-					parser->step = STEP_HEADERS_N0;
-				else
-					g_string_append_c(parser->buf, d);
-				++ consumed;
-				continue;
 
-			case STEP_HEADERS_N0:
-				if (d == '\n') {
-					parser->step = STEP_SEP_R0;
-					++ consumed;
-					continue;
-				}
-				return _build_rc(HPRC_ERROR, "HDR parsing error");
+				/* The empty line ends the head */
+				if (!_manage_head(parser))
+					return _build_rc(HPRC_ERROR, "HDR parsing error");
+				parser->step = STEP_BODY_ASIS;
+				if (parser->content_read >= parser->content_length)
+					return _build_rc(HPRC_SUCCESS, NULL);
+				continue;
+			}
 
 			case STEP_BODY_ASIS:
 				max = available - consumed;
@@ -236,10 +222,11 @@ http_parse(struct http_parser_s *parser, const guint8 *data, gsize available)
 }
 
 static void
-http_parser_reset(struct http_parser_s *parser)
+http_parser_reset(struct http_parser_s *parser, GString *head)
 {
-	parser->step = STEP_FIRST_R0;
-	g_string_set_size(parser->buf, 0);
+	parser->step = STEP_HEAD;
+	parser->head = head;
+	parser->line_start = 0;
 	parser->content_read = 0;
 	parser->content_length = -1;
 	if (parser->error)
@@ -247,11 +234,10 @@ http_parser_reset(struct http_parser_s *parser)
 }
 
 static struct http_parser_s*
-http_parser_create(void)
+http_parser_create(GString *head)
 {
 	struct http_parser_s *parser = g_malloc0(sizeof(struct http_parser_s));
-	parser->buf = g_string_sized_new(1024);
-	http_parser_reset(parser);
+	http_parser_reset(parser, head);
 	return parser;
 }
 
@@ -260,7 +246,8 @@ http_parser_destroy(struct http_parser_s *parser)
 {
 	if (!parser)
 		return;
-	g_string_free(parser->buf, TRUE);
+	if (parser->error)
+		g_clear_error(&parser->error);
 	g_free(parser);
 }
 
@@ -270,7 +257,9 @@ http_request_create(struct network_client_s *client)
 	struct http_request_s *req;
 	req = g_malloc0(sizeof(*req));
 	req->client = client;
-	req->tree_headers = g_tree_new_full(metautils_strcmp3, NULL, g_free, g_free);
+	req->head = g_string_sized_new(1024);
+	/* keys and values are slices of the head */
+	req->tree_headers = g_tree_new_full(metautils_strcmp3, NULL, NULL, NULL);
 	req->body = g_byte_array_sized_new(512);
 	return req;
 }
@@ -278,14 +267,10 @@ http_request_create(struct network_client_s *client)
 static void
 http_request_clean(struct http_request_s *req)
 {
-	if (req->cmd)
-		g_free(req->cmd);
-	if (req->req_uri)
-		g_free(req->req_uri);
-	if (req->version)
-		g_free(req->version);
 	if (req->tree_headers)
 		g_tree_destroy(req->tree_headers);
+	if (req->head)
+		g_string_free(req->head, TRUE);
 	if (req->body)
 		g_byte_array_free(req->body, TRUE);
 	g_free(req);
@@ -313,8 +298,8 @@ transport_http_factory0(http_handler_f hdl, struct network_client_s *client)
 
 	client_context = g_malloc0(sizeof(struct transport_client_context_s));
 	client_context->handler = hdl;
-	client_context->parser = http_parser_create();
 	client_context->request = http_request_create(client);
+	client_context->parser = http_parser_create(client_context->request->head);
 
 	transport = &(client->transport);
 	transport->client_context = client_context;
@@ -567,14 +552,16 @@ http_notify_input(struct network_client_s *clt)
 {
 	struct req_ctx_s r = {0};
 
-	void command_provider(const gchar *c, const gchar *s, const gchar *v) {
-		r.request->cmd = g_ascii_strup(c, -1);
-		r.request->req_uri = g_strdup(s);
-		r.request->version = g_ascii_strup(v, -1);
+	void command_provider(gchar *c, gchar *s, gchar *v) {
+		oio_str_upper(c);
+		oio_str_upper(v);
+		r.request->cmd = c;
+		r.request->req_uri = s;
+		r.request->version = v;
 	}
-	void header_provider(const gchar *k, const gchar *v) {
+	void header_provider(gchar *k, gchar *v) {
 		/* 'k' should be already lowercase */
-		g_tree_replace(r.request->tree_headers, g_strdup(k), g_strdup(v));
+		g_tree_replace(r.request->tree_headers, k, v);
 	}
 	void body_provider(const guint8 *data, gsize data_len) {
 		g_byte_array_append(r.request->body, data, (guint)data_len);
@@ -591,6 +578,15 @@ http_notify_input(struct network_client_s *clt)
 	parser->body_provider = body_provider;
 	parser->header_provider = header_provider;
 
+	/* The replies to pipelined requests are held, then sent together */
+	guint pipelined = 0;
+	gboolean held = FALSE;
+	void _release(void) {
+		if (held)
+			network_client_hold_output(clt, FALSE);
+		held = FALSE;
+	}
+
 	gboolean done = FALSE;
 	while (!done && data_slab_sequence_has_data(&clt->input)) {
 
@@ -620,6 +616,19 @@ http_notify_input(struct network_client_s *clt)
 
 		if (rc.status == HPRC_SUCCESS) {
 
+			if (rc.consumed < data_size) {
+				/* Input slabs are plain buffers, give the bytes back */
+				EXTRA_ASSERT(slab->type == STYPE_BUFFER);
+				slab->data.buffer.start -= (guint)(data_size - rc.consumed);
+			}
+
+			const gboolean more = data_slab_has_data(slab)
+				|| data_slab_sequence_has_data(&clt->input);
+			if (more && !held && server_http_pipeline_max > 1) {
+				network_client_hold_output(clt, TRUE);
+				held = TRUE;
+			}
+
 			// Important times are now known.
 			// First, the last chunk of data received;
 			// Second, the moment the real treatment start ... i.e. now!
@@ -628,34 +637,43 @@ http_notify_input(struct network_client_s *clt)
 
 			GError *err = http_manage_request(&r);
 
-			http_parser_reset(parser);
 			http_request_clean(r.request);
 			r.request = r.context->request = http_request_create(r.client);
+			http_parser_reset(parser, r.request->head);
 
 			if (err) {
 				GRID_INFO("Request management error: %d %s",
 						err->code, err->message);
 				g_clear_error(&err);
 				network_client_allow_input(clt, FALSE);
+				_release();
 				network_client_close_output(clt, 0);
 				done = TRUE;
 			}
 			else if (r.close_after_request) {
 				GRID_TRACE("No connection keep-alive, closing.");
 				network_client_allow_input(clt, FALSE);
+				_release();
 				network_client_close_output(clt, 0);
 				done = TRUE;
 			}
+			else if (++pipelined >= server_http_pipeline_max) {
+				/* Bound the amount of replies held in memory */
+				_release();
+				pipelined = 0;
+			}
 		}
 		else if (rc.status == HPRC_ERROR) {
 			GRID_DEBUG("Request parsing error");
 			network_client_allow_input(clt, FALSE);
+			_release();
 			network_client_close_output(clt, 0);
 			done = TRUE;
 		}
 
 		data_slab_sequence_unshift(&clt->input, slab);
 	}
+	_release();
 
 	parser->command_provider = NULL;
 	parser->body_provider = NULL;
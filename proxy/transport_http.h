@@ -29,12 +29,15 @@ struct http_request_s
 {
 	struct network_client_s *client;
 
-	/* unpacked request line */
+	/* raw request line and headers, split in place by the parser */
+	GString *head;
+
+	/* unpacked request line, slices of <head> */
 	gchar *cmd;
 	gchar *req_uri;
 	gchar *version;
 
-	/* all the headers mapped as <gchar*,gchar*> */
+	/* all the headers mapped as <gchar*,gchar*>, slices of <head> */
 	GTree *tree_headers;
 	GByteArray *body;
 };
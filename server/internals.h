@@ -99,6 +99,7 @@ enum
 	NETCLIENT_OUT_CLOSED        = 0x0002,
 	NETCLIENT_OUT_CLOSE_PENDING = 0x0004,
 	NETCLIENT_IN_PAUSED         = 0x0008,
+	NETCLIENT_OUT_HELD          = 0x0010,
 };
 
 #endif /*OIO_SDS__server__internals_h*/
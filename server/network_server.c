@@ -1427,7 +1427,8 @@ network_client_send_slab(struct network_client_s *client, struct data_slab_s *ds
 	}
 
 	/* Try to send the slab now, if allowed */
-	if (!_client_has_pending_output(client)) {
+	if (!(client->flags & NETCLIENT_OUT_HELD)
+			&& !_client_has_pending_output(client)) {
 		if (!data_slab_send(ds, client->fd)) {
 			if (errno != EAGAIN) {
 				data_slab_free(ds);
@@ -1444,6 +1445,26 @@ network_client_send_slab(struct network_client_s *client, struct data_slab_s *ds
 	return 0;
 }
 
+void
+network_client_hold_output(struct network_client_s *clt, gboolean v)
+{
+	EXTRA_ASSERT(clt != NULL);
+
+	if (v) {
+		clt->flags |= NETCLIENT_OUT_HELD;
+		return;
+	}
+
+	if (!(clt->flags & NETCLIENT_OUT_HELD))
+		return;
+	clt->flags &= ~NETCLIENT_OUT_HELD;
+	if (clt->fd >= 0 && _client_has_pending_output(clt)) {
+		/* What cannot be sent now will be when the socket is writable */
+		if (RC_ERROR == _client_manage_output(clt))
+			clt->events |= CLT_ERROR;
+	}
+}
+
 void
 network_client_close_output(struct network_client_s *clt, int now)
 {
@@ -170,6 +170,11 @@ void network_server_send_gauge(struct network_server_s *srv, gchar *metric_name,
 void network_server_send_timing(struct network_server_s *srv, gchar *metric_name,
 		gint64 micros);
 
+/** While the output is held, the slabs sent to the client are only queued.
+ * Releasing the output sends them at once, coalesced in as few syscalls as
+ * possible. */
+void network_client_hold_output(struct network_client_s *clt, gboolean v);
+
 void network_client_close_output(struct network_client_s *clt, int now);
 
 int network_client_send_slab(struct network_client_s *client,
@@ -21,6 +21,8 @@ License along with this library.
 #include <errno.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
 
 #include "slab.h"
 #include "internals.h"
@@ -38,6 +40,8 @@ data_slab_size(struct data_slab_s *ds)
 			return (ds->data.buffer.end - ds->data.buffer.start);
 		case STYPE_GBYTES:
 			return g_bytes_get_size (ds->data.gbytes);
+		case STYPE_FILE:
+			return ds->data.file.end - ds->data.file.start;
 		case STYPE_EOF:
 			return 0;
 	}
@@ -55,6 +59,8 @@ data_slab_has_data(struct data_slab_s *ds)
 				&& (ds->data.buffer.start < ds->data.buffer.end);
 		case STYPE_GBYTES:
 			return 0 < g_bytes_get_size (ds->data.gbytes);
+		case STYPE_FILE:
+			return ds->data.file.start < ds->data.file.end;
 		case STYPE_EOF:
 			return FALSE;
 	}
@@ -80,6 +86,11 @@ data_slab_free(struct data_slab_s *ds)
 		case STYPE_GBYTES:
 			g_bytes_unref (ds->data.gbytes);
 			break;
+		case STYPE_FILE:
+			if (ds->data.file.shared)
+				data_slab_file_unref(ds->data.file.shared);
+			ds->data.file.shared = NULL;
+			break;
 		case STYPE_EOF:
 			break;
 	}
@@ -166,6 +177,20 @@ data_slab_send(struct data_slab_s *ds, int fd)
 			} while (0);
 			return TRUE;
 
+		case STYPE_FILE:
+			/* sendfile() advances the offset by itself */
+			errno = 0;
+			w = sendfile(fd, ds->data.file.shared->fd, &ds->data.file.start,
+					ds->data.file.end - ds->data.file.start);
+			if (w < 0)
+				return FALSE;
+			if (w == 0) {
+				/* The file has been truncated under our feet */
+				errno = EPIPE;
+				return FALSE;
+			}
+			return TRUE;
+
 		case STYPE_EOF:
 			shutdown(fd, SHUT_RDWR);
 			return TRUE;
@@ -208,6 +233,7 @@ data_slab_consume(struct data_slab_s *ds, guint8 **p_data, gsize *p_size)
 			return TRUE;
 
 		case STYPE_GBYTES:
+		case STYPE_FILE:
 		case STYPE_EOF:
 			/* consuming from such sources is not managed yet, neither by the
 			   server that never fills them nor the be clients that do not
@@ -220,6 +246,42 @@ data_slab_consume(struct data_slab_s *ds, guint8 **p_data, gsize *p_size)
 	return FALSE;
 }
 
+/* How many slabs are gathered in a single writev() */
+#define SLAB_IOV_MAX 64
+
+static const guint8 *
+_slab_memory(struct data_slab_s *ds, gsize *len)
+{
+	switch (ds->type) {
+		case STYPE_BUFFER:
+		case STYPE_BUFFER_STATIC:
+			*len = data_slab_size(ds);
+			return ds->data.buffer.buff + ds->data.buffer.start;
+		case STYPE_GBYTES:
+			return g_bytes_get_data(ds->data.gbytes, len);
+		default:
+			*len = 0;
+			return NULL;
+	}
+}
+
+/* Consume at most <max> bytes of a memory slab, returns how many */
+static gsize
+_slab_skip(struct data_slab_s *ds, gsize max)
+{
+	gsize len = 0;
+	_slab_memory(ds, &len);
+	const gsize w = MIN(len, max);
+	if (ds->type == STYPE_GBYTES) {
+		GBytes *old = ds->data.gbytes;
+		ds->data.gbytes = g_bytes_new_from_bytes(old, w, len - w);
+		g_bytes_unref(old);
+	} else {
+		ds->data.buffer.start += (guint) w;
+	}
+	return w;
+}
+
 gboolean
 data_slab_sequence_send(struct data_slab_sequence_s *dss, int fd)
 {
@@ -228,7 +290,33 @@ data_slab_sequence_send(struct data_slab_sequence_s *dss, int fd)
 		return TRUE;
 	}
 
-	return data_slab_send(dss->first, fd);
+	/* Gather the consecutive memory slabs (e.g. the replies to pipelined
+	 * requests) in a single syscall. */
+	struct iovec iov[SLAB_IOV_MAX];
+	int iovcnt = 0;
+	for (struct data_slab_s *ds = dss->first;
+			ds && iovcnt < SLAB_IOV_MAX; ds = ds->next) {
+		gsize len = 0;
+		const guint8 *b = _slab_memory(ds, &len);
+		if (!b)
+			break;
+		if (!len)
+			continue;
+		iov[iovcnt].iov_base = (void*) b;
+		iov[iovcnt].iov_len = len;
+		iovcnt ++;
+	}
+
+	if (iovcnt < 2)
+		return data_slab_send(dss->first, fd);
+
+	errno = 0;
+	ssize_t w = writev(fd, iov, iovcnt);
+	if (w < 0)
+		return FALSE;
+	for (struct data_slab_s *ds = dss->first; w > 0 && ds; ds = ds->next)
+		w -= _slab_skip(ds, w);
+	return TRUE;
 }
 
 void
@@ -331,3 +419,46 @@ data_slab_make_gbytes(GBytes *gb)
 	return ds;
 }
 
+struct data_slab_file_s *
+data_slab_file_new(int fd, GDestroyNotify release, gpointer udata)
+{
+	struct data_slab_file_s *f = g_malloc0(sizeof(*f));
+	f->fd = fd;
+	f->refcount = 1;
+	f->release = release;
+	f->udata = udata;
+	return f;
+}
+
+struct data_slab_file_s *
+data_slab_file_ref(struct data_slab_file_s *f)
+{
+	EXTRA_ASSERT(f != NULL);
+	g_atomic_int_inc(&f->refcount);
+	return f;
+}
+
+void
+data_slab_file_unref(struct data_slab_file_s *f)
+{
+	EXTRA_ASSERT(f != NULL);
+	if (!g_atomic_int_dec_and_test(&f->refcount))
+		return;
+	if (f->fd >= 0)
+		close(f->fd);
+	if (f->release)
+		f->release(f->udata);
+	g_free(f);
+}
+
+struct data_slab_s *
+data_slab_make_file(struct data_slab_file_s *f, gint64 offset, gint64 length)
+{
+	struct data_slab_s *ds = _slab();
+	ds->type = STYPE_FILE;
+	ds->data.file.shared = data_slab_file_ref(f);
+	ds->data.file.start = offset;
+	ds->data.file.end = offset + length;
+	ds->next = NULL;
+	return ds;
+}
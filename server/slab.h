@@ -28,9 +28,20 @@ enum data_slab_type_e {
 	STYPE_BUFFER=1,
 	STYPE_BUFFER_STATIC,
 	STYPE_GBYTES,
+	STYPE_FILE,
 	STYPE_EOF
 };
 
+/* A file descriptor shared by several STYPE_FILE slabs. It is closed
+ * when the last reference is dropped, then <release> is called. */
+struct data_slab_file_s
+{
+	int fd;
+	gint refcount;
+	GDestroyNotify release;
+	gpointer udata;
+};
+
 struct data_slab_s
 {
 	enum data_slab_type_e type;
@@ -42,6 +53,11 @@ struct data_slab_s
 			guint alloc;
 			guint8 *buff;
 		} buffer;
+		struct {
+			struct data_slab_file_s *shared;
+			off_t start;
+			off_t end;
+		} file;
 	} data;
 	struct data_slab_s *next;
 };
@@ -97,6 +113,19 @@ struct data_slab_s * data_slab_make_eof(void);
 
 struct data_slab_s * data_slab_make_gbytes(GBytes *gb);
 
+/* The returned file owns <fd>, and holds one reference. */
+struct data_slab_file_s * data_slab_file_new(int fd,
+		GDestroyNotify release, gpointer udata);
+
+struct data_slab_file_s * data_slab_file_ref(struct data_slab_file_s *f);
+
+void data_slab_file_unref(struct data_slab_file_s *f);
+
+/* Sends [offset, offset+length[ of the file, without copying it in
+ * userland. The slab holds its own reference on the file. */
+struct data_slab_s * data_slab_make_file(struct data_slab_file_s *f,
+		gint64 offset, gint64 length);
+
 struct data_slab_s *
 data_slab_make_buffer2(guint8 *buff, gboolean tobefreed, gsize start,
 		gsize end, gsize alloc);
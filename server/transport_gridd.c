@@ -23,6 +23,7 @@ License along with this library.
 #include <stdlib.h>
 #include <string.h>
 #include <malloc.h>
+#include <unistd.h>
 
 #include <metautils/lib/metautils.h>
 #include <metautils/lib/common_variables.h>
@@ -585,6 +586,8 @@ _client_call_handler(struct req_ctx_s *req_ctx)
 	struct gridd_reply_ctx_s ctx = {};
 	GHashTable *headers = NULL;
 	GByteArray *body = NULL;
+	struct data_slab_file_s *body_file = NULL;
+	gint64 body_file_offset = 0, body_file_length = 0;
 
 	void _subject(const gchar *fmt, ...) {
 		va_list args;
@@ -612,8 +615,17 @@ _client_call_handler(struct req_ctx_s *req_ctx)
 	void _add_body(GByteArray *b) {
 		EXTRA_ASSERT(!req_ctx->final_sent);
 		EXTRA_ASSERT(body == NULL);
+		EXTRA_ASSERT(body_file == NULL);
 		body = b;
 	}
+	void _add_body_fd(struct data_slab_file_s *f, gint64 offset, gint64 length) {
+		EXTRA_ASSERT(!req_ctx->final_sent);
+		EXTRA_ASSERT(body == NULL);
+		EXTRA_ASSERT(body_file == NULL);
+		body_file = data_slab_file_ref(f);
+		body_file_offset = offset;
+		body_file_length = length;
+	}
 	void _send_reply(gint code, gchar *msg) {
 		EXTRA_ASSERT(!req_ctx->final_sent);
 		GRID_TRACE("fd=%d REPLY code=%d message=%s", req_ctx->client->fd, code, msg);
@@ -634,7 +646,20 @@ _client_call_handler(struct req_ctx_s *req_ctx)
 		}
 
 		/* encode and send */
-		gsize answer_size = _reply_message(req_ctx->client, answer);
+		gsize answer_size = 0;
+		if (body_file) {
+			GByteArray *hdr = message_marshall_gba_header(answer,
+					body_file_length, NULL);
+			metautils_message_destroy(answer);
+			answer_size = hdr->len + body_file_length;
+			network_client_send_slab(req_ctx->client, data_slab_make_gba(hdr));
+			network_client_send_slab(req_ctx->client, data_slab_make_file(
+						body_file, body_file_offset, body_file_length));
+			data_slab_file_unref(body_file);
+			body_file = NULL;
+		} else {
+			answer_size = _reply_message(req_ctx->client, answer);
+		}
 
 		if ((req_ctx->final_sent = is_code_final(code))) {
 			struct log_item_s item;
@@ -670,6 +695,7 @@ _client_call_handler(struct req_ctx_s *req_ctx)
 	/* reply data */
 	ctx.add_header = _add_header;
 	ctx.add_body = _add_body;
+	ctx.add_body_fd = _add_body_fd;
 	ctx.send_reply = _send_reply;
 	ctx.send_error = _send_error;
 	ctx.subject = _subject;
@@ -742,6 +768,8 @@ _client_call_handler(struct req_ctx_s *req_ctx)
 	}
 
 	EXTRA_ASSERT(body == NULL);
+	if (body_file)
+		data_slab_file_unref(body_file);
 	if (headers)
 		g_hash_table_destroy(headers);
 	oio_ext_enable_perfdata(FALSE);
@@ -1014,6 +1042,10 @@ network_server_stats_to_prometheus(GArray *stats, GByteArray *body)
 				g_string_append_static(key_suffix, "connections_active");
 				goto next;
 			}
+			if (strcmp(stat[1], "cnx.pooled") == 0) {
+				g_string_append_static(key_suffix, "connections_pooled");
+				goto next;
+			}
 			goto error;
 		}
 error:
@@ -31,6 +31,7 @@ extern const char *oio_server_namespace;
 struct network_client_s;
 struct network_server_s;
 struct network_transport_s;
+struct data_slab_file_s;
 
 /* Hidden structures internally defined */
 struct gridd_request_dispatcher_s;
@@ -47,6 +48,11 @@ struct gridd_reply_ctx_s
 
 	void (*add_body)   (GByteArray *body);
 
+	/* Like add_body(), but the body is a part of a file, sent without
+	 * being copied in userland. The reply takes its own reference on
+	 * the file. */
+	void (*add_body_fd) (struct data_slab_file_s *f, gint64 offset, gint64 length);
+
 	void (*send_reply) (gint code, gchar *message);
 
 	void (*send_error) (gint code, GError *err);
@@ -37,7 +37,7 @@ License along with this library.
 #define STATUS_FINAL(e) ((e) >= STEP_SLAVE)
 
 #ifdef HAVE_EXTRA_DEBUG
-#define TRACE_EXECUTION(M) _manager_record_activity((M), __FUNCTION__, __LINE__)
+#define TRACE_EXECUTION(S) _shard_record_activity((S), __FUNCTION__, __LINE__)
 #else
 #define TRACE_EXECUTION(...)
 #endif
@@ -90,6 +90,37 @@ struct deque_beacon_s
 	guint count;
 };
 
+/* --- Timer wheel -----------------------------------------------------------
+ * Hashed and hierarchical: each of the WHEEL_LEVELS levels has WHEEL_SLOTS
+ * slots, a slot of the level L covers WHEEL_SLOTS^L ticks. A timer is stored
+ * in the lowest level able to hold its deadline, and cascades to the lower
+ * levels when the wheel reaches its slot. Playing a tick only touches the
+ * timers that are due (or cascading). */
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 5
+#define WHEEL_TICK G_TIME_SPAN_MILLISECOND
+
+/* @private */
+struct election_timer_s
+{
+	struct election_timer_s *prev;
+	struct election_timer_s *next;
+	guint64 tick;
+	guint16 slot;  /* level * WHEEL_SLOTS + index, only valid when armed */
+	guint8 armed;
+};
+
+/* @private */
+struct election_wheel_s
+{
+	guint64 now;  /* last tick played */
+	guint count[WHEEL_LEVELS];
+	struct election_timer_s *slots[WHEEL_LEVELS * WHEEL_SLOTS];
+};
+
 /* @private */
 struct activity_trace_element_s
 {
@@ -119,25 +150,45 @@ struct election_manager_s
 	/* do not free or change the fields below */
 	const struct replication_config_s *config;
 
-	/* GTree<gchar*,GCond*> */
-	GTree *conditions;
-
 	GThreadPool *completions;
 
 	GThreadPool *tasks_getpeers;
 
-	/* GTree<gchar*,struct election_member_s*> */
-	GTree *members_by_key;
+	/* The members are partitioned among independent shards, each with its
+	 * own lock. The number of shards MUST remain constant during the process
+	 * lifetime. */
+	struct election_shard_s *shard_tab;
+	guint shard_nb;
+
+	gboolean exiting;
+};
+
+/* @private */
+struct election_shard_s
+{
+	struct election_manager_s *manager;
+
+	/* GHashTable<gchar*,GCond*> */
+	GHashTable *conditions;
+
+	/* GHashTable<gchar*,struct election_member_s*> */
+	GHashTable *members_by_key;
 
 	GMutex lock;
 
 	/* Trace of actions while the lock was held */
 	GArray *activity_trace;
 
-	gboolean exiting;
-
 	gboolean deferred_peering_notify;
 
+	/* Timers of the members of the shard */
+	struct election_wheel_s wheel;
+
+	/* Contention statistics, only updated with the lock held */
+	guint64 stat_locked;
+	guint64 stat_contended;
+	gint64 stat_wait;
+
 	struct deque_beacon_s members_by_state[STEP_MAX];
 };
 
@@ -156,7 +207,11 @@ struct election_member_s
 	struct election_member_s *prev;
 	struct election_member_s *next;
 
+	/* Next deadline of the member, in the wheel of its shard */
+	struct election_timer_s timer;
+
 	struct election_manager_s *manager;
+	struct election_shard_s *shard;
 	struct sqlx_sync_s *sync;
 
 	/* Weak pointer to the condition, do not free! */
@@ -175,6 +230,10 @@ struct election_member_s
 	/* last time the app wanted a status */
 	gint64 last_atime;
 
+	/* Until when the MASTER status may be trusted without any check of the
+	 * election. Zero when the member is not MASTER or lost its session. */
+	gint64 lease_until;
+
 	/* First node of the children sequence (sorted by ID) */
 	gchar *master_url;
 
@@ -377,6 +436,8 @@ static void transition(struct election_member_s *member,
 static gboolean wait_for_final_status(struct election_member_s *m,
 		const gint64 deadline, GError **err);
 
+static gint64 _member_next_timeout(const struct election_member_s *m);
+
 #define _thlocal_set_manager(M) do { \
 	g_private_replace (&th_local_key_manager, (M)); \
 } while (0)
@@ -396,36 +457,37 @@ _cond_clean (gpointer p)
 #define _ELECTION_MANAGER_LOCKED 0x02
 
 static inline void
-_manager_record_activity(struct election_manager_s *M, const char *fn, int ln)
+_shard_record_activity(struct election_shard_s *S, const char *fn, int ln)
 {
-	if (M->exiting) return;
+	if (S->manager->exiting) return;
 
 	struct activity_trace_element_s item = {};
 	item.when = oio_ext_monotonic_time();
 	item.func = fn;
 	item.line = ln;
-	g_array_append_vals(M->activity_trace, &item, 1);
+	g_array_append_vals(S->activity_trace, &item, 1);
 }
 
 #ifdef HAVE_EXTRA_DEBUG
 
-#define _manager_save_locked(M) do { \
-	g_array_set_size(M->activity_trace, 0); \
-	TRACE_EXECUTION(M); \
+#define _shard_save_locked(S) do { \
+	g_array_set_size(S->activity_trace, 0); \
+	TRACE_EXECUTION(S); \
 } while (0)
 
 static void
-_manage_dump_activity(struct election_manager_s *M)
+_shard_dump_activity(struct election_shard_s *S)
 {
-	if (M->exiting) return;
+	if (S->manager->exiting) return;
 
-	const GArray *ga = M->activity_trace;
+	const GArray *ga = S->activity_trace;
 	EXTRA_ASSERT(ga->len > 0);
 	gint64 _in = g_array_index(ga, struct activity_trace_element_s, 0).when;
 	const gint64 _out = g_array_index(ga, struct activity_trace_element_s, ga->len - 1).when;
 	if (_out - _in > oio_election_lock_alert_delay) {
 		GString *tmp = g_string_sized_new(512);
-		g_string_printf(tmp, "total=%" G_GINT64_FORMAT, _out - _in);
+		g_string_printf(tmp, "shard=%u total=%" G_GINT64_FORMAT,
+				(guint)(S - S->manager->shard_tab), _out - _in);
 		for (guint i=0; i< ga->len ;i++) {
 			const struct activity_trace_element_s * const item =
 				&g_array_index(ga, struct activity_trace_element_s, i);
@@ -438,26 +500,40 @@ _manage_dump_activity(struct election_manager_s *M)
 	}
 }
 #else
-#define _manager_save_locked(...)
-#define _manage_dump_activity(...)
+#define _shard_save_locked(...)
+#define _shard_dump_activity(...)
 #endif
 
-#define _manager_lock(M) do { \
-	g_mutex_lock(&(M)->lock); \
-	_manager_save_locked(M); \
+/* Try first without blocking, so that the contention is accounted without
+ * any clock reading in the common case. */
+#define _shard_lock(S) do { \
+	if (!g_mutex_trylock(&(S)->lock)) { \
+		const gint64 _pre_lock = oio_ext_monotonic_time(); \
+		g_mutex_lock(&(S)->lock); \
+		(S)->stat_wait += oio_ext_monotonic_time() - _pre_lock; \
+		++ (S)->stat_contended; \
+	} \
+	++ (S)->stat_locked; \
+	_shard_save_locked(S); \
 } while (0)
 
-#define _manager_unlock(M) do { \
-	TRACE_EXECUTION(M); \
-	_manage_dump_activity(M); \
-	const gboolean _peering_notify = (M)->deferred_peering_notify; \
-	(M)->deferred_peering_notify = FALSE; \
-	g_mutex_unlock(&M->lock); \
+#define _shard_unlock(S) do { \
+	TRACE_EXECUTION(S); \
+	_shard_dump_activity(S); \
+	const gboolean _peering_notify = (S)->deferred_peering_notify; \
+	(S)->deferred_peering_notify = FALSE; \
+	g_mutex_unlock(&(S)->lock); \
 	if (_peering_notify) { \
-		sqlx_peering__notify((M)->peering); \
+		sqlx_peering__notify((S)->manager->peering); \
 	} \
 } while (0)
 
+static inline struct election_shard_s *
+_manager_get_shard(struct election_manager_s *M, const char *k)
+{
+	return M->shard_tab + (g_str_hash(k) % M->shard_nb);
+}
+
 static void _completion_router(gpointer p, struct election_manager_s *M);
 static void _worker_getpeers(struct election_member_s *m, struct election_manager_s *M);
 
@@ -468,7 +544,7 @@ _DEQUE_remove (struct election_member_s *m)
 {
 	EXTRA_ASSERT(m != NULL);
 	EXTRA_ASSERT(m->step < STEP_MAX);
-	struct deque_beacon_s *beacon = m->manager->members_by_state + m->step;
+	struct deque_beacon_s *beacon = m->shard->members_by_state + m->step;
 	EXTRA_ASSERT(beacon->count > 0);
 
 	struct election_member_s *prev = m->prev, *next = m->next;
@@ -487,7 +563,7 @@ _DEQUE_add (struct election_member_s *m)
 	EXTRA_ASSERT(m->step < STEP_MAX);
 	EXTRA_ASSERT(m->prev == NULL);
 	EXTRA_ASSERT(m->next == NULL);
-	struct deque_beacon_s *beacon = m->manager->members_by_state + m->step;
+	struct deque_beacon_s *beacon = m->shard->members_by_state + m->step;
 
 	if (beacon->back) {
 		m->prev = beacon->back;
@@ -499,6 +575,152 @@ _DEQUE_add (struct election_member_s *m)
 	++ beacon->count;
 }
 
+/* -------------------------------------------------------------------------- */
+
+#define TIMER2MEMBER(t) ((struct election_member_s*) \
+		((guint8*)(t) - offsetof(struct election_member_s, timer)))
+
+static inline guint64
+_wheel_tick(const gint64 when)
+{
+	return (MAX(0, when) + WHEEL_TICK - 1) / WHEEL_TICK;
+}
+
+static void
+_wheel_init(struct election_wheel_s *w, const gint64 now)
+{
+	memset(w, 0, sizeof(*w));
+	w->now = MAX(0, now) / WHEEL_TICK;
+}
+
+/* <floor> is the earliest tick the timer may be stored at: the next tick
+ * for a new timer, the current one for a cascading timer. */
+static void
+_wheel_link(struct election_wheel_s *w, struct election_timer_s *t,
+		const guint64 floor)
+{
+	EXTRA_ASSERT(!t->armed);
+	guint64 tick = MAX(t->tick, floor);
+	const guint64 delta = tick - w->now;
+	guint level = 0;
+	while (level < WHEEL_LEVELS - 1
+			&& delta >= (1ULL << (WHEEL_BITS * (level + 1))))
+		level ++;
+	/* Beyond the horizon, the timer will cascade in the top level until
+	 * its deadline is reachable. */
+	if (delta >= (1ULL << (WHEEL_BITS * WHEEL_LEVELS)))
+		tick = w->now + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+
+	t->slot = level * WHEEL_SLOTS + ((tick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+	t->armed = 1;
+	t->prev = NULL;
+	t->next = w->slots[t->slot];
+	if (t->next)
+		t->next->prev = t;
+	w->slots[t->slot] = t;
+	w->count[level] ++;
+}
+
+static void
+_wheel_unlink(struct election_wheel_s *w, struct election_timer_s *t)
+{
+	if (!t->armed)
+		return;
+	if (t->prev)
+		t->prev->next = t->next;
+	else
+		w->slots[t->slot] = t->next;
+	if (t->next)
+		t->next->prev = t->prev;
+	t->prev = t->next = NULL;
+	w->count[t->slot / WHEEL_SLOTS] --;
+	t->armed = 0;
+}
+
+static void
+_wheel_schedule(struct election_wheel_s *w, struct election_timer_s *t,
+		const gint64 when)
+{
+	_wheel_unlink(w, t);
+	t->tick = _wheel_tick(when);
+	_wheel_link(w, t, w->now + 1);
+}
+
+/* Play the next tick of the wheel (or jump over a run of empty ticks),
+ * without going beyond <target>. Return the timers that expired, chained
+ * through their <next> field and unarmed. */
+static struct election_timer_s *
+_wheel_step(struct election_wheel_s *w, const guint64 target)
+{
+	if (w->now >= target)
+		return NULL;
+
+	guint empty = 0;
+	while (empty < WHEEL_LEVELS && !w->count[empty])
+		empty ++;
+	if (empty >= WHEEL_LEVELS) {
+		w->now = target;
+		return NULL;
+	}
+	if (empty > 0) {
+		/* Nothing to play before the next slot of the first level not empty */
+		const guint shift = WHEEL_BITS * empty;
+		const guint64 last = (((w->now >> shift) + 1) << shift) - 1;
+		w->now = MIN(last, target - 1);
+	}
+
+	w->now ++;
+
+	/* Cascade the upper levels whose slot has been reached, the highest
+	 * first so that the timers can fall down several levels at once. */
+	guint top = 0;
+	while (top + 1 < WHEEL_LEVELS
+			&& !(w->now & ((1ULL << (WHEEL_BITS * (top + 1))) - 1)))
+		top ++;
+	for (guint level = top; level > 0; level--) {
+		const guint slot = level * WHEEL_SLOTS +
+			((w->now >> (WHEEL_BITS * level)) & WHEEL_MASK);
+		struct election_timer_s *t = w->slots[slot];
+		w->slots[slot] = NULL;
+		while (t) {
+			struct election_timer_s *next = t->next;
+			w->count[level] --;
+			t->armed = 0;
+			_wheel_link(w, t, w->now);
+			t = next;
+		}
+	}
+
+	const guint slot = w->now & WHEEL_MASK;
+	struct election_timer_s *due = w->slots[slot];
+	w->slots[slot] = NULL;
+	for (struct election_timer_s *t = due; t; t = t->next) {
+		w->count[0] --;
+		t->armed = 0;
+	}
+	return due;
+}
+
+/* When the next slot is to be played, or 0 if the wheel is empty */
+static gint64
+_wheel_next(const struct election_wheel_s *w)
+{
+	guint64 best = G_MAXUINT64;
+	for (guint level = 0; level < WHEEL_LEVELS; level++) {
+		if (!w->count[level])
+			continue;
+		const guint shift = WHEEL_BITS * level;
+		const guint64 base = w->now >> shift;
+		for (guint64 i = 1; i <= WHEEL_SLOTS; i++) {
+			if (w->slots[level * WHEEL_SLOTS + ((base + i) & WHEEL_MASK)]) {
+				best = MIN(best, (base + i) << shift);
+				break;
+			}
+		}
+	}
+	return best == G_MAXUINT64 ? 0 : (gint64)(best * WHEEL_TICK);
+}
+
 /* --- Misc helpers --------------------------------------------------------- */
 
 static inline gboolean
@@ -593,13 +815,19 @@ election_manager_create(struct replication_config_s *config,
 	manager->mux_factor = sqliterepo_zk_mux_factor;
 	manager->nb_shards = 0;
 
-	g_mutex_init(&manager->lock);
-
-	manager->members_by_key =
-		g_tree_new_full(metautils_strcmp3, NULL, NULL, NULL);
-
-	manager->conditions =
-		g_tree_new_full(metautils_strcmp3, NULL, g_free, _cond_clean);
+	manager->shard_nb = MAX(1, sqliterepo_election_shards);
+	manager->shard_tab = g_malloc0(manager->shard_nb * sizeof(struct election_shard_s));
+	for (guint i = 0; i < manager->shard_nb; i++) {
+		struct election_shard_s *shard = manager->shard_tab + i;
+		shard->manager = manager;
+		g_mutex_init(&shard->lock);
+		shard->members_by_key = g_hash_table_new(g_str_hash, g_str_equal);
+		shard->conditions =
+			g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _cond_clean);
+		shard->activity_trace = g_array_sized_new(FALSE, FALSE,
+				sizeof(struct activity_trace_element_s), 32);
+		_wheel_init(&shard->wheel, oio_ext_monotonic_time());
+	}
 
 	manager->completions =
 		g_thread_pool_new((GFunc)_completion_router, manager, 8, FALSE, NULL);
@@ -607,9 +835,6 @@ election_manager_create(struct replication_config_s *config,
 	manager->tasks_getpeers =
 		g_thread_pool_new((GFunc)_worker_getpeers, manager, 8, FALSE, NULL);
 
-	manager->activity_trace =
-		g_array_sized_new(FALSE, FALSE, sizeof(struct activity_trace_element_s), 32);
-
 	*result = manager;
 	return NULL;
 }
@@ -645,6 +870,14 @@ election_manager_set_peering (struct election_manager_s *manager,
 	manager->peering = peering;
 }
 
+struct sqlx_peering_s *
+election_manager_get_peering (const struct election_manager_s *manager)
+{
+	EXTRA_ASSERT(manager != NULL);
+	EXTRA_ASSERT(manager->vtable == &VTABLE);
+	return manager->peering;
+}
+
 GError *
 election_has_peers (struct election_manager_s *m, const struct sqlx_name_s *n,
 		gboolean nocache, gboolean *result)
@@ -696,28 +929,42 @@ election_manager_get_mode (const struct election_manager_s *m)
 	return ((struct abstract_election_manager_s*)m)->vtable->get_mode(m);
 }
 
-static struct election_counts_s
-_NOLOCK_count (struct election_manager_s *manager)
+static void
+_NOLOCK_count (struct election_shard_s *shard, struct election_counts_s *count)
+{
+	guint pending = 0;
+	pending += shard->members_by_state[STEP_CREATING].count;
+	pending += shard->members_by_state[STEP_WATCHING].count;
+	pending += shard->members_by_state[STEP_LISTING].count;
+	pending += shard->members_by_state[STEP_ASKING].count;
+	pending += shard->members_by_state[STEP_CHECKING_MASTER].count;
+	pending += shard->members_by_state[STEP_CHECKING_SLAVES].count;
+	pending += shard->members_by_state[STEP_DELAYED_CHECKING_MASTER].count;
+	pending += shard->members_by_state[STEP_DELAYED_CHECKING_SLAVES].count;
+	pending += shard->members_by_state[STEP_REFRESH_CHECKING_MASTER].count;
+	pending += shard->members_by_state[STEP_REFRESH_CHECKING_SLAVES].count;
+	pending += shard->members_by_state[STEP_SYNCING].count;
+	pending += shard->members_by_state[STEP_LEAVING].count;
+	pending += shard->members_by_state[STEP_LEAVING_FAILING].count;
+	const guint none = shard->members_by_state[STEP_NONE].count;
+	const guint failed = shard->members_by_state[STEP_FAILED].count;
+	const guint slave = shard->members_by_state[STEP_SLAVE].count;
+	const guint master = shard->members_by_state[STEP_MASTER].count;
+	count->none += none;
+	count->pending += pending;
+	count->failed += failed;
+	count->slave += slave;
+	count->master += master;
+	count->total += none + pending + master + slave + failed;
+}
+
+static guint
+_NOLOCK_count_step (struct election_manager_s *manager,
+		enum election_step_e step)
 {
-	struct election_counts_s count = {0};
-	count.none = manager->members_by_state[STEP_NONE].count;
-	count.pending += manager->members_by_state[STEP_CREATING].count;
-	count.pending += manager->members_by_state[STEP_WATCHING].count;
-	count.pending += manager->members_by_state[STEP_LISTING].count;
-	count.pending += manager->members_by_state[STEP_ASKING].count;
-	count.pending += manager->members_by_state[STEP_CHECKING_MASTER].count;
-	count.pending += manager->members_by_state[STEP_CHECKING_SLAVES].count;
-	count.pending += manager->members_by_state[STEP_DELAYED_CHECKING_MASTER].count;
-	count.pending += manager->members_by_state[STEP_DELAYED_CHECKING_SLAVES].count;
-	count.pending += manager->members_by_state[STEP_REFRESH_CHECKING_MASTER].count;
-	count.pending += manager->members_by_state[STEP_REFRESH_CHECKING_SLAVES].count;
-	count.pending += manager->members_by_state[STEP_SYNCING].count;
-	count.pending += manager->members_by_state[STEP_LEAVING].count;
-	count.pending += manager->members_by_state[STEP_LEAVING_FAILING].count;
-	count.failed = manager->members_by_state[STEP_FAILED].count;
-	count.slave = manager->members_by_state[STEP_SLAVE].count;
-	count.master = manager->members_by_state[STEP_MASTER].count;
-	count.total = count.none + count.pending + count.master + count.slave + count.failed;
+	guint count = 0;
+	for (guint i = 0; i < manager->shard_nb; i++)
+		count += manager->shard_tab[i].members_by_state[step].count;
 	return count;
 }
 
@@ -727,14 +974,41 @@ election_manager_count(struct election_manager_s *manager)
 	MANAGER_CHECK(manager);
 	EXTRA_ASSERT (manager->vtable == &VTABLE);
 
-	_manager_lock(manager);
-	struct election_counts_s count = _NOLOCK_count (manager);
-	_manager_unlock(manager);
+	struct election_counts_s count = {0};
+	for (guint i = 0; i < manager->shard_nb; i++) {
+		struct election_shard_s *shard = manager->shard_tab + i;
+		_shard_lock(shard);
+		_NOLOCK_count (shard, &count);
+		_shard_unlock(shard);
+	}
 	return count;
 }
 
+guint
+election_manager_shard_stats(struct election_manager_s *manager,
+		struct election_shard_stats_s **result)
+{
+	MANAGER_CHECK(manager);
+	EXTRA_ASSERT (manager->vtable == &VTABLE);
+	EXTRA_ASSERT(result != NULL);
+
+	struct election_shard_stats_s *tab =
+		g_malloc0(manager->shard_nb * sizeof(struct election_shard_stats_s));
+	for (guint i = 0; i < manager->shard_nb; i++) {
+		struct election_shard_s *shard = manager->shard_tab + i;
+		_shard_lock(shard);
+		tab[i].members = g_hash_table_size(shard->members_by_key);
+		tab[i].locked = shard->stat_locked;
+		tab[i].contended = shard->stat_contended;
+		tab[i].wait = shard->stat_wait;
+		_shard_unlock(shard);
+	}
+	*result = tab;
+	return manager->shard_nb;
+}
+
 static struct election_member_s *
-_LOCKED_get_member (struct election_manager_s *ma, const char *k);
+_LOCKED_get_member (struct election_shard_s *shard, const char *k);
 
 #define member_reset_peers(m) do { \
 	if (m->peers) { \
@@ -749,13 +1023,11 @@ _LOCKED_get_member (struct election_manager_s *ma, const char *k);
 } while (0)
 
 static gboolean
-_LOCKED_get_cached_peers(struct election_manager_s *manager,
-		const struct sqlx_name_s *n, gchar ***result)
+_LOCKED_get_cached_peers(struct election_shard_s *shard,
+		const char *key, gchar ***result)
 {
 	gboolean success = FALSE;
-	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
-	sqliterepo_hash_name(n, key, sizeof(key));
-	struct election_member_s *member = _LOCKED_get_member(manager, key);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		if (member->peers && *(member->peers)) {
 			*result = g_strdupv(member->peers);
@@ -767,12 +1039,10 @@ _LOCKED_get_cached_peers(struct election_manager_s *manager,
 }
 
 static void
-_LOCKED_cache_peers(struct election_manager_s *manager,
-		const struct sqlx_name_s *n, gchar **peers)
+_LOCKED_cache_peers(struct election_shard_s *shard,
+		const char *key, gchar **peers)
 {
-	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
-	sqliterepo_hash_name(n, key, sizeof(key));
-	struct election_member_s *member = _LOCKED_get_member(manager, key);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		if (member->peers)
 			member_reset_peers(member);
@@ -783,22 +1053,22 @@ _LOCKED_cache_peers(struct election_manager_s *manager,
 }
 
 static gboolean
-_get_cached_peers(struct election_manager_s *manager,
-		const struct sqlx_name_s *n, gchar ***result)
+_get_cached_peers(struct election_shard_s *shard,
+		const char *key, gchar ***result)
 {
-	_manager_lock(manager);
-	gboolean rc = _LOCKED_get_cached_peers(manager, n, result);
-	_manager_unlock(manager);
+	_shard_lock(shard);
+	gboolean rc = _LOCKED_get_cached_peers(shard, key, result);
+	_shard_unlock(shard);
 	return rc;
 }
 
 static void
-_cache_peers(struct election_manager_s *manager,
-		const struct sqlx_name_s *n, gchar **peers)
+_cache_peers(struct election_shard_s *shard,
+		const char *key, gchar **peers)
 {
-	_manager_lock(manager);
-	_LOCKED_cache_peers(manager, n, peers);
-	_manager_unlock(manager);
+	_shard_lock(shard);
+	_LOCKED_cache_peers(shard, key, peers);
+	_shard_unlock(shard);
 }
 
 static GError *
@@ -817,11 +1087,14 @@ _election_get_peers(struct election_manager_s *manager,
 	gchar **peers = NULL;
 	gboolean nocache = flags & SQLX_REPO_NOCACHE;
 	gboolean peers_from_election = FALSE;
+	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
+	sqliterepo_hash_name(n, key, sizeof(key));
+	struct election_shard_s *shard = _manager_get_shard(manager, key);
 	if (!nocache) {
 		if (flags & _ELECTION_MANAGER_LOCKED)
-			peers_from_election = _LOCKED_get_cached_peers(manager, n, &peers);
+			peers_from_election = _LOCKED_get_cached_peers(shard, key, &peers);
 		else
-			peers_from_election = _get_cached_peers(manager, n, &peers);
+			peers_from_election = _get_cached_peers(shard, key, &peers);
 	}
 	if (!peers_from_election) {
 		/* Member does not exist yet
@@ -834,9 +1107,9 @@ _election_get_peers(struct election_manager_s *manager,
 		if (!peers_from_election) {
 			/* Peers did not come from election, we can cache them. */
 			if (flags & _ELECTION_MANAGER_LOCKED)
-				_LOCKED_cache_peers(manager, n, peers);
+				_LOCKED_cache_peers(shard, key, peers);
 			else
-				_cache_peers(manager, n, peers);
+				_cache_peers(shard, key, peers);
 		}
 		*result = peers;
 	} else {
@@ -853,17 +1126,14 @@ _manager_clean(struct election_manager_s *manager)
 	if (!manager)
 		return;
 
-	struct election_counts_s count = _NOLOCK_count(manager);
+	struct election_counts_s count = {0};
+	for (guint i = 0; i < manager->shard_nb; i++)
+		_NOLOCK_count(manager->shard_tab + i, &count);
 	GRID_DEBUG("%d elections still alive at manager shutdown: %d masters, "
 			"%d slaves, %d pending, %d failed, %d exited",
 			count.total, count.master, count.slave, count.pending,
 			count.failed, count.none);
 
-	if (manager->activity_trace) {
-		g_array_free(manager->activity_trace, TRUE);
-		manager->activity_trace = NULL;
-	}
-
 	if (manager->completions) {
 		g_thread_pool_free(manager->completions, FALSE, TRUE);
 		manager->completions = NULL;
@@ -874,30 +1144,34 @@ _manager_clean(struct election_manager_s *manager)
 		manager->tasks_getpeers = NULL;
 	}
 
-	if (manager->members_by_key) {
-		g_tree_destroy (manager->members_by_key);
-		manager->members_by_key = NULL;
-	}
+	for (guint s = 0; s < manager->shard_nb; s++) {
+		struct election_shard_s *shard = manager->shard_tab + s;
 
-	/* Ensure all the items are unlinked */
-	for (int i=STEP_NONE; i<STEP_MAX ;++i) {
-		struct deque_beacon_s *beacon = manager->members_by_state + i;
-		while (beacon->front != NULL) {
-			struct election_member_s *m = beacon->front;
-			_DEQUE_remove(m);
-			m->refcount = 0; /* ugly quirk that cope with an assert on refcount */
-			member_destroy (m);
+		g_hash_table_destroy(shard->members_by_key);
+		shard->members_by_key = NULL;
+
+		/* Ensure all the items are unlinked */
+		for (int i=STEP_NONE; i<STEP_MAX ;++i) {
+			struct deque_beacon_s *beacon = shard->members_by_state + i;
+			while (beacon->front != NULL) {
+				struct election_member_s *m = beacon->front;
+				_DEQUE_remove(m);
+				m->refcount = 0; /* ugly quirk that cope with an assert on refcount */
+				member_destroy (m);
+			}
+			g_assert (beacon->count == 0);
 		}
-		g_assert (beacon->count == 0);
-	}
 
-	if (manager->conditions) {
-		g_tree_destroy(manager->conditions);
-		manager->conditions = NULL;
-	}
+		g_hash_table_destroy(shard->conditions);
+		shard->conditions = NULL;
+
+		g_array_free(shard->activity_trace, TRUE);
+		shard->activity_trace = NULL;
 
-	g_mutex_clear(&manager->lock);
+		g_mutex_clear(&shard->lock);
+	}
 
+	g_free(manager->shard_tab);
 	g_free(manager->sync_tab);
 	g_free(manager);
 }
@@ -1013,15 +1287,15 @@ member_get_cond(struct election_member_s *m)
 static GMutex*
 member_get_lock(struct election_member_s *m)
 {
-	return &(MMANAGER(m)->lock);
+	return &(m->shard->lock);
 }
 
 #define member_lock(m) do { \
-	_manager_lock(m->manager); \
+	_shard_lock(m->shard); \
 } while (0)
 
 #define member_unlock(m) do { \
-	_manager_unlock(m->manager); \
+	_shard_unlock(m->shard); \
 } while (0)
 
 #define member_signal(m) do { \
@@ -1090,6 +1364,36 @@ member_reset(struct election_member_s *m)
 	 * typically to a restart, e.g. to perform a final resync */
 }
 
+/* (Re)arm the timer of the member on its next deadline, if any */
+static void
+_member_schedule(struct election_member_s *m)
+{
+	const gint64 deadline = _member_next_timeout(m);
+	if (deadline > 0)
+		_wheel_schedule(&m->shard->wheel, &m->timer, deadline);
+	else
+		_wheel_unlink(&m->shard->wheel, &m->timer);
+}
+
+/* A lease granted while the ZK session is established remains safe for
+ * a third of the session timeout: the client library reports the loss of
+ * the connection after two thirds of the timeout without any reply, while
+ * the server expires the session (and our ephemeral node) after the whole
+ * timeout. The timeout is the one negotiated for the live session, the
+ * server may have shortened the configured one. The margin covers the
+ * drift between the clocks. */
+static gint64
+_lease_duration(struct sqlx_sync_s *sync)
+{
+	if (sqliterepo_election_lease <= 0)
+		return 0;
+	const gint64 session = sync ? sqlx_sync_session_timeout(sync) : 0;
+	if (session <= 0)
+		return 0;
+	const gint64 lease = MIN(sqliterepo_election_lease, session / 3);
+	return MAX(0, lease - sqliterepo_election_lease_margin);
+}
+
 static void
 member_set_status(struct election_member_s *m, const enum election_step_e post)
 {
@@ -1098,9 +1402,17 @@ member_set_status(struct election_member_s *m, const enum election_step_e post)
 	if (pre != post)
 		m->last_status = oio_ext_monotonic_time();
 
+	if (post != STEP_MASTER) {
+		m->lease_until = 0;
+	} else if (pre != STEP_MASTER) {
+		const gint64 lease = _lease_duration(m->sync);
+		m->lease_until = lease > 0 ? oio_ext_monotonic_time() + lease : 0;
+	}
+
 	_DEQUE_remove (m);
 	m->step = post;
 	_DEQUE_add (m);
+	_member_schedule (m);
 
 	/* send a signal to wake all the threads waiting for the election. They
 	 * should receive a signal when they have an action to perform with it:
@@ -1164,6 +1476,7 @@ member_destroy(struct election_member_s *member)
 
 	EXTRA_ASSERT (member->refcount == 0);
 
+	_wheel_unlink(&member->shard->wheel, &member->timer);
 	member->cond = NULL;
 	oio_str_clean (&member->master_url);
 	member_reset_peers(member);
@@ -1172,36 +1485,37 @@ member_destroy(struct election_member_s *member)
 }
 
 static struct election_member_s *
-_LOCKED_get_member (struct election_manager_s *M, const char *k)
+_LOCKED_get_member (struct election_shard_s *S, const char *k)
 {
-	struct election_member_s *m = g_tree_lookup (M->members_by_key, k);
+	struct election_member_s *m = g_hash_table_lookup (S->members_by_key, k);
 	if (m)
 		member_ref (m);
-	TRACE_EXECUTION(M);
+	TRACE_EXECUTION(S);
 	return m;
 }
 
 static GCond *
-_manager_get_condition (struct election_manager_s *m, const char *k)
+_shard_get_condition (struct election_shard_s *S, const char *k)
 {
-	GCond *cond = g_tree_lookup (m->conditions, k);
+	GCond *cond = g_hash_table_lookup (S->conditions, k);
 	if (!cond) {
 		cond = g_malloc0 (sizeof(GCond));
 		g_cond_init (cond);
-		g_tree_replace (m->conditions, g_strdup(k), cond);
+		g_hash_table_replace (S->conditions, g_strdup(k), cond);
 	}
 	return cond;
 }
 
 static struct election_member_s *
-_LOCKED_init_member(struct election_manager_s *manager,
+_LOCKED_init_member(struct election_shard_s *shard,
 		const struct sqlx_name_s *n, const char *key,
 		gboolean autocreate, gchar ***peers)
 {
+	struct election_manager_s *manager = shard->manager;
 	MANAGER_CHECK(manager);
 	NAME_CHECK(n);
 
-	struct election_member_s *member = _LOCKED_get_member (manager, key);
+	struct election_member_s *member = _LOCKED_get_member (shard, key);
 	if (!member && autocreate) {
 
 		/* Shard the election on the ZK ensembles, taking into account the
@@ -1247,6 +1561,7 @@ _LOCKED_init_member(struct election_manager_s *manager,
 		member->sync = sync;
 		member->generation_id = oio_ext_rand_int();
 		member->manager = manager;
+		member->shard = shard;
 		member->last_status = oio_ext_monotonic_time ();
 		g_strlcpy(member->key, key, sizeof(member->key));
 		g_strlcpy(member->inline_name.base, n->base, sizeof(member->inline_name.base));
@@ -1254,17 +1569,18 @@ _LOCKED_init_member(struct election_manager_s *manager,
 		g_strlcpy(member->inline_name.suffix, n->suffix, sizeof(member->inline_name.suffix));
 		g_strlcpy(member->inline_name.ns, n->ns, sizeof(member->inline_name.ns));
 		member->refcount = 2;
-		member->cond = _manager_get_condition(manager, member->key);
+		member->cond = _shard_get_condition(shard, member->key);
 		if (peers && *peers) {
 			member->peers = *peers;
 			*peers = NULL;
 		}
 
 		_DEQUE_add (member);
-		g_tree_replace(manager->members_by_key, member->key, member);
+		_member_schedule (member);
+		g_hash_table_replace(shard->members_by_key, member->key, member);
 	}
 
-	TRACE_EXECUTION(manager);
+	TRACE_EXECUTION(shard);
 	return member;
 }
 
@@ -1275,7 +1591,7 @@ manager_count_active(struct election_manager_s *manager)
 	return count.pending + count.master + count.slave;
 }
 
-static gboolean
+static void
 _run_exit (gpointer k, gpointer v, gpointer i)
 {
 	(void) k;
@@ -1285,7 +1601,6 @@ _run_exit (gpointer k, gpointer v, gpointer i)
 	if (m->step != STEP_NONE
 			&& m->step != STEP_LEAVING)
 		transition(m, evt_type, NULL);
-	return FALSE;
 }
 
 gboolean
@@ -1295,7 +1610,7 @@ election_manager_is_operational(struct election_manager_s *manager)
 			manager->vtable != NULL &&
 			manager->peering != NULL &&
 			manager->config != NULL &&
-			manager->members_by_key != NULL);
+			manager->shard_tab != NULL);
 }
 
 void
@@ -1313,14 +1628,17 @@ election_manager_exit_all(struct election_manager_s *manager,
 	gint64 deadline = oio_ext_monotonic_time() + duration;
 
 	/* Order the nodes to exit */
-	_manager_lock(manager);
 	manager->exiting = TRUE;
-	g_tree_foreach(manager->members_by_key, _run_exit,
-			leave_cleanly?
-				GINT_TO_POINTER(EVT_LEAVE_REQ)
-				: GINT_TO_POINTER(EVT_DISCONNECTED)
-	);
-	_manager_unlock(manager);
+	for (guint i = 0; i < manager->shard_nb; i++) {
+		struct election_shard_s *shard = manager->shard_tab + i;
+		_shard_lock(shard);
+		g_hash_table_foreach(shard->members_by_key, _run_exit,
+				leave_cleanly?
+					GINT_TO_POINTER(EVT_LEAVE_REQ)
+					: GINT_TO_POINTER(EVT_DISCONNECTED)
+		);
+		_shard_unlock(shard);
+	}
 
 	guint count = manager_count_active(manager);
 	if (duration <= 0) {
@@ -1383,6 +1701,9 @@ member_json (struct election_member_s *m, GString *gs)
 	OIO_JSON_append_int(gs, "seconds_since_last_access", last_access);
 	g_string_append_c(gs, ',');
 	OIO_JSON_append_int(gs, "seconds_since_last_status", last_status);
+	g_string_append_c(gs, ',');
+	OIO_JSON_append_int(gs, "lease_remaining_ms",
+			MAX(0, m->lease_until - now) / G_TIME_SPAN_MILLISECOND);
 	g_string_append_c(gs, '}');
 
 	/* the peers */
@@ -1425,8 +1746,9 @@ election_manager_whatabout (struct election_manager_s *m,
 	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
 	sqliterepo_hash_name(n, key, sizeof(key));
 
-	_manager_lock(m);
-	struct election_member_s *member = _LOCKED_get_member(m, key);
+	struct election_shard_s *shard = _manager_get_shard(m, key);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		member_json (member, out);
 		member_unref (member);
@@ -1436,7 +1758,7 @@ election_manager_whatabout (struct election_manager_s *m,
 		else
 			g_string_append_static (out, "null");
 	}
-	_manager_unlock (m);
+	_shard_unlock (shard);
 }
 
 /* --- Zookeeper callbacks ----------------------------------------------------
@@ -1497,7 +1819,7 @@ deferred_completion_CREATING(struct exec_later_CREATING_context_s *d)
 	member_lock(d->member);
 	member_log_completion("CREATE", d->zrc, d->member);
 	_thlocal_set_manager (d->member->manager);
-	TRACE_EXECUTION(d->member->manager);
+	TRACE_EXECUTION(d->member->shard);
 
 #ifdef HAVE_ENBUG
 	if (oio_ext_rand_int_range(1,100) > oio_sync_failure_threshold_action) {
@@ -1623,14 +1945,14 @@ deferred_completion_ASKING(struct exec_later_ASKING_context_s *d)
 				int zrc2 = sqlx_sync_adelete(d->member->sync,
 						member_masterpath(d->member, path, sizeof(path)), -1,
 						completion_DeleteRogueNode, NULL);
-				TRACE_EXECUTION(d->member->manager);
+				TRACE_EXECUTION(d->member->shard);
 
 				if (zrc2 != ZOK) {
 					GRID_WARN("Failed to delete Rogue ZK node %s: %s", path, zerror(zrc2));
 				} else {
 					GRID_WARN("Rogue ZK node being deleted %s", path);
 				}
-				TRACE_EXECUTION(d->member->manager);
+				TRACE_EXECUTION(d->member->shard);
 
 				transition(d->member, EVT_MASTER_BAD, NULL);
 			} else if (!oio_strv_has(peers, d->master)) {
@@ -1832,8 +2154,9 @@ _find_member (struct election_manager_s *M, const char *path, guint gen)
 	memcpy(key, slash, len);
 	key[len] = 0;
 
-	_manager_lock(M);
-	struct election_member_s *member = _LOCKED_get_member(M, key);
+	struct election_shard_s *shard = _manager_get_shard(M, key);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		if (member->generation_id == gen)
 			return member;
@@ -1845,7 +2168,7 @@ _find_member (struct election_manager_s *M, const char *path, guint gen)
 		 * that have already left. */
 		GRID_DEBUG("watcher: [%s] no election found", key);
 	}
-	_manager_unlock(M);
+	_shard_unlock(shard);
 	return NULL;
 }
 
@@ -1857,21 +2180,24 @@ _reset_matching_members(struct election_manager_s *M, zhandle_t *zh,
 		enum election_step_e step)
 {
 	guint count = 0;
-	_manager_lock(M);
-	struct deque_beacon_s *beacon = M->members_by_state + step;
-	struct election_member_s *member = beacon->front;
-	while (member != NULL) {
-		if (step == member->step && sqlx_sync_uses_handle(member->sync, zh)) {
-			count++;
-			member_reset(member);
-			member_log_change(member, EVT_DISCONNECTED,
-					member_set_status(member, STEP_NONE));
-			member = beacon->front;
-		} else {
-			member = member->next;
+	for (guint i = 0; i < M->shard_nb; i++) {
+		struct election_shard_s *shard = M->shard_tab + i;
+		_shard_lock(shard);
+		struct deque_beacon_s *beacon = shard->members_by_state + step;
+		struct election_member_s *member = beacon->front;
+		while (member != NULL) {
+			if (step == member->step && sqlx_sync_uses_handle(member->sync, zh)) {
+				count++;
+				member_reset(member);
+				member_log_change(member, EVT_DISCONNECTED,
+						member_set_status(member, STEP_NONE));
+				member = beacon->front;
+			} else {
+				member = member->next;
+			}
 		}
+		_shard_unlock(shard);
 	}
-	_manager_unlock(M);
 	return count;
 }
 
@@ -1914,7 +2240,7 @@ deferred_watch_COMMON(struct deferred_watcher_context_s *d,
 			member_log_change(member, EVT_DISCONNECTED,
 					member_set_status(member, STEP_NONE));
 		// Not under lock but it's just a read operation
-		} else if (M->members_by_state[STEP_MASTER].count > 0) {
+		} else if (_NOLOCK_count_step(M, STEP_MASTER) > 0) {
 #if ZOO_35
 			GRID_WARN("Got ZK session event (-> %s) for an unknown election, "
 					"resetting all local elections using %s and "
@@ -2062,7 +2388,7 @@ _worker_getpeers(struct election_member_s *m, struct election_manager_s *M)
 		transition(m, EVT_GETPEERS_DONE, peers);
 	}
 	member_unref(m);
-	TRACE_EXECUTION(m->manager);
+	TRACE_EXECUTION(m->shard);
 	member_unlock(m);
 
 	if (peers)
@@ -2148,15 +2474,16 @@ _election_make(struct election_manager_s *m, const struct sqlx_name_s *n,
 	gboolean peers_present = FALSE;
 
 	sqliterepo_hash_name(n, key, sizeof(key));
+	struct election_shard_s *shard = _manager_get_shard(m, key);
 
-	_manager_lock(m);
-	member = _LOCKED_get_member(m, key);
+	_shard_lock(shard);
+	member = _LOCKED_get_member(shard, key);
 	if (member != NULL) {
 		peers_present = member->peers != NULL && member->peers[0] != NULL;
 		member_unref(member);
 		member = NULL;
 	}
-	_manager_unlock(m);
+	_shard_unlock(shard);
 
 	if (op != ELOP_EXIT && !peers_present) {
 		if (oio_str_is_set(new_peers)) {
@@ -2178,8 +2505,8 @@ _election_make(struct election_manager_s *m, const struct sqlx_name_s *n,
 	if (peers_present && replicated)
 		*replicated = TRUE;
 
-	_manager_lock(m);
-	member = _LOCKED_init_member(m, n, key, op != ELOP_EXIT, &peers);
+	_shard_lock(shard);
+	member = _LOCKED_init_member(shard, n, key, op != ELOP_EXIT, &peers);
 	switch (op) {
 		case ELOP_NONE:
 			_election_atime(member);
@@ -2212,7 +2539,7 @@ _election_make(struct election_manager_s *m, const struct sqlx_name_s *n,
 			*out_status = member->step;
 		member_unref(member);
 	}
-	_manager_unlock(m);
+	_shard_unlock(shard);
 
 	g_strfreev(peers);
 	return NULL;
@@ -2357,11 +2684,11 @@ wait_for_final_status(struct election_member_s *m, const gint64 deadline,
 				m->when_unstable / G_TIME_SPAN_SECOND, now / G_TIME_SPAN_SECOND);
 
 		/* perform the real WAIT on the real clock. */
-		TRACE_EXECUTION(m->manager);
-		_manage_dump_activity(m->manager);
+		TRACE_EXECUTION(m->shard);
+		_shard_dump_activity(m->shard);
 		g_cond_wait_until(member_get_cond(m), member_get_lock(m),
 				g_get_monotonic_time() + oio_election_period_cond_wait);
-		_manager_save_locked(m->manager);
+		_shard_save_locked(m->shard);
 	}
 
 	m->last_atime = oio_ext_monotonic_time ();
@@ -2386,8 +2713,9 @@ _election_get_status(struct election_manager_s *mgr,
 	const gint64 local_deadline = start + oio_election_delay_wait;
 	deadline = (deadline <= 0) ? local_deadline : MIN(deadline, local_deadline);
 
-	_manager_lock(mgr);
-	struct election_member_s *m = _LOCKED_init_member(mgr, n, key, TRUE, NULL);
+	struct election_shard_s *shard = _manager_get_shard(mgr, key);
+	_shard_lock(shard);
+	struct election_member_s *m = _LOCKED_init_member(shard, n, key, TRUE, NULL);
 
 	if (!wait_for_final_status(m, deadline, err)) {  /* TIMEOUT! */
 		rc = STEP_FAILED;
@@ -2402,7 +2730,7 @@ _election_get_status(struct election_manager_s *mgr,
 	member_unref(m);
 	if (rc == STEP_NONE || STATUS_FINAL(rc))
 		member_signal(m);
-	_manager_unlock(mgr);
+	_shard_unlock(shard);
 
 	GRID_TRACE("STEP=%s/%d master=%s", _step2str(rc), rc, url);
 	switch (rc) {
@@ -2459,10 +2787,10 @@ defer_USE(struct election_member_s *member, const gboolean master)
 		gchar *all_peers = _member_all_peers(member);
 		member->last_USE = oio_ext_monotonic_time();
 		for (gchar **p = member->peers; *p; p++) {
-			member->manager->deferred_peering_notify |= sqlx_peering__use(
+			member->shard->deferred_peering_notify |= sqlx_peering__use(
 					member->manager->peering, *p, &member->inline_name,
 					all_peers, master);
-			TRACE_EXECUTION(member->manager);
+			TRACE_EXECUTION(member->shard);
 		}
 		g_free(all_peers);
 	}
@@ -2694,7 +3022,7 @@ _common_action_to_LEAVE(struct election_member_s *member,
 #endif
 	zrc = sqlx_sync_adelete(
 			member->sync, path, -1, completion_LEAVING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK))
 		return member_fail_on_error(member, zrc);
@@ -2757,7 +3085,7 @@ member_action_to_CREATING(struct election_member_s *member)
 			myurl, strlen(myurl),
 			ZOO_EPHEMERAL|ZOO_SEQUENCE,
 			completion_CREATING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK)) {
 		member_warn_failed_action(member, zrc, "CREATE");
@@ -2789,7 +3117,7 @@ member_action_to_WATCHING(struct election_member_s *member)
 			member_fullpath(member, path, sizeof(path)),
 			watch_SELF, GUINT_TO_POINTER(member->generation_id),
 			completion_WATCHING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK)) {
 		member_warn_failed_action(member, zrc, "WATCH");
@@ -2814,7 +3142,7 @@ member_action_to_LISTING(struct election_member_s *member)
 	int zrc = sqlx_sync_awget_siblings(member->sync,
 			member_fullpath(member, path, sizeof(path)),
 			NULL, NULL, completion_LISTING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK)) {
 		member_warn_failed_action(member, zrc, "LIST");
@@ -2844,7 +3172,7 @@ member_action_to_ASKING(struct election_member_s *member)
 			member_masterpath(member, path, sizeof(path)),
 			watch_MASTER, GUINT_TO_POINTER(member->generation_id),
 			completion_ASKING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK)) {
 		member_warn_failed_action(member, zrc, "ASK");
@@ -2875,11 +3203,11 @@ member_action_to_SYNCING(struct election_member_s *member)
 	member->when_unstable = oio_ext_monotonic_time();
 
 	member_ref(member);
-	member->manager->deferred_peering_notify |= sqlx_peering__pipefrom(
+	member->shard->deferred_peering_notify |= sqlx_peering__pipefrom(
 			member->manager->peering, target, &member->inline_name, source,
 			member->db_check_type,
 			member, 0, _result_PIPEFROM);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	return member_set_status(member, STEP_SYNCING);
 }
@@ -2948,10 +3276,10 @@ member_action_to_CHECKING_MASTER(struct election_member_s *m)
 
 	gchar *all_peers = _member_all_peers(m);
 	member_ref(m);
-	m->manager->deferred_peering_notify |= sqlx_peering__getvers(
+	m->shard->deferred_peering_notify |= sqlx_peering__getvers(
 			m->manager->peering, m->master_url, &m->inline_name, all_peers,
 			m, 0, _result_GETVERS);
-	TRACE_EXECUTION(m->manager);
+	TRACE_EXECUTION(m->shard);
 	g_free(all_peers);
 
 	return member_set_status(m, STEP_CHECKING_MASTER);
@@ -2984,10 +3312,10 @@ member_action_to_CHECKING_SLAVES(struct election_member_s *m)
 	gchar *all_peers = _member_all_peers(m);
 	for (gchar **p=m->peers; *p; p++) {
 		member_ref(m);
-		m->manager->deferred_peering_notify |= sqlx_peering__getvers(
+		m->shard->deferred_peering_notify |= sqlx_peering__getvers(
 				m->manager->peering, *p, &m->inline_name, all_peers,
 				m, 0, _result_GETVERS);
-		TRACE_EXECUTION(m->manager);
+		TRACE_EXECUTION(m->shard);
 	}
 	g_free(all_peers);
 
@@ -3511,12 +3839,12 @@ _member_react_PEERING(struct election_member_s *member,
 		case EVT_GETPEERS_DONE:
 			member_reset_peers(member);
 			member->peers = g_strdupv(peers);
-			TRACE_EXECUTION(member->manager);
+			TRACE_EXECUTION(member->shard);
 			if (!member->peers)
 				member_action_to_FAILED(member);
 			else
 				member_action_to_CREATING(member);
-			TRACE_EXECUTION(member->manager);
+			TRACE_EXECUTION(member->shard);
 			return;
 
 			/* Abnormal events */
@@ -4287,6 +4615,8 @@ _member_next_timeout(const struct election_member_s *m)
 {
 	switch (m->step) {
 		case STEP_NONE:
+			if (oio_election_delay_expire_NONE <= 0)
+				return 0;
 			return m->last_status + oio_election_delay_expire_NONE;
 		case STEP_CREATING:
 			return m->last_status + oio_election_delay_expire_pending;
@@ -4377,7 +4707,7 @@ transition(struct election_member_s *member, enum event_type_e evt,
 {
 	member_log_change(member, evt,
 			_member_react(member, evt, evt_arg);
-			TRACE_EXECUTION(member->manager));
+			TRACE_EXECUTION(member->shard));
 
 	/* re-kickoff elections marked as to be restarted, but only if without
 	 * activity and if the manager if not being exited. */
@@ -4386,7 +4716,7 @@ transition(struct election_member_s *member, enum event_type_e evt,
 			&& !member->manager->exiting) {
 		member_log_change(member, EVT_NONE,
 			_member_react(member, EVT_NONE, NULL);
-			TRACE_EXECUTION(member->manager));
+			TRACE_EXECUTION(member->shard));
 	}
 }
 
@@ -4407,57 +4737,35 @@ _member_expirable(struct election_member_s *m, const gint64 now)
 		&& _is_over(now, m->last_status, oio_election_delay_expire_NONE);
 }
 
-void
-election_manager_play_expirations(struct election_manager_s *M, const gint64 now)
+static void
+_member_play_timer(struct election_member_s *m, const gint64 now)
 {
-	struct deque_beacon_s *beacon = M->members_by_state + STEP_NONE;
+	const gint64 deadline = _member_next_timeout(m);
+	if (!deadline)
+		return;
+	if (now < deadline) {
+		/* The deadline moved since the timer was armed, e.g. the base has
+		 * been accessed in the meantime. */
+		_wheel_schedule(&m->shard->wheel, &m->timer, deadline);
+		return;
+	}
 
-	while (beacon->front) {
-		_manager_lock(M);
-		struct election_member_s *m = beacon->front;
-		if (!m || !_member_expirable(m, now)) {
-			_manager_unlock(M);
-			break;
-		} else {
+	if (m->step == STEP_NONE) {
+		if (_member_expirable(m, now)) {
 			_DEQUE_remove (m);
-			g_tree_remove (M->members_by_key, m->key);
+			g_hash_table_remove (m->shard->members_by_key, m->key);
 			member_unref (m);
 			member_destroy (m);
-			_manager_unlock(M);
+			return;
 		}
+	} else {
+		transition (m, EVT_NONE, NULL);
 	}
-}
 
-static void
-_send_NONE_to_step(struct election_manager_s *M, struct deque_beacon_s *beacon,
-		const gint64 now)
-{
-	gboolean stop = FALSE;
-
-	while (beacon->front && !stop) {
-		_manager_lock(M);
-		struct election_member_s *m = beacon->front;
-		if (!m) {
-			/* The queue emptied before the lock */
-			stop = TRUE;
-		} else {
-			const gint64 deadline = _member_next_timeout(m);
-			if (!deadline) {
-				/* The FSM is not waiting for a timer
-				 * !!! This is abnormal, we should not call the current timer
-				 * function on such a queue. !!! */
-				stop = TRUE;
-			} else {
-				if (now < deadline) {
-					/* The timer didn't fire */
-					stop = TRUE;
-				} else {
-					transition (m, EVT_NONE, NULL);
-				}
-			}
-		}
-		_manager_unlock(M);
-	}
+	/* The FSM did not rearm the timer (still in use, or nothing to do yet) */
+	if (!m->timer.armed && _member_next_timeout(m) > 0)
+		_wheel_schedule(&m->shard->wheel, &m->timer,
+				now + G_TIME_SPAN_SECOND);
 }
 
 guint
@@ -4470,20 +4778,32 @@ election_manager_balance_masters(struct election_manager_s *M, guint max,
 	if (inactivity > 0)
 		pivot = OLDEST(oio_ext_monotonic_time(), inactivity);
 
+	/* Round-robin on the shards, so that the whole quota is not consumed
+	 * by the first shards. */
+	gboolean *done = g_malloc0(M->shard_nb * sizeof(gboolean));
 	for (gboolean running = TRUE; running && count < max;) {
-		_manager_lock(M);
-		struct election_member_s *current = M->members_by_state[STEP_MASTER].front;
-		if (!current || (pivot > 0 && current->last_atime < pivot)) {
-			running = FALSE;
-		} else {
-			/* Tell the first base to leave its MASTER position but to re-join
-			 * immediately after. */
-			current->requested_USE = rejoin;
-			transition(current, EVT_LEAVE_REQ, NULL);
-			++ count;
+		running = FALSE;
+		for (guint i = 0; i < M->shard_nb && count < max; i++) {
+			if (done[i])
+				continue;
+			struct election_shard_s *shard = M->shard_tab + i;
+			_shard_lock(shard);
+			struct election_member_s *current =
+				shard->members_by_state[STEP_MASTER].front;
+			if (!current || (pivot > 0 && current->last_atime < pivot)) {
+				done[i] = TRUE;
+			} else {
+				/* Tell the first base to leave its MASTER position but to
+				 * re-join immediately after. */
+				current->requested_USE = rejoin;
+				transition(current, EVT_LEAVE_REQ, NULL);
+				++ count;
+				running = TRUE;
+			}
+			_shard_unlock(shard);
 		}
-		_manager_unlock(M);
 	}
+	g_free(done);
 
 	return count;
 }
@@ -4500,30 +4820,19 @@ election_manager_configured(const struct election_manager_s *m)
 gint64
 election_manager_next_timer(struct election_manager_s *M)
 {
-	static const int steps[] = {
-		STEP_NONE,
-		STEP_FAILED,
-		STEP_DELAYED_CHECKING_MASTER,
-		STEP_DELAYED_CHECKING_SLAVES,
-		STEP_SLAVE,
-		STEP_MASTER,
-		-1
-	};
-
 	if (!election_manager_configured(M))
 		return 0;
 
 	gint64 latest = G_MAXINT64;
 
-	_manager_lock(M);
-	for (int i=0; steps[i] != -1 ;i++) {
-		const struct election_member_s *m = M->members_by_state[steps[i]].front;
-		if (!m)
-			continue;
-		const gint64 expiration = _member_next_timeout(m);
-		latest = MIN(latest, expiration);
+	for (guint s = 0; s < M->shard_nb; s++) {
+		struct election_shard_s *shard = M->shard_tab + s;
+		_shard_lock(shard);
+		const gint64 expiration = _wheel_next(&shard->wheel);
+		if (expiration > 0)
+			latest = MIN(latest, expiration);
+		_shard_unlock(shard);
 	}
-	_manager_unlock(M);
 
 	return latest == G_MAXINT64 ? 0 : latest;
 }
@@ -4531,19 +4840,24 @@ election_manager_next_timer(struct election_manager_s *M)
 void
 election_manager_play_timers(struct election_manager_s *M, const gint64 now)
 {
-	static const int steps[] = {
-		STEP_FAILED,
-		STEP_DELAYED_CHECKING_MASTER,
-		STEP_DELAYED_CHECKING_SLAVES,
-		STEP_CREATING,
-		STEP_SLAVE,
-		STEP_MASTER,
-		-1
-	};
-
 	oio_ext_set_prefixed_random_reqid("eltimer-");
-	for (int i=0; steps[i] != -1 ;i++)
-		_send_NONE_to_step(M, M->members_by_state + steps[i], now);
+	const guint64 target = now / WHEEL_TICK;
+	for (guint s = 0; s < M->shard_nb; s++) {
+		struct election_shard_s *shard = M->shard_tab + s;
+		/* One tick per critical section, to let the other threads in */
+		for (gboolean running = TRUE; running;) {
+			_shard_lock(shard);
+			struct election_timer_s *t = _wheel_step(&shard->wheel, target);
+			running = shard->wheel.now < target;
+			while (t) {
+				struct election_timer_s *next = t->next;
+				t->prev = t->next = NULL;
+				_member_play_timer(TIMER2MEMBER(t), now);
+				t = next;
+			}
+			_shard_unlock(shard);
+		}
+	}
 }
 
 GError*
@@ -4557,8 +4871,9 @@ election_check_replication_allowed(struct election_manager_s *manager,
 	GError *err = NULL;
 	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
 	sqliterepo_hash_name(n, key, sizeof(key));
-	_manager_lock(manager);
-	struct election_member_s *member = _LOCKED_get_member(manager, key);
+	struct election_shard_s *shard = _manager_get_shard(manager, key);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		if (member->step == STEP_MASTER
 				|| member->step == STEP_CHECKING_SLAVES) {
@@ -4574,10 +4889,56 @@ election_check_replication_allowed(struct election_manager_s *manager,
 		}
 		member_unref(member);
 	}
-	_manager_unlock(manager);
+	_shard_unlock(shard);
 	return err;
 }
 
+gboolean
+election_has_lease(struct election_manager_s *manager,
+		const struct sqlx_name_s *n, gint64 *until)
+{
+	MANAGER_CHECK(manager);
+	EXTRA_ASSERT(n != NULL);
+
+	if (sqliterepo_election_lease <= 0 || manager->exiting)
+		return FALSE;
+	/* Local copies have no election */
+	if (n->suffix && *(n->suffix))
+		return FALSE;
+
+	gboolean rc = FALSE;
+	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
+	sqliterepo_hash_name(n, key, sizeof(key));
+
+	struct election_shard_s *shard = _manager_get_shard(manager, key);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
+	if (member) {
+		if (member->step == STEP_MASTER && member->lease_until > 0) {
+			const gint64 now = oio_ext_monotonic_time();
+			const gint64 lease = _lease_duration(member->sync);
+			if (member->lease_until > now) {
+				rc = TRUE;
+			} else if (lease > 0 && sqlx_sync_connected(member->sync)) {
+				member->lease_until = now + lease;
+				rc = TRUE;
+			} else {
+				/* The session is lost, the election will be reset soon. */
+				member->lease_until = 0;
+			}
+		}
+		if (rc) {
+			_election_atime(member);
+			if (until)
+				*until = member->lease_until;
+		}
+		member_unref(member);
+	}
+	_shard_unlock(shard);
+
+	return rc;
+}
+
 enum election_status_e
 election_get_status_nowait(struct election_manager_s *manager,
 		const struct sqlx_name_s *n)
@@ -4589,8 +4950,9 @@ election_get_status_nowait(struct election_manager_s *manager,
 	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
 	sqliterepo_hash_name(n, key, sizeof(key));
 
-	_manager_lock(manager);
-	struct election_member_s *member = _LOCKED_get_member(manager, key);
+	struct election_shard_s *shard = _manager_get_shard(manager, key);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		switch (member->step) {
 		case STEP_FAILED:
@@ -4613,7 +4975,7 @@ election_get_status_nowait(struct election_manager_s *manager,
 		}
 		member_unref(member);
 	}
-	_manager_unlock(manager);
+	_shard_unlock(shard);
 
 	return status;
 }
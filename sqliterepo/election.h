@@ -33,6 +33,14 @@ struct election_counts_s
 	guint slave;
 };
 
+struct election_shard_stats_s
+{
+	guint members;
+	guint64 locked;     /* how many times the lock has been taken */
+	guint64 contended;  /* how many times it had to wait for the lock */
+	gint64 wait;        /* cumulated waiting time, in microseconds */
+};
+
 /* Hidden type */
 struct sqlx_repository_s;
 struct election_manager_s;
@@ -200,6 +208,11 @@ void election_manager_dump_delays(void);
 
 struct election_counts_s election_manager_count (struct election_manager_s *m);
 
+/* Fills <result> with a newly allocated array (to be freed with g_free())
+ * of the statistics of each shard of the manager, and return its size. */
+guint election_manager_shard_stats (struct election_manager_s *m,
+		struct election_shard_stats_s **result);
+
 /* Make some elections leave their MASTER state if they are inactive since
  * longer than `inactivity`, but not more than `max` elections.
  * If rejoin is FALSE, do not schedule to join the election again
@@ -211,10 +224,10 @@ guint election_manager_balance_masters(struct election_manager_s *M,
  * Return 0 if there is none. */
 gint64 election_manager_next_timer(struct election_manager_s *m);
 
+/* Fire the timers due at <now>, including the expiration of the idle
+ * elections. */
 void election_manager_play_timers(struct election_manager_s *m, const gint64 now);
 
-void election_manager_play_expirations(struct election_manager_s *m, const gint64 now);
-
 /* Similar to the MANAGER_CHECK macro, but not stripped in Release mode,
  * and returns a boolean instead of asserting. */
 gboolean election_manager_is_operational(struct election_manager_s *manager);
@@ -234,6 +247,9 @@ void election_manager_add_sync(struct election_manager_s *manager,
 void election_manager_set_peering (struct election_manager_s *m,
 		struct sqlx_peering_s *peering);
 
+struct sqlx_peering_s * election_manager_get_peering (
+		const struct election_manager_s *m);
+
 gboolean election_manager_configured(const struct election_manager_s *m);
 
 /** Check the current state of the election to tell if the database can
@@ -243,6 +259,13 @@ GError* election_check_replication_allowed(struct election_manager_s *manager,
 		const struct sqlx_name_s *n, const gchar *expected_master,
 		const gchar *operation);
 
+/** Tell if the local service holds a valid lease on the MASTER status of
+ * the election: the base may then be served without any check of the
+ * election, until the monotonic time set in <until>. The lease is renewed
+ * while the ZK session of the election is established. */
+gboolean election_has_lease(struct election_manager_s *manager,
+		const struct sqlx_name_s *n, gint64 *until);
+
 /** Get the status of an election without waiting for this status to be final.
  * If no election has started, or the election is still pending, return 0. */
 enum election_status_e election_get_status_nowait(
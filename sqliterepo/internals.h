@@ -105,4 +105,16 @@ struct sqlx_repository_s
 
 void load_statement(sqlite3_stmt *stmt, Row_t *r, Table_t *t);
 
+/* Wait for the quorum of each transaction replicated in pipelined mode,
+ * then free the list. Must be called once the base has been released. */
+GError* sqlx_replication_wait_tickets(GSList *tickets);
+
+/* Forget the recent transactions kept for the base */
+void sqlx_replication_clear_deltas(struct sqlx_sqlite3_s *sq3);
+
+/* Get the (encoded) transactions replicated since the given version,
+ * in order. Fails with CODE_NOT_FOUND when they are not known anymore. */
+GError* sqlx_replication_get_deltas(struct sqlx_sqlite3_s *sq3,
+		GTree *version, GPtrArray **result);
+
 #endif /*OIO_SDS__sqliterepo__internals_h*/
@@ -28,10 +28,40 @@ License along with this library.
 
 #include "sqliterepo.h"
 #include "election.h"
+#include "synchro.h"
 #include "version.h"
 #include "sqlx_remote.h"
+#include "sqlx_remote_ex.h"
 #include "internals.h"
 
+/* Tracks the replies of the slaves to a transaction replicated in pipelined
+ * mode. The committing worker waits on it once the base has been released,
+ * while the thread of the client pool collects the replies. */
+struct sqlx_repli_ticket_s
+{
+	GMutex lock;
+	GCond cond;
+
+	struct election_manager_s *manager;
+	struct sqlx_name_inline_s name;
+	gchar **peers;
+
+	// Slaves that replied they are out of sync, they will be asked to resync
+	// once the base has been released.
+	GPtrArray *resync_todo; // <gchar*>
+
+	GString *errors;
+
+	gint64 deadline;
+
+	guint refcount;
+	guint pending;
+	guint quorum;
+	guint count_success;
+	guint other_master;
+	guint slave_ahead;
+};
+
 struct sqlx_repctx_s
 {
 	// Explicit changes matched
@@ -49,6 +79,10 @@ struct sqlx_repctx_s
 
 	GString *errors;
 
+	// Set when the changes have been sent in pipelined mode, the quorum
+	// will be awaited when the base is released.
+	struct sqlx_repli_ticket_s *ticket;
+
 	// Count the explicit changes, those matched
 	int changes;
 	guint8 local_changes : 1;
@@ -63,6 +97,10 @@ struct sqlx_repctx_s
 	guint8 huge : 1;
 
 	guint8 any_change : 1;
+
+	// Set when the delta of the transaction has been kept, before the
+	// COMMIT: it must be forgotten if the COMMIT fails.
+	guint8 delta_recorded : 1;
 };
 
 static guint
@@ -272,10 +310,12 @@ context_pending_to_rowset(sqlite3 *db, struct sqlx_repctx_s *ctx)
 			GRID_TRACE2("%s(%s,%"G_GINT64_FORMAT",%d)", __FUNCTION__,
 					hashstr_str(name), rowid, deleted);
 
+			/* The row is reloaded whatever the last operation recorded:
+			 * a change rolled back to a savepoint leaves its ROWID here.
+			 * A row that does not exist anymore is sent as a deletion. */
 			struct Row *row = ASN1C_CALLOC(1, sizeof(*row));
 			metautils_asn_int64_to_INTEGER(&(row->rowid), rowid);
-			if (!deleted)
-				load_table_row(db, name, rowid, row, table);
+			load_table_row(db, name, rowid, row, table);
 
 			asn_sequence_add(&(table->rows.list), row);
 			return FALSE;
@@ -299,17 +339,94 @@ context_pending_to_rowset(sqlite3 *db, struct sqlx_repctx_s *ctx)
 	context_flush_pending(ctx);
 }
 
+/* Recent transactions ----------------------------------------------------- */
+
+/* A transaction already replicated, kept to resync a lagging slave
+ * without dumping the whole base. */
+struct sqlx_repli_delta_s
+{
+	GTree *version;  /* version of the base once the transaction applied */
+	GByteArray *rowsets;  /* the encoded TableSequence */
+};
+
+static void
+_delta_free(struct sqlx_repli_delta_s *delta)
+{
+	if (!delta)
+		return;
+	if (delta->version)
+		g_tree_destroy(delta->version);
+	if (delta->rowsets)
+		g_byte_array_unref(delta->rowsets);
+	g_free(delta);
+}
+
+static gboolean
+_version_equal(GTree *v0, GTree *v1)
+{
+	gboolean equal = g_tree_nnodes(v0) == g_tree_nnodes(v1);
+	gboolean runner(gpointer k, gpointer v, gpointer u) {
+		struct object_version_s *o = g_tree_lookup(u, k);
+		if (!o || o->version != ((struct object_version_s*)v)->version)
+			equal = FALSE;
+		return !equal;
+	}
+	if (equal)
+		g_tree_foreach(v0, runner, v1);
+	return equal;
+}
+
+static void
+_delta_record(struct sqlx_repctx_s *ctx)
+{
+	struct sqlx_sqlite3_s *sq3 = ctx->sq3;
+	GError *err = NULL;
+
+	if (!sqliterepo_repli_delta_max_count)
+		return sqlx_replication_clear_deltas(sq3);
+
+	GByteArray *rowsets = sqlx_encode_TableSequence(&ctx->sequence, &err);
+	if (!rowsets) {
+		GRID_DEBUG("Transaction not kept [%s][%s]: (%d) %s",
+				sq3->name.base, sq3->name.type, err->code, err->message);
+		g_clear_error(&err);
+		/* A hole in the sequence makes the older ones useless */
+		return sqlx_replication_clear_deltas(sq3);
+	}
+	if ((gint64)rowsets->len > sqliterepo_repli_delta_max_size) {
+		g_byte_array_unref(rowsets);
+		return sqlx_replication_clear_deltas(sq3);
+	}
+
+	struct sqlx_repli_delta_s *delta = g_malloc0(sizeof(*delta));
+	/* The versions have been incremented before the COMMIT */
+	delta->version = version_extract_from_admin(sq3);
+	delta->rowsets = rowsets;
+
+	if (!sq3->repli_deltas)
+		sq3->repli_deltas = g_queue_new();
+	g_queue_push_tail(sq3->repli_deltas, delta);
+	sq3->repli_deltas_size += rowsets->len;
+
+	while (g_queue_get_length(sq3->repli_deltas) > sqliterepo_repli_delta_max_count
+			|| sq3->repli_deltas_size > sqliterepo_repli_delta_max_size) {
+		struct sqlx_repli_delta_s *old = g_queue_pop_head(sq3->repli_deltas);
+		sq3->repli_deltas_size -= old->rowsets->len;
+		_delta_free(old);
+	}
+}
+
 /* HOOKS ------------------------------------------------------------------- */
 
 static void
-_leave_election(gchar **peers, struct sqlx_repctx_s *ctx, gboolean local,
+_leave_election(struct election_manager_s *manager,
+		const struct sqlx_name_s *n, gchar **peers, gboolean local,
 		gint64 deadline)
 {
-	NAME2CONST(n, ctx->sq3->name);
-	dump_request(__FUNCTION__, peers, "SQLX_EXITELECTION", &n);
+	dump_request(__FUNCTION__, peers, "SQLX_EXITELECTION", n);
 
 	// Leave the election locally
-	GError *err = election_exit(ctx->sq3->manager, &n);
+	GError *err = election_exit(manager, n);
 	if (err) {
 		GRID_WARN("Failed to leave election locally: %s", err->message);
 		g_clear_error(&err);
@@ -319,7 +436,7 @@ _leave_election(gchar **peers, struct sqlx_repctx_s *ctx, gboolean local,
 		return;
 	}
 
-	GByteArray *encoded = sqlx_pack_EXITELECTION(&n, deadline);
+	GByteArray *encoded = sqlx_pack_EXITELECTION(n, deadline);
 	struct gridd_client_s **clients =
 		gridd_client_create_many(peers, encoded, NULL, NULL);
 	g_byte_array_unref(encoded);
@@ -368,7 +485,7 @@ _replicate_on_peers(gchar **peers, struct sqlx_repctx_s *ctx, gint64 deadline)
 	// Local address or service ID
 	const gchar *local_addr = election_manager_get_local(ctx->sq3->manager);
 	GByteArray *encoded = sqlx_pack_REPLICATE(
-			&n, &(ctx->sequence), local_addr, deadline);
+			&n, &(ctx->sequence), local_addr, 0, deadline);
 	struct gridd_client_s **clients =
 		gridd_client_create_many(peers, encoded, NULL, NULL);
 	g_byte_array_unref(encoded);
@@ -489,7 +606,7 @@ _replicate_on_peers(gchar **peers, struct sqlx_repctx_s *ctx, gint64 deadline)
 			 * already left while the current request was in progress). */
 			GRID_WARN("Master changed? Leave the election locally [%s][%s] reqid=%s",
 					ctx->sq3->name.base, ctx->sq3->name.type, oio_ext_get_reqid());
-			_leave_election(peers, ctx, TRUE, 0);
+			_leave_election(ctx->sq3->manager, &n, peers, TRUE, 0);
 		} else {
 			/* Note 4: not sure who is right, make everyone leave. The new
 			 * election process will compare all versions and decide.
@@ -498,13 +615,181 @@ _replicate_on_peers(gchar **peers, struct sqlx_repctx_s *ctx, gint64 deadline)
 			GRID_WARN("Double master detected, try to leave the election "
 					"on all peers [%s][%s] reqid=%s", ctx->sq3->name.base,
 				ctx->sq3->name.type, oio_ext_get_reqid());
-			_leave_election(peers, ctx, FALSE, 0);
+			_leave_election(ctx->sq3->manager, &n, peers, FALSE, 0);
+		}
+	}
+
+	return err;
+}
+
+static guint
+_ticket_quorum(struct election_manager_s *manager, guint groupsize)
+{
+	if (election_manager_get_mode(manager) == ELECTION_MODE_GROUP)
+		return groupsize;
+	return group_to_quorum(groupsize);
+}
+
+static struct sqlx_repli_ticket_s *
+_ticket_create(struct sqlx_repctx_s *ctx, gchar **peers, gint64 deadline)
+{
+	struct sqlx_repli_ticket_s *t = g_malloc0(sizeof(*t));
+	g_mutex_init(&t->lock);
+	g_cond_init(&t->cond);
+	t->manager = ctx->sq3->manager;
+	memcpy(&(t->name), &(ctx->sq3->name), sizeof(t->name));
+	t->peers = g_strdupv(peers);
+	t->resync_todo = g_ptr_array_new_with_free_func(g_free);
+	t->errors = g_string_sized_new(128);
+	t->deadline = deadline;
+	t->pending = g_strv_length(peers);
+	t->quorum = _ticket_quorum(t->manager, 1 + t->pending);
+	// The local commit counts as a success
+	t->count_success = 1;
+	// One reference per peer, and one for the waiting worker
+	t->refcount = 1 + t->pending;
+	return t;
+}
+
+static void
+_ticket_unref(struct sqlx_repli_ticket_s *t)
+{
+	g_mutex_lock(&t->lock);
+	const guint refcount = -- t->refcount;
+	g_mutex_unlock(&t->lock);
+	if (refcount > 0)
+		return;
+
+	g_strfreev(t->peers);
+	g_ptr_array_free(t->resync_todo, TRUE);
+	g_string_free(t->errors, TRUE);
+	g_cond_clear(&t->cond);
+	g_mutex_clear(&t->lock);
+	g_free(t);
+}
+
+static void
+_ticket_on_reply(GError *e, const char *url, struct sqlx_repli_ticket_s *t)
+{
+	g_mutex_lock(&t->lock);
+	if (!e) {
+		++ t->count_success;
+	} else {
+		switch (e->code) {
+			case CODE_IS_MASTER:
+				t->other_master++;
+				break;
+			case CODE_PIPETO:
+			case CODE_CONCURRENT:
+				t->slave_ahead++;
+				/* FALLTHROUGH */
+			case CODE_PIPEFROM:
+			case SQLITE_CORRUPT:
+				g_ptr_array_add(t->resync_todo, g_strdup(url));
+				break;
+			default:
+				break;
 		}
+		g_string_append_printf(t->errors, " [%s/%d/%s]",
+				url, e->code, e->message);
 	}
+	EXTRA_ASSERT(t->pending > 0);
+	-- t->pending;
+	g_cond_signal(&t->cond);
+	g_mutex_unlock(&t->lock);
 
+	_ticket_unref(t);
+}
+
+static GError *
+_ticket_wait(struct sqlx_repli_ticket_s *t)
+{
+	GError *err = NULL;
+	gchar **resync = NULL;
+	guint other_master = 0, slave_ahead = 0;
+	NAME2CONST(n, t->name);
+
+	g_mutex_lock(&t->lock);
+	while (t->count_success < t->quorum && t->pending > 0) {
+		if (!g_cond_wait_until(&t->cond, &t->lock, t->deadline))
+			break;
+	}
+	if (t->count_success < t->quorum) {
+		err = NEWERROR(CODE_UNAVAILABLE,
+				"Not enough successes, no %s (%u/%u)%s",
+				election_manager_get_mode(t->manager) == ELECTION_MODE_GROUP
+					? "group" : "quorum",
+				t->count_success, 1 + g_strv_length(t->peers),
+				t->errors->str);
+	} else if (t->errors->len > 0) {
+		GRID_WARN("REPLI errors on [%s.%s]:%s reqid=%s",
+				n.base, n.type, t->errors->str, oio_ext_get_reqid());
+	}
+	other_master = t->other_master;
+	slave_ahead = t->slave_ahead;
+	if (t->resync_todo->len > 0) {
+		g_ptr_array_add(t->resync_todo, NULL);
+		resync = g_strdupv((gchar**) t->resync_todo->pdata);
+		g_ptr_array_remove_index_fast(t->resync_todo, t->resync_todo->len - 1);
+	}
+	g_mutex_unlock(&t->lock);
+
+	/* The changes are already committed locally, the slaves that missed
+	 * them must catch up. Replies arriving after the quorum are not
+	 * considered here: those slaves will fail the next DB_REPLI. */
+	if (other_master > 0) {
+		GRID_WARN("Master changed? Leave the election [%s][%s] reqid=%s",
+				n.base, n.type, oio_ext_get_reqid());
+		_leave_election(t->manager, &n, t->peers, slave_ahead > 0, 0);
+	} else if (resync) {
+		GError *err2 = sqlx_remote_execute_RESYNC_many(
+				resync, NULL, &n, t->deadline);
+		if (err2) {
+			GRID_WARN("Failed to resync peers of [%s][%s]: (%d) %s reqid=%s",
+					n.base, n.type, err2->code, err2->message,
+					oio_ext_get_reqid());
+			g_clear_error(&err2);
+		}
+	}
+
+	g_strfreev(resync);
 	return err;
 }
 
+static GError*
+_replicate_on_peers_pipelined(gchar **peers, struct sqlx_repctx_s *ctx,
+		gint64 deadline)
+{
+	NAME2CONST(n, ctx->sq3->name);
+	dump_request(__FUNCTION__, peers, "SQLX_REPLICATE", &n);
+
+	struct sqlx_peering_s *peering =
+		election_manager_get_peering(ctx->sq3->manager);
+	if (!peering)
+		return _replicate_on_peers(peers, ctx, deadline);
+
+	/* The admin table already carries the incremented versions: the slaves
+	 * use it to apply the changes in the same order as the master. */
+	const gchar *local_addr = election_manager_get_local(ctx->sq3->manager);
+	const gint64 seq = sqlx_admin_get_i64(ctx->sq3, "version:main.admin", 0);
+	GByteArray *encoded = sqlx_pack_REPLICATE(
+			&n, &(ctx->sequence), local_addr, seq, deadline);
+
+	struct sqlx_repli_ticket_s *ticket = _ticket_create(ctx, peers, deadline);
+	gboolean notify = FALSE;
+	for (gchar **p = peers; *p; ++p) {
+		notify |= sqlx_peering__replicate(peering, *p, encoded, ticket,
+				(sqlx_peering_replicate_end_f) _ticket_on_reply);
+	}
+	g_byte_array_unref(encoded);
+	if (notify)
+		sqlx_peering__notify(peering);
+
+	EXTRA_ASSERT(ctx->ticket == NULL);
+	ctx->ticket = ticket;
+	return NULL;
+}
+
 static void
 _defer_synchronous_RESYNC(struct sqlx_repctx_s *ctx)
 {
@@ -557,10 +842,18 @@ _perform_REPLICATE(struct sqlx_repctx_s *ctx)
 	if (status != ELECTION_LEADER) {
 		err = NEWERROR(
 				CODE_CONCURRENT, "Election status changed during transaction");
+	} else if (sqliterepo_repli_pipelined) {
+		err = _replicate_on_peers_pipelined(
+				peers, ctx, oio_ext_get_deadline());
 	} else {
 		err = _replicate_on_peers(peers, ctx, oio_ext_get_deadline());
 	}
 	g_strfreev(peers);
+	if (likely(err == NULL)) {
+		_delta_record(ctx);
+		ctx->delta_recorded = 1;
+	} else
+		sqlx_replication_clear_deltas(ctx->sq3);
 	context_flush_rowsets(ctx);
 
 	if (likely(err == NULL))
@@ -588,6 +881,7 @@ hook_commit(gpointer d)
 	gint64 start = oio_ext_monotonic_time();
 	int rc = 0;
 	if (ctx->huge) {
+		sqlx_replication_clear_deltas(ctx->sq3);
 		_defer_synchronous_RESYNC(ctx);
 	} else if (ctx->sequence.list.count <= 0) {
 		GRID_DEBUG("Empty transaction!");
@@ -604,7 +898,14 @@ hook_commit(gpointer d)
 static void
 hook_rollback(void *d)
 {
+	struct sqlx_repctx_s *ctx = d;
 	GRID_TRACE2("%s(%p)", __FUNCTION__, d);
+	/* The COMMIT failed after the delta has been kept, the sequence
+	 * has a hole */
+	if (ctx->delta_recorded) {
+		sqlx_replication_clear_deltas(ctx->sq3);
+		ctx->delta_recorded = 0;
+	}
 	context_flush_pending(d);
 	context_flush_rowsets(d);
 }
@@ -688,6 +989,8 @@ sqlx_replication_free_context(struct sqlx_repctx_s *ctx)
 		g_ptr_array_free(ctx->resync_todo, TRUE);
 	if (ctx->errors)
 		g_string_free (ctx->errors, TRUE);
+	if (ctx->ticket)
+		_ticket_unref(ctx->ticket);
 	g_slice_free(struct sqlx_repctx_s, ctx);
 }
 
@@ -774,6 +1077,13 @@ _sqlx_transaction_validate(struct sqlx_repctx_s *ctx)
 		// Restore the in-RAM cache
 		sqlx_admin_reload(ctx->sq3);
 	}
+	if (ctx->ticket) {
+		/* The slaves already received the changes, even if the local
+		 * COMMIT failed: their replies must be collected anyway. */
+		ctx->sq3->repli_tickets =
+			g_slist_prepend(ctx->sq3->repli_tickets, ctx->ticket);
+		ctx->ticket = NULL;
+	}
 	if (ctx->errors->len > 0) {
 		GRID_WARN("COMMIT errors on [%s.%s]:%s reqid=%s",
 				ctx->sq3->name.base, ctx->sq3->name.type,
@@ -846,6 +1156,80 @@ _sqlx_transaction_end(struct sqlx_repctx_s *ctx, GError *err, gboolean force_rol
 
 // Public API -----------------------------------------------------------------
 
+GError *
+sqlx_replication_wait_tickets(GSList *tickets)
+{
+	GError *err = NULL;
+	for (GSList *l = tickets; l; l = l->next) {
+		struct sqlx_repli_ticket_s *t = l->data;
+		GError *e = _ticket_wait(t);
+		if (e) {
+			if (!err) {
+				err = e;
+			} else {
+				GRID_WARN("Pipelined replication failed: (%d) %s reqid=%s",
+						e->code, e->message, oio_ext_get_reqid());
+				g_clear_error(&e);
+			}
+		}
+		_ticket_unref(t);
+	}
+	g_slist_free(tickets);
+	return err;
+}
+
+void
+sqlx_replication_clear_deltas(struct sqlx_sqlite3_s *sq3)
+{
+	if (!sq3->repli_deltas)
+		return;
+	g_queue_free_full(sq3->repli_deltas, (GDestroyNotify)_delta_free);
+	sq3->repli_deltas = NULL;
+	sq3->repli_deltas_size = 0;
+}
+
+GError *
+sqlx_replication_get_deltas(struct sqlx_sqlite3_s *sq3, GTree *version,
+		GPtrArray **result)
+{
+	EXTRA_ASSERT(sq3 != NULL);
+	EXTRA_ASSERT(version != NULL);
+	EXTRA_ASSERT(result != NULL);
+	*result = NULL;
+
+	GTree *current = version_extract_from_admin(sq3);
+	if (_version_equal(version, current)) {
+		g_tree_destroy(current);
+		*result = g_ptr_array_new();
+		return NULL;
+	}
+
+	/* The recent transactions are only useful if they lead to the
+	 * current state of the base: any change that did not go through
+	 * the replication (e.g. a VACUUM) breaks the chain. */
+	struct sqlx_repli_delta_s *last = sq3->repli_deltas
+		? g_queue_peek_tail(sq3->repli_deltas) : NULL;
+	gboolean usable = last && _version_equal(last->version, current);
+	g_tree_destroy(current);
+	if (!usable)
+		return NEWERROR(CODE_NOT_FOUND, "No recent transaction");
+
+	for (GList *l = sq3->repli_deltas->tail; l; l = l->prev) {
+		struct sqlx_repli_delta_s *delta = l->data;
+		if (!_version_equal(version, delta->version))
+			continue;
+		GPtrArray *out = g_ptr_array_new_with_free_func(
+				(GDestroyNotify)g_byte_array_unref);
+		for (l = l->next; l; l = l->next) {
+			delta = l->data;
+			g_ptr_array_add(out, g_byte_array_ref(delta->rowsets));
+		}
+		*result = out;
+		return NULL;
+	}
+	return NEWERROR(CODE_NOT_FOUND, "Version too old");
+}
+
 GError *
 sqlx_transaction_prepare(struct sqlx_sqlite3_s *sq3,
 		struct sqlx_repctx_s **result)
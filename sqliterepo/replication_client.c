@@ -186,3 +186,141 @@ peer_dump(const gchar *target, struct sqlx_name_s *name, gboolean chunked,
 
 	return err;
 }
+
+GError *
+peer_dump_diff(const gchar *target, struct sqlx_name_s *name,
+		gint check_type, gint64 extent_size, GByteArray *hashes,
+		peer_dump_diff_cb callback, gpointer cb_arg, gint64 *psize,
+		gint64 deadline)
+{
+	struct gridd_client_s *client;
+	GByteArray *encoded;
+	GError *err = NULL;
+	gint64 next_offset = 0;
+
+	*psize = -1;
+
+	gboolean on_reply(gpointer ctx, guint status UNUSED, MESSAGE reply) {
+		GError *err2 = NULL;
+		gsize bsize = 0;
+		gint64 offset = next_offset, size = -1;
+		(void) ctx;
+
+		err2 = metautils_message_extract_strint64(reply, "offset", FALSE,
+				&offset);
+		if (!err2)
+			err2 = metautils_message_extract_strint64(reply, "size", FALSE,
+					&size);
+		if (err2 != NULL) {
+			GRID_ERROR("Failed to extract the position: (%d) %s (reqid=%s)",
+					err2->code, err2->message, oio_ext_get_reqid());
+			g_clear_error(&err2);
+			return FALSE;
+		}
+		if (offset < 0)
+			offset = next_offset;
+		if (size >= 0)
+			*psize = size;
+
+		void *b = metautils_message_get_BODY(reply, &bsize);
+		if (b && bsize) {
+			GByteArray *part = g_byte_array_new();
+			g_byte_array_append(part, b, bsize);
+			err2 = callback(part, offset, cb_arg);
+			next_offset = offset + bsize;
+		}
+		if (err2 != NULL) {
+			GRID_ERROR("Failed to use result of dump: (%d) %s",
+					err2->code, err2->message);
+			g_clear_error(&err2);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	if (!target)
+		return SYSERR("No target URL");
+
+	encoded = sqlx_pack_DUMP_DIFF(name, check_type, extent_size, hashes,
+			oio_clamp_deadline(3600.0, deadline));
+	client = gridd_client_create(target, encoded, NULL, on_reply);
+	g_byte_array_unref(encoded);
+
+	if (!client)
+		return SYSERR("Failed to create client to [%s], bad address?", target);
+
+	/* set a long timeout to allow moving large meta2 bases */
+	gridd_client_set_timeout_cnx(client, oio_clamp_timeout(1.0, deadline));
+	gridd_client_set_timeout(client, oio_clamp_timeout(3600.0, deadline));
+
+	gridd_client_start(client);
+	if (!(err = gridd_client_loop(client))) {
+		err = gridd_client_error(client);
+	}
+
+	gridd_client_free(client);
+
+	/* Without any explicit size, the whole base has been sent */
+	if (!err && *psize < 0)
+		*psize = next_offset;
+	return err;
+}
+
+GError *
+peer_delta(const gchar *target, struct sqlx_name_s *name, GTree *version,
+		peer_dump_cb callback, gpointer cb_arg, gint64 deadline)
+{
+	struct gridd_client_s *client;
+	GByteArray *encoded;
+	GError *err = NULL;
+
+	gboolean on_reply(gpointer ctx, guint status UNUSED, MESSAGE reply) {
+		GError *err2 = NULL;
+		gsize bsize = 0;
+		gint64 remaining = -1;
+		(void) ctx;
+
+		/* Optional, only informative */
+		err2 = metautils_message_extract_strint64(reply, "remaining", FALSE,
+				&remaining);
+		if (err2 != NULL)
+			g_clear_error(&err2);
+
+		void *b = metautils_message_get_BODY(reply, &bsize);
+		if (b && bsize) {
+			GByteArray *delta = g_byte_array_new();
+			g_byte_array_append(delta, b, bsize);
+			err2 = callback(delta, remaining, cb_arg);
+		}
+		if (err2 != NULL) {
+			GRID_WARN("Failed to use result of delta: (%d) %s",
+					err2->code, err2->message);
+			g_clear_error(&err2);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	if (!target)
+		return SYSERR("No target URL");
+
+	encoded = sqlx_pack_DELTA(name, version, deadline);
+	client = gridd_client_create(target, encoded, NULL, on_reply);
+	g_byte_array_unref(encoded);
+
+	if (!client)
+		return SYSERR("Failed to create client to [%s], bad address?", target);
+
+	gridd_client_set_timeout_cnx(client,
+			oio_clamp_timeout(oio_election_replicate_timeout_cnx, deadline));
+	gridd_client_set_timeout(client,
+			oio_clamp_timeout(oio_election_replicate_timeout_req, deadline));
+
+	gridd_client_start(client);
+	if (!(err = gridd_client_loop(client))) {
+		err = gridd_client_error(client);
+	}
+
+	gridd_client_free(client);
+	return err;
+}
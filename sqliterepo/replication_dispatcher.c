@@ -20,6 +20,7 @@ License along with this library.
 
 #include <errno.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <glib.h>
 #include <sqlite3.h>
@@ -31,6 +32,7 @@ License along with this library.
 
 #include <server/transport_gridd.h>
 #include <server/network_server.h>
+#include <server/slab.h>
 #include <server/internals.h>
 #include <sqliterepo/sqliterepo_variables.h>
 
@@ -608,9 +610,121 @@ _dump_chunked(struct sqlx_repository_s *repo, struct sqlx_name_s *name,
 	return err;
 }
 
+static void
+_release_dump_slot(gpointer u UNUSED)
+{
+	sqlx_repository_dump_slot_release();
+}
+
+static GError *
+_dump_streamed(struct sqlx_repository_s *repo, struct sqlx_name_s *name,
+		gint check_type,
+		void (*_send_chunk)(struct data_slab_file_s *f,
+			gint64 offset, gint64 length, gint64 remaining))
+{
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	GError *err = sqlx_repository_open_and_lock(repo, name,
+			SQLX_OPEN_LOCAL|SQLX_OPEN_NOREFCHECK, &sq3, NULL);
+	if (NULL != err)
+		return err;
+
+	int fd = -1;
+	err = sqlx_repository_dump_base_snapshot(sq3, check_type, &fd);
+	sqlx_repository_unlock_and_close_noerror(sq3);
+	if (err)
+		return err;
+
+	/* All the parts share the (unlinked) copy, that keeps the dump slot
+	 * until the last part has been sent. */
+	struct data_slab_file_s *f =
+		data_slab_file_new(fd, _release_dump_slot, NULL);
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		err = NEWERROR(errno, "Failed to stat the database file (fd=%d)", fd);
+	} else {
+		for (gint64 offset = 0; offset < st.st_size; ) {
+			const gint64 len = MIN(sqliterepo_dump_chunk_size,
+					st.st_size - offset);
+			offset += len;
+			_send_chunk(f, offset - len, len, st.st_size - offset);
+		}
+	}
+	data_slab_file_unref(f);
+	return err;
+}
+
+/* Fill the restoration file with the local copy of the base, and ask the
+ * source for the extents that differ only. */
+static GError *
+_dump_diff(struct sqlx_repository_s *repo, struct sqlx_name_s *name,
+		gint check_type, gint64 extent_size, GByteArray *hashes,
+		dump_base_diff_cb _send_chunk, gint64 *psize)
+{
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	GError *err = sqlx_repository_open_and_lock(repo, name,
+			SQLX_OPEN_LOCAL|SQLX_OPEN_NOREFCHECK, &sq3, NULL);
+	if (NULL != err)
+		return err;
+
+	err = sqlx_repository_dump_base_diff(sq3, sqliterepo_dump_chunk_size,
+			check_type, extent_size, hashes, _send_chunk, NULL, psize);
+
+	sqlx_repository_unlock_and_close_noerror(sq3);
+	return err;
+}
+
+static GError *
+_pipe_base_diff_from(const gchar *source, struct sqlx_repository_s *repo,
+		struct sqlx_name_s *name, gint check_type, struct restore_ctx_s *ctx)
+{
+	GByteArray *hashes = NULL;
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	/* The peer refuses the extents larger than its chunks */
+	const gint64 extent_size =
+		MIN(sqliterepo_dump_extent_size, sqliterepo_dump_chunk_size);
+	GError *err = sqlx_repository_open_and_lock(repo, name,
+			SQLX_OPEN_LOCAL|SQLX_OPEN_NOREFCHECK, &sq3, NULL);
+	if (!err) {
+		err = sqlx_repository_dump_base_to_fd(sq3, ctx->fd,
+				extent_size, &hashes);
+		sqlx_repository_unlock_and_close_noerror(sq3);
+	}
+	if (err) {
+		/* No usable local copy, everything will be sent */
+		GRID_DEBUG("No local copy of %s to diff with: (%d) %s",
+				name->base, err->code, err->message);
+		g_clear_error(&err);
+		if ((err = restore_ctx_truncate(ctx, 0)))
+			return err;
+		hashes = g_byte_array_new();
+	}
+
+	guint64 received = 0;
+	GError *_pipe_diff_cb(GByteArray *part, gint64 offset, gpointer arg UNUSED)
+	{
+		GError *err2 = restore_ctx_write_at(ctx, offset, part->data, part->len);
+		received += part->len;
+		metautils_gba_unref(part);
+		return err2;
+	}
+
+	gint64 size = -1;
+	err = peer_dump_diff(source, name, check_type, extent_size,
+			hashes, _pipe_diff_cb, NULL, &size, oio_ext_get_deadline());
+	if (!err)
+		err = restore_ctx_truncate(ctx, size);
+	if (!err)
+		GRID_INFO("PIPEFROM db %s from %s: %"G_GUINT64_FORMAT"/%"
+				G_GINT64_FORMAT" bytes transferred reqid=%s", name->base,
+				source, received, size, oio_ext_get_reqid());
+	g_byte_array_free(hashes, TRUE);
+	return err;
+}
+
 static GError *
 _pipe_base_from(const gchar *source, struct sqlx_repository_s *repo,
-		struct sqlx_name_s *name, gint check_type, struct restore_ctx_s **ctx)
+		struct sqlx_name_s *name, gint check_type, gboolean incremental,
+		struct restore_ctx_s **ctx)
 {
 	GError *err;
 	gboolean try_slash_tmp = FALSE, autocreate = TRUE;
@@ -643,6 +757,9 @@ retry:
 		return err;
 	}
 
+	if (incremental && sqliterepo_dump_incremental)
+		return _pipe_base_diff_from(source, repo, name, check_type, *ctx);
+
 	GError *_pipe_from_cb(GByteArray *part, gint64 remaining, gpointer arg)
 	{
 		(void) arg;
@@ -658,6 +775,52 @@ retry:
 			oio_ext_get_deadline());
 }
 
+/* Catch up with the source by applying only the transactions missed
+ * since the local version of the base. */
+static GError *
+_delta_from(const gchar *source, struct sqlx_repository_s *repo,
+		struct sqlx_name_s *name)
+{
+	GTree *version = NULL;
+	GError *err = sqlx_repository_get_version2(repo, name, &version);
+	if (err)
+		return err;
+
+	GPtrArray *deltas = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)g_byte_array_unref);
+	GError *_on_delta(GByteArray *delta, gint64 remaining UNUSED,
+			gpointer arg UNUSED) {
+		g_ptr_array_add(deltas, delta);
+		return NULL;
+	}
+	err = peer_delta(source, name, version, _on_delta, NULL,
+			oio_ext_get_deadline());
+	g_tree_destroy(version);
+
+	if (!err && deltas->len > 0) {
+		struct sqlx_sqlite3_s *sq3 = NULL;
+		err = sqlx_repository_open_and_lock(repo, name,
+				SQLX_OPEN_LOCAL|SQLX_OPEN_NOREFCHECK, &sq3, NULL);
+		if (!err) {
+			// Check the election without triggering it
+			err = election_check_replication_allowed(
+					repo->election_manager, name, source, "DB_DELTA");
+			/* Each transaction is checked against the local version,
+			 * a concurrent change makes the whole operation fail. */
+			for (guint i = 0; !err && i < deltas->len; i++) {
+				GByteArray *delta = deltas->pdata[i];
+				err = replicate_body_parse(sq3, delta->data, delta->len);
+			}
+			sqlx_repository_unlock_and_close_noerror(sq3);
+		}
+	}
+
+	GRID_DEBUG("DELTA db %s from %s: %u transactions", name->base, source,
+			deltas->len);
+	g_ptr_array_free(deltas, TRUE);
+	return err;
+}
+
 static GError *
 _pipe_from(const gchar *source, struct sqlx_repository_s *repo,
 		struct sqlx_name_s *name, gint check_type)
@@ -665,7 +828,23 @@ _pipe_from(const gchar *source, struct sqlx_repository_s *repo,
 	GError *err;
 	struct restore_ctx_s *ctx = NULL;
 	gint64 start = oio_ext_monotonic_time();
-	err = _pipe_base_from(source, repo, name, check_type, &ctx);
+
+	if (sqliterepo_repli_delta_max_count > 0) {
+		if (!(err = _delta_from(source, repo, name))) {
+			GRID_INFO("DELTA db %s from %s took %"G_GINT64_FORMAT" ms reqid=%s",
+					name->base, source,
+					(oio_ext_monotonic_time() - start) / G_TIME_SPAN_MILLISECOND,
+					oio_ext_get_reqid());
+			return NULL;
+		}
+		GRID_DEBUG("DELTA db %s from %s failed, falling back on a DUMP: "
+				"(%d) %s reqid=%s", name->base, source, err->code,
+				err->message, oio_ext_get_reqid());
+		g_clear_error(&err);
+		start = oio_ext_monotonic_time();
+	}
+
+	err = _pipe_base_from(source, repo, name, check_type, TRUE, &ctx);
 	gint64 after_dump = oio_ext_monotonic_time();
 	GRID_INFO("DUMP db %s from %s took %"G_GINT64_FORMAT" ms reqid=%s",
 			name->base, source, (after_dump - start) / G_TIME_SPAN_MILLISECOND,
@@ -690,7 +869,7 @@ _snapshot_from(const gchar *src_addr, struct sqlx_repository_s *repo,
 {
 	GError *err = NULL;
 	struct restore_ctx_s *ctx = NULL;
-	err = _pipe_base_from(src_addr, repo, src_name, -1, &ctx);
+	err = _pipe_base_from(src_addr, repo, src_name, -1, FALSE, &ctx);
 	if (!err)
 		err = _restore_snapshot(repo, dest_name, ctx->path, dest_peers,
 				dest_properties);
@@ -891,6 +1070,39 @@ _handler_GETVERS(struct gridd_reply_ctx_s *reply,
 	return TRUE;
 }
 
+/* Pipelined DB_REPLI requests may be received out of order. Give the
+ * previous changes a chance to be applied before the current one. */
+static GError *
+_replicate_wait_previous(struct sqlx_repository_s *repo,
+		const struct sqlx_name_s *n, struct sqlx_sqlite3_s **psq3, gint64 seq)
+{
+	const gint64 limit = MIN(oio_ext_get_deadline(),
+			oio_ext_monotonic_time() + sqliterepo_repli_reorder_delay);
+	gulong delay = 500;
+
+	for (;;) {
+		const gint64 local =
+			sqlx_admin_get_i64(*psq3, "version:main.admin", 0);
+		if (local + 1 >= seq)
+			return NULL;
+		if (oio_ext_monotonic_time() >= limit) {
+			return NEWERROR(CODE_PIPEFROM, "Missing changes: local version is"
+					" %"G_GINT64_FORMAT", expected %"G_GINT64_FORMAT,
+					local, seq - 1);
+		}
+
+		sqlx_repository_unlock_and_close_noerror(*psq3);
+		*psq3 = NULL;
+		g_usleep(delay);
+		delay = MIN(delay * 2, 10 * G_TIME_SPAN_MILLISECOND);
+
+		GError *err = sqlx_repository_open_and_lock(repo, n,
+				SQLX_OPEN_LOCAL|SQLX_OPEN_URGENT, psq3, NULL);
+		if (err)
+			return err;
+	}
+}
+
 static gboolean
 _handler_REPLICATE(struct gridd_reply_ctx_s *reply,
 		struct sqlx_repository_s *repo, gpointer ignored UNUSED)
@@ -899,6 +1111,7 @@ _handler_REPLICATE(struct gridd_reply_ctx_s *reply,
 	struct sqlx_name_inline_s name;
 	NAME2CONST(n0, name);
 	gchar source[LIMIT_LENGTH_SRVID];
+	gint64 seq = 0;
 	GError *err = NULL;
 
 	reply->no_access();
@@ -921,6 +1134,11 @@ _handler_REPLICATE(struct gridd_reply_ctx_s *reply,
 		GRID_WARN("Caller did not tell its service id, please update reqid=%s",
 				oio_ext_get_reqid());
 	}
+	if ((err = metautils_message_extract_strint64(reply->request,
+				NAME_MSGKEY_REPLI_SEQ, FALSE, &seq))) {
+		reply->send_error(0, err);
+		return TRUE;
+	}
 
 	reply->send_reply(CODE_TEMPORARY, "received");
 
@@ -935,8 +1153,11 @@ _handler_REPLICATE(struct gridd_reply_ctx_s *reply,
 		return TRUE;
 	}
 
+	if (seq > 0)
+		err = _replicate_wait_previous(repo, &n0, &sq3, seq);
+
 	// Check the election without triggering it
-	if (!(err = election_check_replication_allowed(
+	if (!err && !(err = election_check_replication_allowed(
 			repo->election_manager, &n0, source, "DB_REPLI"))) {
 		/* Unpack the body from the message, decode it */
 		err = replicate_body_parse(sq3, b, bsize);
@@ -948,7 +1169,8 @@ _handler_REPLICATE(struct gridd_reply_ctx_s *reply,
 		reply->send_error(0, err);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	if (sq3)
+		sqlx_repository_unlock_and_close_noerror(sq3);
 
 	return TRUE;
 }
@@ -1216,7 +1438,54 @@ _handler_DUMP(struct gridd_reply_ctx_s *reply,
 		reply->send_reply(CODE_PARTIAL_CONTENT, "Partial content");
 	}
 
+	void _send_fd_part(struct data_slab_file_s *f,
+			gint64 offset, gint64 length, gint64 remaining)
+	{
+		gchar tmp[32] = {0};
+		g_snprintf(tmp, 32, "%"G_GINT64_FORMAT, remaining);
+		GRID_DEBUG("DUMP streaming block of %"G_GINT64_FORMAT" bytes, %"
+				G_GINT64_FORMAT" bytes remaining", length, remaining);
+		reply->add_body_fd(f, offset, length);
+		reply->add_header("remaining", metautils_gba_from_string(tmp));
+		reply->send_reply(CODE_PARTIAL_CONTENT, "Partial content");
+	}
+
+	GError *_send_extents(GByteArray *part, gint64 offset, gint64 size,
+			gpointer arg UNUSED)
+	{
+		gchar tmp[32] = {0};
+		g_snprintf(tmp, sizeof(tmp), "%"G_GINT64_FORMAT, offset);
+		reply->add_header("offset", metautils_gba_from_string(tmp));
+		g_snprintf(tmp, sizeof(tmp), "%"G_GINT64_FORMAT, size);
+		reply->add_header("size", metautils_gba_from_string(tmp));
+		_send_part(part, size - (offset + part->len));
+		return NULL;
+	}
+
+	gint64 extent_size = 0, size = -1;
 	if (flags & FLAG_CHUNKED) {
+		err = metautils_message_extract_strint64(reply->request,
+				NAME_MSGKEY_EXTENT_SIZE, FALSE, &extent_size);
+	}
+	if (err) {
+		/* Already set, reported below */
+	} else if ((flags & FLAG_CHUNKED) && extent_size != 0
+			&& (extent_size < 4096 || extent_size > sqliterepo_dump_chunk_size)) {
+		err = BADREQ("Invalid extent size %"G_GINT64_FORMAT
+				" (expected in [4096, %"G_GINT64_FORMAT"])",
+				extent_size, sqliterepo_dump_chunk_size);
+	} else if ((flags & FLAG_CHUNKED) && extent_size > 0) {
+		gsize bsize = 0;
+		void *b = metautils_message_get_BODY(reply->request, &bsize);
+		GByteArray *hashes = g_byte_array_new();
+		if (b && bsize)
+			g_byte_array_append(hashes, b, bsize);
+		err = _dump_diff(repo, &n0, (gint)check_type, extent_size, hashes,
+				_send_extents, &size);
+		g_byte_array_free(hashes, TRUE);
+	} else if ((flags & FLAG_CHUNKED) && sqliterepo_dump_streaming) {
+		err = _dump_streamed(repo, &n0, (gint)check_type, _send_fd_part);
+	} else if (flags & FLAG_CHUNKED) {
 		err = _dump_chunked(repo, &n0, (gint)check_type, _send_part);
 	} else {
 		GByteArray *dump = NULL;
@@ -1231,6 +1500,11 @@ _handler_DUMP(struct gridd_reply_ctx_s *reply,
 		reply->send_error(0, err);
 	} else {
 		reply->add_header("format", metautils_gba_from_string("sqlite3"));
+		if (size >= 0) {
+			gchar tmp[32] = {0};
+			g_snprintf(tmp, sizeof(tmp), "%"G_GINT64_FORMAT, size);
+			reply->add_header("size", metautils_gba_from_string(tmp));
+		}
 		reply->send_reply(CODE_FINAL_OK, "OK");
 	}
 	return TRUE;
@@ -1406,6 +1680,57 @@ cleanup:
 	return TRUE;
 }
 
+static gboolean
+_handler_DELTA(struct gridd_reply_ctx_s *reply,
+		struct sqlx_repository_s *repo, gpointer ignored UNUSED)
+{
+	GError *err = NULL;
+	struct sqlx_name_inline_s name;
+	NAME2CONST(n0, name);
+
+	reply->no_access();
+
+	if (NULL != (err = _load_sqlx_name(reply, &name, NULL))) {
+		reply->send_error(0, err);
+		return TRUE;
+	}
+
+	gsize bsize = 0;
+	void *b = metautils_message_get_BODY(reply->request, &bsize);
+	GTree *version = (b && bsize) ? version_decode(b, bsize) : NULL;
+	if (!version) {
+		reply->send_error(0, BADREQ("Missing or invalid version"));
+		return TRUE;
+	}
+
+	GPtrArray *deltas = NULL;
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	err = sqlx_repository_open_and_lock(repo, &n0,
+			SQLX_OPEN_LOCAL|SQLX_OPEN_NOREFCHECK, &sq3, NULL);
+	if (!err) {
+		err = sqlx_replication_get_deltas(sq3, version, &deltas);
+		sqlx_repository_unlock_and_close_noerror(sq3);
+	}
+	g_tree_destroy(version);
+
+	if (NULL != err) {
+		reply->send_error(0, err);
+		return TRUE;
+	}
+
+	for (guint i = 0; i < deltas->len; i++) {
+		gchar tmp[32] = {0};
+		g_snprintf(tmp, sizeof(tmp), "%u", deltas->len - i - 1);
+		reply->add_body(g_byte_array_ref(deltas->pdata[i]));
+		reply->add_header("remaining", metautils_gba_from_string(tmp));
+		reply->send_reply(CODE_PARTIAL_CONTENT, "Partial content");
+	}
+	g_ptr_array_free(deltas, TRUE);
+
+	reply->send_reply(CODE_FINAL_OK, "OK");
+	return TRUE;
+}
+
 static gboolean
 _handler_RESYNC(struct gridd_reply_ctx_s *reply,
 		struct sqlx_repository_s *repo, gpointer ignored UNUSED)
@@ -1543,7 +1868,7 @@ _handler_PROPDEL(struct gridd_reply_ctx_s *reply,
 		oio_url_clean(url);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 
 	if (!err) {
 		// Tip for forcing property sharing with shards
@@ -1724,7 +2049,7 @@ _handler_PROPSET(struct gridd_reply_ctx_s *reply,
 		oio_url_clean(url);
 	}
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 
 	if (!err) {
 		// Tip for forcing property sharing with shards
@@ -1785,7 +2110,7 @@ _handler_ENABLE(struct gridd_reply_ctx_s *reply,
 			sqlx_admin_save_lazy_tnx (sq3);
 		}
 	}
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 
 	if (NULL != err)
 		reply->send_error(0, err);
@@ -1837,7 +2162,7 @@ _handler_FREEZE(struct gridd_reply_ctx_s *reply,
 			sqlx_admin_save_lazy_tnx (sq3);
 		}
 	}
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 
 	if (NULL != err)
 		reply->send_error(0, err);
@@ -1888,7 +2213,7 @@ _handler_DISABLE(struct gridd_reply_ctx_s *reply,
 			sqlx_admin_save_lazy_tnx (sq3);
 		}
 	}
-	sqlx_repository_unlock_and_close_noerror(sq3);
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 
 	if (NULL != err)
 		reply->send_error(0, err);
@@ -1937,13 +2262,13 @@ _handler_DISABLE2(struct gridd_reply_ctx_s *reply,
 			sqlx_admin_save_lazy_tnx (sq3);
 		}
 	}
+	err = sqlx_repository_unlock_and_close_written(sq3, err);
 
 	if (NULL != err)
 		reply->send_error(0, err);
 	else
 		reply->send_reply(CODE_FINAL_OK, "OK");
 
-	sqlx_repository_unlock_and_close_noerror(sq3);
 	return TRUE;
 }
 
@@ -1985,8 +2310,11 @@ static void
 _info_elections(struct sqlx_repository_s *repo, GString *gstr,
 		gboolean prometheus_format)
 {
-	struct election_counts_s count = election_manager_count(
-			sqlx_repository_get_elections_manager(repo));
+	struct election_manager_s *manager =
+		sqlx_repository_get_elections_manager(repo);
+	struct election_counts_s count = election_manager_count(manager);
+	struct election_shard_stats_s *shards = NULL;
+	const guint nb_shards = election_manager_shard_stats(manager, &shards);
 	if (prometheus_format) {
 		g_string_append_printf(gstr,
 				"meta_base_elections{status=\"none\"} %u\n"
@@ -1996,6 +2324,15 @@ _info_elections(struct sqlx_repository_s *repo, GString *gstr,
 				"meta_base_elections{status=\"master\"} %u\n",
 				count.none, count.pending, count.failed,
 				count.slave, count.master);
+		for (guint i = 0; i < nb_shards; i++) {
+			g_string_append_printf(gstr,
+					"meta_base_elections_shard_members{shard=\"%u\"} %u\n"
+					"meta_base_elections_shard_locks{shard=\"%u\"} %"G_GUINT64_FORMAT"\n"
+					"meta_base_elections_shard_contended{shard=\"%u\"} %"G_GUINT64_FORMAT"\n"
+					"meta_base_elections_shard_wait{shard=\"%u\"} %"G_GINT64_FORMAT"\n",
+					i, shards[i].members, i, shards[i].locked,
+					i, shards[i].contended, i, shards[i].wait);
+		}
 	} else {
 		g_string_append_static(gstr, "\"elections\":{");
 		oio_str_gstring_append_json_pair_int(gstr, "total", count.total);
@@ -2009,8 +2346,23 @@ _info_elections(struct sqlx_repository_s *repo, GString *gstr,
 		oio_str_gstring_append_json_pair_int(gstr, "slave", count.slave);
 		g_string_append_c(gstr, ',');
 		oio_str_gstring_append_json_pair_int(gstr, "master", count.master);
-		g_string_append_c(gstr, '}');
+		g_string_append_static(gstr, ",\"shards\":[");
+		for (guint i = 0; i < nb_shards; i++) {
+			if (i > 0)
+				g_string_append_c(gstr, ',');
+			g_string_append_c(gstr, '{');
+			oio_str_gstring_append_json_pair_int(gstr, "members", shards[i].members);
+			g_string_append_c(gstr, ',');
+			oio_str_gstring_append_json_pair_int(gstr, "locks", shards[i].locked);
+			g_string_append_c(gstr, ',');
+			oio_str_gstring_append_json_pair_int(gstr, "contended", shards[i].contended);
+			g_string_append_c(gstr, ',');
+			oio_str_gstring_append_json_pair_int(gstr, "wait", shards[i].wait);
+			g_string_append_c(gstr, '}');
+		}
+		g_string_append_static(gstr, "]}");
 	}
+	g_free(shards);
 }
 
 static const char*
@@ -2288,6 +2640,7 @@ sqlx_repli_gridd_get_requests(void)
 		{NAME_MSGNAME_SQLX_REPLICATE,    (hook) sqlx_dispatch_all, _handler_REPLICATE},
 		{NAME_MSGNAME_SQLX_GETVERS,      (hook) sqlx_dispatch_all, _handler_GETVERS},
 		{NAME_MSGNAME_SQLX_RESYNC,       (hook) sqlx_dispatch_all, _handler_RESYNC},
+		{NAME_MSGNAME_SQLX_DELTA,        (hook) sqlx_dispatch_all, _handler_DELTA},
 		{NAME_MSGNAME_SQLX_VACUUM,       (hook) sqlx_dispatch_all, _handler_VACUUM},
 
 		{NAME_MSGNAME_SQLX_INFO,    (hook) sqlx_dispatch_all, _handler_INFO},
@@ -247,6 +247,7 @@ __close_base(struct sqlx_sqlite3_s *sq3)
 	sq3->update_queries = NULL;
 	beanstalkd_destroy(sq3->sharding_queue);
 	sq3->sharding_queue = NULL;
+	sqlx_replication_clear_deltas(sq3);
 	g_slice_free(struct sqlx_sqlite3_s, sq3);
 }
 
@@ -1019,7 +1020,15 @@ _open_and_lock_base(struct open_args_s *args, enum election_status_e expected,
 		election_manager_configured(args->repo->election_manager);
 
 	gint64 start = oio_ext_monotonic_time();
-	if (election_configured && !args->no_refcheck) {
+	gboolean leased = FALSE;
+	if (election_configured && !args->no_refcheck
+			&& (expected & ELECTION_LEADER) && !args->create
+			&& election_has_lease(args->repo->election_manager,
+				&args->name, NULL)) {
+		/* Confirmed MASTER: no need to check the election */
+		leased = TRUE;
+		args->is_replicated = TRUE;
+	} else if (election_configured && !args->no_refcheck) {
 		gboolean replicated = FALSE;
 		enum election_step_e step = STEP_NONE;
 		err = election_init(args->repo->election_manager, &args->name,
@@ -1047,7 +1056,12 @@ _open_and_lock_base(struct open_args_s *args, enum election_status_e expected,
 retry_open:
 
 	/* Now manage the replication status */
-	if (!expected || !election_configured || !args->is_replicated) {
+	if (leased) {
+		GRID_TRACE("MASTER lease held on [%s][%s]",
+				args->name.base, args->name.type);
+		status_before = ELECTION_LEADER;
+		leased = FALSE;  /* a retry must check the election */
+	} else if (!expected || !election_configured || !args->is_replicated) {
 		GRID_TRACE("No status (%d) expected on [%s][%s] (peers found: %s)",
 				expected, args->name.base, args->name.type,
 				args->is_replicated ? "true" : "false");
@@ -1163,6 +1177,10 @@ sqlx_repository_unlock_and_close2(struct sqlx_sqlite3_s *sq3, guint32 flags)
 	GRID_TRACE2("Closing bd=%d [%s][%s]", sq3->bd,
 			sq3->name.base, sq3->name.type);
 
+	/* The handle may be reused by another thread as soon as it is unlocked */
+	GSList *tickets = sq3->repli_tickets;
+	sq3->repli_tickets = NULL;
+
 	sq3->election = 0;
 
 	if (sq3->admin_dirty)
@@ -1184,6 +1202,17 @@ sqlx_repository_unlock_and_close2(struct sqlx_sqlite3_s *sq3, guint32 flags)
 		__close_base(sq3);
 	}
 
+	if (tickets) {
+		GError *err2 = sqlx_replication_wait_tickets(tickets);
+		if (!err) {
+			err = err2;
+		} else if (err2) {
+			GRID_WARN("Pipelined replication failed: (%d) %s reqid=%s",
+					err2->code, err2->message, oio_ext_get_reqid());
+			g_clear_error(&err2);
+		}
+	}
+
 	return err;
 }
 
@@ -1210,6 +1239,20 @@ sqlx_repository_unlock_and_close_noerror2(struct sqlx_sqlite3_s *sq3,
 	}
 }
 
+GError*
+sqlx_repository_unlock_and_close_written(struct sqlx_sqlite3_s *sq3,
+		GError *err)
+{
+	GError *err2 = sqlx_repository_unlock_and_close2(sq3, 0);
+	if (!err)
+		return err2;
+	if (err2) {
+		GRID_WARN("DB closure error: (%d) %s", err2->code, err2->message);
+		g_clear_error(&err2);
+	}
+	return err;
+}
+
 void
 sqlx_repository_unlock_and_close_noerror(struct sqlx_sqlite3_s *sq3)
 {
@@ -1618,53 +1661,65 @@ _fadvise_whole_seq(int fd, const char *path)
 		GRID_INFO("fadvise failed for %s: (%d) %s", path, rc, strerror(rc));
 }
 
-GError*
-sqlx_repository_dump_base_fd(struct sqlx_sqlite3_s *sq3,
-		dump_base_fd_cb read_file_cb, gpointer cb_arg)
-{
-	static struct dump_context_s {
-		volatile int lazy_init;
-		gint counter;
-		GMutex mutex;
-		GCond cond;
-	} context = {1, 5, {}, {}};
+static struct dump_context_s {
+	volatile int lazy_init;
+	gint counter;
+	GMutex mutex;
+	GCond cond;
+} dump_context = {1, 5, {}, {}};
 
-	gchar path[LIMIT_LENGTH_VOLUMENAME+32] = {0};
-	gboolean try_slash_tmp = FALSE;
-	int rc, fd = -1;
-	sqlite3 *dst = NULL;
+static GError*
+_dump_slot_acquire(void)
+{
 	GError *err = NULL;
 
-	GRID_TRACE2("%s(%p,%p,%p)", __FUNCTION__, sq3, read_file_cb, cb_arg);
-	EXTRA_ASSERT(sq3 != NULL);
-	EXTRA_ASSERT(read_file_cb != NULL);
-
-	if (context.lazy_init) {
-		if (g_atomic_int_compare_and_exchange(&context.lazy_init, 1, 0)) {
-			g_cond_init(&context.cond);
-			g_mutex_init(&context.mutex);
-			context.counter = sqliterepo_dumps_max;
+	if (dump_context.lazy_init) {
+		if (g_atomic_int_compare_and_exchange(&dump_context.lazy_init, 1, 0)) {
+			g_cond_init(&dump_context.cond);
+			g_mutex_init(&dump_context.mutex);
+			dump_context.counter = sqliterepo_dumps_max;
 		}
 	}
 
 	/* Check the limit has not been reached */
-	g_mutex_lock(&context.mutex);
+	g_mutex_lock(&dump_context.mutex);
 retry:
-	if (context.counter <= 0) {
+	if (dump_context.counter <= 0) {
 		gint64 deadline = MIN(oio_ext_get_deadline(),
 				g_get_monotonic_time() + sqliterepo_dumps_timeout);
-		if (g_cond_wait_until(&context.cond, &context.mutex, deadline)) {
+		if (g_cond_wait_until(&dump_context.cond, &dump_context.mutex, deadline)) {
 			/* Signaled! */
 			goto retry;
 		} else {
 			err = BUSY("Too many concurrents DB dumps");
 		}
 	} else {
-		context.counter --;
+		dump_context.counter --;
 	}
-	g_mutex_unlock(&context.mutex);
-	if (err)
-		return err;
+	g_mutex_unlock(&dump_context.mutex);
+	return err;
+}
+
+void
+sqlx_repository_dump_slot_release(void)
+{
+	/* Notify a waiting thread that a slot is now available */
+	g_mutex_lock(&dump_context.mutex);
+	dump_context.counter ++;
+	g_cond_signal(&dump_context.cond);
+	g_mutex_unlock(&dump_context.mutex);
+}
+
+/* Copy the base into an unlinked temporary file, whose descriptor is
+ * returned in <pfd> on success. */
+static GError*
+_dump_to_tmp(struct sqlx_sqlite3_s *sq3, int *pfd)
+{
+	gchar path[LIMIT_LENGTH_VOLUMENAME+32] = {0};
+	gboolean try_slash_tmp = FALSE;
+	int rc, fd = -1;
+	sqlite3 *dst = NULL;
+	GError *err = NULL;
 
 	/* First try to dump on local volume, on error try /tmp */
 	for (;;) {
@@ -1705,19 +1760,34 @@ retry:
 		}
 	}
 
-	if (!err) {
+	if (err) {
+		metautils_pclose(&fd);
+	} else {
 		_fadvise_whole_seq(fd, path);
-		err = read_file_cb(fd, cb_arg);
+		*pfd = fd;
 	}
+	return err;
+}
 
-	metautils_pclose(&fd);
+GError*
+sqlx_repository_dump_base_fd(struct sqlx_sqlite3_s *sq3,
+		dump_base_fd_cb read_file_cb, gpointer cb_arg)
+{
+	int fd = -1;
 
-	/* Notify a waiting thread that a slot is now available */
-	g_mutex_lock(&context.mutex);
-	context.counter ++;
-	g_cond_signal(&context.cond);
-	g_mutex_unlock(&context.mutex);
+	GRID_TRACE2("%s(%p,%p,%p)", __FUNCTION__, sq3, read_file_cb, cb_arg);
+	EXTRA_ASSERT(sq3 != NULL);
+	EXTRA_ASSERT(read_file_cb != NULL);
+
+	GError *err = _dump_slot_acquire();
+	if (err)
+		return err;
+
+	if (!(err = _dump_to_tmp(sq3, &fd)))
+		err = read_file_cb(fd, cb_arg);
 
+	metautils_pclose(&fd);
+	sqlx_repository_dump_slot_release();
 	return err;
 }
 
@@ -1743,6 +1813,46 @@ sqlx_repository_flush_wal(struct sqlx_sqlite3_s *sq3)
 	return NULL;
 }
 
+static GError*
+_check_base(struct sqlx_sqlite3_s *sq3, gint check_type)
+{
+	int rc = SQLITE_OK;
+	gint64 now = oio_ext_monotonic_time();
+	switch (check_type) {
+		case 0:
+			rc = SQLITE_OK;
+			break;
+		default:
+			GRID_WARN("Invalid value %d for sqliterepo.dump.check_type, "
+					"using 1 (quick_check).", check_type);
+			// FALLTHROUGH
+		case 1:
+			rc = sqlx_exec(sq3->db, "PRAGMA quick_check");
+			GRID_INFO("Pragma quick_check took %"G_GINT64_FORMAT" ms [%s][%s]",
+					(oio_ext_monotonic_time () - now) / G_TIME_SPAN_MILLISECOND,
+					sq3->name.base, sq3->name.type);
+			break;
+		case 2:
+			rc = sqlx_exec(sq3->db, "PRAGMA integrity_check");
+			GRID_INFO("Pragma integrity_check took "
+					"%"G_GINT64_FORMAT" ms [%s][%s]",
+					(oio_ext_monotonic_time () - now) / G_TIME_SPAN_MILLISECOND,
+					sq3->name.base, sq3->name.type);
+			break;
+	}
+
+	if (rc == SQLITE_OK)
+		return NULL;
+	if (rc == SQLITE_NOTADB || rc == SQLITE_CORRUPT) {
+		sq3->corrupted = TRUE;
+		return NEWERROR(CODE_CORRUPT_DATABASE,
+				"invalid or corrupt database file: (%d) %s",
+				rc, sqlite_strerror(rc));
+	}
+	return NEWERROR(CODE_INTERNAL_ERROR,
+			"failed to check base: (%d) %s", rc, sqlite_strerror(rc));
+}
+
 GError*
 sqlx_repository_dump_base_fd_no_copy(struct sqlx_sqlite3_s *sq3,
 		gboolean check_size, gint check_type,
@@ -1788,43 +1898,8 @@ sqlx_repository_dump_base_fd_no_copy(struct sqlx_sqlite3_s *sq3,
 	}
 
 	/* Detect a wrong/corrupted database file */
-	gint64 now = oio_ext_monotonic_time();
-	switch (check_type) {
-		case 0:
-			rc = SQLITE_OK;
-			break;
-		default:
-			GRID_WARN("Invalid value %d for sqliterepo.dump.check_type, "
-					"using 1 (quick_check).", check_type);
-			// FALLTHROUGH
-		case 1:
-			rc = sqlx_exec(sq3->db, "PRAGMA quick_check");
-			GRID_INFO("Pragma quick_check took %"G_GINT64_FORMAT" ms [%s][%s]",
-					(oio_ext_monotonic_time () - now) / G_TIME_SPAN_MILLISECOND,
-					sq3->name.base, sq3->name.type);
-			break;
-		case 2:
-			rc = sqlx_exec(sq3->db, "PRAGMA integrity_check");
-			GRID_INFO("Pragma integrity_check took "
-					"%"G_GINT64_FORMAT" ms [%s][%s]",
-					(oio_ext_monotonic_time () - now) / G_TIME_SPAN_MILLISECOND,
-					sq3->name.base, sq3->name.type);
-			break;
-	}
-
-	if (rc != SQLITE_OK) {
-		if (rc == SQLITE_NOTADB || rc == SQLITE_CORRUPT) {
-			err = NEWERROR(CODE_CORRUPT_DATABASE,
-					"invalid or corrupt database file: (%d) %s",
-					rc, sqlite_strerror(rc));
-			sq3->corrupted = TRUE;
-		} else {
-			err = NEWERROR(CODE_INTERNAL_ERROR,
-					"failed to check base: (%d) %s",
-					rc, sqlite_strerror(rc));
-		}
+	if ((err = _check_base(sq3, check_type)))
 		goto end;
-	}
 
 	// Flush the cache to permanent storage
 	if ((rc = sqlite3_db_cacheflush(sq3->db)) != SQLITE_OK) {
@@ -1877,6 +1952,22 @@ sqlx_repository_dump_base_gba(struct sqlx_sqlite3_s *sq3, gint check_type,
 			_monolytic_dump_cb, dump);
 }
 
+GError*
+sqlx_repository_dump_base_snapshot(struct sqlx_sqlite3_s *sq3,
+		gint check_type, int *pfd)
+{
+	EXTRA_ASSERT(sq3 != NULL);
+	EXTRA_ASSERT(pfd != NULL);
+	GError *err = _check_base(sq3, check_type);
+	if (!err)
+		err = _dump_slot_acquire();
+	if (err)
+		return err;
+	if ((err = _dump_to_tmp(sq3, pfd)))
+		sqlx_repository_dump_slot_release();
+	return err;
+}
+
 GError*
 sqlx_repository_dump_base_chunked(struct sqlx_sqlite3_s *sq3,
 		gint chunk_size, gint check_type,
@@ -1909,6 +2000,149 @@ sqlx_repository_dump_base_chunked(struct sqlx_sqlite3_s *sq3,
 			_chunked_dump_cb, NULL);
 }
 
+static void
+_hash_extent(guint8 *data, gsize len, guint8 *out)
+{
+	gsize out_len = SQLX_EXTENT_HASH_SIZE;
+	GChecksum *sum = g_checksum_new(G_CHECKSUM_MD5);
+	g_checksum_update(sum, data, len);
+	g_checksum_get_digest(sum, out, &out_len);
+	g_checksum_free(sum);
+}
+
+static GError*
+_read_extent(int fd, gint64 offset, guint8 *buf, gsize size, gsize *pread_len)
+{
+	gsize total = 0;
+	while (total < size) {
+		ssize_t r = pread(fd, buf + total, size - total, offset + total);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return NEWERROR(errno, "read error: %s", strerror(errno));
+		}
+		if (r == 0)
+			break;
+		total += r;
+	}
+	*pread_len = total;
+	return NULL;
+}
+
+GError*
+sqlx_repository_dump_base_to_fd(struct sqlx_sqlite3_s *sq3,
+		int dst_fd, gint64 extent_size, GByteArray **hashes)
+{
+	EXTRA_ASSERT(extent_size > 0);
+	GByteArray *out = hashes ? g_byte_array_new() : NULL;
+
+	GError *_copy_cb(int fd, gpointer arg UNUSED)
+	{
+		GError *err = NULL;
+		guint8 *buf = g_malloc(extent_size);
+		guint8 digest[SQLX_EXTENT_HASH_SIZE];
+		for (gint64 offset = 0; !err; offset += extent_size) {
+			gsize len = 0;
+			if ((err = _read_extent(fd, offset, buf, extent_size, &len))
+					|| len == 0)
+				break;
+			for (gsize w = 0; !err && w < len; ) {
+				ssize_t rc = write(dst_fd, buf + w, len - w);
+				if (rc < 0)
+					err = NEWERROR(errno, "write error: %s", strerror(errno));
+				else
+					w += rc;
+			}
+			if (out) {
+				_hash_extent(buf, len, digest);
+				g_byte_array_append(out, digest, sizeof(digest));
+			}
+		}
+		g_free(buf);
+		return err;
+	}
+
+	GError *err = sqlx_repository_dump_base_fd_no_copy(sq3, FALSE, 0,
+			_copy_cb, NULL);
+	if (out) {
+		if (err)
+			g_byte_array_free(out, TRUE);
+		else
+			*hashes = out;
+	}
+	return err;
+}
+
+GError*
+sqlx_repository_dump_base_diff(struct sqlx_sqlite3_s *sq3,
+		gint chunk_size, gint check_type,
+		gint64 extent_size, GByteArray *hashes,
+		dump_base_diff_cb callback, gpointer callback_arg, gint64 *psize)
+{
+	EXTRA_ASSERT(extent_size > 0);
+	EXTRA_ASSERT(hashes != NULL);
+	EXTRA_ASSERT(psize != NULL);
+	const gint64 known = hashes->len / SQLX_EXTENT_HASH_SIZE;
+
+	GError *_diff_dump_cb(int fd, gpointer arg UNUSED)
+	{
+		struct stat st;
+		GError *err = NULL;
+		if (fstat(fd, &st) < 0)
+			return NEWERROR(errno,
+					"Failed to stat the database file (fd=%d)", fd);
+		*psize = st.st_size;
+
+		/* Contiguous extents are sent together, up to chunk_size */
+		GByteArray *pending = NULL;
+		gint64 pending_offset = 0;
+		guint8 *buf = g_malloc(extent_size);
+		guint8 digest[SQLX_EXTENT_HASH_SIZE];
+
+		for (gint64 i = 0; !err && i * extent_size < st.st_size; i++) {
+			gsize len = 0;
+			const gint64 offset = i * extent_size;
+			if ((err = _read_extent(fd, offset, buf, extent_size, &len))
+					|| len == 0)
+				break;
+			if (i < known && len == (gsize)extent_size) {
+				_hash_extent(buf, len, digest);
+				if (!memcmp(digest,
+						hashes->data + i * SQLX_EXTENT_HASH_SIZE,
+						SQLX_EXTENT_HASH_SIZE))
+					continue;
+			}
+			if (pending && (pending_offset + pending->len != (guint64)offset
+					|| pending->len + len > (guint)chunk_size)) {
+				err = callback(pending, pending_offset, st.st_size,
+						callback_arg);
+				pending = NULL;
+			}
+			if (!err) {
+				if (!pending) {
+					pending = g_byte_array_sized_new(MIN(chunk_size,
+								st.st_size - offset));
+					pending_offset = offset;
+				}
+				g_byte_array_append(pending, buf, len);
+			}
+		}
+		if (pending) {
+			if (!err)
+				err = callback(pending, pending_offset, st.st_size,
+						callback_arg);
+			else
+				g_byte_array_free(pending, TRUE);
+		}
+		g_free(buf);
+		return err;
+	}
+
+	*psize = -1;
+	return sqlx_repository_dump_base_fd_no_copy(sq3, FALSE, check_type,
+			_diff_dump_cb, NULL);
+}
+
 GError*
 sqlx_repository_restore_from_file(struct sqlx_sqlite3_s *sq3,
 		const gchar *path)
@@ -65,3 +65,26 @@ restore_ctx_append(struct restore_ctx_s *ctx, guint8 *raw, gsize rawsize)
 	}
 	return NULL;
 }
+
+GError*
+restore_ctx_write_at(struct restore_ctx_s *ctx, gint64 offset,
+		guint8 *raw, gsize rawsize)
+{
+	for (gsize wtotal = 0; wtotal < rawsize; ) {
+		gssize w = pwrite(ctx->fd, raw + wtotal, rawsize - wtotal,
+				offset + wtotal);
+		if (w < 0) {
+			return NEWERROR(errno, "pwrite: %s", strerror(errno));
+		}
+		wtotal += w;
+	}
+	return NULL;
+}
+
+GError*
+restore_ctx_truncate(struct restore_ctx_s *ctx, gint64 size)
+{
+	if (ftruncate(ctx->fd, size) < 0)
+		return NEWERROR(errno, "ftruncate: %s", strerror(errno));
+	return NULL;
+}
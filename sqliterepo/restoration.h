@@ -31,5 +31,8 @@ struct restore_ctx_s
 GError *restore_ctx_create(const gchar *path_pattern, struct restore_ctx_s **ctx);
 void restore_ctx_clear(struct restore_ctx_s **ctx);
 GError *restore_ctx_append(struct restore_ctx_s *ctx, guint8 *raw, gsize rawsize);
+GError *restore_ctx_write_at(struct restore_ctx_s *ctx, gint64 offset,
+		guint8 *raw, gsize rawsize);
+GError *restore_ctx_truncate(struct restore_ctx_s *ctx, gint64 size);
 
 #endif /*OIO_SDS__sqliterepo__restoration_h*/
\ No newline at end of file
@@ -131,6 +131,14 @@ struct sqlx_sqlite3_s
 
 	// Sharding
 	struct beanstalkd_s *sharding_queue;
+
+	// Transactions replicated in pipelined mode, whose quorum is awaited
+	// when the base is released.
+	GSList *repli_tickets;
+
+	// Recent replicated transactions, to resync slightly lagging slaves
+	GQueue *repli_deltas;
+	gsize repli_deltas_size;
 };
 
 struct sqlx_repo_config_s
@@ -244,6 +252,12 @@ GError* sqlx_repository_unlock_and_close(struct sqlx_sqlite3_s *sq3);
 GError* sqlx_repository_unlock_and_close2(struct sqlx_sqlite3_s *sq3,
 		guint32 flags);
 
+/** Close a base that may have been written. In pipelined replication mode,
+ * the quorum is only known at that time: its failure is returned unless
+ * <err> is already set, then <err> is returned. */
+GError* sqlx_repository_unlock_and_close_written(struct sqlx_sqlite3_s *sq3,
+		GError *err);
+
 /** @see sqlx_repository_unlock_and_close() */
 void sqlx_repository_unlock_and_close_noerror(struct sqlx_sqlite3_s *sq3);
 
@@ -315,6 +329,17 @@ GError* sqlx_repository_dump_base_fd_no_copy(struct sqlx_sqlite3_s *sq3,
 		gboolean check_size, gint check_type,
 		dump_base_fd_cb read_file_cb, gpointer cb_arg);
 
+/** Check the database integrity if required, then return in <pfd> the
+ *  descriptor of a private copy of the base (already unlinked, thus
+ *  immutable). On success the caller owns the descriptor and one dump
+ *  slot: it must close the former, then call
+ *  sqlx_repository_dump_slot_release(). */
+GError* sqlx_repository_dump_base_snapshot(struct sqlx_sqlite3_s *sq3,
+		gint check_type, int *pfd);
+
+/** Give back a dump slot taken by sqlx_repository_dump_base_snapshot(). */
+void sqlx_repository_dump_slot_release(void);
+
 /** Callback for sqlx_repository_dump_base_chunked() */
 typedef GError*(*dump_base_chunked_cb)(GByteArray *gba, gint64 remaining_bytes,
 		gpointer arg);
@@ -326,6 +351,27 @@ GError* sqlx_repository_dump_base_chunked(struct sqlx_sqlite3_s *sq3,
 		gint chunk_size, gint check_type,
 		dump_base_chunked_cb callback, gpointer callback_arg);
 
+/** Size of a hash sent by sqlx_repository_dump_base_diff() */
+#define SQLX_EXTENT_HASH_SIZE 16
+
+/** Copy the database file into dst_fd, and compute the hash of each
+ *  extent of extent_size bytes (concatenated in *hashes, if not NULL). */
+GError* sqlx_repository_dump_base_to_fd(struct sqlx_sqlite3_s *sq3,
+		int dst_fd, gint64 extent_size, GByteArray **hashes);
+
+/** Callback for sqlx_repository_dump_base_diff() */
+typedef GError*(*dump_base_diff_cb)(GByteArray *gba, gint64 offset,
+		gint64 size, gpointer arg);
+
+/** Like sqlx_repository_dump_base_chunked(), but only send the extents
+ *  whose hash differs from the one in hashes (as computed by
+ *  sqlx_repository_dump_base_to_fd()), with their offset in the file.
+ *  The final size of the file is stored in *psize. */
+GError* sqlx_repository_dump_base_diff(struct sqlx_sqlite3_s *sq3,
+		gint chunk_size, gint check_type,
+		gint64 extent_size, GByteArray *hashes,
+		dump_base_diff_cb callback, gpointer callback_arg, gint64 *psize);
+
 /** Flush the WAL of the database (does nothing if journal_mode!=WAL). */
 GError* sqlx_repository_flush_wal(struct sqlx_sqlite3_s *sq3);
 
@@ -223,6 +223,23 @@ sqlx_pack_DUMP(const struct sqlx_name_s *name, gboolean chunked,
 	return message_marshall_gba_and_clean(req);
 }
 
+GByteArray*
+sqlx_pack_DUMP_DIFF(const struct sqlx_name_s *name, gint check_type,
+		gint64 extent_size, GByteArray *hashes, gint64 deadline)
+{
+	gboolean chunked = TRUE;
+	MESSAGE req = make_request(NAME_MSGNAME_SQLX_DUMP, NULL, name, deadline);
+	metautils_message_add_field(req, NAME_MSGKEY_CHUNKED, &chunked, 1);
+	if (check_type >= 0) {
+		metautils_message_add_field_strint64(
+				req, NAME_MSGKEY_CHECK_TYPE, check_type);
+	}
+	metautils_message_add_field_strint64(
+			req, NAME_MSGKEY_EXTENT_SIZE, extent_size);
+	metautils_message_set_BODY(req, hashes->data, hashes->len);
+	return message_marshall_gba_and_clean(req);
+}
+
 GByteArray*
 sqlx_pack_RESTORE(const struct sqlx_name_s *name,
 		const guint8 *raw, gsize rawsize,
@@ -236,17 +253,32 @@ sqlx_pack_RESTORE(const struct sqlx_name_s *name,
 
 GByteArray*
 sqlx_pack_REPLICATE(const struct sqlx_name_s *name,
-		struct TableSequence *tabseq, const gchar *local_addr, gint64 deadline)
+		struct TableSequence *tabseq, const gchar *local_addr, gint64 seq,
+		gint64 deadline)
 {
 	EXTRA_ASSERT(name != NULL);
 	EXTRA_ASSERT(tabseq != NULL);
 
 	MESSAGE req = make_request(NAME_MSGNAME_SQLX_REPLICATE, NULL, name, deadline);
 	metautils_message_add_field_str(req, NAME_MSGKEY_SRC, local_addr);
+	if (seq > 0)
+		metautils_message_add_field_strint64(req, NAME_MSGKEY_REPLI_SEQ, seq);
 	metautils_message_add_body_unref(req, sqlx_encode_TableSequence(tabseq, NULL));
 	return message_marshall_gba_and_clean(req);
 }
 
+GByteArray*
+sqlx_pack_DELTA(const struct sqlx_name_s *name, GTree *version,
+		gint64 deadline)
+{
+	EXTRA_ASSERT(name != NULL);
+	EXTRA_ASSERT(version != NULL);
+
+	MESSAGE req = make_request(NAME_MSGNAME_SQLX_DELTA, NULL, name, deadline);
+	metautils_message_add_body_unref(req, version_encode(version));
+	return message_marshall_gba_and_clean(req);
+}
+
 GByteArray*
 sqlx_pack_GETVERS(const struct sqlx_name_s *name, const gchar *peers,
 		gint64 deadline)
@@ -105,6 +105,10 @@ GByteArray* sqlx_pack_STATUS(const struct sqlx_name_s *name, gint64 deadline);
 GByteArray* sqlx_pack_GETVERS(const struct sqlx_name_s *name, const gchar *peers,
 		gint64 deadline);
 
+/* Ask for the transactions replicated since the given version */
+GByteArray* sqlx_pack_DELTA(const struct sqlx_name_s *name, GTree *version,
+		gint64 deadline);
+
 GByteArray* sqlx_pack_SNAPSHOT(const struct sqlx_name_s *name,
 		const gchar *src_addr, const gchar *src_base, const gchar *src_suffix,
 		gchar **dest_properties, const gchar **fields, gint64 deadline);
@@ -114,13 +118,19 @@ GByteArray* sqlx_pack_REMOVE(const struct sqlx_name_s *name, gint64 deadline);
 GByteArray* sqlx_pack_RESYNC(const struct sqlx_name_s *name, const gint check_type, gint64 deadline);
 GByteArray* sqlx_pack_VACUUM(const struct sqlx_name_s *name, gboolean local, gint64 deadline);
 GByteArray* sqlx_pack_DUMP(const struct sqlx_name_s *name, gboolean chunked, gint check_type, gint64 deadline);
+
+/* Chunked DUMP of the extents that differ from the given hashes */
+GByteArray* sqlx_pack_DUMP_DIFF(const struct sqlx_name_s *name, gint check_type,
+		gint64 extent_size, GByteArray *hashes, gint64 deadline);
 GByteArray* sqlx_pack_RESTORE(
 		const struct sqlx_name_s *name, const guint8 *raw, gsize rawsize,
 		const gchar *local_addr, gint64 deadline);
 
+/* <seq> is the version of the admin table once the changes are applied, and
+ * lets the slaves apply pipelined changes in order. Set it to 0 to skip it. */
 GByteArray* sqlx_pack_REPLICATE(
 		const struct sqlx_name_s *name, struct TableSequence *tabseq,
-		const gchar *local_addr, gint64 deadline);
+		const gchar *local_addr, gint64 seq, gint64 deadline);
 
 // service-wide requests
 GByteArray* sqlx_pack_LEANIFY(gint64 deadline);
@@ -144,6 +154,24 @@ typedef GError* (*peer_dump_cb)(GByteArray *part, gint64 remaining, gpointer arg
 GError * peer_dump(const gchar *target, struct sqlx_name_s *name, gboolean chunked,
 		gint check_type, peer_dump_cb, gpointer cb_arg, gint64 deadline);
 
+typedef GError* (*peer_dump_diff_cb)(GByteArray *part, gint64 offset,
+		gpointer arg);
+
+/* Chunked dump of the extents of the target's copy that differ from the
+ * hashes of the local copy. Servers unaware of the extents send the whole
+ * base, the offsets are then consecutive. *psize receives the size of the
+ * remote copy, or -1 when not told. */
+GError * peer_dump_diff(const gchar *target, struct sqlx_name_s *name,
+		gint check_type, gint64 extent_size, GByteArray *hashes,
+		peer_dump_diff_cb callback, gpointer cb_arg, gint64 *psize,
+		gint64 deadline);
+
+/* Fetch the transactions replicated by the target since the given version.
+ * The callback is called once per transaction, in order. */
+GError * peer_delta(const gchar *target, struct sqlx_name_s *name,
+		GTree *version, peer_dump_cb callback, gpointer cb_arg,
+		gint64 deadline);
+
 GByteArray* sqlx_pack_LOCAL_COPY(const struct sqlx_name_s *name, const gchar *source,
 		const gchar *suffix, gint64 deadline);
 
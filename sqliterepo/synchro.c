@@ -73,6 +73,20 @@ struct sqlx_sync_s
 	guint hash_depth;
 
 	struct grid_single_rrd_s *conn_attempts;
+
+	/* Set while the ZK session is in the CONNECTED state, updated by
+	 * the thread of the ZK handle. */
+	gint connected;
+
+	/* Coalescing of the requests toward ZK. All the fields below are
+	 * protected by <batch_lock>. */
+	GMutex batch_lock;
+	/* <struct zk_op_s*> creations and deletions not sent yet */
+	GPtrArray *batch;
+	/* requests carrying creations or deletions, sent and not completed */
+	guint batch_inflight;
+	/* <gchar*,struct zk_listing_s*> pending listings of parent nodes */
+	GHashTable *listings;
 };
 
 static void _clear(struct sqlx_sync_s *ss);
@@ -106,6 +120,10 @@ static int _awget_siblings (struct sqlx_sync_s *ss, const char *path,
 static int _aremove_all_watches(struct sqlx_sync_s *ss, const char *path,
 		void_completion_t completion, const void *data);
 
+static gboolean _connected(struct sqlx_sync_s *ss);
+
+static gint64 _session_timeout(struct sqlx_sync_s *ss);
+
 static struct sqlx_sync_vtable_s VTABLE =
 {
 	_clear,
@@ -118,6 +136,8 @@ static struct sqlx_sync_vtable_s VTABLE =
 	_awget_children,
 	_awget_siblings,
 	_aremove_all_watches,
+	_connected,
+	_session_timeout,
 };
 
 static gchar *
@@ -161,6 +181,9 @@ sqlx_sync_create(const char *url)
 	ss->zk_url = shuffled;
 	ss->conn_attempts = grid_single_rrd_create(
 			oio_ext_monotonic_seconds(), disconnection_rrd_window + 1);
+	g_mutex_init(&ss->batch_lock);
+	ss->batch = g_ptr_array_new();
+	ss->listings = g_hash_table_new(g_str_hash, g_str_equal);
 	return ss;
 }
 
@@ -252,6 +275,7 @@ _reconnect(struct sqlx_sync_s *ss)
 	}
 
 	/* Forget the previous ID and reconnect */
+	g_atomic_int_set(&ss->connected, 0);
 	memset (&ss->zk_id, 0, sizeof(ss->zk_id));
 
 	GRID_NOTICE("Zookeeper: starting connection to [%s]", ss->zk_url);
@@ -285,6 +309,7 @@ zk_main_watch(zhandle_t *zh, int type, int state, const char *path UNUSED,
 
 	const gint64 now = oio_ext_monotonic_seconds();
 	struct sqlx_sync_s *ss = watcherCtx;
+	g_atomic_int_set(&ss->connected, state == ZOO_CONNECTED_STATE);
 
 	if (state == ZOO_EXPIRED_SESSION_STATE || state == ZOO_AUTH_FAILED_STATE) {
 		GRID_WARN("Zookeeper: %s/%s to %s",
@@ -339,6 +364,8 @@ _close(struct sqlx_sync_s *ss)
 {
 	EXTRA_ASSERT(ss != NULL);
 	EXTRA_ASSERT(ss->vtable == &VTABLE);
+	_batch_abort(ss, ZCLOSING);
+	g_atomic_int_set(&ss->connected, 0);
 	if (ss->zh) {
 		zookeeper_close(ss->zh);
 		ss->zh = NULL;
@@ -351,6 +378,10 @@ _clear(struct sqlx_sync_s *ss)
 	EXTRA_ASSERT(ss != NULL);
 	EXTRA_ASSERT(ss->vtable == &VTABLE);
 	_close(ss);
+	EXTRA_ASSERT(ss->batch->len == 0);
+	g_ptr_array_free(ss->batch, TRUE);
+	g_hash_table_destroy(ss->listings);
+	g_mutex_clear(&ss->batch_lock);
 	oio_str_clean (&ss->zk_prefix);
 	oio_str_clean (&ss->zk_url);
 	grid_single_rrd_destroy(ss->conn_attempts);
@@ -358,6 +389,353 @@ _clear(struct sqlx_sync_s *ss)
 	g_free(ss);
 }
 
+/* Batching ------------------------------------------------------------------
+ * While a request carrying creations or deletions is pending on the
+ * connection, the new ones are queued, then sent together in a single
+ * zoo_amulti() as soon as the pending requests complete (or when the batch
+ * is full). A multi-op is a transaction: when one operation fails, the others
+ * are rolled back, then sent again one by one.
+ * The listings of a parent node are merged the same way: the requests that
+ * arrive while a listing of the same node is pending share the next one.
+ * -------------------------------------------------------------------------- */
+
+/* @private */
+struct zk_op_s
+{
+	struct sqlx_sync_s *ss;
+	int type;  /* ZOO_CREATE_OP or ZOO_DELETE_OP */
+	int flags;
+	int version;
+	int vlen;
+	gchar *value;
+	string_completion_t create_done;
+	void_completion_t delete_done;
+	const void *data;
+	gchar path[PATH_MAXLEN];
+	gchar created[PATH_MAXLEN];
+};
+
+/* @private */
+struct zk_multi_s
+{
+	struct sqlx_sync_s *ss;
+	GPtrArray *ops;
+	zoo_op_t *zops;
+	zoo_op_result_t *results;
+};
+
+/* @private */
+struct zk_listing_waiter_s
+{
+	strings_completion_t completion;
+	const void *data;
+};
+
+/* @private */
+struct zk_listing_s
+{
+	struct sqlx_sync_s *ss;
+	gchar *path;
+	GArray *pending;  /* <struct zk_listing_waiter_s> waiting for the reply */
+	GArray *queued;   /* <struct zk_listing_waiter_s> for the next request */
+};
+
+static void _batch_release(struct sqlx_sync_s *ss);
+
+static void
+_op_free(struct zk_op_s *op)
+{
+	g_free(op->value);
+	g_free(op);
+}
+
+static void
+_op_complete(struct zk_op_s *op, int rc, const char *created)
+{
+	if (op->type == ZOO_CREATE_OP) {
+		if (op->create_done)
+			op->create_done(rc, rc == ZOK ? created : NULL, op->data);
+	} else {
+		if (op->delete_done)
+			op->delete_done(rc, op->data);
+	}
+	_op_free(op);
+}
+
+static void
+_op_single_created(int rc, const char *value, const void *data)
+{
+	struct zk_op_s *op = (struct zk_op_s *) data;
+	struct sqlx_sync_s *ss = op->ss;
+	_op_complete(op, rc, value);
+	_batch_release(ss);
+}
+
+static void
+_op_single_deleted(int rc, const void *data)
+{
+	struct zk_op_s *op = (struct zk_op_s *) data;
+	struct sqlx_sync_s *ss = op->ss;
+	_op_complete(op, rc, NULL);
+	_batch_release(ss);
+}
+
+/* Send the operation alone. On success, the operation will be completed
+ * and the batch released by the ZK completion. */
+static int
+_op_send(struct zk_op_s *op)
+{
+	struct sqlx_sync_s *ss = op->ss;
+	if (!ss->zh)
+		return ZINVALIDSTATE;
+	if (op->type == ZOO_CREATE_OP)
+		return zoo_acreate(ss->zh, op->path, op->value, op->vlen,
+				&ZOO_OPEN_ACL_UNSAFE, op->flags, _op_single_created, op);
+	return zoo_adelete(ss->zh, op->path, op->version,
+			_op_single_deleted, op);
+}
+
+static void
+_multi_free(struct zk_multi_s *multi)
+{
+	g_ptr_array_free(multi->ops, TRUE);
+	g_free(multi->zops);
+	g_free(multi->results);
+	g_free(multi);
+}
+
+static void
+_multi_done(int rc, const void *data)
+{
+	struct zk_multi_s *multi = (struct zk_multi_s *) data;
+	struct sqlx_sync_s *ss = multi->ss;
+
+	/* Look for the operation that made the transaction fail. The others
+	 * are reported either ZOK or ZRUNTIMEINCONSISTENCY. If none is found,
+	 * the whole request failed (e.g. the connection has been lost). */
+	gint culprit = -1;
+	if (rc != ZOK) {
+		for (guint i = 0; i < multi->ops->len && culprit < 0; i++) {
+			const int err = multi->results[i].err;
+			if (err != ZOK && err != ZRUNTIMEINCONSISTENCY)
+				culprit = i;
+		}
+	}
+
+	for (guint i = 0; i < multi->ops->len; i++) {
+		struct zk_op_s *op = multi->ops->pdata[i];
+		if (rc == ZOK) {
+			_op_complete(op, ZOK, op->created);
+		} else if (culprit < 0) {
+			_op_complete(op, rc, NULL);
+		} else if ((gint)i == culprit) {
+			_op_complete(op, multi->results[i].err, NULL);
+		} else {
+			g_mutex_lock(&ss->batch_lock);
+			ss->batch_inflight ++;
+			g_mutex_unlock(&ss->batch_lock);
+			const int rc_single = _op_send(op);
+			if (rc_single != ZOK) {
+				_op_complete(op, rc_single, NULL);
+				_batch_release(ss);
+			}
+		}
+	}
+
+	_multi_free(multi);
+	_batch_release(ss);
+}
+
+/* The batch must already be accounted in <batch_inflight>, its operations
+ * will all be completed. */
+static void
+_batch_send(struct sqlx_sync_s *ss, GPtrArray *ops)
+{
+	if (ops->len == 1) {
+		struct zk_op_s *op = ops->pdata[0];
+		g_ptr_array_free(ops, TRUE);
+		const int rc = _op_send(op);
+		if (rc != ZOK) {
+			_op_complete(op, rc, NULL);
+			_batch_release(ss);
+		}
+		return;
+	}
+
+	struct zk_multi_s *multi = g_malloc0(sizeof(*multi));
+	multi->ss = ss;
+	multi->ops = ops;
+	multi->zops = g_malloc0(ops->len * sizeof(zoo_op_t));
+	multi->results = g_malloc0(ops->len * sizeof(zoo_op_result_t));
+	for (guint i = 0; i < ops->len; i++) {
+		struct zk_op_s *op = ops->pdata[i];
+		if (op->type == ZOO_CREATE_OP)
+			zoo_create_op_init(multi->zops + i, op->path, op->value, op->vlen,
+					&ZOO_OPEN_ACL_UNSAFE, op->flags,
+					op->created, sizeof(op->created));
+		else
+			zoo_delete_op_init(multi->zops + i, op->path, op->version);
+	}
+
+	GRID_TRACE("ZK multi-op with %u operations", ops->len);
+	int rc = ZINVALIDSTATE;
+	if (ss->zh)
+		rc = zoo_amulti(ss->zh, ops->len, multi->zops, multi->results,
+				_multi_done, multi);
+	if (rc != ZOK)
+		_multi_done(rc, multi);
+}
+
+static void
+_batch_release(struct sqlx_sync_s *ss)
+{
+	GPtrArray *ops = NULL;
+	g_mutex_lock(&ss->batch_lock);
+	EXTRA_ASSERT(ss->batch_inflight > 0);
+	-- ss->batch_inflight;
+	if (!ss->batch_inflight && ss->batch->len > 0) {
+		ops = ss->batch;
+		ss->batch = g_ptr_array_new();
+		ss->batch_inflight ++;
+	}
+	g_mutex_unlock(&ss->batch_lock);
+
+	if (ops)
+		_batch_send(ss, ops);
+}
+
+/* Takes the ownership of <op>. When the operation is sent immediately, the
+ * error is returned and the completion not called, as with the ZK API. */
+static int
+_batch_push(struct sqlx_sync_s *ss, struct zk_op_s *op)
+{
+	GPtrArray *full = NULL;
+
+	g_mutex_lock(&ss->batch_lock);
+	if (!ss->batch_inflight) {
+		ss->batch_inflight ++;
+		g_mutex_unlock(&ss->batch_lock);
+		const int rc = _op_send(op);
+		if (rc != ZOK) {
+			_op_free(op);
+			_batch_release(ss);
+		}
+		return rc;
+	}
+
+	g_ptr_array_add(ss->batch, op);
+	if (ss->batch->len >= sqliterepo_zk_multi_max_ops) {
+		full = ss->batch;
+		ss->batch = g_ptr_array_new();
+		ss->batch_inflight ++;
+	}
+	g_mutex_unlock(&ss->batch_lock);
+
+	if (full)
+		_batch_send(ss, full);
+	return ZOK;
+}
+
+static void
+_batch_abort(struct sqlx_sync_s *ss, int rc)
+{
+	g_mutex_lock(&ss->batch_lock);
+	GPtrArray *ops = ss->batch;
+	ss->batch = g_ptr_array_new();
+	g_mutex_unlock(&ss->batch_lock);
+
+	for (guint i = 0; i < ops->len; i++)
+		_op_complete(ops->pdata[i], rc, NULL);
+	g_ptr_array_free(ops, TRUE);
+}
+
+static void _listing_done(int rc, const struct String_vector *sv,
+		const void *data);
+
+static void
+_listing_free(struct zk_listing_s *l)
+{
+	g_array_free(l->pending, TRUE);
+	g_array_free(l->queued, TRUE);
+	g_free(l->path);
+	g_free(l);
+}
+
+static int
+_listing_send(struct zk_listing_s *l)
+{
+	if (!l->ss->zh)
+		return ZINVALIDSTATE;
+	return zoo_awget_children(l->ss->zh, l->path, NULL, NULL,
+			_listing_done, l);
+}
+
+static void
+_listing_done(int rc, const struct String_vector *sv, const void *data)
+{
+	struct zk_listing_s *l = (struct zk_listing_s *) data;
+	struct sqlx_sync_s *ss = l->ss;
+
+	g_mutex_lock(&ss->batch_lock);
+	GArray *done = l->pending;
+	l->pending = l->queued;
+	l->queued = g_array_new(FALSE, FALSE, sizeof(struct zk_listing_waiter_s));
+	const gboolean again = l->pending->len > 0;
+	if (!again)
+		g_hash_table_remove(ss->listings, l->path);
+	g_mutex_unlock(&ss->batch_lock);
+
+	for (guint i = 0; i < done->len; i++) {
+		struct zk_listing_waiter_s *w =
+			&g_array_index(done, struct zk_listing_waiter_s, i);
+		w->completion(rc, sv, w->data);
+	}
+	g_array_free(done, TRUE);
+
+	if (!again) {
+		_listing_free(l);
+	} else {
+		const int rc_next = _listing_send(l);
+		if (rc_next != ZOK)
+			_listing_done(rc_next, NULL, l);
+	}
+}
+
+/* A pending listing may miss the changes made after it has been sent, so
+ * a new request only joins the next listing of the same node. */
+static int
+_listing_push(struct sqlx_sync_s *ss, const char *path,
+		strings_completion_t completion, const void *data)
+{
+	struct zk_listing_waiter_s w = {completion, data};
+
+	g_mutex_lock(&ss->batch_lock);
+	struct zk_listing_s *l = g_hash_table_lookup(ss->listings, path);
+	if (l) {
+		g_array_append_vals(l->queued, &w, 1);
+		g_mutex_unlock(&ss->batch_lock);
+		return ZOK;
+	}
+	l = g_malloc0(sizeof(*l));
+	l->ss = ss;
+	l->path = g_strdup(path);
+	l->pending = g_array_new(FALSE, FALSE, sizeof(struct zk_listing_waiter_s));
+	l->queued = g_array_new(FALSE, FALSE, sizeof(struct zk_listing_waiter_s));
+	g_array_append_vals(l->pending, &w, 1);
+	g_hash_table_insert(ss->listings, l->path, l);
+	g_mutex_unlock(&ss->batch_lock);
+
+	const int rc = _listing_send(l);
+	if (rc != ZOK) {
+		/* The caller manages the error, it must not be notified */
+		g_mutex_lock(&ss->batch_lock);
+		g_array_set_size(l->pending, 0);
+		g_mutex_unlock(&ss->batch_lock);
+		_listing_done(rc, NULL, l);
+	}
+	return rc;
+}
+
 static int
 _acreate (struct sqlx_sync_s *ss, const char *path, const char *v,
 		int vlen, int flags, string_completion_t completion, const void *data)
@@ -369,10 +747,21 @@ _acreate (struct sqlx_sync_s *ss, const char *path, const char *v,
 		return ZOPERATIONTIMEOUT;
 #endif
 	gchar p[PATH_MAXLEN];
-	int rc = zoo_acreate(ss->zh, _realpath(ss, path, p, sizeof(p)),
-			v, vlen, &ZOO_OPEN_ACL_UNSAFE,
-			flags, completion, data);
-	return rc;
+	_realpath(ss, path, p, sizeof(p));
+	if (sqliterepo_zk_multi_max_ops <= 1)
+		return zoo_acreate(ss->zh, p, v, vlen, &ZOO_OPEN_ACL_UNSAFE,
+				flags, completion, data);
+
+	struct zk_op_s *op = g_malloc0(sizeof(*op));
+	op->ss = ss;
+	op->type = ZOO_CREATE_OP;
+	op->flags = flags;
+	op->vlen = vlen;
+	op->value = (v && vlen > 0) ? g_memdup(v, vlen) : NULL;
+	op->create_done = completion;
+	op->data = data;
+	g_strlcpy(op->path, p, sizeof(op->path));
+	return _batch_push(ss, op);
 }
 
 static int
@@ -386,9 +775,18 @@ _adelete (struct sqlx_sync_s *ss, const char *path, int version,
 		return ZOPERATIONTIMEOUT;
 #endif
 	gchar p[PATH_MAXLEN];
-	int rc = zoo_adelete(ss->zh, _realpath(ss, path, p, sizeof(p)),
-			version, completion, data);
-	return rc;
+	_realpath(ss, path, p, sizeof(p));
+	if (sqliterepo_zk_multi_max_ops <= 1)
+		return zoo_adelete(ss->zh, p, version, completion, data);
+
+	struct zk_op_s *op = g_malloc0(sizeof(*op));
+	op->ss = ss;
+	op->type = ZOO_DELETE_OP;
+	op->version = version;
+	op->delete_done = completion;
+	op->data = data;
+	g_strlcpy(op->path, p, sizeof(op->path));
+	return _batch_push(ss, op);
 }
 
 static int
@@ -454,9 +852,12 @@ _awget_siblings (struct sqlx_sync_s *ss, const char *path,
 		return ZOPERATIONTIMEOUT;
 #endif
 	gchar p[PATH_MAXLEN];
-	int rc = zoo_awget_children(ss->zh, _realdirname(ss, path, p, sizeof(p)),
-			watcher, watcherCtx, completion, data);
-	return rc;
+	_realdirname(ss, path, p, sizeof(p));
+	/* The watchers cannot be shared */
+	if (watcher || !sqliterepo_zk_merge_listings)
+		return zoo_awget_children(ss->zh, p, watcher, watcherCtx,
+				completion, data);
+	return _listing_push(ss, p, completion, data);
 }
 
 static int
@@ -486,6 +887,24 @@ _aremove_all_watches(struct sqlx_sync_s *ss, const char *path,
 	return rc;
 }
 
+static gboolean
+_connected(struct sqlx_sync_s *ss)
+{
+	EXTRA_ASSERT(ss != NULL);
+	EXTRA_ASSERT(ss->vtable == &VTABLE);
+	return ss->zh != NULL && g_atomic_int_get(&ss->connected);
+}
+
+static gint64
+_session_timeout(struct sqlx_sync_s *ss)
+{
+	EXTRA_ASSERT(ss != NULL);
+	EXTRA_ASSERT(ss->vtable == &VTABLE);
+	if (!ss->zh)
+		return 0;
+	return (gint64) zoo_recv_timeout(ss->zh) * G_TIME_SPAN_MILLISECOND;
+}
+
 /* -------------------------------------------------------------------------- */
 
 #define SYNC_CALL(self,F) VTABLE_CALL(self,struct abstract_sqlx_sync_s*,F)
@@ -602,6 +1021,26 @@ sqlx_sync_aremove_all_watches(struct sqlx_sync_s *ss, const char *path,
 #endif
 }
 
+gboolean
+sqlx_sync_connected(struct sqlx_sync_s *ss)
+{
+#ifdef HAVE_EXTRA_DEBUG
+	SYNC_CALL(ss,connected)(ss);
+#else
+	return _connected(ss);
+#endif
+}
+
+gint64
+sqlx_sync_session_timeout(struct sqlx_sync_s *ss)
+{
+#ifdef HAVE_EXTRA_DEBUG
+	SYNC_CALL(ss,session_timeout)(ss);
+#else
+	return _session_timeout(ss);
+#endif
+}
+
 int
 sqlx_sync_uses_handle(struct sqlx_sync_s *ss, zhandle_t *zh)
 {
@@ -664,10 +1103,19 @@ static gboolean _direct_pipefrom (struct sqlx_peering_s *self,
 		guint reqid,
 		sqlx_peering_pipefrom_end_f result);
 
+static gboolean _direct_replicate (struct sqlx_peering_s *self,
+		/* in */
+		const char *url,
+		GByteArray *request,
+		/* out */
+		gpointer udata,
+		sqlx_peering_replicate_end_f result);
+
 struct sqlx_peering_vtable_s vtable_peering_DIRECT =
 {
 	_direct_destroy, _direct_notify,
-	_direct_use, _direct_getvers, _direct_pipefrom
+	_direct_use, _direct_getvers, _direct_pipefrom,
+	_direct_replicate
 };
 
 struct sqlx_peering_direct_s
@@ -1025,6 +1473,73 @@ _direct_getvers (struct sqlx_peering_s *self,
 	return TRUE;
 }
 
+struct evtclient_REPLICATE_s
+{
+	struct event_client_s ec;
+
+	sqlx_peering_replicate_end_f hook;
+	gpointer udata;
+};
+
+static void
+on_end_REPLICATE(struct evtclient_REPLICATE_s *mc)
+{
+	EXTRA_ASSERT(mc != NULL);
+	EXTRA_ASSERT(mc->ec.client != NULL);
+
+	GError *err = gridd_client_error(mc->ec.client);
+	/* The pool frees the clients on connection errors without failing
+	 * them: the request has not been acknowledged in that case. */
+	if (!err && !gridd_client_finished(mc->ec.client))
+		err = NEWERROR(CODE_NETWORK_ERROR, "Connection closed");
+	mc->hook(err, gridd_client_url(mc->ec.client), mc->udata);
+	if (err)
+		g_error_free(err);
+}
+
+static gboolean
+_direct_replicate (struct sqlx_peering_s *self,
+		/* in */
+		const char *url,
+		GByteArray *request,
+		/* out */
+		gpointer udata,
+		sqlx_peering_replicate_end_f result)
+{
+	struct sqlx_peering_direct_s *p = (struct sqlx_peering_direct_s*) self;
+	EXTRA_ASSERT(p != NULL && p->vtable == &vtable_peering_DIRECT);
+	EXTRA_ASSERT(url != NULL);
+	EXTRA_ASSERT(request != NULL);
+	EXTRA_ASSERT(result != NULL);
+
+	struct evtclient_REPLICATE_s *mc =
+		g_slice_alloc0(sizeof(struct evtclient_REPLICATE_s));
+	mc->ec.struct_size = sizeof(struct evtclient_REPLICATE_s);
+	mc->ec.client = gridd_client_create_empty ();
+	mc->ec.on_end = (gridd_client_end_f) on_end_REPLICATE;
+	mc->hook = result;
+	mc->udata = udata;
+
+	const gint64 deadline = oio_ext_get_deadline();
+	gridd_client_set_timeout_cnx(mc->ec.client,
+			oio_clamp_timeout(oio_election_replicate_timeout_cnx, deadline));
+	gridd_client_set_timeout(mc->ec.client,
+			oio_clamp_timeout(oio_election_replicate_timeout_req, deadline));
+
+	GError *err = gridd_client_connect_url (mc->ec.client, url);
+	if (err) {
+		gridd_client_fail(mc->ec.client, err);
+	} else {
+		err = gridd_client_request(mc->ec.client, request, NULL, NULL);
+		if (err) {
+			gridd_client_fail(mc->ec.client, err);
+		}
+	}
+	// See comment in _direct_getvers().
+	gridd_client_pool_defer(p->pool, &mc->ec);
+	return TRUE;
+}
+
 /* -------------------------------------------------------------------------- */
 
 #define PEER_CALL(self,F) VTABLE_CALL(self,struct sqlx_peering_abstract_s*,F)
@@ -1100,3 +1615,19 @@ sqlx_peering__pipefrom (struct sqlx_peering_s *self,
 	return _direct_pipefrom(self, url, n, src, check_type, m, reqid, result);
 #endif
 }
+
+gboolean
+sqlx_peering__replicate (struct sqlx_peering_s *self,
+		/* in */
+		const char *url,
+		GByteArray *request,
+		/* out */
+		gpointer udata,
+		sqlx_peering_replicate_end_f result)
+{
+#ifdef HAVE_EXTRA_DEBUG
+	PEER_CALL(self,replicate)(self, url, request, udata, result);
+#else
+	return _direct_replicate(self, url, request, udata, result);
+#endif
+}
@@ -74,6 +74,10 @@ struct sqlx_sync_vtable_s
 
 	int (*aremove_all_watches) (struct sqlx_sync_s *ss, const char *path,
 			void_completion_t completion, const void *data);
+
+	gboolean (*connected) (struct sqlx_sync_s *ss);
+
+	gint64 (*session_timeout) (struct sqlx_sync_s *ss);
 };
 
 struct abstract_sqlx_sync_s
@@ -112,6 +116,14 @@ int sqlx_sync_awget_siblings (struct sqlx_sync_s *ss, const char *path,
 int sqlx_sync_aremove_all_watches(struct sqlx_sync_s *ss, const char *path,
 		  void_completion_t completion, const void *data);
 
+/** Tell if the session with ZooKeeper is currently established, i.e. if the
+ * ephemeral nodes of the local service are still alive. */
+gboolean sqlx_sync_connected(struct sqlx_sync_s *ss);
+
+/** Tell the timeout (in microseconds) of the current ZooKeeper session, as
+ * negotiated with the server. 0 if there is no session. */
+gint64 sqlx_sync_session_timeout(struct sqlx_sync_s *ss);
+
 /** Initiates a sqlx synchronizer based on ZooKeeper.
  * @param url the Zookeeper connection string */
 struct sqlx_sync_s * sqlx_sync_create(const char *url);
@@ -151,6 +163,10 @@ typedef void (*sqlx_peering_getvers_end_f) (GError *e,
 		const char *reqid,
 		GTree *vremote);
 
+typedef void (*sqlx_peering_replicate_end_f) (GError *e,
+		const char *url,
+		gpointer udata);
+
 /* Represents what an election needs to communicate with its peers. */
 struct sqlx_peering_vtable_s
 {
@@ -188,6 +204,17 @@ struct sqlx_peering_vtable_s
 			struct election_member_s *m,
 			guint reqid,
 			sqlx_peering_pipefrom_end_f result);
+
+	/** Send an already encoded DB_REPLI request. The result hook is called
+	 * exactly once, even if the request could not be sent.
+	 * @return FALSE if no notify() is necessary (i.e. no command deferred) */
+	gboolean (*replicate) (struct sqlx_peering_s *self,
+			/* in */
+			const char *url,
+			GByteArray *request,
+			/* out */
+			gpointer udata,
+			sqlx_peering_replicate_end_f result);
 };
 
 struct sqlx_peering_abstract_s
@@ -227,6 +254,14 @@ gboolean sqlx_peering__pipefrom (struct sqlx_peering_s *self,
 		guint reqid,
 		sqlx_peering_pipefrom_end_f result);
 
+gboolean sqlx_peering__replicate (struct sqlx_peering_s *self,
+		/* in */
+		const char *url,
+		GByteArray *request,
+		/* out */
+		gpointer udata,
+		sqlx_peering_replicate_end_f result);
+
 struct sqlx_peering_s * sqlx_peering_factory__create_direct (
 		struct gridd_client_pool_s *clipool);
 
@@ -1018,7 +1018,6 @@ _worker_timers(gpointer p)
 		/* A little bias avoids looping too often */
 		const gint64 bias = G_TIME_SPAN_MILLISECOND;
 		election_manager_play_timers(M, oio_ext_monotonic_time() + bias);
-		election_manager_play_expirations(M, oio_ext_monotonic_time() + bias);
 
 		/* wait for the next timer */
 		const gint64 now = oio_ext_monotonic_time();
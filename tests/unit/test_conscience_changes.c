@@ -0,0 +1,173 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <metautils/lib/metautils.h>
+
+#define main _conscience_main
+#include "../../cluster/module/server.c"
+#undef main
+
+#define TYPE "echo"
+
+static struct service_info_s *
+_si (guint port, gint32 score)
+{
+	gchar url[64];
+	g_snprintf(url, sizeof(url), "127.0.0.1:%u", port);
+	struct service_info_s *si = g_malloc0(sizeof(*si));
+	g_strlcpy(si->ns_name, "NS", sizeof(si->ns_name));
+	g_strlcpy(si->type, TYPE, sizeof(si->type));
+	g_assert_true(grid_string_to_addrinfo(url, &si->addr));
+	si->put_score.value = si->get_score.value = score;
+	si->tags = g_ptr_array_new();
+	return si;
+}
+
+static void
+_push (guint port, gint32 score)
+{
+	GPtrArray *sis = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)service_info_clean);
+	g_ptr_array_add(sis, _si(port, score));
+	g_assert_cmpuint(1, ==, push_services(sis, NULL));
+	g_ptr_array_free(sis, TRUE);
+}
+
+static void
+_remove (guint port)
+{
+	struct service_info_s *si = _si(port, 0);
+	service_info_dated_free(rm_service(si));
+	service_info_clean(si);
+}
+
+/* The changes since <token>: the services changed, the services removed
+ * (-1 for a full list) and the new generation. */
+static guint
+_changes (const gchar *token, gint *removed, gchar **generation)
+{
+	GByteArray *body = g_byte_array_new();
+	g_byte_array_append(body, header, 2);
+	GByteArray *gba = NULL;
+	GError *err = conscience_run_srvtype_changes(TYPE, token, body,
+			&gba, generation);
+	g_assert_no_error(err);
+	g_byte_array_append(body, footer, 2);
+
+	GSList *l = NULL;
+	g_assert_cmpint(0, <, service_info_unmarshall(&l, body->data, body->len, &err));
+	g_assert_no_error(err);
+	const guint changed = g_slist_length(l);
+	g_slist_free_full(l, (GDestroyNotify)service_info_clean);
+	g_byte_array_free(body, TRUE);
+
+	*removed = -1;
+	if (gba) {
+		l = NULL;
+		g_assert_cmpint(0, <, service_info_unmarshall(&l, gba->data, gba->len, &err));
+		g_assert_no_error(err);
+		*removed = g_slist_length(l);
+		g_slist_free_full(l, (GDestroyNotify)service_info_clean);
+		g_byte_array_free(gba, TRUE);
+	}
+	return changed;
+}
+
+static void
+test_changes (void)
+{
+	gchar *g0 = NULL, *g1 = NULL, *g2 = NULL, *g3 = NULL, *g = NULL;
+	gint removed = 0;
+
+	_push(6000, 50);
+	_push(6001, 50);
+
+	/* Unknown tokens get the full list */
+	g_assert_cmpuint(2, ==, _changes("0", &removed, &g0));
+	g_assert_cmpint(-1, ==, removed);
+	g_assert_cmpuint(2, ==, _changes("1.0", &removed, &g));
+	g_assert_cmpint(-1, ==, removed);
+	g_free(g);
+
+	/* Nothing changed */
+	g_assert_cmpuint(0, ==, _changes(g0, &removed, &g1));
+	g_assert_cmpint(0, ==, removed);
+	g_assert_cmpstr(g0, ==, g1);
+	g_free(g1);
+
+	/* The same registration changes nothing, a new score does */
+	_push(6000, 50);
+	g_assert_cmpuint(0, ==, _changes(g0, &removed, &g));
+	g_free(g);
+	_push(6001, 60);
+	_push(6002, 50);
+	g_assert_cmpuint(2, ==, _changes(g0, &removed, &g2));
+	g_assert_cmpint(0, ==, removed);
+	g_assert_cmpuint(0, ==, _changes(g2, &removed, &g));
+	g_free(g);
+
+	/* A removal is only sent to the clients that knew the service */
+	_remove(6000);
+	g_assert_cmpuint(0, ==, _changes(g2, &removed, &g3));
+	g_assert_cmpint(1, ==, removed);
+	g_assert_cmpuint(2, ==, _changes(g0, &removed, &g));
+	g_assert_cmpint(1, ==, removed);
+	g_free(g);
+	g_assert_cmpuint(0, ==, _changes(g3, &removed, &g));
+	g_assert_cmpint(0, ==, removed);
+	g_free(g);
+
+	/* A generation from the future is not trusted */
+	g = _srv_generation_encode(G_MAXUINT64);
+	g_assert_cmpuint(2, ==, _changes(g, &removed, &g1));
+	g_assert_cmpint(-1, ==, removed);
+	g_free(g);
+	g_free(g1);
+
+	/* Too many removals are forgotten, the clients reload everything */
+	for (guint i = 0; i <= MAX_REMOVED_SERVICES; i++) {
+		_push(7000 + i, 50);
+		_remove(7000 + i);
+	}
+	g_assert_cmpuint(2, ==, _changes(g3, &removed, &g));
+	g_assert_cmpint(-1, ==, removed);
+	g_free(g);
+
+	g_free(g0);
+	g_free(g2);
+	g_free(g3);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	oio_server_namespace = "NS";
+	srv_generation_epoch = 0x0123456789ABCDEFULL;
+	g_rw_lock_init(&rwlock_srv);
+	srvtypes = g_tree_new_full(metautils_strcmp3, NULL,
+			g_free, (GDestroyNotify) conscience_srvtype_destroy);
+	g_assert_nonnull(conscience_get_srvtype(TYPE, TRUE));
+
+	g_test_add_func("/conscience/changes", test_changes);
+	int rc = g_test_run();
+
+	g_tree_destroy(srvtypes);
+	g_rw_lock_clear(&rwlock_srv);
+	return rc;
+}
@@ -0,0 +1,194 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <math.h>
+
+#include <metautils/lib/metautils.h>
+#include <cluster/module/expr.h>
+
+static const char * const bases[] = {"stat", "tag", NULL};
+
+static const char *expressions[] = {
+	"100",
+	"(num stat.cpu)",
+	"1 + (num stat.cpu)",
+	"((num stat.cpu)>0) * ((num stat.io)>0) * ((num stat.space)>1) * root(3,((num stat.cpu)*(num stat.space)*(num stat.io)))",
+	"(num tag.up) * root(4, (pow(2, (clamp((((num stat.space) - 1) * 1.010101), 0, 100))) * clamp((((num stat.cpu) - 5) * 6.666667), 1, 100) * clamp((((num stat.io) - 5) * 1.333333), 1, 100)))",
+	"root(3, (num stat.cpu) * (num stat.space) * (100 - root(3, (num stat.jobs_ready))))",
+	"(num stat.missing : \"42\") + (num stat.missing : \"x\")",
+	"(num foo.bar : \"42\") + 1",
+	"(tag.loc == \"rack1\") * 10 + (tag.loc == tag.vol)",
+	"(tag.missing : \"abc\") + (foo.bar : \"ab\") + \"abcd\"",
+	"num \"12.5\" + num \"x\"",
+	"(num stat.cpu) / ((num stat.io) - (num stat.io))",
+	"((num stat.cpu) <N> 50) + ((num stat.cpu) < 50) + ((num stat.cpu) >= 50)",
+	"((num stat.cpu) == 50) + ((num stat.cpu) != 50) + ((num stat.space) > 1)",
+	"((num tag.up) * 3) + ((num stat.cpu) - 70) + ((num stat.io) * 2) + ((num stat.space) / 4)",
+	"(num stat.cpu) + (num tag.loc)",
+	NULL
+};
+
+static GPtrArray *tags = NULL;
+
+static gchar *
+_get_field(const char *b, const char *f)
+{
+	gchar *name = g_strdup_printf("%s.%s", b, f);
+	struct service_tag_s *tag = service_info_get_tag(tags, name);
+	g_free(name);
+	if (!tag)
+		return NULL;
+	switch (tag->type) {
+	case STVT_I64:
+		return g_strdup_printf("%"G_GINT64_FORMAT, tag->value.i);
+	case STVT_REAL:
+		return g_strdup_printf("%f", tag->value.r);
+	case STVT_BOOL:
+		return g_strdup_printf("%d", tag->value.b ? 1 : 0);
+	case STVT_STR:
+		return g_strdup(tag->value.s);
+	case STVT_BUF:
+		return g_strdup(tag->value.buf);
+	}
+	return NULL;
+}
+
+static gchar * _get_stat(const char *f) { return _get_field("stat", f); }
+
+static gchar * _get_tag(const char *f) { return _get_field("tag", f); }
+
+static accessor_f *
+_get_acc(const char *b)
+{
+	if (!strcmp(b, "stat"))
+		return _get_stat;
+	if (!strcmp(b, "tag"))
+		return _get_tag;
+	return NULL;
+}
+
+static void
+_check_equivalence(void)
+{
+	for (const char **pexpr = expressions; *pexpr; pexpr++) {
+		struct expr_s *pE = NULL;
+		g_assert_cmpint(0, ==, expr_parse(*pexpr, &pE));
+		struct expr_prog_s *prog = NULL;
+		g_assert_cmpint(0, ==, expr_compile(pE, bases, &prog));
+
+		const guint count = expr_prog_count_slots(prog);
+		const struct service_tag_s *slots[count + 1];
+		for (guint i = 0; i < count; i++)
+			slots[i] = service_info_get_tag(tags, expr_prog_get_slot(prog, i));
+
+		gdouble d0 = 0, d1 = 0;
+		const int rc0 = expr_evaluate(&d0, pE, _get_acc);
+		const int rc1 = expr_prog_evaluate(&d1, prog, slots);
+		g_assert_cmpint(rc0, ==, rc1);
+		if (rc0 == EXPR_EVAL_DEF) {
+			if (isnan(d0))
+				g_assert_true(isnan(d1));
+			else
+				g_assert_cmpfloat(d0, ==, d1);
+		}
+
+		expr_prog_clean(prog);
+		expr_clean(pE);
+	}
+}
+
+static void
+_set_stats(gint64 cpu, gdouble io, const gchar *space)
+{
+	service_tag_set_value_i64(service_info_ensure_tag(tags, "stat.cpu"), cpu);
+	service_tag_set_value_float(service_info_ensure_tag(tags, "stat.io"), io);
+	service_tag_set_value_string(service_info_ensure_tag(tags, "stat.space"), space);
+}
+
+static void
+test_compiled_equivalence(void)
+{
+	tags = g_ptr_array_new_with_free_func((GDestroyNotify)service_tag_destroy);
+
+	/* No tag at all */
+	_check_equivalence();
+
+	service_tag_set_value_boolean(service_info_ensure_tag(tags, "tag.up"), TRUE);
+	service_tag_set_value_string(service_info_ensure_tag(tags, "tag.loc"), "rack1");
+	service_tag_set_value_string(service_info_ensure_tag(tags, "tag.vol"), "/var/lib");
+	service_tag_set_value_i64(service_info_ensure_tag(tags, "stat.jobs_ready"), 27);
+	_set_stats(0, 0, "0");
+	_check_equivalence();
+	_set_stats(50, 50.0, "50");
+	_check_equivalence();
+	_set_stats(97, 12.5, "3.25");
+	_check_equivalence();
+	_set_stats(-3, -0.125, "not a number");
+	_check_equivalence();
+	_set_stats(G_MAXINT32, 1e12, "");
+	_check_equivalence();
+
+	service_tag_set_value_boolean(service_info_ensure_tag(tags, "tag.up"), FALSE);
+	service_tag_set_value_string(service_info_ensure_tag(tags, "tag.vol"), "rack1");
+	_check_equivalence();
+
+	g_ptr_array_free(tags, TRUE);
+	tags = NULL;
+}
+
+static void
+test_compiled_slots(void)
+{
+	struct expr_s *pE = NULL;
+	g_assert_cmpint(0, ==, expr_parse(
+				"(num stat.cpu) * (num stat.cpu) + (num foo.bar : \"1\")"
+				" + (num tag.up : \"1\")", &pE));
+	struct expr_prog_s *prog = NULL;
+	g_assert_cmpint(0, ==, expr_compile(pE, bases, &prog));
+
+	/* Each accessor once, the unknown bases are not resolved */
+	g_assert_cmpuint(2, ==, expr_prog_count_slots(prog));
+	g_assert_cmpstr("stat.cpu", ==, expr_prog_get_slot(prog, 0));
+	g_assert_cmpstr("tag.up", ==, expr_prog_get_slot(prog, 1));
+
+	GPtrArray *a = g_ptr_array_new_with_free_func((GDestroyNotify)service_tag_destroy);
+	struct service_tag_s *cpu = service_info_ensure_tag(a, "stat.cpu");
+	service_tag_set_value_float(cpu, 4.5);
+	const struct service_tag_s *slots[2] = {cpu, NULL};
+	gdouble d = 0;
+	g_assert_cmpint(EXPR_EVAL_DEF, ==, expr_prog_evaluate(&d, prog, slots));
+	g_assert_cmpfloat(d, ==, 4.5 * 4.5 + 0 + 1);
+
+	slots[0] = NULL;
+	g_assert_cmpint(EXPR_EVAL_UNDEF, ==, expr_prog_evaluate(&d, prog, slots));
+
+	g_ptr_array_free(a, TRUE);
+	expr_prog_clean(prog);
+	expr_clean(pE);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/conscience/expr/compiled/equivalence",
+			test_compiled_equivalence);
+	g_test_add_func("/conscience/expr/compiled/slots",
+			test_compiled_slots);
+	return g_test_run();
+}
@@ -0,0 +1,276 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <string.h>
+
+#include <glib.h>
+#include <core/oiostr.h>
+#include <core/ec.h>
+#include <core/internals.h>
+#include <metautils/lib/metautils.h>
+
+/* Encode a segment into its k+m fragments, headers included */
+static guint8 **
+_encode (struct oio_ec_s *ec, const guint8 *seg, gsize seg_size,
+		gsize *frag_size)
+{
+	const guint k = oio_ec_get_k(ec), m = oio_ec_get_m(ec);
+	const gsize fs = oio_ec_get_fragment_size(ec, seg_size);
+	const gsize bs = fs - OIO_EC_HEADER_SIZE;
+
+	guint8 **frags = g_malloc0((k + m + 1) * sizeof(guint8*));
+	const guint8 *data[k];
+	guint8 *parity[m];
+	for (guint i = 0; i < k + m; i++) {
+		frags[i] = g_malloc0(fs);
+		const struct oio_ec_header_s hdr = {i, bs, seg_size};
+		oio_ec_header_pack(ec, &hdr, frags[i]);
+		if (i < k) {
+			const gsize offset = i * bs;
+			if (offset < seg_size)
+				memcpy(frags[i] + OIO_EC_HEADER_SIZE, seg + offset,
+						MIN(bs, seg_size - offset));
+			data[i] = frags[i] + OIO_EC_HEADER_SIZE;
+		} else {
+			parity[i - k] = frags[i] + OIO_EC_HEADER_SIZE;
+		}
+	}
+	oio_ec_encode(ec, data, parity, bs);
+	*frag_size = fs;
+	return frags;
+}
+
+static void
+_check_roundtrip (const char *chunk_method, gsize seg_size)
+{
+	struct oio_ec_s *ec = NULL;
+	GError *err = oio_ec_create(chunk_method, &ec);
+	g_assert_no_error(err);
+	const guint k = oio_ec_get_k(ec), m = oio_ec_get_m(ec), n = k + m;
+
+	guint8 *seg = g_malloc(seg_size);
+	oio_buf_randomize(seg, seg_size);
+	gsize fs = 0;
+	guint8 **frags = _encode(ec, seg, seg_size, &fs);
+
+	/* Any pattern of at most m missing fragments */
+	for (guint mask = 0; mask < (1U << n); mask++) {
+		const guint missing = __builtin_popcount(mask);
+		const guint8 *present[n];
+		for (guint i = 0; i < n; i++)
+			present[i] = (mask & (1U << i)) ? NULL : frags[i];
+		GByteArray *out = g_byte_array_new();
+		err = oio_ec_decode(ec, present, fs, out);
+		if (missing > m) {
+			g_assert_nonnull(err);
+			g_clear_error(&err);
+		} else {
+			g_assert_no_error(err);
+			g_assert_cmpuint(out->len, ==, seg_size);
+			g_assert_cmpint(0, ==, memcmp(out->data, seg, seg_size));
+		}
+		g_byte_array_free(out, TRUE);
+	}
+
+	/* A corrupted header is detected */
+	frags[0][0] ^= 0xFF;
+	GByteArray *out = g_byte_array_new();
+	err = oio_ec_decode(ec, (const guint8 * const *)frags, fs, out);
+	g_assert_nonnull(err);
+	g_assert_cmpint(err->code, ==, CODE_CONTENT_CORRUPTED);
+	g_clear_error(&err);
+	g_byte_array_free(out, TRUE);
+
+	g_strfreev((gchar**)frags);
+	g_free(seg);
+	oio_ec_destroy(ec);
+}
+
+/* The fragments of "liberasurecode/isa-l", with k=3 and m=2, as written by
+ * liberasurecode 1.6.2 and its backends: isa-l 2.14 and its own rs_vand,
+ * without checksum of the data. Each is the header then the block.
+ * XXX They still come from a model of liberasurecode written apart from
+ * ec.c, not from the library itself: replace them with the output of
+ * tools/oio-ec-known-answers.py run against liberasurecode 1.6.2. */
+static const struct {
+	const char *chunk_method;
+	const char *frags[5];
+} known_answers[] = {
+	{"ec/k=3,m=2,algo=liberasurecode_rs_vand", {
+		"00000000080000000000000014000000000000000100000000000000000000000000000000000000"
+		"00000000000000000000000000000600000100CC5E0C0B020601006688D4C9000000000000000000"
+		"6C69626572617375",
+		"01000000080000000000000014000000000000000100000000000000000000000000000000000000"
+		"00000000000000000000000000000600000100CC5E0C0B020601005675A28A000000000000000000"
+		"7265636F64652F69",
+		"02000000080000000000000014000000000000000100000000000000000000000000000000000000"
+		"00000000000000000000000000000600000100CC5E0C0B02060100C5AB1C67000000000000000000"
+		"73612D6C00000000",
+		"03000000080000000000000014000000000000000100000000000000000000000000000000000000"
+		"00000000000000000000000000000600000100CC5E0C0B02060100F5566A24000000000000000000"
+		"6D6D2C6616045C1C",
+		"04000000080000000000000014000000000000000100000000000000000000000000000000000000"
+		"00000000000000000000000000000600000100CC5E0C0B02060100A6E96252000000000000000000"
+		"ECA476A088534FED"
+	}},
+	{"ec/k=3,m=2,algo=isa_l_rs_vand", {
+		"00000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000004000E0200CC5E0C0B02060100F8344A2A000000000000000000"
+		"6C696265726173",
+		"01000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000004000E0200CC5E0C0B02060100C8C93C69000000000000000000"
+		"757265636F6465",
+		"02000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000004000E0200CC5E0C0B020601005B178284000000000000000000"
+		"2F6973612D6C00",
+		"03000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000004000E0200CC5E0C0B020601006BEAF4C7000000000000000000"
+		"36727467306916",
+		"04000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000004000E0200CC5E0C0B020601003855FCB1000000000000000000"
+		"3A34793A1804B9"
+	}},
+	{"ec/k=3,m=2,algo=isa_l_rs_cauchy", {
+		"00000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000007000E0200CC5E0C0B02060100D7B11592000000000000000000"
+		"6C696265726173",
+		"01000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000007000E0200CC5E0C0B02060100E74C63D1000000000000000000"
+		"757265636F6465",
+		"02000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000007000E0200CC5E0C0B020601007492DD3C000000000000000000"
+		"2F6973612D6C00",
+		"03000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000007000E0200CC5E0C0B02060100446FAB7F000000000000000000"
+		"BF771AFDBA8A66",
+		"04000000070000000000000014000000000000000100000000000000000000000000000000000000"
+		"000000000000000000000000000007000E0200CC5E0C0B0206010017D0A309000000000000000000"
+		"24DA112BF9003F"
+	}},
+};
+
+static void
+test_known_answers (void)
+{
+	static const char seg[] = "liberasurecode/isa-l";
+	const gsize seg_size = sizeof(seg) - 1;
+
+	for (guint t = 0; t < G_N_ELEMENTS(known_answers); t++) {
+		struct oio_ec_s *ec = NULL;
+		GError *err = oio_ec_create(known_answers[t].chunk_method, &ec);
+		g_assert_no_error(err);
+		const guint n = oio_ec_get_k(ec) + oio_ec_get_m(ec);
+		g_assert_cmpuint(n, ==, G_N_ELEMENTS(known_answers[t].frags));
+
+		/* Encoded byte for byte, headers included */
+		gsize fs = 0;
+		guint8 **frags = _encode(ec, (const guint8*) seg, seg_size, &fs);
+		guint8 *expected[n];
+		for (guint i = 0; i < n; i++) {
+			const char *hex = known_answers[t].frags[i];
+			g_assert_cmpuint(strlen(hex), ==, 2 * fs);
+			expected[i] = g_malloc(fs);
+			g_assert_true(oio_str_hex2bin(hex, expected[i], fs));
+			g_assert_cmpint(0, ==, memcmp(frags[i], expected[i], fs));
+		}
+
+		/* Decoded without the first data fragments */
+		const guint8 *present[n];
+		for (guint i = 0; i < n; i++)
+			present[i] = i < 2 ? NULL : expected[i];
+		GByteArray *out = g_byte_array_new();
+		err = oio_ec_decode(ec, present, fs, out);
+		g_assert_no_error(err);
+		g_assert_cmpuint(out->len, ==, seg_size);
+		g_assert_cmpint(0, ==, memcmp(out->data, seg, seg_size));
+		g_byte_array_free(out, TRUE);
+
+		/* The metadata checksum covers the version of the backend */
+		struct oio_ec_header_s hdr = {0};
+		g_assert_true(oio_ec_header_parse(expected[2], &hdr));
+		g_assert_cmpuint(hdr.index, ==, 2);
+		g_assert_cmpuint(hdr.size, ==, fs - OIO_EC_HEADER_SIZE);
+		g_assert_cmpuint(hdr.orig_data_size, ==, seg_size);
+		expected[2][55] ^= 0x01;
+		g_assert_false(oio_ec_header_parse(expected[2], &hdr));
+
+		for (guint i = 0; i < n; i++)
+			g_free(expected[i]);
+		g_strfreev((gchar**)frags);
+		oio_ec_destroy(ec);
+	}
+}
+
+/* liberasurecode >= 1.6.3 writes the metadata checksum of zlib */
+static void
+test_header_checksum (void)
+{
+	guint8 raw[OIO_EC_HEADER_SIZE];
+	gchar *hex = g_strndup(known_answers[0].frags[0], 2 * sizeof(raw));
+	g_assert_true(oio_str_hex2bin(hex, raw, sizeof(raw)));
+	g_free(hex);
+	g_assert_true(oio_str_hex2bin("E9BECB8A", raw + 67, 4));
+
+	struct oio_ec_header_s hdr = {0};
+	g_assert_true(oio_ec_header_parse(raw, &hdr));
+	g_assert_cmpuint(hdr.size, ==, 8);
+	g_assert_cmpuint(hdr.orig_data_size, ==, 20);
+	raw[67] ^= 0x01;
+	g_assert_false(oio_ec_header_parse(raw, &hdr));
+}
+
+static void
+test_roundtrip (void)
+{
+	_check_roundtrip("ec/k=6,m=3,algo=liberasurecode_rs_vand,distance=1", 100001);
+	_check_roundtrip("ec/k=12,m=4,algo=liberasurecode_rs_vand", 999);
+	_check_roundtrip("ec/k=4,m=2,algo=isa_l_rs_vand", 65536);
+	_check_roundtrip("ec/k=8,m=4,algo=isa_l_rs_cauchy", 12345);
+}
+
+static void
+test_create (void)
+{
+	struct oio_ec_s *ec = NULL;
+	GError *err = oio_ec_create("ec/k=6,m=3,algo=jerasure_rs_vand", &ec);
+	g_assert_nonnull(err);
+	g_assert_cmpint(err->code, ==, CODE_NOT_IMPLEMENTED);
+	g_clear_error(&err);
+	err = oio_ec_create("plain/nb_copy=3", &ec);
+	g_assert_nonnull(err);
+	g_assert_cmpint(err->code, ==, CODE_BAD_REQUEST);
+	g_clear_error(&err);
+
+	err = oio_ec_create("ec/k=6,m=3,algo=isa_l_rs_vand,ec_segment_size=4096", &ec);
+	g_assert_no_error(err);
+	g_assert_cmpuint(4096, ==, oio_ec_get_segment_size(ec));
+	g_assert_cmpuint(OIO_EC_HEADER_SIZE + 683, ==,
+			oio_ec_get_fragment_size(ec, 4096));
+	oio_ec_destroy(ec);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/core/ec/create", test_create);
+	g_test_add_func("/core/ec/roundtrip", test_roundtrip);
+	g_test_add_func("/core/ec/known_answers", test_known_answers);
+	g_test_add_func("/core/ec/header/checksum", test_header_checksum);
+	return g_test_run();
+}
@@ -0,0 +1,166 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <glib.h>
+
+#include <core/oio_core.h>
+#include "../../events/oio_events_queue_ring.c"
+
+#define PRODUCERS 4
+
+static void
+test_ring_basic(void)
+{
+	struct oio_events_ring_s *r = oio_events_ring_create(4);
+	g_assert_cmpint(0, ==, oio_events_ring_length(r));
+	g_assert_null(oio_events_ring_pop(r, 0));
+	g_assert_null(oio_events_ring_pop(r, 10 * G_TIME_SPAN_MILLISECOND));
+
+	/* More than the capacity: the extra items overflow, in order */
+	for (guintptr i = 1; i <= 10; i++)
+		oio_events_ring_push(r, GUINT_TO_POINTER(i));
+	g_assert_cmpint(10, ==, oio_events_ring_length(r));
+
+	g_assert_cmpuint(1, ==, GPOINTER_TO_UINT(oio_events_ring_pop(r, 0)));
+	oio_events_ring_push_front(r, GUINT_TO_POINTER(1));
+	g_assert_cmpint(10, ==, oio_events_ring_length(r));
+
+	gpointer tab[16];
+	g_assert_cmpuint(3, ==, oio_events_ring_pop_batch(r, tab, 3, 0));
+	for (guint i = 0; i < 3; i++)
+		g_assert_cmpuint(i + 1, ==, GPOINTER_TO_UINT(tab[i]));
+	g_assert_cmpuint(7, ==, oio_events_ring_pop_batch(r, tab, 16, 0));
+	for (guint i = 0; i < 7; i++)
+		g_assert_cmpuint(i + 4, ==, GPOINTER_TO_UINT(tab[i]));
+	g_assert_cmpint(0, ==, oio_events_ring_length(r));
+
+	oio_events_ring_destroy(r);
+}
+
+static gpointer
+_publish_late(gpointer p)
+{
+	struct oio_events_ring_s *r = p;
+	g_usleep(50 * G_TIME_SPAN_MILLISECOND);
+	struct _ring_slot_s *s = r->slots + (1 & r->mask);
+	s->item = GUINT_TO_POINTER(2);
+	__atomic_store_n(&s->seq, 2, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/* A slot claimed by a producer is served before the overflow, even if it
+ * is published late. */
+static void
+test_ring_pending_slot(void)
+{
+	struct oio_events_ring_s *r = oio_events_ring_create(4);
+	oio_events_ring_push(r, GUINT_TO_POINTER(1));
+	/* claim the next slot, as a producer about to publish */
+	__atomic_store_n(&r->head, 2, __ATOMIC_RELEASE);
+	g_mutex_lock(&r->lock);
+	g_queue_push_tail(&r->overflow, GUINT_TO_POINTER(3));
+	g_atomic_int_inc(&r->overflow_len);
+	g_mutex_unlock(&r->lock);
+
+	GThread *th = g_thread_new("producer", _publish_late, r);
+	for (guint i = 1; i <= 3; i++)
+		g_assert_cmpuint(i, ==, GPOINTER_TO_UINT(oio_events_ring_pop(r, 0)));
+	g_assert_null(oio_events_ring_pop(r, 0));
+	g_thread_join(th);
+	oio_events_ring_destroy(r);
+}
+
+struct producer_s
+{
+	struct oio_events_ring_s *ring;
+	guint id;
+	guint count;
+};
+
+static gpointer
+_produce(gpointer p)
+{
+	struct producer_s *prod = p;
+	for (guint i = 1; i <= prod->count; i++) {
+		guint64 *item = g_malloc(sizeof(guint64));
+		*item = ((guint64)prod->id << 32) | i;
+		oio_events_ring_push(prod->ring, item);
+	}
+	return NULL;
+}
+
+/* Each producer's items are received in order, none is lost, even when
+ * the ring overflows. */
+static void
+_test_ring_concurrent(guint capacity)
+{
+	const guint count = g_test_thorough() ? 1000000 : 100000;
+	struct oio_events_ring_s *r = oio_events_ring_create(capacity);
+	struct producer_s prod[PRODUCERS];
+	GThread *th[PRODUCERS];
+	for (guint i = 0; i < PRODUCERS; i++) {
+		prod[i].ring = r;
+		prod[i].id = i;
+		prod[i].count = count;
+		th[i] = g_thread_new("producer", _produce, prod + i);
+	}
+
+	guint last[PRODUCERS] = {0};
+	guint64 total = 0;
+	gpointer tab[256];
+	while (total < (guint64)count * PRODUCERS) {
+		const guint n = oio_events_ring_pop_batch(r, tab, 256, G_TIME_SPAN_SECOND);
+		g_assert_cmpuint(n, >, 0);
+		for (guint i = 0; i < n; i++) {
+			guint64 *item = tab[i];
+			const guint id = *item >> 32, seq = *item & 0xFFFFFFFF;
+			g_assert_cmpuint(seq, ==, last[id] + 1);
+			last[id] = seq;
+			g_free(item);
+		}
+		total += n;
+	}
+
+	for (guint i = 0; i < PRODUCERS; i++)
+		g_thread_join(th[i]);
+	g_assert_cmpint(0, ==, oio_events_ring_length(r));
+	oio_events_ring_destroy(r);
+}
+
+static void
+test_ring_concurrent(void)
+{
+	_test_ring_concurrent(1024);
+}
+
+static void
+test_ring_concurrent_overflow(void)
+{
+	_test_ring_concurrent(8);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/events/ring/basic", test_ring_basic);
+	g_test_add_func("/events/ring/pending", test_ring_pending_slot);
+	g_test_add_func("/events/ring/concurrent", test_ring_concurrent);
+	g_test_add_func("/events/ring/overflow", test_ring_concurrent_overflow);
+	return g_test_run();
+}
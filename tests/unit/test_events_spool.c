@@ -0,0 +1,242 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <core/oio_core.h>
+#include <core/internals.h>
+#include <events/events_variables.h>
+#include <events/oio_events_queue_spool.h>
+
+struct replayed_s
+{
+	GPtrArray *keys;
+	GPtrArray *msgs;
+};
+
+static void
+_collect(gchar *key, gchar *msg, gpointer u)
+{
+	struct replayed_s *r = u;
+	g_ptr_array_add(r->keys, key);
+	g_ptr_array_add(r->msgs, msg);
+}
+
+static void
+_replayed_init(struct replayed_s *r)
+{
+	r->keys = g_ptr_array_new_with_free_func(g_free);
+	r->msgs = g_ptr_array_new_with_free_func(g_free);
+}
+
+static void
+_replayed_clean(struct replayed_s *r)
+{
+	g_ptr_array_free(r->keys, TRUE);
+	g_ptr_array_free(r->msgs, TRUE);
+}
+
+static void
+_rm_spool(gchar *dir, const gchar *name)
+{
+	gchar *path = g_build_filename(dir, name, "lock", NULL);
+	g_unlink(path);
+	g_free(path);
+	path = g_build_filename(dir, name, NULL);
+	g_rmdir(path);
+	g_free(path);
+	g_rmdir(dir);
+	g_free(dir);
+}
+
+static void
+test_spool_order(void)
+{
+	gchar *dir = g_dir_make_tmp("spool-XXXXXX", NULL);
+	g_assert_nonnull(dir);
+	/* Rotate often */
+	oio_events_spool_segment_size = 64;
+
+	struct oio_events_spool_s *s = NULL;
+	GError *err = oio_events_spool_open(dir, "oio/events", &s);
+	g_assert_no_error(err);
+	g_assert_false(oio_events_spool_is_active(s));
+
+	/* Not forced while inactive */
+	g_assert_false(oio_events_spool_offer(s, NULL, "{}", FALSE));
+	for (guint i = 0; i < 32; i++) {
+		gchar *msg = g_strdup_printf("{\"event\":%u}", i);
+		g_assert_true(oio_events_spool_offer(s,
+					i % 2 ? "key" : NULL, msg, i == 0));
+		g_free(msg);
+	}
+	g_assert_true(oio_events_spool_is_active(s));
+	g_assert_cmpuint(oio_events_spool_size(s), >, 0);
+	oio_events_spool_sync(s);
+
+	/* The spool is locked */
+	struct oio_events_spool_s *other = NULL;
+	err = oio_events_spool_open(dir, "oio/events", &other);
+	g_assert_nonnull(err);
+	g_assert_cmpint(err->code, ==, CODE_UNAVAILABLE);
+	g_clear_error(&err);
+
+	struct replayed_s r;
+	_replayed_init(&r);
+	g_assert_cmpuint(10, ==, oio_events_spool_replay(s, 10, _collect, &r));
+	g_assert_true(oio_events_spool_is_active(s));
+	oio_events_spool_close(s);
+
+	/* What has not been replayed is found again */
+	err = oio_events_spool_open(dir, "oio/events", &s);
+	g_assert_no_error(err);
+	g_assert_true(oio_events_spool_is_active(s));
+	g_assert_true(oio_events_spool_offer(s, "last", "{\"event\":32}", FALSE));
+	while (oio_events_spool_replay(s, 7, _collect, &r) > 0) {}
+	g_assert_false(oio_events_spool_is_active(s));
+	g_assert_cmpuint(0, ==, oio_events_spool_size(s));
+
+	/* In order, and the segment replayed before the restart is replayed
+	 * again from its beginning. */
+	g_assert_cmpuint(r.msgs->len, >=, 33);
+	g_assert_cmpuint(r.msgs->len, <=, 43);
+	const guint restart = 33 - (r.msgs->len - 10);
+	for (guint i = 0; i < r.msgs->len; i++) {
+		const guint expected = i < 10 ? i : restart + i - 10;
+		gchar *msg = g_strdup_printf("{\"event\":%u}", expected);
+		g_assert_cmpstr(msg, ==, r.msgs->pdata[i]);
+		g_free(msg);
+		if (expected == 32)
+			g_assert_cmpstr("last", ==, r.keys->pdata[i]);
+		else if (expected % 2)
+			g_assert_cmpstr("key", ==, r.keys->pdata[i]);
+		else
+			g_assert_null(r.keys->pdata[i]);
+	}
+	_replayed_clean(&r);
+
+	oio_events_spool_close(s);
+	_rm_spool(dir, "oio_events");
+}
+
+/* A partial record, e.g. after a crash, ends its segment */
+static void
+test_spool_torn(void)
+{
+	gchar *dir = g_dir_make_tmp("spool-XXXXXX", NULL);
+	oio_events_spool_segment_size = 1024 * 1024;
+
+	struct oio_events_spool_s *s = NULL;
+	GError *err = oio_events_spool_open(dir, "q", &s);
+	g_assert_no_error(err);
+	g_assert_true(oio_events_spool_offer(s, NULL, "{\"a\":1}", TRUE));
+	g_assert_true(oio_events_spool_offer(s, NULL, "{\"a\":2}", TRUE));
+	oio_events_spool_close(s);
+
+	gchar *path = g_build_filename(dir, "q", "0000000100000000.spool", NULL);
+	int fd = open(path, O_WRONLY|O_APPEND);
+	g_assert_cmpint(fd, >=, 0);
+	/* The lengths beyond the end of the segment are not trusted */
+	const guint32 hdr[2] = {G_MAXUINT32, G_MAXUINT32};
+	g_assert_cmpint(sizeof(hdr), ==, write(fd, hdr, sizeof(hdr)));
+	g_assert_cmpint(3, ==, write(fd, "{\"b", 3));
+	close(fd);
+
+	err = oio_events_spool_open(dir, "q", &s);
+	g_assert_no_error(err);
+	struct replayed_s r;
+	_replayed_init(&r);
+	g_assert_cmpuint(2, ==, oio_events_spool_replay(s, 10, _collect, &r));
+	g_assert_cmpstr("{\"a\":2}", ==, r.msgs->pdata[1]);
+	g_assert_false(oio_events_spool_is_active(s));
+	g_assert_false(g_file_test(path, G_FILE_TEST_EXISTS));
+	_replayed_clean(&r);
+	oio_events_spool_close(s);
+
+	g_free(path);
+	_rm_spool(dir, "q");
+}
+
+/* The events pending in memory at the exit are older than those spooled */
+static void
+test_spool_prepend(void)
+{
+	gchar *dir = g_dir_make_tmp("spool-XXXXXX", NULL);
+	oio_events_spool_segment_size = 64;
+
+	struct oio_events_spool_s *s = NULL;
+	GError *err = oio_events_spool_open(dir, "q", &s);
+	g_assert_no_error(err);
+	gchar *keys[2] = {"k0", NULL}, *msgs[2] = {"{\"p\":0}", "{\"p\":1}"};
+
+	/* Into an empty spool, and kept across a restart */
+	g_assert_true(oio_events_spool_prepend(s, NULL, msgs, 1));
+	g_assert_true(oio_events_spool_is_active(s));
+	oio_events_spool_close(s);
+	err = oio_events_spool_open(dir, "q", &s);
+	g_assert_no_error(err);
+
+	struct replayed_s r;
+	_replayed_init(&r);
+	g_assert_cmpuint(1, ==, oio_events_spool_replay(s, 10, _collect, &r));
+	g_assert_cmpstr("{\"p\":0}", ==, r.msgs->pdata[0]);
+	g_assert_false(oio_events_spool_is_active(s));
+	_replayed_clean(&r);
+
+	/* Ahead of what remains of the segment being replayed */
+	for (guint i = 0; i < 10; i++) {
+		gchar *msg = g_strdup_printf("{\"event\":%u}", i);
+		g_assert_true(oio_events_spool_offer(s, NULL, msg, TRUE));
+		g_free(msg);
+	}
+	_replayed_init(&r);
+	g_assert_cmpuint(2, ==, oio_events_spool_replay(s, 2, _collect, &r));
+	g_assert_true(oio_events_spool_prepend(s, keys, msgs, 2));
+	while (oio_events_spool_replay(s, 3, _collect, &r) > 0) {}
+	g_assert_false(oio_events_spool_is_active(s));
+	g_assert_cmpuint(0, ==, oio_events_spool_size(s));
+
+	g_assert_cmpuint(r.msgs->len, ==, 12);
+	g_assert_cmpstr("{\"p\":0}", ==, r.msgs->pdata[2]);
+	g_assert_cmpstr("k0", ==, r.keys->pdata[2]);
+	g_assert_cmpstr("{\"p\":1}", ==, r.msgs->pdata[3]);
+	g_assert_null(r.keys->pdata[3]);
+	for (guint i = 0; i < 10; i++) {
+		gchar *msg = g_strdup_printf("{\"event\":%u}", i);
+		g_assert_cmpstr(msg, ==, r.msgs->pdata[i < 2 ? i : i + 2]);
+		g_free(msg);
+	}
+	_replayed_clean(&r);
+
+	oio_events_spool_close(s);
+	_rm_spool(dir, "q");
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/events/spool/order", test_spool_order);
+	g_test_add_func("/events/spool/torn", test_spool_torn);
+	g_test_add_func("/events/spool/prepend", test_spool_prepend);
+	return g_test_run();
+}
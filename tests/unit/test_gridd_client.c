@@ -20,6 +20,7 @@ License along with this library.
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <stdio.h>
 #include <arpa/inet.h>
@@ -261,6 +262,129 @@ test_down_peer(void)
 	metautils_pclose(&fd);
 }
 
+struct fake_peer_s
+{
+	int fd;
+	gint accepted;
+	gint closed;
+	gint close_after_reply;
+};
+
+/* Serves the requests one connection at a time, with an empty success */
+static gpointer
+_fake_peer_run(gpointer p)
+{
+	struct fake_peer_s *peer = p;
+	MESSAGE m = metautils_message_create_named(NAME_MSGNAME_METAREPLY, 0);
+	metautils_message_add_field_strint(m, NAME_MSGKEY_STATUS, CODE_FINAL_OK);
+	metautils_message_add_field_str(m, NAME_MSGKEY_MESSAGE, "OK");
+	GByteArray *reply = message_marshall_gba_and_clean(m);
+
+	int cnx;
+	while ((cnx = accept(peer->fd, NULL, NULL)) >= 0) {
+		g_atomic_int_inc(&peer->accepted);
+		guint32 size = 0;
+		guint8 payload[4096];
+		while (sizeof(size) == recv(cnx, &size, sizeof(size), MSG_WAITALL)) {
+			const gsize len = g_ntohl(size);
+			g_assert_cmpuint(len, <=, sizeof(payload));
+			if ((ssize_t)len != recv(cnx, payload, len, MSG_WAITALL))
+				break;
+			if ((ssize_t)reply->len != write(cnx, reply->data, reply->len))
+				break;
+			if (g_atomic_int_get(&peer->close_after_reply))
+				break;
+		}
+		close(cnx);
+		g_atomic_int_inc(&peer->closed);
+	}
+
+	g_byte_array_unref(reply);
+	return NULL;
+}
+
+static guint64
+_stat_value(const char *name)
+{
+	guint64 value = 0;
+	const GQuark k = g_quark_from_string(name);
+	GArray *all = network_server_stat_getall();
+	for (guint i = 0; i < all->len; i++) {
+		const struct stat_record_s *st =
+			&g_array_index(all, struct stat_record_s, i);
+		if (st->which == k)
+			value = st->value;
+	}
+	g_array_free(all, TRUE);
+	return value;
+}
+
+static void
+test_cnx_pool(void)
+{
+	gchar url[STRLEN_ADDRINFO] = "127.0.0.1:0";
+	struct fake_peer_s peer = {};
+	struct sockaddr_storage ss = {};
+	socklen_t ss_len = sizeof(ss);
+	gsize sz = sizeof(ss);
+	GError *err = NULL;
+
+	peer.fd = sock_build_for_url(url, &err, &ss, &sz);
+	g_assert_no_error(err);
+	g_assert_cmpint(peer.fd, >=, 0);
+	fcntl(peer.fd, F_SETFL, fcntl(peer.fd, F_GETFL) & ~O_NONBLOCK);
+	g_assert_cmpint(0, ==, bind(peer.fd, (struct sockaddr*)&ss, sz));
+	g_assert_cmpint(0, ==, listen(peer.fd, 64));
+	g_assert_cmpint(0, ==, getsockname(peer.fd, (struct sockaddr*)&ss, &ss_len));
+	g_assert_cmpint(0, <, grid_sockaddr_to_string(
+				(struct sockaddr*)&ss, url, sizeof(url)));
+	GThread *th = g_thread_new("peer", _fake_peer_run, &peer);
+
+	oio_var_value_one("client.cnx_pool.enabled", "true");
+	gridd_client_cnx_pool_flush();
+	const guint64 hits = _stat_value("counter cnx.pool_hit");
+	const guint64 broken = _stat_value("counter cnx.pool_broken");
+	GByteArray *req = message_marshall_gba_and_clean(
+			metautils_message_create_named("REQ_PING", 0));
+
+	/* A single connection serves all the requests */
+	for (guint i = 0; i < 4; i++) {
+		err = gridd_client_exec(url, 1.0, req);
+		g_assert_no_error(err);
+	}
+	g_assert_cmpint(1, ==, g_atomic_int_get(&peer.accepted));
+	g_assert_cmpuint(hits + 3, ==, _stat_value("counter cnx.pool_hit"));
+	g_assert_cmpuint(1, ==, _stat_value("gauge cnx.pooled"));
+
+	/* The peer closes the idle connection, a new one is established */
+	g_atomic_int_set(&peer.close_after_reply, 1);
+	err = gridd_client_exec(url, 1.0, req);
+	g_assert_no_error(err);
+	while (g_atomic_int_get(&peer.closed) < 1)
+		g_usleep(G_TIME_SPAN_MILLISECOND);
+	err = gridd_client_exec(url, 1.0, req);
+	g_assert_no_error(err);
+	g_assert_cmpint(2, ==, g_atomic_int_get(&peer.accepted));
+	g_assert_cmpuint(broken + 1, ==, _stat_value("counter cnx.pool_broken"));
+
+	/* Without the pool, one connection per request */
+	g_atomic_int_set(&peer.close_after_reply, 0);
+	gridd_client_cnx_pool_flush();
+	oio_var_value_one("client.cnx_pool.enabled", "false");
+	for (guint i = 0; i < 2; i++) {
+		err = gridd_client_exec(url, 1.0, req);
+		g_assert_no_error(err);
+	}
+	g_assert_cmpint(4, ==, g_atomic_int_get(&peer.accepted));
+	g_assert_cmpuint(0, ==, _stat_value("gauge cnx.pooled"));
+	oio_var_value_one("client.cnx_pool.enabled", "true");
+
+	g_byte_array_unref(req);
+	shutdown(peer.fd, SHUT_RDWR);
+	g_thread_join(th);
+	metautils_pclose(&peer.fd);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -275,6 +399,8 @@ main(int argc, char **argv)
 			test_failed_start_on_ignored_connect_error);
 	g_test_add_func("/metautils/gridd_client/ignored_connect_loop",
 			test_loop_on_ignored_start_error);
+	g_test_add_func("/metautils/gridd_client/cnx_pool",
+			test_cnx_pool);
 	return g_test_run();
 }
 
@@ -0,0 +1,227 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <string.h>
+
+#include <glib.h>
+#include <core/oiostr.h>
+#include <metautils/lib/metautils.h>
+
+#include "../../core/http_put.c"
+
+#define CHUNK_METHOD "ec/k=4,m=2,algo=isa_l_rs_vand,ec_segment_size=4096"
+
+static struct http_put_s *
+_create_ec (struct oio_ec_s **pec, guint *keys)
+{
+	GError *err = oio_ec_create(CHUNK_METHOD, pec);
+	g_assert_no_error(err);
+	const guint n = oio_ec_get_k(*pec) + oio_ec_get_m(*pec);
+	struct http_put_s *p = http_put_create_ec(*pec, -1);
+	if (!p)
+		return NULL;
+	for (guint i = 0; i < n; i++) {
+		gchar url[64];
+		g_snprintf(url, sizeof(url), "http://127.0.0.1:1/%u", i);
+		struct http_put_dest_s *d = http_put_add_dest(p, url, keys + i);
+		/* in the reverse order of the destinations */
+		http_put_dest_set_fragment(d, n - 1 - i);
+	}
+	return p;
+}
+
+static struct http_put_dest_s *
+_dest (struct http_put_s *p, guint i)
+{
+	return g_slist_nth_data(p->dests, i);
+}
+
+static void
+test_ec_fragments (void)
+{
+	guint keys[6] = {0};
+	struct oio_ec_s *ec = NULL;
+	struct http_put_s *p = _create_ec(&ec, keys);
+	if (!p) {
+		g_test_skip("EC upload requires libcurl >= 7.64");
+		oio_ec_destroy(ec);
+		return;
+	}
+	const guint k = oio_ec_get_k(ec), m = oio_ec_get_m(ec), n = k + m;
+	const gsize seg = oio_ec_get_segment_size(ec);
+
+	/* 3 whole segments and a partial one, fed in uneven pieces */
+	const gsize total = 3 * seg + 1000;
+	guint8 *data = g_malloc(total);
+	oio_buf_randomize(data, total);
+	for (gsize off = 0; off < total; ) {
+		const gsize len = MIN(total - off, 1 + off % 5000);
+		http_put_feed(p, g_bytes_new(data + off, len));
+		off += len;
+	}
+	http_put_feed(p, g_bytes_new_static("", 0));
+	g_assert_cmpint(p->metachunk_size, ==, total);
+
+	/* Each destination gets its own fragment of each segment, then the
+	 * end-of-stream marker, as fast as it consumes them */
+	GByteArray *chunks[n];
+	guint counts[n];
+	for (guint i = 0; i < n; i++) {
+		chunks[i] = g_byte_array_new();
+		counts[i] = 0;
+	}
+	do {
+		for (guint i = 0; i < n; i++) {
+			struct http_put_dest_s *d = _dest(p, i);
+			g_assert_cmpuint(g_queue_get_length(d->fragments), <=, EC_MIN_QUEUED);
+			GBytes *b;
+			while ((b = g_queue_pop_head(d->fragments))) {
+				gsize len = 0;
+				const guint8 *raw = g_bytes_get_data(b, &len);
+				if (len) {
+					struct oio_ec_header_s hdr = {0};
+					g_assert_true(oio_ec_header_parse(raw, &hdr));
+					g_assert_cmpuint(hdr.index, ==, d->fragment);
+					g_byte_array_append(chunks[i], raw, len);
+				}
+				counts[i] ++;
+				g_bytes_unref(b);
+			}
+		}
+		_ec_encode_pending(p);
+	} while (!g_queue_is_empty(p->buffer_tail)
+			|| !g_queue_is_empty(_dest(p, 0)->fragments));
+
+	for (guint i = 0; i < n; i++) {
+		g_assert_cmpuint(counts[i], ==, 5);
+
+		/* The checksum committed is the one of the fragments */
+		gchar *h = g_compute_checksum_for_data(G_CHECKSUM_MD5,
+				chunks[i]->data, chunks[i]->len);
+		g_assert_cmpstr(h, ==, http_put_get_checksum(p, keys + i));
+		g_free(h);
+	}
+
+	/* The segments are rebuilt without the first m fragments */
+	GByteArray *out = g_byte_array_new();
+	gsize offset = 0;
+	for (gsize done = 0; done < total; ) {
+		const gsize len = MIN(seg, total - done);
+		const gsize fs = oio_ec_get_fragment_size(ec, len);
+		const guint8 *frags[n];
+		for (guint i = 0; i < n; i++) {
+			const guint idx = _dest(p, i)->fragment;
+			frags[idx] = idx < m ? NULL : chunks[i]->data + offset;
+		}
+		GError *err = oio_ec_decode(ec, frags, fs, out);
+		g_assert_no_error(err);
+		offset += fs;
+		done += len;
+	}
+	g_assert_cmpuint(out->len, ==, total);
+	g_assert_cmpint(0, ==, memcmp(out->data, data, total));
+
+	g_byte_array_free(out, TRUE);
+	for (guint i = 0; i < n; i++)
+		g_byte_array_free(chunks[i], TRUE);
+	g_free(data);
+	http_put_destroy(p);
+	oio_ec_destroy(ec);
+}
+
+static void
+test_ec_drop_laggards (void)
+{
+	guint keys[6] = {0};
+	struct oio_ec_s *ec = NULL;
+	struct http_put_s *p = _create_ec(&ec, keys);
+	if (!p) {
+		g_test_skip("EC upload requires libcurl >= 7.64");
+		oio_ec_destroy(ec);
+		return;
+	}
+	const guint n = oio_ec_get_k(ec) + oio_ec_get_m(ec);
+	const gsize seg = oio_ec_get_segment_size(ec);
+	const guint segments = 4 * EC_MAX_BACKLOG;
+	guint8 *data = g_malloc0(seg * segments);
+
+	void _drain(guint i) {
+		struct http_put_dest_s *d = _dest(p, i);
+		g_queue_free_full(d->fragments, (GDestroyNotify)g_bytes_unref);
+		d->fragments = g_queue_new();
+	}
+
+	/* Everybody lags, one of them by a single fragment more */
+	for (guint i = 0; i < EC_MAX_BACKLOG + 2; i++)
+		_ec_push_segment(p, data, seg);
+	g_bytes_unref(g_queue_pop_head(_dest(p, 0)->fragments));
+	_ec_drop_laggards(p);
+	g_assert_cmpuint(_count_up_dests(p), ==, n);
+
+	/* Only k destinations keep up, below the quorum of k+1 */
+	for (guint i = 0; i < n - 2; i++)
+		_drain(i);
+	_ec_drop_laggards(p);
+	g_assert_cmpuint(_count_up_dests(p), ==, n);
+
+	/* k+1 destinations keep up, the last one is abandoned */
+	_drain(n - 2);
+	_ec_drop_laggards(p);
+	g_assert_cmpuint(_count_up_dests(p), ==, n - 1);
+	struct http_put_dest_s *last = _dest(p, n - 1);
+	g_assert_cmpint(last->state, ==, HTTP_SINGLE_FINISHED);
+	g_assert_cmpint(last->http_code, ==, 0);
+	g_assert_cmpuint(g_queue_get_length(last->fragments), ==, 0);
+	g_assert_cmpuint(http_put_get_failure_number(p), ==, 1);
+
+	/* ... and does not receive the next fragments */
+	_ec_push_segment(p, data, seg);
+	g_assert_cmpuint(g_queue_get_length(last->fragments), ==, 0);
+	for (guint i = 0; i < n - 1; i++)
+		g_assert_cmpuint(g_queue_get_length(_dest(p, i)->fragments), ==, 1);
+	for (guint i = 0; i < n - 1; i++)
+		_drain(i);
+
+	/* What is fed is only encoded as fast as the quorum consumes it */
+	http_put_feed(p, g_bytes_new_static(data, seg * segments));
+	for (guint done = 0; done < segments; done += EC_MIN_QUEUED) {
+		for (guint i = 0; i < n - 1; i++)
+			g_assert_cmpuint(g_queue_get_length(_dest(p, i)->fragments),
+					==, EC_MIN_QUEUED);
+		g_assert_cmpint(http_put_wants_data(p),
+				==, done + EC_MIN_QUEUED >= segments);
+		for (guint i = 0; i < n - 1; i++)
+			_drain(i);
+		_ec_encode_pending(p);
+	}
+	g_assert_true(http_put_wants_data(p));
+	g_assert_cmpuint(_count_up_dests(p), ==, n - 1);
+
+	g_free(data);
+	http_put_destroy(p);
+	oio_ec_destroy(ec);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/core/http_put/ec/fragments", test_ec_fragments);
+	g_test_add_func("/core/http_put/ec/drop_laggards", test_ec_drop_laggards);
+	return g_test_run();
+}
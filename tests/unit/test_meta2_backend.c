@@ -30,6 +30,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <resolver/hc_resolver.h>
 #include <cluster/lib/gridcluster.h>
 
+/* Reach the group commits, with the errors of the meta2 */
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "oio.m2v2"
+#include "../../meta2v2/meta2_backend.c"
+
 #undef GQ
 #define GQ() g_quark_from_static_string("oio.m2v2")
 
@@ -1463,6 +1468,284 @@ test_props_set_simple()
 	_container_wraper_allversions("NS", test);
 }
 
+/* Group commits ------------------------------------------------------------ */
+
+struct grouped_writer_s
+{
+	struct meta2_backend_s *m2;
+	struct oio_url_s *url;
+	GSList *beans;
+	GThread *th;
+	gint64 timeout;  /* for the request, 0 for none */
+	gboolean block;  /* hold the base until the gate opens */
+	gboolean fail;   /* fail after its changes */
+	gboolean ran;
+	gboolean lent;   /* ran with the base of another writer */
+	gint finished;
+	GError *err;
+};
+
+static GMutex gate_lock;
+static GCond gate_cond;
+static gboolean gate_open = FALSE;
+static gboolean gate_reached = FALSE;
+
+static struct m2b_commit_group_s *
+_group(struct meta2_backend_s *m2, struct oio_url_s *url)
+{
+	gchar key[STRLEN_CONTAINERID + 4];
+	g_snprintf(key, sizeof(key), "%s/0", oio_url_get(url, OIOURL_HEXID));
+	return g_hash_table_lookup(m2->commit_groups, key);
+}
+
+static guint
+_group_waiting(struct meta2_backend_s *m2, struct oio_url_s *url)
+{
+	g_mutex_lock(&m2->commit_groups_lock);
+	struct m2b_commit_group_s *group = _group(m2, url);
+	const guint count = group ? g_queue_get_length(&group->writers) : 0;
+	g_mutex_unlock(&m2->commit_groups_lock);
+	return count;
+}
+
+static GError *
+_grouped_op(struct sqlx_sqlite3_s *sq3, gpointer udata)
+{
+	struct grouped_writer_s *w = udata;
+	w->ran = TRUE;
+	g_mutex_lock(&w->m2->commit_groups_lock);
+	w->lent = _group(w->m2, w->url)->sq3 == sq3;
+	g_mutex_unlock(&w->m2->commit_groups_lock);
+
+	if (w->block) {
+		g_mutex_lock(&gate_lock);
+		gate_reached = TRUE;
+		g_cond_broadcast(&gate_cond);
+		while (!gate_open)
+			g_cond_wait(&gate_cond, &gate_lock);
+		g_mutex_unlock(&gate_lock);
+	}
+
+	struct m2b_put_alias_s ctx = {.url = w->url, .beans = w->beans};
+	GError *err = _put_alias_grouped(sq3, &ctx);
+	if (!err && w->fail) {
+		sqlx_admin_set_str(sq3, "user.group_commit", "failed");
+		err = BADREQ("Failing on purpose");
+	}
+	return err;
+}
+
+static gpointer
+_grouped_writer(gpointer p)
+{
+	struct grouped_writer_s *w = p;
+	if (w->timeout > 0)
+		oio_ext_set_deadline(oio_ext_monotonic_time() + w->timeout);
+	w->err = m2b_group_commit(w->m2, w->url,
+			M2V2_OPEN_MASTERONLY|M2V2_OPEN_ENABLED, _grouped_op, w);
+	g_atomic_int_set(&w->finished, 1);
+	return w;
+}
+
+static void
+_grouped_init(struct grouped_writer_s *w, struct meta2_backend_s *m2,
+		struct oio_url_s *u, guint i)
+{
+	gchar path[32];
+	g_snprintf(path, sizeof(path), "group-%u", i);
+	memset(w, 0, sizeof(*w));
+	w->m2 = m2;
+	w->url = oio_url_dup(u);
+	oio_url_set(w->url, OIOURL_PATH, path);
+	_set_content_id(w->url);
+	w->beans = _create_alias(m2, w->url, NULL);
+}
+
+static void
+_grouped_start(struct grouped_writer_s *w)
+{
+	w->th = g_thread_new("writer", _grouped_writer, w);
+}
+
+/* Start the leader and wait for it to hold the base */
+static void
+_grouped_lead(struct grouped_writer_s *w)
+{
+	gate_open = gate_reached = FALSE;
+	w->block = TRUE;
+	_grouped_start(w);
+	g_mutex_lock(&gate_lock);
+	while (!gate_reached)
+		g_cond_wait(&gate_cond, &gate_lock);
+	g_mutex_unlock(&gate_lock);
+}
+
+/* Start a writer and wait for it to queue in the group (or to give up) */
+static void
+_grouped_join(struct grouped_writer_s *w)
+{
+	const guint before = _group_waiting(w->m2, w->url);
+	_grouped_start(w);
+	while (_group_waiting(w->m2, w->url) <= before
+			&& !g_atomic_int_get(&w->finished))
+		g_usleep(G_TIME_SPAN_MILLISECOND);
+}
+
+static void
+_grouped_wait(struct grouped_writer_s *w)
+{
+	if (w->th)
+		g_thread_join(w->th);
+	w->th = NULL;
+}
+
+static void
+_grouped_release(void)
+{
+	g_mutex_lock(&gate_lock);
+	gate_open = TRUE;
+	g_cond_broadcast(&gate_cond);
+	g_mutex_unlock(&gate_lock);
+}
+
+static GError *
+_grouped_check(struct grouped_writer_s *w)
+{
+	_grouped_wait(w);
+	GPtrArray *tmp = g_ptr_array_new();
+	GError *err = meta2_backend_get_alias(w->m2, w->url, 0,
+			_bean_buffer_cb, tmp);
+	if (!err)
+		g_assert_cmpuint(tmp->len, >, 0);
+	_bean_cleanv2(tmp);
+	return err;
+}
+
+static void
+_grouped_clean(struct grouped_writer_s *w)
+{
+	g_clear_error(&w->err);
+	_bean_cleanl2(w->beans);
+	oio_url_pclean(&w->url);
+}
+
+static void
+_grouped_wrapper(guint max, container_test_f cf)
+{
+	const guint max0 = meta2_group_commit_max;
+	meta2_group_commit_max = max;
+	_container_wraper("NS", 1, cf);
+	meta2_group_commit_max = max0;
+}
+
+static void
+test_group_commit_handoff(void)
+{
+	void test(struct meta2_backend_s *m2, struct oio_url_s *u, gint64 maxver) {
+		(void) maxver;
+		struct grouped_writer_s w[3];
+		for (guint i = 0; i < 3; i++)
+			_grouped_init(w + i, m2, u, i);
+
+		/* The leader only takes one more writer, the last one is left
+		 * alone and leads its own group once the first is committed. */
+		_grouped_lead(w + 0);
+		_grouped_join(w + 1);
+		_grouped_join(w + 2);
+		_grouped_release();
+
+		for (guint i = 0; i < 3; i++) {
+			GError *err = _grouped_check(w + i);
+			g_assert_no_error(err);
+			g_assert_no_error(w[i].err);
+			g_assert_true(w[i].ran);
+		}
+		g_assert_false(w[0].lent);
+		g_assert_true(w[1].lent);
+		g_assert_false(w[2].lent);
+		g_assert_null(_group(m2, u));
+
+		for (guint i = 0; i < 3; i++)
+			_grouped_clean(w + i);
+	}
+	_grouped_wrapper(2, test);
+}
+
+static void
+test_group_commit_member_failure(void)
+{
+	void test(struct meta2_backend_s *m2, struct oio_url_s *u, gint64 maxver) {
+		(void) maxver;
+		struct grouped_writer_s w[3];
+		for (guint i = 0; i < 3; i++)
+			_grouped_init(w + i, m2, u, i);
+
+		/* The second writer fails after its changes: only these are
+		 * rolled back, the rest of the batch is committed. */
+		_grouped_lead(w + 0);
+		w[1].fail = TRUE;
+		_grouped_join(w + 1);
+		_grouped_join(w + 2);
+		_grouped_release();
+
+		GError *err = _grouped_check(w + 0);
+		g_assert_no_error(err);
+		g_assert_no_error(w[0].err);
+		err = _grouped_check(w + 1);
+		g_assert_error(err, GQ(), CODE_CONTENT_NOTFOUND);
+		g_clear_error(&err);
+		g_assert_error(w[1].err, GQ(), CODE_BAD_REQUEST);
+		err = _grouped_check(w + 2);
+		g_assert_no_error(err);
+		g_assert_no_error(w[2].err);
+		g_assert_true(w[1].lent);
+		g_assert_true(w[2].lent);
+
+		/* Its changes of the admin table are forgotten too */
+		struct sqlx_sqlite3_s *sq3 = NULL;
+		err = m2b_open(m2, u, M2V2_OPEN_LOCAL, &sq3);
+		g_assert_no_error(err);
+		g_assert_false(sqlx_admin_has(sq3, "user.group_commit"));
+		m2b_close(m2, sq3, u);
+
+		for (guint i = 0; i < 3; i++)
+			_grouped_clean(w + i);
+	}
+	_grouped_wrapper(4, test);
+}
+
+static void
+test_group_commit_timeout(void)
+{
+	void test(struct meta2_backend_s *m2, struct oio_url_s *u, gint64 maxver) {
+		(void) maxver;
+		struct grouped_writer_s w[2];
+		for (guint i = 0; i < 2; i++)
+			_grouped_init(w + i, m2, u, i);
+
+		/* The base is held longer than the second writer can wait */
+		_grouped_lead(w + 0);
+		w[1].timeout = 10 * G_TIME_SPAN_MILLISECOND;
+		_grouped_join(w + 1);
+		_grouped_wait(w + 1);
+		g_assert_error(w[1].err, GQ(), CODE_UNAVAILABLE);
+		g_assert_false(w[1].ran);
+		g_assert_cmpuint(0, ==, _group_waiting(m2, u));
+		_grouped_release();
+
+		GError *err = _grouped_check(w + 0);
+		g_assert_no_error(err);
+		g_assert_no_error(w[0].err);
+		err = _grouped_check(w + 1);
+		g_assert_error(err, GQ(), CODE_CONTENT_NOTFOUND);
+		g_clear_error(&err);
+
+		for (guint i = 0; i < 2; i++)
+			_grouped_clean(w + i);
+	}
+	_grouped_wrapper(4, test);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1520,6 +1803,12 @@ main(int argc, char **argv)
 			test_content_check_ec_first_missing_chunks);
 	g_test_add_func("/meta2v2/backend/content/check_ec_last_missing_chunks",
 			test_content_check_ec_last_missing_chunks);
+	g_test_add_func("/meta2v2/backend/group_commit/handoff",
+			test_group_commit_handoff);
+	g_test_add_func("/meta2v2/backend/group_commit/member_failure",
+			test_group_commit_member_failure);
+	g_test_add_func("/meta2v2/backend/group_commit/timeout",
+			test_group_commit_timeout);
 
 	return g_test_run();
 }
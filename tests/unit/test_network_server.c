@@ -17,6 +17,8 @@ License along with this library.
 */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <glib.h>
 
@@ -24,6 +26,7 @@ License along with this library.
 #include <core/internals.h>
 
 #include <server/network_server.h>
+#include <server/slab.h>
 
 #define GQ_SERVER() g_quark_from_static_string("oio.srv")
 
@@ -70,6 +73,34 @@ test_bad_bind_address_empty_brackets(void)
 	_test_bad_bind_address("[]:12345");
 }
 
+static void
+_count_release(gpointer u)
+{
+	(*(guint*)u) ++;
+}
+
+static void
+test_slab_file_shared(void)
+{
+	guint released = 0;
+	int fd = open("/dev/null", O_RDONLY);
+	g_assert_cmpint(fd, >=, 0);
+
+	struct data_slab_file_s *f = data_slab_file_new(fd, _count_release, &released);
+	struct data_slab_s *s0 = data_slab_make_file(f, 0, 4096);
+	struct data_slab_s *s1 = data_slab_make_file(f, 4096, 4096);
+	data_slab_file_unref(f);
+	g_assert_cmpuint(data_slab_size(s0), ==, 4096);
+
+	/* The descriptor outlives all the slabs but the last */
+	data_slab_free(s0);
+	g_assert_cmpuint(released, ==, 0);
+	g_assert_cmpint(fcntl(fd, F_GETFD), >=, 0);
+	data_slab_free(s1);
+	g_assert_cmpuint(released, ==, 1);
+	g_assert_cmpint(fcntl(fd, F_GETFD), <, 0);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -82,5 +113,6 @@ main(int argc, char **argv)
 			test_bad_bind_address_quotes);
 	g_test_add_func("/server/core/bad_bind_address/257",
 			test_bad_bind_address_257);
+	g_test_add_func("/server/slab/file/shared", test_slab_file_shared);
 	return g_test_run();
 }
@@ -0,0 +1,222 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2024 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <metautils/lib/metautils.h>
+
+#include "../../proxy/transport_http.c"
+
+static const gchar REQUEST[] =
+	"post /v3.0/NS/content/create?acct=A&ref=R HTTP/1.1\r\n"
+	"Host: 127.0.0.1:6000\r\n"
+	"X-oio-req-id:  0123456789ABCDEF \r\n"
+	"Content-Type: application/json\r\n"
+	"Content-Length: 13\r\n"
+	"Connection: Keep-Alive\r\n"
+	"\r\n"
+	"{\"key\":\"val\"}";
+
+struct parsed_s
+{
+	GString *head;
+	struct http_parser_s *parser;
+	gchar *cmd, *uri, *version;
+	GTree *headers;
+	GByteArray *body;
+};
+
+static void
+_parsed_init(struct parsed_s *p)
+{
+	memset(p, 0, sizeof(*p));
+	p->head = g_string_new("");
+	p->parser = http_parser_create(p->head);
+	p->headers = g_tree_new_full(metautils_strcmp3, NULL, NULL, NULL);
+	p->body = g_byte_array_new();
+}
+
+static void
+_parsed_clean(struct parsed_s *p)
+{
+	http_parser_destroy(p->parser);
+	g_tree_destroy(p->headers);
+	g_byte_array_free(p->body, TRUE);
+	g_string_free(p->head, TRUE);
+}
+
+/* Feed the parser with <data> split in chunks of <step> bytes */
+static int
+_parse(struct parsed_s *p, const gchar *data, gsize len, gsize step)
+{
+	void command_provider(gchar *c, gchar *s, gchar *v) {
+		p->cmd = c; p->uri = s; p->version = v;
+	}
+	void header_provider(gchar *k, gchar *v) {
+		g_tree_replace(p->headers, k, v);
+	}
+	void body_provider(const guint8 *d, gsize dlen) {
+		g_byte_array_append(p->body, d, dlen);
+	}
+	p->parser->command_provider = command_provider;
+	p->parser->header_provider = header_provider;
+	p->parser->body_provider = body_provider;
+
+	int status = HPRC_MORE;
+	for (gsize done = 0; done < len && status == HPRC_MORE; done += step) {
+		const gsize max = MIN(step, len - done);
+		status = http_parse(p->parser, (const guint8*) data + done, max).status;
+	}
+
+	p->parser->command_provider = NULL;
+	p->parser->header_provider = NULL;
+	p->parser->body_provider = NULL;
+	return status;
+}
+
+static void
+test_parse_split(void)
+{
+	const gsize len = sizeof(REQUEST) - 1;
+	for (gsize step = 1; step <= len; step++) {
+		struct parsed_s p;
+		_parsed_init(&p);
+		g_assert_cmpint(HPRC_SUCCESS, ==, _parse(&p, REQUEST, len, step));
+		g_assert_cmpstr(p.cmd, ==, "post");
+		g_assert_cmpstr(p.uri, ==, "/v3.0/NS/content/create?acct=A&ref=R");
+		g_assert_cmpstr(p.version, ==, "HTTP/1.1");
+		g_assert_cmpstr(g_tree_lookup(p.headers, "host"), ==, "127.0.0.1:6000");
+		g_assert_cmpstr(g_tree_lookup(p.headers, "x-oio-req-id"), ==,
+				"0123456789ABCDEF");
+		g_assert_cmpstr(g_tree_lookup(p.headers, "connection"), ==,
+				"Keep-Alive");
+		g_assert_cmpint(g_tree_nnodes(p.headers), ==, 5);
+		g_assert_cmpint(p.parser->content_length, ==, 13);
+		g_assert_cmpint(p.body->len, ==, 13);
+		g_assert_true(0 == memcmp(p.body->data, "{\"key\":\"val\"}", 13));
+		_parsed_clean(&p);
+	}
+}
+
+static void
+test_parse_errors(void)
+{
+	static const gchar *BAD[] = {
+		"\r\n\r\n",
+		"GET\r\n\r\n",
+		"GET / HTTP/1.1\n\r\n",
+		"GET / HTTP/1.1\r\nHost\r\n\r\n",
+		"GET / HTTP/1.1\r\n: empty\r\n\r\n",
+		"GET / HTTP/1.1\r\nHost: a\rb\r\n\r\n",
+		NULL
+	};
+	for (const gchar **pb = BAD; *pb; pb++) {
+		struct parsed_s p;
+		_parsed_init(&p);
+		g_assert_cmpint(HPRC_ERROR, ==, _parse(&p, *pb, strlen(*pb), 4096));
+		_parsed_clean(&p);
+	}
+
+	/* Incomplete, but valid so far */
+	struct parsed_s p;
+	_parsed_init(&p);
+	g_assert_cmpint(HPRC_MORE, ==, _parse(&p, REQUEST, 60, 4096));
+	_parsed_clean(&p);
+}
+
+/* Pipelined requests: the parser stops at the end of the first one */
+static void
+test_parse_pipelined(void)
+{
+	const gsize len = sizeof(REQUEST) - 1;
+	gchar *buf = g_strconcat(REQUEST, REQUEST, NULL);
+	struct parsed_s p;
+	_parsed_init(&p);
+	gsize offset = 0;
+	for (guint i = 0; i < 2; i++) {
+		struct http_parsing_result_s rc =
+			http_parse(p.parser, (guint8*) buf + offset, 2 * len - offset);
+		g_assert_cmpint(HPRC_SUCCESS, ==, rc.status);
+		g_assert_cmpuint(rc.consumed, ==, len);
+		offset += rc.consumed;
+		g_string_set_size(p.head, 0);
+		http_parser_reset(p.parser, p.head);
+	}
+	_parsed_clean(&p);
+	g_free(buf);
+}
+
+/* Random mutations of a valid request must never crash the parser */
+static void
+test_parse_fuzz(void)
+{
+	const gsize len = sizeof(REQUEST) - 1;
+	const guint rounds = g_test_thorough() ? 1000000 : 10000;
+	gchar *buf = g_malloc(len);
+	for (guint i = 0; i < rounds; i++) {
+		memcpy(buf, REQUEST, len);
+		const guint changes = g_random_int_range(1, 8);
+		for (guint j = 0; j < changes; j++) {
+			const gsize where = g_random_int_range(0, len);
+			switch (g_random_int_range(0, 4)) {
+				case 0: buf[where] = '\r'; break;
+				case 1: buf[where] = '\n'; break;
+				case 2: buf[where] = ':'; break;
+				default: buf[where] = g_random_int_range(0, 256); break;
+			}
+		}
+		struct parsed_s p;
+		_parsed_init(&p);
+		_parse(&p, buf, len, g_random_int_range(1, len + 1));
+		_parsed_clean(&p);
+	}
+	g_free(buf);
+}
+
+static void
+test_parse_bench(void)
+{
+	if (!g_test_perf())
+		return;
+
+	const gsize len = sizeof(REQUEST) - 1;
+	const guint rounds = 1000000;
+	struct parsed_s p;
+	_parsed_init(&p);
+	g_test_timer_start();
+	for (guint i = 0; i < rounds; i++) {
+		g_assert_cmpint(HPRC_SUCCESS, ==, _parse(&p, REQUEST, len, len));
+		g_string_set_size(p.head, 0);
+		g_byte_array_set_size(p.body, 0);
+		http_parser_reset(p.parser, p.head);
+	}
+	const gdouble elapsed = g_test_timer_elapsed();
+	g_test_minimized_result(elapsed * G_TIME_SPAN_SECOND / rounds,
+			"%.3f us per request", elapsed * G_TIME_SPAN_SECOND / rounds);
+	_parsed_clean(&p);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/proxy/http/parse/split", test_parse_split);
+	g_test_add_func("/proxy/http/parse/errors", test_parse_errors);
+	g_test_add_func("/proxy/http/parse/pipelined", test_parse_pipelined);
+	g_test_add_func("/proxy/http/parse/fuzz", test_parse_fuzz);
+	g_test_add_func("/proxy/http/parse/bench", test_parse_bench);
+	return g_test_run();
+}
@@ -0,0 +1,114 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2024 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <metautils/lib/metautils.h>
+#include <proxy/path_parser.h>
+
+static struct path_parser_s *
+_parser(void)
+{
+	struct path_parser_s *pp = path_parser_init();
+	path_parser_configure(pp, "v3.0/status/#GET", GINT_TO_POINTER(1));
+	path_parser_configure(pp, "v3.0/$NS/lb/choose/#GET", GINT_TO_POINTER(2));
+	path_parser_configure(pp, "v3.0/$NS/container/create/#POST", GINT_TO_POINTER(3));
+	path_parser_configure(pp, "v3.0/$NS/$TYPE/create/#POST", GINT_TO_POINTER(4));
+	path_parser_configure(pp, "v3.0/$NS/container/show/#GET", GINT_TO_POINTER(5));
+	path_parser_configure(pp, "v3.0/$NS/content/create/#POST", GINT_TO_POINTER(6));
+	path_parser_configure(pp, "v3.0/cache/status/#GET", GINT_TO_POINTER(7));
+	return pp;
+}
+
+static guint
+_match(struct path_parser_s *pp, const char *key,
+		struct path_matching_s *tab, guint max)
+{
+	static gchar buf[256];
+	g_strlcpy(buf, key, sizeof(buf));
+	return path_parser_match(pp, buf, tab, max);
+}
+
+static void
+test_match(void)
+{
+	struct path_parser_s *pp = _parser();
+	struct path_matching_s tab[PATH_MATCHING_MAX];
+
+	g_assert_cmpuint(1, ==, _match(pp, "v3.0/status/#GET", tab, PATH_MATCHING_MAX));
+	g_assert_cmpint(1, ==, GPOINTER_TO_INT(tab[0].last->u));
+	g_assert_cmpuint(0, ==, tab[0].vars_count);
+
+	g_assert_cmpuint(1, ==, _match(pp, "v3.0/NS/lb/choose/#GET", tab, PATH_MATCHING_MAX));
+	g_assert_cmpint(2, ==, GPOINTER_TO_INT(tab[0].last->u));
+	g_assert_cmpstr("NS", ==, path_matching_get_variable(tab, "NS"));
+	g_assert_null(path_matching_get_variable(tab, "TYPE"));
+
+	/* Both the explicit word and the variable match, in the order of the
+	 * declarations */
+	g_assert_cmpuint(2, ==, _match(pp, "v3.0/NS/container/create/#POST", tab, PATH_MATCHING_MAX));
+	g_assert_cmpint(3, ==, GPOINTER_TO_INT(tab[0].last->u));
+	g_assert_cmpint(4, ==, GPOINTER_TO_INT(tab[1].last->u));
+	g_assert_cmpstr("container", ==, path_matching_get_variable(tab + 1, "TYPE"));
+	g_assert_cmpuint(1, ==, _match(pp, "v3.0/NS/container/create/#POST", tab, 1));
+	g_assert_cmpint(3, ==, GPOINTER_TO_INT(tab[0].last->u));
+
+	/* The tokens are unescaped */
+	g_assert_cmpuint(1, ==, _match(pp, "v3.0/N%2FS/lb/choose/#GET", tab, PATH_MATCHING_MAX));
+	g_assert_cmpstr("N/S", ==, path_matching_get_variable(tab, "NS"));
+
+	g_assert_cmpuint(0, ==, _match(pp, "v3.0/status/#POST", tab, PATH_MATCHING_MAX));
+	g_assert_cmpuint(0, ==, _match(pp, "v3.0/NS/lb/#GET", tab, PATH_MATCHING_MAX));
+	g_assert_cmpuint(0, ==, _match(pp, "v3.0/NS/lb/choose/x/#GET", tab, PATH_MATCHING_MAX));
+	g_assert_cmpuint(0, ==, _match(pp, "v3.0/N%zzS/lb/choose/#GET", tab, PATH_MATCHING_MAX));
+	g_assert_cmpuint(0, ==, _match(pp, "v3.0/N%00S/lb/choose/#GET", tab, PATH_MATCHING_MAX));
+	g_assert_cmpuint(0, ==, _match(pp, "", tab, PATH_MATCHING_MAX));
+
+	guint count = 0;
+	void _count(const struct trie_node_s *n) { (void) n; count ++; }
+	path_parser_foreach(pp, _count);
+	g_assert_cmpuint(7, ==, count);
+
+	path_parser_clean(pp);
+}
+
+static void
+test_match_bench(void)
+{
+	if (!g_test_perf())
+		return;
+
+	struct path_parser_s *pp = _parser();
+	struct path_matching_s tab[PATH_MATCHING_MAX];
+	const guint rounds = 1000000;
+	g_test_timer_start();
+	for (guint i = 0; i < rounds; i++)
+		g_assert_cmpuint(1, ==, _match(pp, "v3.0/NS/container/show/#GET",
+					tab, PATH_MATCHING_MAX));
+	const gdouble elapsed = g_test_timer_elapsed();
+	g_test_minimized_result(elapsed * 1e9 / rounds,
+			"%.1f ns per match", elapsed * 1e9 / rounds);
+	path_parser_clean(pp);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/proxy/path_parser/match", test_match);
+	g_test_add_func("/proxy/path_parser/bench", test_match_bench);
+	return g_test_run();
+}
@@ -0,0 +1,108 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <metautils/lib/metautils.h>
+#include <proxy/srvtype_list.h>
+
+static struct service_info_s *
+_si (guint port, gint32 score)
+{
+	gchar url[64];
+	g_snprintf(url, sizeof(url), "127.0.0.1:%u", port);
+	struct service_info_s *si = g_malloc0(sizeof(*si));
+	g_strlcpy(si->ns_name, "NS", sizeof(si->ns_name));
+	g_strlcpy(si->type, "rawx", sizeof(si->type));
+	g_assert_true(grid_string_to_addrinfo(url, &si->addr));
+	si->put_score.value = si->get_score.value = score;
+	return si;
+}
+
+static gint32
+_score (GSList *all, guint port)
+{
+	for (GSList *l = all; l; l = l->next) {
+		struct service_info_s *si = l->data;
+		if (port == g_ntohs(si->addr.port))
+			return si->put_score.value;
+	}
+	return -1;
+}
+
+static void
+test_apply (void)
+{
+	struct srvtype_list_s *sl = srvtype_list_create();
+	GSList *changed = NULL, *removed = NULL, *all = NULL;
+
+	/* A full list replaces what is known */
+	changed = g_slist_prepend(NULL, _si(6000, 10));
+	changed = g_slist_prepend(changed, _si(6001, 10));
+	g_assert_false(srvtype_list_apply(sl, g_strdup("g1"), FALSE,
+				changed, NULL, &all));
+	g_assert_cmpstr("g1", ==, sl->generation);
+	g_assert_cmpuint(2, ==, g_slist_length(all));
+	g_slist_free(changed);
+	g_slist_free(all);
+
+	/* Only additions and changes: the LB may be fed incrementally */
+	changed = g_slist_prepend(NULL, _si(6001, 20));
+	changed = g_slist_prepend(changed, _si(6002, 20));
+	g_assert_true(srvtype_list_apply(sl, g_strdup("g2"), TRUE,
+				changed, NULL, &all));
+	g_assert_cmpstr("g2", ==, sl->generation);
+	g_assert_cmpuint(3, ==, g_slist_length(all));
+	g_assert_cmpint(10, ==, _score(all, 6000));
+	g_assert_cmpint(20, ==, _score(all, 6001));
+	g_assert_cmpint(20, ==, _score(all, 6002));
+	g_slist_free(changed);
+	g_slist_free(all);
+
+	/* Nothing changed */
+	g_assert_true(srvtype_list_apply(sl, g_strdup("g2"), TRUE,
+				NULL, NULL, &all));
+	g_assert_cmpuint(3, ==, g_slist_length(all));
+	g_slist_free(all);
+
+	/* A removal requires the LB to be purged */
+	removed = g_slist_prepend(NULL, _si(6000, 0));
+	g_assert_false(srvtype_list_apply(sl, g_strdup("g3"), TRUE,
+				NULL, removed, &all));
+	g_assert_cmpuint(2, ==, g_slist_length(all));
+	g_assert_cmpint(-1, ==, _score(all, 6000));
+	g_slist_free_full(removed, (GDestroyNotify)service_info_clean);
+	g_slist_free(all);
+
+	/* A full list forgets the services it does not hold */
+	changed = g_slist_prepend(NULL, _si(6003, 30));
+	g_assert_false(srvtype_list_apply(sl, g_strdup("g4"), FALSE,
+				changed, NULL, &all));
+	g_assert_cmpuint(1, ==, g_slist_length(all));
+	g_assert_cmpint(30, ==, _score(all, 6003));
+	g_slist_free(changed);
+	g_slist_free(all);
+
+	srvtype_list_free(sl);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/proxy/srvtype_list/apply", test_apply);
+	return g_test_run();
+}
@@ -0,0 +1,188 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <glib.h>
+
+#include "../../core/sds.c"
+
+static struct chunk_s *
+_chunk (guint port)
+{
+	gchar url[64];
+	g_snprintf (url, sizeof(url), "http://127.0.0.1:%u/0123456789ABCDEF", port);
+	struct chunk_s *c = g_malloc0 (sizeof(struct chunk_s) + strlen(url) + 1);
+	strcpy (c->url, url);
+	return c;
+}
+
+static struct oio_sds_s *
+_sds (void)
+{
+	struct oio_sds_s *sds = NULL;
+	struct oio_error_s *err = oio_sds_init (&sds, "NS");
+	g_assert_null (err);
+	return sds;
+}
+
+static void
+test_latency_p99 (void)
+{
+	struct oio_sds_s *sds = _sds ();
+	struct chunk_s *c = _chunk (6000);
+	gint64 p99 = 0;
+
+	/* Unknown service */
+	g_assert_cmpint (0, ==, _rawx_latency_get (sds, c, &p99));
+	g_assert_cmpint (-1, ==, p99);
+
+	/* Too few samples for a p99 */
+	for (gint64 i = 1; i < 8; i++)
+		_rawx_latency_record (sds, c, i * G_TIME_SPAN_MILLISECOND);
+	g_assert_cmpint (0, <, _rawx_latency_get (sds, c, &p99));
+	g_assert_cmpint (-1, ==, p99);
+
+	/* Only the recent samples are kept */
+	for (gint64 i = 8; i <= 100; i++)
+		_rawx_latency_record (sds, c, i * G_TIME_SPAN_MILLISECOND);
+	_rawx_latency_get (sds, c, &p99);
+	g_assert_cmpint (100 * G_TIME_SPAN_MILLISECOND, ==, p99);
+	for (guint i = 0; i < RAWX_LATENCY_SAMPLES - 1; i++)
+		_rawx_latency_record (sds, c, G_TIME_SPAN_MILLISECOND);
+	_rawx_latency_get (sds, c, &p99);
+	g_assert_cmpint (100 * G_TIME_SPAN_MILLISECOND, ==, p99);
+	_rawx_latency_record (sds, c, G_TIME_SPAN_MILLISECOND);
+	_rawx_latency_get (sds, c, &p99);
+	g_assert_cmpint (G_TIME_SPAN_MILLISECOND, ==, p99);
+
+	g_free (c);
+	oio_sds_free (sds);
+}
+
+static void
+test_order_replicas (void)
+{
+	struct oio_sds_s *sds = _sds ();
+	struct chunk_s *fast = _chunk (6000), *unknown = _chunk (6001),
+			*slow = _chunk (6002), *slower = _chunk (6003);
+	_rawx_latency_record (sds, fast, 10);
+	_rawx_latency_record (sds, slow, 25);
+	_rawx_latency_record (sds, slower, 50);
+
+	struct metachunk_s meta = {0};
+	meta.chunks = g_slist_append (NULL, slow);
+	meta.chunks = g_slist_append (meta.chunks, fast);
+	meta.chunks = g_slist_append (meta.chunks, slower);
+	meta.chunks = g_slist_append (meta.chunks, unknown);
+	struct metachunk_s *metachunks[2] = {&meta, NULL};
+	struct _download_ctx_s dl = {0};
+	dl.sds = sds;
+	dl.metachunks = metachunks;
+
+	/* The slow ones go last, in their order, the unknown one is tried */
+	_download_order_replicas (&dl);
+	g_assert_cmpuint (4, ==, g_slist_length (meta.chunks));
+	g_assert_true (fast == g_slist_nth_data (meta.chunks, 0));
+	g_assert_true (unknown == g_slist_nth_data (meta.chunks, 1));
+	g_assert_true (slow == g_slist_nth_data (meta.chunks, 2));
+	g_assert_true (slower == g_slist_nth_data (meta.chunks, 3));
+
+	g_slist_free (meta.chunks);
+	g_free (fast);
+	g_free (unknown);
+	g_free (slow);
+	g_free (slower);
+	oio_sds_free (sds);
+}
+
+static struct _download_fetch_s *
+_fetch (struct _download_part_s *part, struct chunk_s *chunk)
+{
+	struct _download_fetch_s *fetch = g_malloc0 (sizeof(*fetch));
+	fetch->part = part;
+	fetch->chunk = chunk;
+	fetch->size = part->size;
+	fetch->started = oio_ext_monotonic_time ();
+	fetch->handle = curl_easy_init ();
+	return fetch;
+}
+
+static void
+test_fetch_race (void)
+{
+	struct oio_sds_s *sds = _sds ();
+	struct chunk_s *c0 = _chunk (6000), *c1 = _chunk (6001), *c2 = _chunk (6002);
+	struct _download_ctx_s dl = {0};
+	dl.sds = sds;
+	dl.mhandle = curl_multi_init ();
+	struct _download_part_s part = {0};
+	part.dl = &dl;
+	part.size = 1024;
+	GError *err;
+
+	/* The hedged read fails first: it is dropped, the first read goes on,
+	 * and the failing service is demoted although it failed fast */
+	part.fetch = _fetch (&part, c0);
+	part.hedge = _fetch (&part, c1);
+	struct _download_fetch_s *first = part.fetch;
+	err = _download_fetch_finish (part.hedge, CURLE_COULDNT_CONNECT);
+	g_assert_no_error (err);
+	g_assert_true (first == part.fetch);
+	g_assert_null (part.hedge);
+	g_assert_cmpint (oio_sds_download_hedge_delay_max, <=,
+			_rawx_latency_get (sds, c1, NULL));
+
+	/* The first read fails: the hedged read goes on */
+	part.hedge = _fetch (&part, c1);
+	struct _download_fetch_s *hedge = part.hedge;
+	err = _download_fetch_finish (part.fetch, CURLE_COULDNT_CONNECT);
+	g_assert_no_error (err);
+	g_assert_true (hedge == part.fetch);
+	g_assert_null (part.hedge);
+
+	/* The loser of a race is dropped, its failure is not held against it */
+	part.hedge = _fetch (&part, c2);
+	part.hedge->flag_cancelled = 1;
+	err = _download_fetch_finish (part.hedge, CURLE_WRITE_ERROR);
+	g_assert_no_error (err);
+	g_assert_true (hedge == part.fetch);
+	g_assert_null (part.hedge);
+	g_assert_cmpint (0, ==, _rawx_latency_get (sds, c2, NULL));
+
+	/* The last read failing, with no more chunk, fails the part */
+	err = _download_fetch_finish (part.fetch, CURLE_COULDNT_CONNECT);
+	g_assert_error (err, GQ(), CODE_INTERNAL_ERROR);
+	g_clear_error (&err);
+	g_assert_false (part.flag_done);
+
+	_download_fetch_free (part.fetch);
+	curl_multi_cleanup (dl.mhandle);
+	g_free (c0);
+	g_free (c1);
+	g_free (c2);
+	oio_sds_free (sds);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func ("/core/sds/download/latency", test_latency_p99);
+	g_test_add_func ("/core/sds/download/order", test_order_replicas);
+	g_test_add_func ("/core/sds/download/race", test_fetch_race);
+	return g_test_run ();
+}
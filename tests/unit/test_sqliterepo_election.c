@@ -43,9 +43,10 @@ static gint64 _get_real (void) { return CLOCK; }
 static struct election_member_s *
 manager_get_member (struct election_manager_s *m, const char *k)
 {
-	_manager_lock(m);
-	struct election_member_s *member = _LOCKED_get_member (m, k);
-	_manager_unlock(m);
+	struct election_shard_s *shard = _manager_get_shard(m, k);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member (shard, k);
+	_shard_unlock(shard);
 	return member;
 }
 
@@ -136,10 +137,25 @@ static gboolean _peering_pipefrom (struct sqlx_peering_s *self,
 		guint reqid,
 		sqlx_peering_pipefrom_end_f result);
 
+static gboolean _peering_replicate (struct sqlx_peering_s *self,
+		/* in */
+		const char *url,
+		GByteArray *request,
+		/* out */
+		gpointer udata,
+		sqlx_peering_replicate_end_f result);
+
+/* The code the fake peers reply to DB_REPLI, 0 for a success */
+static gint peering_replicate_code = 0;
+
+/* The last DB_REPLI request sent to the fake peers */
+static GByteArray *peering_replicated = NULL;
+
 struct sqlx_peering_vtable_s vtable_peering_NOOP =
 {
 	_peering_destroy, _peering_notify,
-	_peering_use, _peering_getvers, _peering_pipefrom
+	_peering_use, _peering_getvers, _peering_pipefrom,
+	_peering_replicate
 };
 
 static void _peering_destroy (struct sqlx_peering_s *self) { g_free (self); }
@@ -189,6 +205,28 @@ _peering_pipefrom (struct sqlx_peering_s *self,
 	return FALSE;
 }
 
+static gboolean
+_peering_replicate (struct sqlx_peering_s *self,
+		/* in */
+		const char *url,
+		GByteArray *request,
+		/* out */
+		gpointer udata,
+		sqlx_peering_replicate_end_f result)
+{
+	(void) self;
+	if (peering_replicated)
+		g_byte_array_unref(peering_replicated);
+	peering_replicated = g_byte_array_ref(request);
+	GError *err = NULL;
+	if (peering_replicate_code)
+		err = NEWERROR(peering_replicate_code, "fake DB_REPLI failure");
+	result(err, url, udata);
+	if (err)
+		g_error_free(err);
+	return FALSE;
+}
+
 static struct sqlx_peering_s *
 _peering_noop (void)
 {
@@ -262,12 +300,19 @@ static int _sync_awget_siblings (struct sqlx_sync_s *ss, const char *path,
 static int _sync_aremove_all_watches(struct sqlx_sync_s *ss, const char *path,
 		void_completion_t completion, const void *data);
 
+static gboolean _sync_connected(struct sqlx_sync_s *ss);
+
+static gint64 _sync_session_timeout(struct sqlx_sync_s *ss);
+
+/* The session timeout negotiated with the fake ZK, 0 for the configured one */
+static gint64 sync_session_timeout = 0;
+
 struct sqlx_sync_vtable_s vtable_sync_NOOP =
 {
 	_sync_clear, _sync_open, _sync_close,
 	_sync_acreate, _sync_adelete, _sync_awexists,
 	_sync_awget, _sync_awget_children, _sync_awget_siblings,
-	_sync_aremove_all_watches,
+	_sync_aremove_all_watches, _sync_connected, _sync_session_timeout,
 };
 
 static void
@@ -376,6 +421,20 @@ _sync_aremove_all_watches(struct sqlx_sync_s *ss, const char *path UNUSED,
 	return ZOK;
 }
 
+static gboolean
+_sync_connected(struct sqlx_sync_s *ss)
+{
+	EXTRA_ASSERT (ss->vtable == &vtable_sync_NOOP);
+	return TRUE;
+}
+
+static gint64
+_sync_session_timeout(struct sqlx_sync_s *ss)
+{
+	EXTRA_ASSERT (ss->vtable == &vtable_sync_NOOP);
+	return sync_session_timeout > 0 ? sync_session_timeout : sqliterepo_zk_timeout;
+}
+
 static struct sqlx_sync_s *
 _sync_factory__noop (void)
 {
@@ -521,6 +580,142 @@ test_election_init(void)
 	sqlx_sync_clear (sync);
 }
 
+static void
+test_shards(void)
+{
+	struct replication_config_s cfg = {
+		_get_id, _get_peers_none, _get_vers, NULL, ELECTION_MODE_NONE};
+	struct sqlx_sync_s *sync = _sync_factory__noop ();
+	struct sqlx_peering_s *peering = _peering_noop ();
+	struct election_manager_s *m = NULL;
+
+	g_assert_no_error(election_manager_create(&cfg, &m));
+	election_manager_add_sync(m, sync);
+	election_manager_set_peering (m, peering);
+	g_assert_cmpuint(m->shard_nb, ==, MAX(1, sqliterepo_election_shards));
+
+	for (int i=0; i<64 ;++i) {
+		struct sqlx_name_inline_s n0 = {.ns="NS", .base="", .type="type",
+				.suffix=""};
+		g_snprintf(n0.base, sizeof(n0.base), "base-%d", i);
+		NAME2CONST(n, n0);
+		g_assert_no_error(election_init(m, &n, NULL, NULL, NULL));
+	}
+
+	struct election_counts_s count = election_manager_count(m);
+	g_assert_cmpuint(count.total, ==, 64);
+
+	struct election_shard_stats_s *stats = NULL;
+	guint nb = election_manager_shard_stats(m, &stats);
+	g_assert_cmpuint(nb, ==, m->shard_nb);
+	guint total = 0, used = 0;
+	for (guint i = 0; i < nb; i++) {
+		total += stats[i].members;
+		used += stats[i].members > 0;
+		g_assert_cmpuint(stats[i].contended, <=, stats[i].locked);
+	}
+	g_assert_cmpuint(total, ==, 64);
+	if (nb > 1)
+		g_assert_cmpuint(used, >, 1);
+	g_free(stats);
+
+	election_manager_clean (m);
+	sqlx_peering__destroy (peering);
+	sqlx_sync_close (sync);
+	sqlx_sync_clear (sync);
+}
+
+static void
+test_wheel(void)
+{
+	/* Deadlines in ticks, chosen around the boundaries of the levels and
+	 * beyond the horizon of the wheel */
+	static const guint64 deadlines[] = {
+		1, 2, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 300000,
+		(1ULL << 30) + 17, (1ULL << 31) + 5, 0
+	};
+	struct election_wheel_s w;
+	_wheel_init(&w, 0);
+	g_assert_cmpint(_wheel_next(&w), ==, 0);
+
+	guint nb = 0;
+	while (deadlines[nb])
+		nb++;
+	struct election_timer_s *timers = g_malloc0(nb * sizeof(*timers));
+	for (guint i = 0; i < nb; i++)
+		_wheel_schedule(&w, timers + i, deadlines[i] * WHEEL_TICK);
+	g_assert_cmpint(_wheel_next(&w), ==, WHEEL_TICK);
+
+	/* Rescheduling an armed timer moves it */
+	_wheel_schedule(&w, timers + 0, 3 * WHEEL_TICK);
+	_wheel_schedule(&w, timers + 0, 1 * WHEEL_TICK);
+
+	guint fired = 0;
+	const guint64 end = deadlines[nb - 1] + 1;
+	while (w.now < end) {
+		struct election_timer_s *t = _wheel_step(&w, end);
+		for (; t; t = t->next) {
+			g_assert_false(t->armed);
+			g_assert_cmpuint(t->tick, ==, w.now);
+			fired ++;
+		}
+	}
+	g_assert_cmpuint(fired, ==, nb);
+	for (guint i = 0; i < WHEEL_LEVELS; i++)
+		g_assert_cmpuint(w.count[i], ==, 0);
+	g_assert_cmpint(_wheel_next(&w), ==, 0);
+
+	/* A timer in the past fires at the next tick */
+	_wheel_schedule(&w, timers, 0);
+	g_assert_cmpint(_wheel_next(&w), ==, (gint64)(end + 1) * WHEEL_TICK);
+	g_assert_true(_wheel_step(&w, end + 1) == timers);
+	g_free(timers);
+}
+
+/* The cost of a tick must depend on the number of timers due, not on the
+ * number of timers armed. Run with "-m perf". */
+static void
+test_wheel_bench(void)
+{
+	if (!g_test_perf()) {
+		g_test_skip("Benchmark only run in perf mode");
+		return;
+	}
+
+	static const guint counts[] = {1000, 10000, 100000, 1000000, 0};
+	const guint64 ticks = 60000;
+	const guint64 period = 3600 * 1000;
+
+	for (const guint *pc = counts; *pc; pc++) {
+		struct election_wheel_s w;
+		_wheel_init(&w, 0);
+		struct election_timer_s *timers = g_malloc0(*pc * sizeof(*timers));
+		for (guint i = 0; i < *pc; i++) {
+			const guint64 tick = g_random_int_range(1, period);
+			_wheel_schedule(&w, timers + i, tick * WHEEL_TICK);
+		}
+
+		guint64 fired = 0;
+		const gint64 pre = g_get_monotonic_time();
+		while (w.now < ticks) {
+			struct election_timer_s *t = _wheel_step(&w, ticks);
+			while (t) {
+				struct election_timer_s *next = t->next;
+				g_assert_cmpuint(t->tick, ==, w.now);
+				_wheel_schedule(&w, t, (w.now + period) * WHEEL_TICK);
+				fired ++;
+				t = next;
+			}
+		}
+		const gint64 elapsed = g_get_monotonic_time() - pre;
+
+		g_test_minimized_result((gdouble)elapsed * 1000.0 / ticks,
+				"%u timers, %"G_GUINT64_FORMAT" fired: %.1f ns/tick",
+				*pc, fired, (gdouble)elapsed * 1000.0 / ticks);
+		g_free(timers);
+	}
+}
+
 static void
 test_create_ok(void)
 {
@@ -1116,6 +1311,203 @@ static void test_STEP_MASTER(void) {
 	TEST_TAIL();
 }
 
+static void test_lease(void) {
+	TEST_HEAD();
+
+	const gint64 lease = _lease_duration(m->sync);
+	g_assert_cmpint(lease, >, 0);
+	g_assert_cmpint(lease, <=, sqliterepo_zk_timeout / 3);
+
+	gint64 until = 0;
+	g_assert_false(election_has_lease(manager, &name, &until));
+
+	member_set_status(m, STEP_MASTER);
+	g_assert_true(election_has_lease(manager, &name, &until));
+	g_assert_cmpint(until, ==, CLOCK + lease);
+
+	/* Renewed while the session is established */
+	CLOCK += lease + 1;
+	g_assert_true(election_has_lease(manager, &name, &until));
+	g_assert_cmpint(until, ==, CLOCK + lease);
+
+	/* Lost with the MASTER status */
+	member_set_status(m, STEP_SLAVE);
+	g_assert_false(election_has_lease(manager, &name, NULL));
+	member_set_status(m, STEP_MASTER);
+	g_assert_true(election_has_lease(manager, &name, NULL));
+
+	/* Disabled */
+	const gint64 saved = sqliterepo_election_lease;
+	sqliterepo_election_lease = 0;
+	g_assert_false(election_has_lease(manager, &name, NULL));
+	sqliterepo_election_lease = saved;
+
+	/* The server negotiated a shorter session than the configured one */
+	member_set_status(m, STEP_NONE);
+	sync_session_timeout = sqliterepo_zk_timeout / 4;
+	const gint64 short_lease = _lease_duration(m->sync);
+	g_assert_cmpint(short_lease, <, lease);
+	g_assert_cmpint(short_lease, <=, sync_session_timeout / 3);
+	member_set_status(m, STEP_MASTER);
+	g_assert_true(election_has_lease(manager, &name, &until));
+	g_assert_cmpint(until, ==, CLOCK + short_lease);
+	sync_session_timeout = 0;
+
+	member_set_status(m, STEP_NONE);
+	TEST_TAIL();
+}
+
+static void
+_locator_memory(gpointer u UNUSED, const struct sqlx_name_s *n UNUSED,
+		GString *file_name)
+{
+	g_string_assign(file_name, ":memory:");
+}
+
+static struct sqlx_repository_s *
+_repo_replicated(struct election_manager_s *manager, const gchar *type)
+{
+	struct sqlx_repo_config_s cfg = {0};
+	struct sqlx_repository_s *repo = NULL;
+	g_assert_no_error(sqlx_repository_init("/tmp", &cfg, &repo));
+	g_assert_no_error(sqlx_repository_configure_type(repo, type,
+			"CREATE TABLE IF NOT EXISTS admin (k TEXT PRIMARY KEY, v NOT NULL);"
+			"CREATE TABLE IF NOT EXISTS t (k TEXT PRIMARY KEY)"));
+	sqlx_repository_set_locator(repo, _locator_memory, NULL);
+	sqlx_repository_set_elections(repo, manager);
+	return repo;
+}
+
+/* In pipelined mode, the commit succeeds locally and the missing quorum
+ * is reported when the base is released. */
+static void test_pipelined_quorum_failure(void) {
+	TEST_HEAD();
+
+	struct sqlx_repository_s *repo = _repo_replicated(manager, name.type);
+	member_set_status(m, STEP_MASTER);
+
+	const gboolean saved = sqliterepo_repli_pipelined;
+	sqliterepo_repli_pipelined = TRUE;
+
+	void _write(const gchar *k, const gint code) {
+		struct sqlx_sqlite3_s *sq3 = NULL;
+		struct sqlx_repctx_s *repctx = NULL;
+		g_assert_no_error(sqlx_repository_open_and_lock(
+				repo, &name, SQLX_OPEN_LOCAL, &sq3, NULL));
+		g_assert_no_error(sqlx_transaction_begin(sq3, &repctx));
+		gchar *sql = g_strdup_printf("INSERT INTO t (k) VALUES ('%s')", k);
+		g_assert_cmpint(sqlx_exec(sq3->db, sql), ==, SQLITE_OK);
+		g_free(sql);
+		g_assert_no_error(sqlx_transaction_end(repctx, NULL));
+		g_assert_nonnull(sq3->repli_tickets);
+
+		GError *err = sqlx_repository_unlock_and_close(sq3);
+		if (code)
+			g_assert_error(err, GQ(), code);
+		else
+			g_assert_no_error(err);
+		g_clear_error(&err);
+	}
+
+	peering_replicate_code = 0;
+	_write("ok", 0);
+	peering_replicate_code = CODE_UNAVAILABLE;
+	_write("ko", CODE_UNAVAILABLE);
+	peering_replicate_code = 0;
+
+	sqliterepo_repli_pipelined = saved;
+	member_set_status(m, STEP_NONE);
+	sqlx_repository_clean(repo);
+	TEST_TAIL();
+}
+
+/* A change rolled back to a savepoint, e.g. by a failed writer of a
+ * meta2 commit group, must not be replicated. */
+static void test_savepoint_rollback(void) {
+	TEST_HEAD();
+
+	struct sqlx_repository_s *repo = _repo_replicated(manager, name.type);
+	member_set_status(m, STEP_MASTER);
+
+	const gboolean saved = sqliterepo_repli_pipelined;
+	sqliterepo_repli_pipelined = TRUE;
+
+	void _write(const gchar * const *statements) {
+		struct sqlx_sqlite3_s *sq3 = NULL;
+		struct sqlx_repctx_s *repctx = NULL;
+		g_assert_no_error(sqlx_repository_open_and_lock(
+				repo, &name, SQLX_OPEN_LOCAL, &sq3, NULL));
+		g_assert_no_error(sqlx_transaction_begin(sq3, &repctx));
+		for (const gchar * const *p = statements; *p; p++)
+			g_assert_cmpint(sqlx_exec(sq3->db, *p), ==, SQLITE_OK);
+		g_assert_no_error(sqlx_transaction_end(repctx, NULL));
+		g_assert_no_error(sqlx_repository_unlock_and_close(sq3));
+	}
+
+	const gchar *init[] = {
+		"INSERT INTO t (k) VALUES ('a')",
+		NULL
+	};
+	_write(init);
+
+	const gchar *group[] = {
+		/* the failed writer */
+		"SAVEPOINT w",
+		"DELETE FROM t WHERE k = 'a'",
+		"INSERT INTO t (k) VALUES ('b')",
+		"INSERT INTO t (k) VALUES ('d')",
+		"ROLLBACK TO w",
+		"RELEASE w",
+		/* the successful writer */
+		"INSERT INTO t (k) VALUES ('c')",
+		NULL
+	};
+	_write(group);
+
+	/* The rows are sent as they were committed: 'a' is kept, 'c' reuses
+	 * the ROWID of 'b', and the ROWID of 'd' is deleted. */
+	g_assert_nonnull(peering_replicated);
+	GError *err = NULL;
+	MESSAGE msg = message_unmarshall(peering_replicated->data,
+			peering_replicated->len, &err);
+	g_assert_no_error(err);
+	gsize bsize = 0;
+	void *b = metautils_message_get_BODY(msg, &bsize);
+	g_assert_nonnull(b);
+
+	asn_codec_ctx_t ctx = {.max_stack_size = ASN1C_MAX_STACK};
+	TableSequence_t *seq = NULL;
+	asn_dec_rval_t rv = ber_decode(&ctx, &asn_DEF_TableSequence,
+			(void**)&seq, b, bsize);
+	g_assert_cmpint(rv.code, ==, RC_OK);
+
+	guint upserts = 0, deletes = 0;
+	for (int i = 0; i < seq->list.count; i++) {
+		Table_t *table = seq->list.array[i];
+		if (table->name.size != 6 || memcmp(table->name.buf, "main.t", 6))
+			continue;
+		for (int j = 0; j < table->rows.list.count; j++) {
+			Row_t *row = table->rows.list.array[j];
+			if (row->fields && row->fields->list.count > 0)
+				upserts ++;
+			else
+				deletes ++;
+		}
+	}
+	g_assert_cmpuint(upserts, ==, 2);
+	g_assert_cmpuint(deletes, ==, 1);
+
+	asn_DEF_TableSequence.free_struct(&asn_DEF_TableSequence, seq, FALSE);
+	metautils_message_destroy(msg);
+	g_byte_array_unref(peering_replicated);
+	peering_replicated = NULL;
+
+	sqliterepo_repli_pipelined = saved;
+	member_set_status(m, STEP_NONE);
+	sqlx_repository_clean(repo);
+	TEST_TAIL();
+}
+
 static void test_STEP_ASKING(void) {
 	TEST_HEAD();
 
@@ -2078,6 +2470,14 @@ main(int argc, char **argv)
 	g_test_add_func("/sqlx/election/create_bad_config", test_create_bad_config);
 	g_test_add_func("/sqlx/election/create_ok", test_create_ok);
 	g_test_add_func("/sqlx/election/election_init", test_election_init);
+	g_test_add_func("/sqlx/election/shards", test_shards);
+	g_test_add_func("/sqlx/election/wheel", test_wheel);
+	g_test_add_func("/sqlx/election/wheel/bench", test_wheel_bench);
+	g_test_add_func("/sqlx/election/lease", test_lease);
+	g_test_add_func("/sqlx/election/pipelined/quorum",
+			test_pipelined_quorum_failure);
+	g_test_add_func("/sqlx/election/savepoint/rollback",
+			test_savepoint_rollback);
 	g_test_add_func("/sqlx/election/step/NONE", test_STEP_NONE);
 	g_test_add_func("/sqlx/election/step/PEERING", test_STEP_PEERING);
 	g_test_add_func("/sqlx/election/step/CREATING", test_STEP_CREATING);
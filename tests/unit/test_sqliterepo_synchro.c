@@ -0,0 +1,402 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2025 OVH SAS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <metautils/lib/metautils.h>
+
+/* The requests toward ZK are kept by the stubs below, the tests
+ * reply to them. */
+#define zoo_acreate _stub_acreate
+#define zoo_adelete _stub_adelete
+#define zoo_amulti _stub_amulti
+#define zoo_awget_children _stub_awget_children
+#include "../../sqliterepo/synchro.c"
+#undef zoo_acreate
+#undef zoo_adelete
+#undef zoo_amulti
+#undef zoo_awget_children
+
+#define MULTI_OP 0
+#define LISTING_OP -1
+
+struct zk_call_s
+{
+	int type;  /* ZOO_CREATE_OP, ZOO_DELETE_OP, MULTI_OP or LISTING_OP */
+	int count;
+	zoo_op_result_t *results;
+	string_completion_t created;
+	void_completion_t done;
+	strings_completion_t listed;
+	const void *data;
+};
+
+/* <struct zk_call_s*> sent and not replied yet */
+static GQueue calls = G_QUEUE_INIT;
+
+/* What the stubs return, anything but ZOK fails the request at once */
+static int stub_rc = ZOK;
+
+static int
+_stub_call(struct zk_call_s *call)
+{
+	if (stub_rc != ZOK) {
+		g_free(call);
+		return stub_rc;
+	}
+	g_queue_push_tail(&calls, call);
+	return ZOK;
+}
+
+int
+_stub_acreate(zhandle_t *zh UNUSED, const char *path UNUSED,
+		const char *value UNUSED, int valuelen UNUSED,
+		const struct ACL_vector *acl UNUSED, int mode UNUSED,
+		string_completion_t completion, const void *data)
+{
+	struct zk_call_s *call = g_malloc0(sizeof(*call));
+	call->type = ZOO_CREATE_OP;
+	call->count = 1;
+	call->created = completion;
+	call->data = data;
+	return _stub_call(call);
+}
+
+int
+_stub_adelete(zhandle_t *zh UNUSED, const char *path UNUSED,
+		int version UNUSED, void_completion_t completion, const void *data)
+{
+	struct zk_call_s *call = g_malloc0(sizeof(*call));
+	call->type = ZOO_DELETE_OP;
+	call->count = 1;
+	call->done = completion;
+	call->data = data;
+	return _stub_call(call);
+}
+
+int
+_stub_amulti(zhandle_t *zh UNUSED, int count, const zoo_op_t *ops UNUSED,
+		zoo_op_result_t *results, void_completion_t completion,
+		const void *data)
+{
+	struct zk_call_s *call = g_malloc0(sizeof(*call));
+	call->type = MULTI_OP;
+	call->count = count;
+	call->results = results;
+	call->done = completion;
+	call->data = data;
+	return _stub_call(call);
+}
+
+int
+_stub_awget_children(zhandle_t *zh UNUSED, const char *path UNUSED,
+		watcher_fn watcher UNUSED, void *watcherCtx UNUSED,
+		strings_completion_t completion, const void *data)
+{
+	struct zk_call_s *call = g_malloc0(sizeof(*call));
+	call->type = LISTING_OP;
+	call->count = 1;
+	call->listed = completion;
+	call->data = data;
+	return _stub_call(call);
+}
+
+static struct zk_call_s *
+_pop(int type, int count)
+{
+	struct zk_call_s *call = g_queue_pop_head(&calls);
+	g_assert_nonnull(call);
+	g_assert_cmpint(call->type, ==, type);
+	g_assert_cmpint(call->count, ==, count);
+	return call;
+}
+
+/* Reply to a single operation or a listing */
+static void
+_reply(struct zk_call_s *call, int rc)
+{
+	struct String_vector sv = {0, NULL};
+	switch (call->type) {
+		case ZOO_CREATE_OP:
+			call->created(rc, rc == ZOK ? "/created" : NULL, call->data);
+			break;
+		case LISTING_OP:
+			call->listed(rc, rc == ZOK ? &sv : NULL, call->data);
+			break;
+		default:
+			call->done(rc, call->data);
+	}
+	g_free(call);
+}
+
+/* Reply to a multi-op, <errs> are the results of its operations. Without
+ * them, the request failed as a whole (or succeeded). */
+static void
+_reply_multi(struct zk_call_s *call, int rc, const int *errs)
+{
+	for (int i = 0; i < call->count; i++)
+		call->results[i].err = errs ? errs[i] : ZOK;
+	call->done(rc, call->data);
+	g_free(call);
+}
+
+struct zk_reply_s
+{
+	guint count;
+	int rc;
+};
+
+static void
+_on_created(int rc, const char *value, const void *data)
+{
+	struct zk_reply_s *r = (struct zk_reply_s *) data;
+	g_assert_true((rc == ZOK) == (value != NULL));
+	r->count ++;
+	r->rc = rc;
+}
+
+static void
+_on_deleted(int rc, const void *data)
+{
+	struct zk_reply_s *r = (struct zk_reply_s *) data;
+	r->count ++;
+	r->rc = rc;
+}
+
+static void
+_on_listed(int rc, const struct String_vector *sv, const void *data)
+{
+	struct zk_reply_s *r = (struct zk_reply_s *) data;
+	g_assert_true((rc == ZOK) == (sv != NULL));
+	r->count ++;
+	r->rc = rc;
+}
+
+static int
+_create(struct sqlx_sync_s *ss, const char *path, struct zk_reply_s *r)
+{
+	return _acreate(ss, path, "", 0, ZOO_EPHEMERAL|ZOO_SEQUENCE,
+			_on_created, r);
+}
+
+static int
+_delete(struct sqlx_sync_s *ss, const char *path, struct zk_reply_s *r)
+{
+	return _adelete(ss, path, -1, _on_deleted, r);
+}
+
+static void
+_check_reply(struct zk_reply_s *r, guint count, int rc)
+{
+	g_assert_cmpuint(r->count, ==, count);
+	if (count)
+		g_assert_cmpint(r->rc, ==, rc);
+}
+
+static struct sqlx_sync_s *
+_sync(guint max_ops)
+{
+	sqliterepo_zk_multi_max_ops = max_ops;
+	struct sqlx_sync_s *ss = sqlx_sync_create("127.0.0.1:2181");
+	g_assert_nonnull(ss);
+	sqlx_sync_set_prefix(ss, "/el");
+	/* Never dereferenced, the stubs only check it is set */
+	ss->zh = (zhandle_t *) ss;
+	return ss;
+}
+
+static void
+_sync_clear(struct sqlx_sync_s *ss)
+{
+	g_assert_true(g_queue_is_empty(&calls));
+	g_assert_cmpuint(ss->batch_inflight, ==, 0);
+	g_assert_cmpuint(ss->batch->len, ==, 0);
+	g_assert_cmpuint(g_hash_table_size(ss->listings), ==, 0);
+	ss->zh = NULL;
+	sqlx_sync_clear(ss);
+}
+
+static void
+test_batch_flush_on_size(void)
+{
+	struct sqlx_sync_s *ss = _sync(3);
+	struct zk_reply_s r[5] = {{0}};
+
+	/* Nothing pending, the first operation is sent alone */
+	g_assert_cmpint(ZOK, ==, _create(ss, "a", r + 0));
+	struct zk_call_s *first = _pop(ZOO_CREATE_OP, 1);
+
+	/* The next ones wait for the batch to be full */
+	g_assert_cmpint(ZOK, ==, _create(ss, "b", r + 1));
+	g_assert_cmpint(ZOK, ==, _delete(ss, "c", r + 2));
+	g_assert_true(g_queue_is_empty(&calls));
+	g_assert_cmpint(ZOK, ==, _create(ss, "d", r + 3));
+	struct zk_call_s *multi = _pop(MULTI_OP, 3);
+
+	/* Both requests must complete before the next one is sent */
+	g_assert_cmpint(ZOK, ==, _create(ss, "e", r + 4));
+	_reply(first, ZOK);
+	_check_reply(r + 0, 1, ZOK);
+	g_assert_true(g_queue_is_empty(&calls));
+	_reply_multi(multi, ZOK, NULL);
+	for (guint i = 1; i < 4; i++)
+		_check_reply(r + i, 1, ZOK);
+	_check_reply(r + 4, 0, ZOK);
+
+	/* The batch of a single operation is sent alone */
+	_reply(_pop(ZOO_CREATE_OP, 1), ZOK);
+	_check_reply(r + 4, 1, ZOK);
+
+	_sync_clear(ss);
+}
+
+static void
+test_batch_flush_on_completion(void)
+{
+	struct sqlx_sync_s *ss = _sync(16);
+	struct zk_reply_s r[4] = {{0}};
+
+	/* A request that fails at once is not queued, and not notified */
+	stub_rc = ZCONNECTIONLOSS;
+	g_assert_cmpint(ZCONNECTIONLOSS, ==, _create(ss, "a", r + 0));
+	stub_rc = ZOK;
+	_check_reply(r + 0, 0, ZOK);
+	g_assert_cmpuint(ss->batch_inflight, ==, 0);
+
+	g_assert_cmpint(ZOK, ==, _create(ss, "a", r + 0));
+	struct zk_call_s *first = _pop(ZOO_CREATE_OP, 1);
+	g_assert_cmpint(ZOK, ==, _create(ss, "b", r + 1));
+	g_assert_cmpint(ZOK, ==, _delete(ss, "c", r + 2));
+	g_assert_true(g_queue_is_empty(&calls));
+
+	/* The pending request times out: the batch is flushed anyway */
+	_reply(first, ZOPERATIONTIMEOUT);
+	_check_reply(r + 0, 1, ZOPERATIONTIMEOUT);
+	struct zk_call_s *multi = _pop(MULTI_OP, 2);
+	_check_reply(r + 1, 0, ZOK);
+
+	/* ... and the batch that cannot be sent is failed */
+	g_assert_cmpint(ZOK, ==, _create(ss, "d", r + 3));
+	stub_rc = ZCONNECTIONLOSS;
+	_reply_multi(multi, ZOK, NULL);
+	stub_rc = ZOK;
+	_check_reply(r + 1, 1, ZOK);
+	_check_reply(r + 2, 1, ZOK);
+	_check_reply(r + 3, 1, ZCONNECTIONLOSS);
+
+	_sync_clear(ss);
+}
+
+static void
+test_batch_partial_failure(void)
+{
+	struct sqlx_sync_s *ss = _sync(16);
+	struct zk_reply_s r[4] = {{0}};
+
+	g_assert_cmpint(ZOK, ==, _create(ss, "a", r + 0));
+	struct zk_call_s *first = _pop(ZOO_CREATE_OP, 1);
+	for (guint i = 1; i < 4; i++)
+		g_assert_cmpint(ZOK, ==, _create(ss, "x", r + i));
+	_reply(first, ZOK);
+
+	/* Only the culprit fails, the others are sent again one by one */
+	const int errs[3] = {ZRUNTIMEINCONSISTENCY, ZNODEEXISTS, ZRUNTIMEINCONSISTENCY};
+	_reply_multi(_pop(MULTI_OP, 3), ZNODEEXISTS, errs);
+	_check_reply(r + 2, 1, ZNODEEXISTS);
+	_check_reply(r + 1, 0, ZOK);
+	_check_reply(r + 3, 0, ZOK);
+	struct zk_call_s *retry0 = _pop(ZOO_CREATE_OP, 1);
+	struct zk_call_s *retry1 = _pop(ZOO_CREATE_OP, 1);
+	g_assert_true(((struct zk_op_s *) retry0->data)->data == r + 1);
+	g_assert_true(((struct zk_op_s *) retry1->data)->data == r + 3);
+
+	/* The new operations wait for the retries */
+	struct zk_reply_s more[2] = {{0}};
+	g_assert_cmpint(ZOK, ==, _delete(ss, "y", more + 0));
+	g_assert_cmpint(ZOK, ==, _delete(ss, "z", more + 1));
+	_reply(retry0, ZOK);
+	g_assert_true(g_queue_is_empty(&calls));
+	_reply(retry1, ZNONODE);
+	_check_reply(r + 1, 1, ZOK);
+	_check_reply(r + 3, 1, ZNONODE);
+
+	/* Without a culprit, the whole request failed */
+	_reply_multi(_pop(MULTI_OP, 2), ZCONNECTIONLOSS, NULL);
+	_check_reply(more + 0, 1, ZCONNECTIONLOSS);
+	_check_reply(more + 1, 1, ZCONNECTIONLOSS);
+
+	_sync_clear(ss);
+}
+
+static void
+test_listing_merge(void)
+{
+	struct sqlx_sync_s *ss = _sync(16);
+	struct zk_reply_s r[4] = {{0}};
+
+	/* The requests arrived during a listing share the next one */
+	g_assert_cmpint(ZOK, ==, _listing_push(ss, "/el/a", _on_listed, r + 0));
+	struct zk_call_s *first = _pop(LISTING_OP, 1);
+	g_assert_cmpint(ZOK, ==, _listing_push(ss, "/el/a", _on_listed, r + 1));
+	g_assert_cmpint(ZOK, ==, _listing_push(ss, "/el/a", _on_listed, r + 2));
+	g_assert_true(g_queue_is_empty(&calls));
+
+	/* Another node is listed on its own */
+	struct zk_reply_s other = {0};
+	g_assert_cmpint(ZOK, ==, _listing_push(ss, "/el/b", _on_listed, &other));
+	_reply(_pop(LISTING_OP, 1), ZOK);
+	_check_reply(&other, 1, ZOK);
+
+	_reply(first, ZOK);
+	_check_reply(r + 0, 1, ZOK);
+	_check_reply(r + 1, 0, ZOK);
+	struct zk_call_s *second = _pop(LISTING_OP, 1);
+	g_assert_cmpint(ZOK, ==, _listing_push(ss, "/el/a", _on_listed, r + 3));
+
+	/* The failure of the next listing reaches all its waiters, and the
+	 * last queued request is sent alone */
+	_reply(second, ZCONNECTIONLOSS);
+	_check_reply(r + 1, 1, ZCONNECTIONLOSS);
+	_check_reply(r + 2, 1, ZCONNECTIONLOSS);
+	_check_reply(r + 3, 0, ZOK);
+	_reply(_pop(LISTING_OP, 1), ZOK);
+	_check_reply(r + 3, 1, ZOK);
+
+	/* A listing that cannot be sent is not notified */
+	struct zk_reply_s failed = {0};
+	stub_rc = ZINVALIDSTATE;
+	g_assert_cmpint(ZINVALIDSTATE, ==,
+			_listing_push(ss, "/el/a", _on_listed, &failed));
+	stub_rc = ZOK;
+	_check_reply(&failed, 0, ZOK);
+
+	_sync_clear(ss);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/sqliterepo/synchro/batch/size",
+			test_batch_flush_on_size);
+	g_test_add_func("/sqliterepo/synchro/batch/completion",
+			test_batch_flush_on_completion);
+	g_test_add_func("/sqliterepo/synchro/batch/partial_failure",
+			test_batch_partial_failure);
+	g_test_add_func("/sqliterepo/synchro/listing/merge",
+			test_listing_merge);
+	return g_test_run();
+}
@@ -52,6 +52,35 @@ test_via_message(void)
 	metautils_message_destroy(msg);
 }
 
+static void
+test_message_header(void)
+{
+	static const gsize sizes[] = {1, 127, 128, 255, 256, 65536, 1024*1024, 0};
+	for (const gsize *psize = sizes; *psize; psize++) {
+		MESSAGE msg = metautils_message_create_named("plop", 0);
+		metautils_message_add_field_str(msg, "key", "value");
+
+		GByteArray *hdr = message_marshall_gba_header(msg, *psize, NULL);
+		g_assert_nonnull(hdr);
+
+		GByteArray *body = g_byte_array_sized_new(*psize);
+		g_byte_array_set_size(body, *psize);
+		memset(body->data, 'x', body->len);
+		g_byte_array_append(hdr, body->data, body->len);
+
+		/* Must be the same as the message with its body */
+		metautils_message_add_body_unref(msg, body);
+		GByteArray *full = message_marshall_gba(msg, NULL);
+		g_assert_nonnull(full);
+		g_assert_cmpuint(hdr->len, ==, full->len);
+		g_assert_cmpint(0, ==, memcmp(hdr->data, full->data, full->len));
+
+		g_byte_array_free(full, TRUE);
+		g_byte_array_free(hdr, TRUE);
+		metautils_message_destroy(msg);
+	}
+}
+
 /* ------------------------------------------------------------------------- */
 
 static void
@@ -248,6 +277,7 @@ main(int argc, char **argv)
 
 	g_test_add_func("/metautils/str/gba", test_via_gba);
 	g_test_add_func("/metautils/str/message", test_via_message);
+	g_test_add_func("/metautils/str/message_header", test_message_header);
 	g_test_add_func("/metautils/str/clean", test_clean);
 	g_test_add_func("/metautils/str/upper", test_upper);
 	g_test_add_func("/metautils/str/lower", test_lower);
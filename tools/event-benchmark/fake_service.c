@@ -132,14 +132,12 @@ _reply_not_found(struct http_reply_ctx_s *rp, GError *err)
 
 // Match route
 
-static struct path_matching_s **
-_fake_service_match(const gchar *method, const gchar *path)
+/* Builds the matching key from the request in <key>, that must be able to
+ * hold strlen(path) + 2 + strlen(method) + 1 bytes. */
+static guint
+_fake_service_match(const gchar *method, const gchar *path, gchar *key,
+		struct path_matching_s *tab, guint max)
 {
-	gsize lp = strlen(path), lm = strlen(method);
-	if (lp > PATH_MAXLEN || lm > METHOD_MAXLEN)
-		return g_malloc0(sizeof(struct path_matching_s*));
-
-	gchar *key = g_alloca(lp + 2 + lm + 1);
 	gchar *pk = key;
 
 	// Copy and purify the path
@@ -164,15 +162,7 @@ _fake_service_match(const gchar *method, const gchar *path)
 	}
 	*pk = '\0';
 
-	gchar **tokens = g_strsplit(key, "/", -1);
-	for (gchar **p=tokens; *p ;++p) {
-		gchar *unescaped = g_uri_unescape_string(*p,NULL);
-		oio_str_reuse(p, unescaped);
-	}
-	struct path_matching_s **result = path_parser_match(path_parser, tokens);
-	g_strfreev(tokens);
-
-	return result;
+	return path_parser_match(path_parser, key, tab, max);
 }
 
 // Handler action
@@ -201,11 +191,17 @@ handler_action(struct http_request_s *request, struct http_reply_ctx_s *reply)
 	struct oio_requri_s ruri = {NULL, NULL, NULL, NULL};
 	oio_requri_parse(request->req_uri, &ruri);
 
-	struct path_matching_s **matchings = _fake_service_match(request->cmd,
-			ruri.path);
+	struct path_matching_s matchings[PATH_MATCHING_MAX];
+	guint matched = 0;
+	const gsize lp = strlen(ruri.path), lm = strlen(request->cmd);
+	if (lp <= PATH_MAXLEN && lm <= METHOD_MAXLEN) {
+		gchar *key = g_alloca(lp + 2 + lm + 1);
+		matched = _fake_service_match(request->cmd, ruri.path, key,
+				matchings, PATH_MATCHING_MAX);
+	}
 
 	enum http_rc_e rc;
-	if (!*matchings) {
+	if (!matched) {
 		rc = _reply_not_found(reply, BADREQ("Route not managed"));
 	} else {
 		struct req_args_s args = {0};
@@ -213,11 +209,10 @@ handler_action(struct http_request_s *request, struct http_reply_ctx_s *reply)
 		args.rq = request;
 		args.rp = reply;
 
-		req_handler_f handler = (*matchings)->last->u;
+		req_handler_f handler = matchings->last->u;
 		rc = (*handler) (&args);
 	}
 
-	path_matching_cleanv(matchings);
 	oio_requri_clear(&ruri);
 	oio_ext_set_reqid(NULL);
 
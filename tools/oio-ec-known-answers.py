@@ -0,0 +1,69 @@
+#!/usr/bin/env python
+# Copyright (C) 2025 OVH SAS
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""
+Print the known_answers fixtures of tests/unit/test_ec.c, encoded by
+liberasurecode through pyeclib. The codec of core/ec.c writes the headers
+of liberasurecode 1.6.2, so the fixtures must come from that version.
+"""
+
+import struct
+import sys
+
+from pyeclib.ec_iface import ECDriver
+
+SEGMENT = b"liberasurecode/isa-l"
+ALGOS = ("liberasurecode_rs_vand", "isa_l_rs_vand", "isa_l_rs_cauchy")
+K, M = 3, 2
+HEADER_SIZE = 80
+# Offset of the version of liberasurecode in the header of a fragment
+VERSION_OFFSET = 63
+EXPECTED_VERSION = (1, 6, 2)
+LINE = 80
+
+
+def _version(frag):
+    (ver,) = struct.unpack_from("<I", frag, VERSION_OFFSET)
+    return (ver >> 16) & 0xFF, (ver >> 8) & 0xFF, ver & 0xFF
+
+
+def _print_frag(frag, last):
+    hexa = frag.hex().upper()
+    head, body = hexa[: 2 * HEADER_SIZE], hexa[2 * HEADER_SIZE :]
+    for i in range(0, len(head), LINE):
+        print('\t\t"%s"' % head[i : i + LINE])
+    print('\t\t"%s"%s' % (body, "" if last else ","))
+
+
+def main():
+    for algo in ALGOS:
+        driver = ECDriver(k=K, m=M, ec_type=algo, chksum_type="none")
+        frags = driver.encode(SEGMENT)
+        version = _version(frags[0])
+        if version != EXPECTED_VERSION:
+            sys.stderr.write(
+                "liberasurecode %d.%d.%d found, %d.%d.%d expected\n"
+                % (version + EXPECTED_VERSION)
+            )
+            return 1
+        print('\t{"ec/k=%d,m=%d,algo=%s", {' % (K, M, algo))
+        for i, frag in enumerate(frags):
+            _print_frag(frag, i == len(frags) - 1)
+        print("\t}},")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())